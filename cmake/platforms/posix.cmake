@@ -1 +1,6 @@
-add_definitions(-DPLATFORM_POSIX=1)
\ No newline at end of file
+add_definitions(-DPLATFORM_POSIX=1)
+
+# shm_open() used by HsmSharedEventRing is provided by librt on older glibc versions
+if (CMAKE_SYSTEM_NAME STREQUAL "Linux")
+    target_link_libraries(${HSM_LIBRARY_NAME} PUBLIC rt)
+endif()
@@ -0,0 +1,343 @@
+// Copyright (C) 2024 Igor Krechetov
+// Distributed under MIT license. See file LICENSE for details
+
+#ifndef HSMCPP_FLATMAP_HPP
+#define HSMCPP_FLATMAP_HPP
+
+#include <algorithm>
+#include <functional>
+#include <initializer_list>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace hsmcpp {
+
+/**
+ * @brief Associative container which keeps its items in a sorted std::vector.
+ * @details FlatMap provides a subset of std::map interface. Lookup is a binary search over contiguous memory and the
+ * whole container uses a single allocation, which makes it much faster than std::map for small and medium sized maps
+ * which are rarely modified (like event arguments).
+ *
+ * Differences from std::map:
+ *  \li inserting or erasing items invalidates all iterators
+ *  \li insertion has linear complexity (except for appending keys in ascending order)
+ *  \li keys are accessible through non-const iterators. Modifying them breaks the order of the container
+ *
+ * @tparam K key type
+ * @tparam V value type
+ * @tparam Compare functor used to order keys
+ */
+template <typename K, typename V, typename Compare = std::less<K>>
+class FlatMap {
+public:
+    using key_type = K;
+    using mapped_type = V;
+    using value_type = std::pair<K, V>;
+    using key_compare = Compare;
+    using container_type = std::vector<value_type>;
+    using size_type = typename container_type::size_type;
+    using iterator = typename container_type::iterator;
+    using const_iterator = typename container_type::const_iterator;
+
+public:
+    FlatMap() = default;
+
+    /**
+     * @brief Constructs container from the list of items. Items with duplicate keys are ignored.
+     */
+    FlatMap(std::initializer_list<value_type> items);
+
+    /**
+     * @brief Constructs container from a range of items. Items with duplicate keys are ignored.
+     */
+    template <typename InputIt>
+    FlatMap(InputIt first, InputIt last);
+
+    iterator begin();
+    const_iterator begin() const;
+    const_iterator cbegin() const;
+    iterator end();
+    const_iterator end() const;
+    const_iterator cend() const;
+
+    bool empty() const;
+    size_type size() const;
+    void clear();
+
+    /**
+     * @brief Reserve memory for the specified number of items.
+     */
+    void reserve(const size_type count);
+
+    iterator find(const K& key);
+    const_iterator find(const K& key) const;
+    size_type count(const K& key) const;
+
+    iterator lower_bound(const K& key);
+    const_iterator lower_bound(const K& key) const;
+
+    /**
+     * @brief Access value by key.
+     * @throws std::out_of_range if key doesn't exist
+     */
+    V& at(const K& key);
+    /** @copydoc at() */
+    const V& at(const K& key) const;
+
+    /**
+     * @brief Access value by key. Inserts a default constructed value if key doesn't exist.
+     */
+    V& operator[](const K& key);
+
+    /**
+     * @brief Insert item into the container.
+     * @return iterator to the item with the same key and true if item was inserted
+     */
+    std::pair<iterator, bool> insert(value_type&& item);
+    /** @copydoc insert() */
+    std::pair<iterator, bool> insert(const value_type& item);
+
+    /**
+     * @brief Construct item from key and value arguments and insert it into the container.
+     * @copydetails insert()
+     */
+    template <typename KArg, typename VArg>
+    std::pair<iterator, bool> emplace(KArg&& key, VArg&& value);
+
+    /**
+     * @brief Remove item with the specified key.
+     * @return number of removed items
+     */
+    size_type erase(const K& key);
+
+    /**
+     * @brief Remove item pointed by iterator.
+     * @return iterator following the removed item
+     */
+    iterator erase(const_iterator pos);
+
+    bool operator==(const FlatMap& other) const;
+    bool operator!=(const FlatMap& other) const;
+    bool operator<(const FlatMap& other) const;
+    bool operator>(const FlatMap& other) const;
+
+private:
+    struct ItemKeyCompare {
+        Compare compare;
+
+        bool operator()(const value_type& item, const K& key) const {
+            return compare(item.first, key);
+        }
+    };
+
+    bool isSameKey(const_iterator it, const K& key) const;
+
+private:
+    container_type mItems;
+    Compare mCompare;
+};
+
+template <typename K, typename V, typename Compare>
+FlatMap<K, V, Compare>::FlatMap(std::initializer_list<value_type> items)
+    // cppcheck-suppress misra-c2012-10.4 : false-positive. thinks that ':' is arithmetic operation
+    : FlatMap(items.begin(), items.end()) {}
+
+template <typename K, typename V, typename Compare>
+template <typename InputIt>
+FlatMap<K, V, Compare>::FlatMap(InputIt first, InputIt last) {
+    for (; first != last; ++first) {
+        (void)insert(*first);
+    }
+}
+
+template <typename K, typename V, typename Compare>
+typename FlatMap<K, V, Compare>::iterator FlatMap<K, V, Compare>::begin() {
+    return mItems.begin();
+}
+
+template <typename K, typename V, typename Compare>
+typename FlatMap<K, V, Compare>::const_iterator FlatMap<K, V, Compare>::begin() const {
+    return mItems.begin();
+}
+
+template <typename K, typename V, typename Compare>
+typename FlatMap<K, V, Compare>::const_iterator FlatMap<K, V, Compare>::cbegin() const {
+    return mItems.cbegin();
+}
+
+template <typename K, typename V, typename Compare>
+typename FlatMap<K, V, Compare>::iterator FlatMap<K, V, Compare>::end() {
+    return mItems.end();
+}
+
+template <typename K, typename V, typename Compare>
+typename FlatMap<K, V, Compare>::const_iterator FlatMap<K, V, Compare>::end() const {
+    return mItems.end();
+}
+
+template <typename K, typename V, typename Compare>
+typename FlatMap<K, V, Compare>::const_iterator FlatMap<K, V, Compare>::cend() const {
+    return mItems.cend();
+}
+
+template <typename K, typename V, typename Compare>
+bool FlatMap<K, V, Compare>::empty() const {
+    return mItems.empty();
+}
+
+template <typename K, typename V, typename Compare>
+typename FlatMap<K, V, Compare>::size_type FlatMap<K, V, Compare>::size() const {
+    return mItems.size();
+}
+
+template <typename K, typename V, typename Compare>
+void FlatMap<K, V, Compare>::clear() {
+    mItems.clear();
+}
+
+template <typename K, typename V, typename Compare>
+void FlatMap<K, V, Compare>::reserve(const size_type count) {
+    mItems.reserve(count);
+}
+
+template <typename K, typename V, typename Compare>
+typename FlatMap<K, V, Compare>::iterator FlatMap<K, V, Compare>::find(const K& key) {
+    iterator it = lower_bound(key);
+
+    return ((true == isSameKey(it, key)) ? it : mItems.end());
+}
+
+template <typename K, typename V, typename Compare>
+typename FlatMap<K, V, Compare>::const_iterator FlatMap<K, V, Compare>::find(const K& key) const {
+    const_iterator it = lower_bound(key);
+
+    return ((true == isSameKey(it, key)) ? it : mItems.end());
+}
+
+template <typename K, typename V, typename Compare>
+typename FlatMap<K, V, Compare>::size_type FlatMap<K, V, Compare>::count(const K& key) const {
+    return ((find(key) != mItems.end()) ? 1U : 0U);
+}
+
+template <typename K, typename V, typename Compare>
+typename FlatMap<K, V, Compare>::iterator FlatMap<K, V, Compare>::lower_bound(const K& key) {
+    return std::lower_bound(mItems.begin(), mItems.end(), key, ItemKeyCompare{mCompare});
+}
+
+template <typename K, typename V, typename Compare>
+typename FlatMap<K, V, Compare>::const_iterator FlatMap<K, V, Compare>::lower_bound(const K& key) const {
+    return std::lower_bound(mItems.begin(), mItems.end(), key, ItemKeyCompare{mCompare});
+}
+
+template <typename K, typename V, typename Compare>
+V& FlatMap<K, V, Compare>::at(const K& key) {
+    iterator it = find(key);
+
+    if (mItems.end() == it) {
+        throw std::out_of_range("FlatMap::at");
+    }
+
+    return it->second;
+}
+
+template <typename K, typename V, typename Compare>
+const V& FlatMap<K, V, Compare>::at(const K& key) const {
+    const_iterator it = find(key);
+
+    if (mItems.end() == it) {
+        throw std::out_of_range("FlatMap::at");
+    }
+
+    return it->second;
+}
+
+template <typename K, typename V, typename Compare>
+V& FlatMap<K, V, Compare>::operator[](const K& key) {
+    iterator it = lower_bound(key);
+
+    if (false == isSameKey(it, key)) {
+        it = mItems.emplace(it, key, V());
+    }
+
+    return it->second;
+}
+
+template <typename K, typename V, typename Compare>
+std::pair<typename FlatMap<K, V, Compare>::iterator, bool> FlatMap<K, V, Compare>::insert(value_type&& item) {
+    std::pair<iterator, bool> result(mItems.end(), false);
+
+    // NOTE: fast path for items which are added in ascending order (for example, when copying another map)
+    if ((true == mItems.empty()) || (true == mCompare(mItems.back().first, item.first))) {
+        mItems.push_back(std::move(item));
+        result.first = mItems.end() - 1;
+        result.second = true;
+    } else {
+        result.first = lower_bound(item.first);
+
+        if (false == isSameKey(result.first, item.first)) {
+            result.first = mItems.insert(result.first, std::move(item));
+            result.second = true;
+        }
+    }
+
+    return result;
+}
+
+template <typename K, typename V, typename Compare>
+std::pair<typename FlatMap<K, V, Compare>::iterator, bool> FlatMap<K, V, Compare>::insert(const value_type& item) {
+    return insert(value_type(item));
+}
+
+template <typename K, typename V, typename Compare>
+template <typename KArg, typename VArg>
+std::pair<typename FlatMap<K, V, Compare>::iterator, bool> FlatMap<K, V, Compare>::emplace(KArg&& key, VArg&& value) {
+    return insert(value_type(K(std::forward<KArg>(key)), V(std::forward<VArg>(value))));
+}
+
+template <typename K, typename V, typename Compare>
+typename FlatMap<K, V, Compare>::size_type FlatMap<K, V, Compare>::erase(const K& key) {
+    size_type erasedCount = 0;
+    const_iterator it = find(key);
+
+    if (mItems.end() != it) {
+        (void)erase(it);
+        erasedCount = 1U;
+    }
+
+    return erasedCount;
+}
+
+template <typename K, typename V, typename Compare>
+typename FlatMap<K, V, Compare>::iterator FlatMap<K, V, Compare>::erase(const_iterator pos) {
+    return mItems.erase(pos);
+}
+
+template <typename K, typename V, typename Compare>
+bool FlatMap<K, V, Compare>::operator==(const FlatMap& other) const {
+    return (mItems == other.mItems);
+}
+
+template <typename K, typename V, typename Compare>
+bool FlatMap<K, V, Compare>::operator!=(const FlatMap& other) const {
+    return (mItems != other.mItems);
+}
+
+template <typename K, typename V, typename Compare>
+bool FlatMap<K, V, Compare>::operator<(const FlatMap& other) const {
+    return (mItems < other.mItems);
+}
+
+template <typename K, typename V, typename Compare>
+bool FlatMap<K, V, Compare>::operator>(const FlatMap& other) const {
+    return (other.mItems < mItems);
+}
+
+template <typename K, typename V, typename Compare>
+bool FlatMap<K, V, Compare>::isSameKey(const_iterator it, const K& key) const {
+    return (mItems.end() != it) && (false == mCompare(key, it->first));
+}
+
+}  // namespace hsmcpp
+
+#endif  // HSMCPP_FLATMAP_HPP
@@ -0,0 +1,217 @@
+// Copyright (C) 2024 Igor Krechetov
+// Distributed under MIT license. See file LICENSE for details
+
+#ifndef HSMCPP_HSMCOROUTINES_HPP
+#define HSMCPP_HSMCOROUTINES_HPP
+
+#if (__cplusplus >= 202002L) && defined(__has_include)
+  #if __has_include(<coroutine>)
+    #define HSM_COROUTINES_AVAILABLE (1)
+  #endif
+#endif
+
+#ifdef HSM_COROUTINES_AVAILABLE
+
+#include <atomic>
+#include <coroutine>
+#include <utility>
+
+#include "hsm.hpp"
+
+namespace hsmcpp {
+
+namespace detail {
+
+// resumes coroutine using executor (if it's set). executor is passed by value since awaitable object could be destroyed
+// while executor is still running
+inline void resumeCoroutine(std::coroutine_handle<> handle, HsmCompletionExecutor_t executor) {
+    if (executor) {
+        executor([handle]() { handle.resume(); });
+    } else {
+        handle.resume();
+    }
+}
+
+// returns value for await_suspend(). must be called at the end of await_suspend() after HSM operation was started
+inline bool finishSuspend(std::atomic<bool>& completed,
+                          std::coroutine_handle<> handle,
+                          const HsmCompletionExecutor_t& executor) {
+    bool suspended = true;
+
+    // NOTE: if operation is already completed coroutine must be resumed here
+    if (true == completed.exchange(true)) {
+        if (executor) {
+            resumeCoroutine(handle, executor);
+        } else {
+            suspended = false;
+        }
+    }
+
+    return suspended;
+}
+
+}  // namespace detail
+
+/**
+ * @brief Awaitable returned by transitionAwait().
+ * @details Suspends the coroutine until HSM processes the event. Resumption is driven by the HSM dispatcher (no additional
+ * threads are used). co_await expression returns TransitionResult.
+ */
+class TransitionAwaitable {
+public:
+    TransitionAwaitable(HierarchicalStateMachine& hsm,
+                        const EventID_t event,
+                        VariantVector_t&& args,
+                        HsmCompletionExecutor_t executor)
+        : mHsm(hsm)
+        , mEvent(event)
+        , mArgs(std::move(args))
+        , mExecutor(std::move(executor)) {}
+
+    TransitionAwaitable(const TransitionAwaitable&) = delete;
+    TransitionAwaitable& operator=(const TransitionAwaitable&) = delete;
+
+    bool await_ready() const noexcept {
+        return false;
+    }
+
+    bool await_suspend(std::coroutine_handle<> handle) {
+        // NOTE: callback is always called exactly once (possibly before transitionAsyncWithArgsArray() returns)
+        (void)mHsm.transitionAsyncWithArgsArray(
+            mEvent,
+            [this, handle](const EventID_t, const TransitionResult result) {
+                mResult = result;
+
+                // coroutine can be resumed only after await_suspend() finished
+                if (true == mCompleted.exchange(true)) {
+                    detail::resumeCoroutine(handle, mExecutor);
+                }
+            },
+            std::move(mArgs));
+
+        return detail::finishSuspend(mCompleted, handle, mExecutor);
+    }
+
+    TransitionResult await_resume() const noexcept {
+        return mResult;
+    }
+
+private:
+    HierarchicalStateMachine& mHsm;
+    EventID_t mEvent;
+    VariantVector_t mArgs;
+    HsmCompletionExecutor_t mExecutor;
+    TransitionResult mResult = TransitionResult::CANCELED;
+    std::atomic<bool> mCompleted{false};
+};
+
+/**
+ * @brief Awaitable returned by waitForStateAwait().
+ * @details Suspends the coroutine until HSM activates the state or timeout expires. Resumption is driven by the HSM
+ * dispatcher (no additional threads are used). co_await expression returns true if state is active.
+ */
+class StateAwaitable {
+public:
+    StateAwaitable(HierarchicalStateMachine& hsm,
+                   const StateID_t state,
+                   const int timeoutMs,
+                   HsmCompletionExecutor_t executor)
+        : mHsm(hsm)
+        , mState(state)
+        , mTimeoutMs(timeoutMs)
+        , mExecutor(std::move(executor)) {}
+
+    StateAwaitable(const StateAwaitable&) = delete;
+    StateAwaitable& operator=(const StateAwaitable&) = delete;
+
+    bool await_ready() const noexcept {
+        return false;
+    }
+
+    bool await_suspend(std::coroutine_handle<> handle) {
+        // NOTE: callback is always called exactly once (possibly before waitForStateAsync() returns)
+        mHsm.waitForStateAsync(mState, mTimeoutMs, [this, handle](const StateID_t, const bool isActive) {
+            mIsActive = isActive;
+
+            if (true == mCompleted.exchange(true)) {
+                detail::resumeCoroutine(handle, mExecutor);
+            }
+        });
+
+        return detail::finishSuspend(mCompleted, handle, mExecutor);
+    }
+
+    bool await_resume() const noexcept {
+        return mIsActive;
+    }
+
+private:
+    HierarchicalStateMachine& mHsm;
+    StateID_t mState;
+    int mTimeoutMs;
+    HsmCompletionExecutor_t mExecutor;
+    bool mIsActive = false;
+    std::atomic<bool> mCompleted{false};
+};
+
+/**
+ * @brief Send event to HSM and suspend the coroutine until the transition is finished.
+ * @details Coroutine version of HierarchicalStateMachine::transitionAsync(). Coroutine is resumed on the executor. If
+ * executor is nullptr coroutine is resumed on the dispatcher's thread.
+ *
+ * @param hsm state machine to send event to
+ * @param executor executor to resume coroutine on (could be nullptr)
+ * @param event ID of event to send to HSM
+ * @param args (optional) arguments to pass to the callbacks
+ * @return awaitable which returns TransitionResult
+ */
+template <typename... Args>
+TransitionAwaitable transitionAwaitWithExecutor(HierarchicalStateMachine& hsm,
+                                                HsmCompletionExecutor_t executor,
+                                                const EventID_t event,
+                                                Args&&... args) {
+    VariantVector_t eventArgs;
+
+    eventArgs.reserve(sizeof...(args));
+    (eventArgs.emplace_back(std::forward<Args>(args)), ...);
+
+    return TransitionAwaitable(hsm, event, std::move(eventArgs), std::move(executor));
+}
+
+/**
+ * @brief Send event to HSM and suspend the coroutine until the transition is finished.
+ * @details Coroutine version of HierarchicalStateMachine::transitionAsync(). Coroutine is resumed on the dispatcher's
+ * thread.
+ *
+ * @param hsm state machine to send event to
+ * @param event ID of event to send to HSM
+ * @param args (optional) arguments to pass to the callbacks
+ * @return awaitable which returns TransitionResult
+ */
+template <typename... Args>
+TransitionAwaitable transitionAwait(HierarchicalStateMachine& hsm, const EventID_t event, Args&&... args) {
+    return transitionAwaitWithExecutor(hsm, nullptr, event, std::forward<Args>(args)...);
+}
+
+/**
+ * @brief Suspend the coroutine until HSM activates the state.
+ * @details Coroutine version of HierarchicalStateMachine::waitForStateAsync().
+ *
+ * @param hsm state machine to wait for
+ * @param state ID of the state to wait for
+ * @param timeoutMs maximum time to wait in milliseconds. Use HSM_WAIT_INDEFINITELY to wait indefinitely.
+ * @param executor executor to resume coroutine on. If nullptr coroutine is resumed on the dispatcher's thread.
+ * @return awaitable which returns true if state is active and false if timeout expired
+ */
+inline StateAwaitable waitForStateAwait(HierarchicalStateMachine& hsm,
+                                        const StateID_t state,
+                                        const int timeoutMs = HSM_WAIT_INDEFINITELY,
+                                        HsmCompletionExecutor_t executor = nullptr) {
+    return StateAwaitable(hsm, state, timeoutMs, std::move(executor));
+}
+
+}  // namespace hsmcpp
+
+#endif  // HSM_COROUTINES_AVAILABLE
+
+#endif  // HSMCPP_HSMCOROUTINES_HPP
@@ -0,0 +1,147 @@
+// Copyright (C) 2024 Igor Krechetov
+// Distributed under MIT license. See file LICENSE for details
+
+#ifndef HSMCPP_HSMDISPATCHERGROUP_HPP
+#define HSMCPP_HSMDISPATCHERGROUP_HPP
+
+#include <functional>
+#include <memory>
+
+#include "HsmTypes.hpp"
+
+namespace hsmcpp {
+
+class HierarchicalStateMachine;
+class IHsmEventDispatcher;
+
+/** Invalid shard index. Returned by HsmDispatcherGroup::getShardIndex() for HSMs which are not attached to the group. */
+constexpr size_t INVALID_HSM_SHARD_INDEX = static_cast<size_t>(-1);
+
+/**
+ * @brief Group of dispatchers (shards) which share HSM instances between them.
+ * @details Each shard is a separate dispatcher created by a user provided factory. Usually each shard is a single-threaded
+ * dispatcher with it's thread pinned to a dedicated CPU core (see HsmEventDispatcherSTD::setCpuAffinity()).
+ *
+ * HSM is placed on a shard when it's attached to the group. Attached HSM can be moved to a different shard at runtime with
+ * migrate() without restarting it. See HierarchicalStateMachine::migrate() for details.
+ *
+ * @remark Group only keeps track of HSM placement. HSM instances are not owned by the group and HSM which is destroyed
+ * without being detached is automatically removed from the group.
+ */
+class HsmDispatcherGroup {
+public:
+    /**
+     * @brief Function used to create dispatcher for each shard.
+     *
+     * @param shardIndex index of the shard [0, shardsCount)
+     * @return new dispatcher instance
+     */
+    using DispatcherFactory_t = std::function<std::shared_ptr<IHsmEventDispatcher>(const size_t shardIndex)>;
+
+    /**
+     * @brief Constructor. Creates and starts all shards.
+     *
+     * @param shardsCount number of shards to create
+     * @param factory function used to create dispatcher for each shard
+     *
+     * @notthreadsafe{Calls IHsmEventDispatcher::start() for all created dispatchers.}
+     */
+    HsmDispatcherGroup(const size_t shardsCount, const DispatcherFactory_t& factory);
+
+    /**
+     * @brief Destructor. Releases references to all shards.
+     * @details Attached HSMs keep using their dispatchers.
+     */
+    ~HsmDispatcherGroup();
+
+    HsmDispatcherGroup(const HsmDispatcherGroup&) = delete;
+    HsmDispatcherGroup& operator=(const HsmDispatcherGroup&) = delete;
+
+    /**
+     * @brief Get number of shards in the group.
+     *
+     * @return number of shards which were successfully created
+     *
+     * @threadsafe{ }
+     */
+    size_t getShardsCount() const;
+
+    /**
+     * @brief Get dispatcher of the shard.
+     *
+     * @param shardIndex index of the shard
+     * @return shard's dispatcher or nullptr if index is not valid
+     *
+     * @threadsafe{ }
+     */
+    std::shared_ptr<IHsmEventDispatcher> getShard(const size_t shardIndex) const;
+
+    /**
+     * @brief Get number of HSM instances attached to the shard.
+     *
+     * @param shardIndex index of the shard
+     * @return number of HSMs or 0 if index is not valid
+     *
+     * @threadsafe{ }
+     */
+    size_t getShardLoad(const size_t shardIndex) const;
+
+    /**
+     * @brief Place HSM on one of the shards.
+     * @details If HSM is not initialized, it's initialized with the selected shard's dispatcher. Otherwise, HSM is migrated to
+     * the selected shard.
+     *
+     * @param hsm HSM instance to attach
+     * @param policy defines how shard is selected
+     * @param key (optional) placement key. Used only with ShardPlacementPolicy::HASH.
+     *
+     * @return index of the shard or INVALID_HSM_SHARD_INDEX if HSM is already attached or failed to initialize
+     *
+     * @notthreadsafe{Could call HierarchicalStateMachine::initialize().}
+     */
+    // cppcheck-suppress misra-c2012-17.8 ; false positive. setting default parameter value is not parameter modification
+    size_t attach(HierarchicalStateMachine& hsm,
+                  const ShardPlacementPolicy policy = ShardPlacementPolicy::LEAST_LOADED,
+                  const size_t key = 0);
+
+    /**
+     * @brief Remove HSM from the group.
+     * @details HSM is not released and keeps using dispatcher of it's last shard.
+     *
+     * @param hsm HSM instance to detach
+     *
+     * @threadsafe{ }
+     */
+    void detach(HierarchicalStateMachine& hsm);
+
+    /**
+     * @brief Move attached HSM to a different shard.
+     * @details See HierarchicalStateMachine::migrate() for details.
+     *
+     * @param hsm attached HSM instance
+     * @param shardIndex index of the destination shard
+     *
+     * @return false if HSM is not attached to the group, shard index is not valid or migration failed
+     *
+     * @threadsafe{Must not be called from HSM callbacks.}
+     */
+    bool migrate(HierarchicalStateMachine& hsm, const size_t shardIndex);
+
+    /**
+     * @brief Get index of the shard which is used by HSM.
+     *
+     * @param hsm HSM instance
+     * @return shard index or INVALID_HSM_SHARD_INDEX if HSM is not attached to the group
+     *
+     * @threadsafe{ }
+     */
+    size_t getShardIndex(const HierarchicalStateMachine& hsm) const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> mImpl;
+};
+
+}  // namespace hsmcpp
+
+#endif  // HSMCPP_HSMDISPATCHERGROUP_HPP
@@ -9,7 +9,10 @@
 #include <memory>
 #include <vector>
 
+#include "HsmMemoryResource.hpp"
 #include "IHsmEventDispatcher.hpp"
+#include "os/AtomicFlag.hpp"
+#include "os/InterruptSafeQueue.hpp"
 #include "os/Mutex.hpp"
 
 /**
@@ -17,6 +20,11 @@
  */
 #define DISPATCHER_DEFAULT_EVENTS_CACHESIZE (10)
 
+/**
+ * @details Default service time quota (in microseconds) used by DispatcherFairnessPolicy::DEFICIT_ROUND_ROBIN policy.
+ */
+#define DISPATCHER_DEFAULT_HANDLER_QUOTA_US (1000)
+
 namespace hsmcpp {
 
 /**
@@ -37,9 +45,20 @@ protected:
         HandlerID_t handlerID = INVALID_HSM_DISPATCHER_HANDLER_ID;
         EventID_t eventID = INVALID_HSM_EVENT_ID;
 
+        EnqueuedEventInfo() = default;
         EnqueuedEventInfo(const HandlerID_t newHandlerID, const EventID_t newEventID);
     };
 
+    // handler which has pending events that were postponed by fairness policy
+    struct DeferredHandlerInfo {
+        HandlerID_t handlerID = INVALID_HSM_DISPATCHER_HANDLER_ID;
+        size_t pendingCalls = 0;
+        int64_t deficitUs = 0;  // only used by DispatcherFairnessPolicy::DEFICIT_ROUND_ROBIN
+    };
+
+    using PendingHandlersList_t = HsmList_t<HandlerID_t>;
+    using EventHandlersMap_t = HsmMap_t<HandlerID_t, EventHandlerFunc_t>;
+
 public:
     /**
      * @brief See IHsmEventDispatcher::stop()
@@ -128,13 +147,121 @@ public:
      */
     bool isTimerRunning(const TimerID_t timerID) override;
 
+    /**
+     * @brief Limit the number of pending events.
+     * @details Pending events are events which were emitted with emitEvent(), but were not dispatched yet. By default their
+     * number is not limited. Once limit is set, new events are handled according to the selected policy when queue is full:
+     *      \li QueueOverflowPolicy::COALESCE - new event is dropped if there is already a pending event for the same handler
+     *      \li QueueOverflowPolicy::DROP_OLDEST - the oldest pending event is dropped and new event is added to the queue
+     *      \li QueueOverflowPolicy::DROP_NEWEST - new event is dropped
+     *      \li QueueOverflowPolicy::BLOCK - not supported since emitEvent() is also called from dispatcher's thread. Behaves
+     *      same way as QueueOverflowPolicy::DROP_NEWEST.
+     *
+     * Policies never drop the only pending event of a handler. If new event belongs to a handler which doesn't have
+     * pending events, it's always added and the oldest event of a handler with several pending events is dropped instead.
+     * If all pending events belong to different handlers, queue is allowed to exceed the limit. So the actual queue size
+     * is bounded by max(maxEvents, number of registered handlers).
+     *
+     * @remark HierarchicalStateMachine keeps it's own events queue and only needs a single pending event to process all of
+     * them. That's why QueueOverflowPolicy::COALESCE is the recommended policy when dispatcher is used with HSM. Use
+     * HierarchicalStateMachine::setPendingEventsLimit() to limit the number of HSM events.
+     *
+     * @param maxEvents maximum number of pending events or HSM_QUEUE_UNLIMITED to remove the limit
+     * @param policy defines how to handle new events when queue is full
+     *
+     * @threadsafe{ }
+     */
+    void setPendingEventsLimit(const size_t maxEvents, const QueueOverflowPolicy policy = QueueOverflowPolicy::COALESCE);
+
+    /**
+     * @brief Get statistics of the pending events queue.
+     * @details EventsQueueStats::coalescedEvents contains number of events dropped by QueueOverflowPolicy::COALESCE policy.
+     *
+     * @return Current queue depth and cumulative counters of dropped and coalesced events.
+     *
+     * @threadsafe{ }
+     */
+    EventsQueueStats getPendingEventsStats() const;
+
+    /**
+     * @brief Get statistics of the queue used by enqueueEvent().
+     * @details Only EventsQueueStats::pendingEvents and EventsQueueStats::droppedEvents are used. Events are dropped when
+     * enqueueEvent() is called while queue is full (see eventsCacheSize argument of the constructor).
+     *
+     * @return Current queue depth and number of dropped events.
+     *
+     * @threadsafe{ }
+     */
+    EventsQueueStats getEnqueuedEventsStats() const;
+
+    /**
+     * @brief Set the order in which event handlers are called.
+     * @details By default handlers are called in the same order as events were emitted (DispatcherFairnessPolicy::FIFO). If
+     * one of the handlers keeps emitting events (for example an HSM which receives a lot of events) it can delay other
+     * handlers registered in the same dispatcher for a long time. Fairness policies limit how much each handler can run
+     * before other handlers get their turn:
+     *      \li DispatcherFairnessPolicy::ROUND_ROBIN - each handler with pending events is called once per dispatching round
+     *      \li DispatcherFairnessPolicy::DEFICIT_ROUND_ROBIN - each handler with pending events gets a service time quota
+     *      per dispatching round and is called while it has a positive balance. Time used above the quota is deducted from
+     *      handler's next rounds.
+     *
+     * Events which were postponed stay pending and are processed in the next rounds. Latency of a handler is bounded by
+     * the number of handlers with pending events (and their quotas) instead of the number of pending events.
+     *
+     * @param policy order in which handlers are called
+     * @param defaultQuotaUs quota used by DEFICIT_ROUND_ROBIN for handlers without an individual quota (see
+     * setHandlerQuota())
+     *
+     * @threadsafe{ }
+     */
+    void setFairnessPolicy(const DispatcherFairnessPolicy policy,
+                           const unsigned int defaultQuotaUs = DISPATCHER_DEFAULT_HANDLER_QUOTA_US);
+
+    /**
+     * @brief Set individual service time quota for event handler.
+     * @details Used by DispatcherFairnessPolicy::DEFICIT_ROUND_ROBIN. Handlers with bigger quota can spend more time
+     * processing their events during a single dispatching round.
+     *
+     * @param handlerID event handler id
+     * @param quotaUs quota in microseconds (0 - use default quota)
+     *
+     * @threadsafe{ }
+     */
+    void setHandlerQuota(const HandlerID_t handlerID, const unsigned int quotaUs);
+
+    /**
+     * @brief Enable measuring of time spent in event handlers.
+     * @details Disabled by default to avoid overhead of reading system clock. Measurements are always done when
+     * DispatcherFairnessPolicy::DEFICIT_ROUND_ROBIN policy is used.
+     *
+     * @param enable true to enable service time accounting
+     *
+     * @threadsafe{ }
+     */
+    void setServiceTimeAccounting(const bool enable);
+
+    /**
+     * @brief Get service time statistics of event handler.
+     * @details Statistics are collected only if service time accounting is enabled (see setServiceTimeAccounting()) or
+     * DispatcherFairnessPolicy::DEFICIT_ROUND_ROBIN policy is used. Statistics are removed when handler is unregistered.
+     *
+     * @param handlerID event handler id
+     * @return cumulative statistics of handler calls
+     *
+     * @threadsafe{ }
+     */
+    HandlerServiceStats getHandlerServiceStats(const HandlerID_t handlerID) const;
+
 protected:
     /**
      * @brief Default constructor.
      * @param eventsCacheSize size of the queue preallocated for delayed events
+     * @param resource memory resource used by internal containers (handlers, timers, pending events). Global heap is used
+     * if nullptr. Resource must be thread-safe and must outlive the dispatcher.
      */
     // cppcheck-suppress misra-c2012-17.8 ; false positive. setting default parameter value is not parameter modification
-    explicit HsmEventDispatcherBase(const size_t eventsCacheSize = DISPATCHER_DEFAULT_EVENTS_CACHESIZE);
+    explicit HsmEventDispatcherBase(const size_t eventsCacheSize = DISPATCHER_DEFAULT_EVENTS_CACHESIZE,
+                                    HsmMemoryResource* resource = nullptr);
 
     /**
      * Destructor.
@@ -225,10 +352,34 @@ protected:
 
     /**
      * @brief Wakeup dispatching thread to process pending events.
-     * @details Must be implemented by derived classes.
+     * @details Must be implemented by derived classes. Notification must not get lost if dispatcher is about to go to
+     * sleep: wakeupDispatcher() calls this function only once until dispatcher clears pending wakeup.
+     *
+     * @remark Function is also called from enqueueEvent(), so it must be async-signal-safe (or interrupt-safe) if
+     * dispatcher supports calling enqueueEvent() from signal handlers.
      */
     virtual void notifyDispatcherAboutEvent() = 0;
 
+    /**
+     * @brief Wakeup dispatching thread unless it was already notified and didn't start processing events yet.
+     * @details Calls notifyDispatcherAboutEvent() only for the first new event after dispatcher started processing events.
+     * This way burst of events costs a single OS-level notification (condition variable, pipe write, posted event, etc.).
+     *
+     * @remark Derived classes must call clearPendingWakeup() before they start processing pending events.
+     *
+     * @threadsafe{Can be called from interrupts.}
+     */
+    void wakeupDispatcher();
+
+    /**
+     * @brief Allows next call to wakeupDispatcher() to notify dispatcher.
+     * @details Must be called by dispatcher's thread right before it starts processing pending events. Called automatically
+     * by dispatchPendingEvents().
+     *
+     * @threadsafe{ }
+     */
+    void clearPendingWakeup();
+
     /**
      * @brief Dispatch currently enqueued events.
      * @details Should be called by derived classes in dedicated dispatcher thread.
@@ -260,22 +411,83 @@ protected:
      *
      * @threadsafe{ }
      */
-    void dispatchPendingEventsImpl(const std::list<HandlerID_t>& events);
+    void dispatchPendingEventsImpl(const PendingHandlersList_t& events);
+
+    /**
+     * @brief Add new event to mPendingEvents while respecting pending events limit.
+     * @details See setPendingEventsLimit() for details.
+     *
+     * @param handlerID event handler id
+     *
+     * @retval true event was added to the queue and dispatcher needs to be notified
+     * @retval false event was dropped
+     *
+     * @notthreadsafe{Must be called with mEmitSync locked.}
+     */
+    bool addPendingEvent(const HandlerID_t handlerID);
+
+    /**
+     * @brief Remove the oldest entry from mPendingEvents which belongs to a handler with several pending entries.
+     * @details Used to free space in the queue without losing the only pending entry of any handler.
+     *
+     * @retval true entry was removed
+     * @retval false all pending entries belong to different handlers
+     *
+     * @notthreadsafe{Must be called with mEmitSync locked.}
+     */
+    bool dropRedundantPendingEvent();
+
+    /**
+     * @brief Check if there are events which were postponed by fairness policy.
+     * @details Derived classes must take these events into account before going to sleep.
+     *
+     * @return true if there are postponed events
+     *
+     * @notthreadsafe{Must be called only from dispatcher's thread.}
+     */
+    bool hasDeferredEvents() const;
+
+private:
+    // calls handler and updates its service time statistics. returns handler's result
+    bool callEventHandler(const HandlerID_t handlerID,
+                          const EventHandlerFunc_t& handler,
+                          const bool measureTime,
+                          uint64_t& outServiceTimeUs);
+
+    // adds events to mDeferredHandlers and runs a single round of fair dispatching
+    void dispatchFairRound(const PendingHandlersList_t& events,
+                           EventHandlersMap_t& eventHandlers,
+                           const DispatcherFairnessPolicy policy,
+                           const bool measureTime);
 
 protected:
     HandlerID_t mNextHandlerId = 1;
-    std::map<TimerID_t, TimerInfo> mActiveTimers;                              // protected by mHandlersSync
-    std::map<HandlerID_t, EventHandlerFunc_t> mEventHandlers;                  // protected by mHandlersSync
-    std::map<HandlerID_t, EnqueuedEventHandlerFunc_t> mEnqueuedEventHandlers;  // protected by mHandlersSync
-    std::map<HandlerID_t, TimerHandlerFunc_t> mTimerHandlers;                  // protected by mHandlersSync
-    std::list<ActionHandlerFunc_t> mPendingActions;                            // protected by mEmitSync
-    std::list<HandlerID_t> mPendingEvents;                                     // protected by mEmitSync
-    std::vector<EnqueuedEventInfo> mEnqueuedEvents;                            // protected by mEnqueuedEventsSync
-    Mutex mEmitSync;
+    HsmMap_t<TimerID_t, TimerInfo> mActiveTimers;                              // protected by mHandlersSync
+    EventHandlersMap_t mEventHandlers;                                         // protected by mHandlersSync
+    HsmMap_t<HandlerID_t, EnqueuedEventHandlerFunc_t> mEnqueuedEventHandlers;  // protected by mHandlersSync
+    HsmMap_t<HandlerID_t, TimerHandlerFunc_t> mTimerHandlers;                  // protected by mHandlersSync
+    HsmList_t<ActionHandlerFunc_t> mPendingActions;                            // protected by mEmitSync
+    PendingHandlersList_t mPendingEvents;                                      // protected by mEmitSync
+    size_t mPendingEventsLimit = HSM_QUEUE_UNLIMITED;                          // protected by mEmitSync
+    QueueOverflowPolicy mPendingEventsPolicy = QueueOverflowPolicy::COALESCE;  // protected by mEmitSync
+    EventsQueueStats mPendingEventsStats;                                      // protected by mEmitSync
+    // NOTE: lock-free on platforms with STL. Producers could be signal handlers or interrupts
+    InterruptSafeQueue<EnqueuedEventInfo> mEnqueuedEvents;
+    mutable Mutex mEmitSync;
     Mutex mHandlersSync;
-    Mutex mEnqueuedEventsSync;
     Mutex mRunningTimersSync;
     bool mStopDispatcher = false;
+
+private:
+    DispatcherFairnessPolicy mFairnessPolicy = DispatcherFairnessPolicy::FIFO;  // protected by mFairnessSync
+    unsigned int mDefaultHandlerQuotaUs = DISPATCHER_DEFAULT_HANDLER_QUOTA_US;  // protected by mFairnessSync
+    HsmMap_t<HandlerID_t, unsigned int> mHandlerQuotas;                          // protected by mFairnessSync
+    HsmMap_t<HandlerID_t, HandlerServiceStats> mHandlerServiceStats;            // protected by mFairnessSync
+    bool mServiceTimeAccounting = false;                                        // protected by mFairnessSync
+    HsmList_t<DeferredHandlerInfo> mDeferredHandlers;                           // used only from dispatcher's thread
+    // set when dispatcher was notified about new events, but didn't start processing them yet
+    AtomicFlag mWakeupPending;
+    mutable Mutex mFairnessSync;
 };
 
 }  // namespace hsmcpp
@@ -6,8 +6,10 @@
 
 #include <glib.h>
 
+#include <atomic>
 #include <condition_variable>
 #include <map>
+#include <vector>
 
 #include "HsmEventDispatcherBase.hpp"
 
@@ -15,11 +17,30 @@ namespace hsmcpp {
 
 /**
  * @brief HsmEventDispatcherGLib provides dispatcher implementation based on glib library.
- * @details Events queue is implemented by using glib IO channel. See @rstref{platforms-dispatcher-glib} for details.
+ * @details Dispatcher uses a single custom GSource for both events and timers. Producers wakeup GLib context only for the
+ * first event after dispatcher started processing events and all pending events are processed in a single dispatch.
+ * Timers are kept in an internal deadline heap which defines poll timeout of the source. See @rstref{platforms-dispatcher-glib}
+ * for details.
  */
 class HsmEventDispatcherGLib : public HsmEventDispatcherBase {
 private:
-    using TimerData_t = std::pair<HsmEventDispatcherGLib*, TimerID_t>;
+    struct DispatcherSource {
+        GSource base;  ///< must be the first member
+        HsmEventDispatcherGLib* dispatcher;
+    };
+
+    struct RunningTimerInfo {
+        gint64 elapseAfterUs;     ///< time when timer should elapse next (monotonic, us)
+        unsigned int generation;  ///< used to detect outdated entries in mTimersHeap
+    };
+
+    struct TimerDeadline {
+        gint64 elapseAfterUs;
+        TimerID_t timerID;
+        unsigned int generation;
+
+        bool operator>(const TimerDeadline& other) const;
+    };
 
 public:
     /**
@@ -45,7 +66,7 @@ public:
                                                           const size_t eventsCacheSize = DISPATCHER_DEFAULT_EVENTS_CACHESIZE);
 
     /**
-     * @brief Create a new IO channel and start events dispatching.
+     * @brief Create dispatcher's GSource and start events dispatching.
      * @details See IHsmEventDispatcher::start() for details.
      * @notthreadsafe{Thread safety is not required by HierarchicalStateMachine::initialize() which uses this API.}
      */
@@ -99,22 +120,34 @@ private:
      */
     void stopTimerImpl(const TimerID_t timerID) override;
 
-    static gboolean onTimerEvent(const TimerData_t* timerData);
-    static void onFreeTimerData(void* timerData);
+    // adds timer deadline to mTimersHeap. must be called with mRunningTimersSync locked
+    void scheduleTimer(const TimerID_t timerID, const gint64 elapseAfterUs);
+    // returns deadline of the nearest timer or -1 if there are no running timers
+    gint64 getNextTimerDeadline();
+    // calls handlers of all timers which elapsed before nowUs
+    void dispatchExpiredTimers(const gint64 nowUs);
 
     void notifyDispatcherAboutEvent() override;
-    static gboolean onPipeDataAvailable(GIOChannel* gio, GIOCondition condition, gpointer data);
+    gboolean dispatchSource();
+
+    static gboolean onSourcePrepare(GSource* source, gint* timeout);
+    static gboolean onSourceCheck(GSource* source);
+    static gboolean onSourceDispatch(GSource* source, GSourceFunc callback, gpointer userData);
 
 private:
+    static GSourceFuncs sSourceFuncs;
+
     GMainContext* mContext = nullptr;
-    GIOChannel* mReadChannel = nullptr;
-    GSource* mIoSource = nullptr;
-    std::mutex mPipeSync;
-    int mPipeFD[2] = {-1, -1};
+    GSource* mSource = nullptr;
+    // set by producers when new events are available. reset by dispatcher before processing events
+    std::atomic<bool> mEventsReady{false};
     bool mDispatchingIterationRunning = false;
     std::mutex mDispatchingSync;
     std::condition_variable mDispatchingDoneEvent;
-    std::map<TimerID_t, GSource*> mNativeTimerHandlers; // protected by mRunningTimersSync
+    std::map<TimerID_t, RunningTimerInfo> mRunningTimers;  // protected by mRunningTimersSync
+    // min-heap of timer deadlines. entries of stopped and restarted timers are removed lazily
+    std::vector<TimerDeadline> mTimersHeap;  // protected by mRunningTimersSync
+    unsigned int mTimersGeneration = 0;      // protected by mRunningTimersSync
 };
 
 }  // namespace hsmcpp
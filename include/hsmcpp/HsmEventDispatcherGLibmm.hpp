@@ -6,7 +6,11 @@
 
 #include <glibmm.h>
 
+#include <atomic>
+#include <chrono>
+#include <map>
 #include <memory>
+#include <vector>
 
 #include "HsmEventDispatcherBase.hpp"
 
@@ -25,9 +29,26 @@ namespace hsmcpp {
  * Unless you really have to, it's always better to reuse a single dispatcher instance for multiple HSMs instead of
  * creating/deleting multiple ones (they will anyway handle events sequentially since they use same Glib main loop).
  *
+ * Glib::Dispatcher is signaled only for the first event after dispatcher started processing events. All HSM timers are
+ * driven by a single timeout source which is armed for the nearest deadline from an internal heap.
+ *
  * See @rstref{platforms-dispatcher-glibmm} for details.
  */
 class HsmEventDispatcherGLibmm : public HsmEventDispatcherBase {
+private:
+    struct RunningTimerInfo {
+        std::chrono::time_point<std::chrono::steady_clock> elapseAfter;  ///< time when timer should elapse next (monotonic)
+        unsigned int generation;  ///< used to detect outdated entries in mTimersHeap
+    };
+
+    struct TimerDeadline {
+        std::chrono::time_point<std::chrono::steady_clock> elapseAfter;
+        TimerID_t timerID;
+        unsigned int generation;
+
+        bool operator>(const TimerDeadline& other) const;
+    };
+
 public:
     /**
      * @brief Create dispatcher instance.
@@ -69,6 +90,17 @@ public:
      */
     void emitEvent(const HandlerID_t handlerID) override;
 
+    /**
+     * @brief Limit number of events processed in a single main loop iteration.
+     * @details By default all pending events are processed when dispatcher is woken up. With a limit, remaining events are
+     * processed in the next iterations which allows other sources of the main loop (UI, IO) to run in between.
+     *
+     * @param batchSize max number of events to process per iteration. 0 means no limit (default).
+     *
+     * @threadsafe{ }
+     */
+    void setDispatchBatchSize(const size_t batchSize);
+
 protected:
     /**
      * @copydoc HsmEventDispatcherBase::HsmEventDispatcherBase()
@@ -105,14 +137,31 @@ protected:
      */
     void stopTimerImpl(const TimerID_t timerID) override;
 
+    // adds timer deadline to mTimersHeap. must be called with mRunningTimersSync locked
+    void scheduleTimer(const TimerID_t timerID, const std::chrono::time_point<std::chrono::steady_clock>& elapseAfter);
+    // arms native timeout for the nearest deadline if needed. must be called with mRunningTimersSync locked
+    void updateNativeTimer();
+    // calls handlers of all timers which elapsed before now
+    void dispatchExpiredTimers(const std::chrono::time_point<std::chrono::steady_clock>& now);
+
     void notifyDispatcherAboutEvent() override;
-    bool onTimerEvent(const TimerID_t timerID);
+    void dispatchEventsBatch();
+    bool onTimerEvent(const unsigned int timeoutGeneration);
 
 private:
     Glib::RefPtr<Glib::MainContext> mMainContext;
     std::unique_ptr<Glib::Dispatcher> mDispatcher;
     sigc::connection mDispatcherConnection;
-    std::map<TimerID_t, sigc::connection> mNativeTimerHandlers; // protected by mRunningTimersSync
+    std::atomic<size_t> mDispatchBatchSize{0};
+    std::map<TimerID_t, RunningTimerInfo> mRunningTimers;  // protected by mRunningTimersSync
+    // min-heap of timer deadlines. entries of stopped and restarted timers are removed lazily
+    std::vector<TimerDeadline> mTimersHeap;  // protected by mRunningTimersSync
+    unsigned int mTimersGeneration = 0;      // protected by mRunningTimersSync
+    // single timeout source used for all timers. armed for the nearest deadline
+    sigc::connection mNativeTimer;  // protected by mRunningTimersSync
+    bool mNativeTimerArmed = false;  // protected by mRunningTimersSync
+    std::chrono::time_point<std::chrono::steady_clock> mNativeTimerDeadline;  // protected by mRunningTimersSync
+    unsigned int mNativeTimerGeneration = 0;  // protected by mRunningTimersSync
 };
 
 }  // namespace hsmcpp
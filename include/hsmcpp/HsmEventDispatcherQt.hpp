@@ -5,22 +5,44 @@
 #define HSMCPP_HSMEVENTDISPATCHERQT_HPP
 
 #include "HsmEventDispatcherBase.hpp"
+#include <QBasicTimer>
 #include <QObject>
 #include <QEvent>
-#include <QTimer>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <vector>
+
+class QThread;
 
 namespace hsmcpp
 {
 
 /**
  * @brief HsmEventDispatcherQt provides dispatcher implementation based on Qt framework.
- * @details See @rstref{platforms-dispatcher-qt} for details.
+ * @details Dispatcher processes events in the thread it's bound to (main thread by default). All HSM timers are
+ * multiplexed onto a single QBasicTimer which is driven by an internal deadline heap. See @rstref{platforms-dispatcher-qt}
+ * for details.
  */
 class HsmEventDispatcherQt: public QObject
                           , public HsmEventDispatcherBase
 {
     Q_OBJECT
 
+private:
+    struct RunningTimerInfo {
+        std::chrono::time_point<std::chrono::steady_clock> elapseAfter;  ///< time when timer should elapse next (monotonic)
+        unsigned int generation;  ///< used to detect outdated entries in mTimersHeap
+    };
+
+    struct TimerDeadline {
+        std::chrono::time_point<std::chrono::steady_clock> elapseAfter;
+        TimerID_t timerID;
+        unsigned int generation;
+
+        bool operator>(const TimerDeadline& other) const;
+    };
+
 public:
     /**
      * @brief Create dispatcher instance.
@@ -32,9 +54,26 @@ public:
     // cppcheck-suppress misra-c2012-17.8 ; false positive. setting default parameter value is not parameter modification
     static std::shared_ptr<HsmEventDispatcherQt> create(const size_t eventsCacheSize = DISPATCHER_DEFAULT_EVENTS_CACHESIZE);
 
+    /**
+     * @brief Create dispatcher instance which processes events in a specific thread.
+     * @details Could be used to move HSM processing out of the main (UI) thread. \a dispatcherThread must be running it's
+     * own event loop (default implementation of QThread::run()) and must outlive the dispatcher.
+     *
+     * @param dispatcherThread thread to use for dispatching. nullptr means main thread.
+     * @param eventsCacheSize size of the queue preallocated for delayed events
+     * @return New dispatcher instance.
+     *
+     * @threadsafe{Instance can be safely created and destroyed from any thread.}
+     */
+    // cppcheck-suppress misra-c2012-17.8 ; false positive. setting default parameter value is not parameter modification
+    static std::shared_ptr<HsmEventDispatcherQt> create(QThread* dispatcherThread,
+                                                        const size_t eventsCacheSize = DISPATCHER_DEFAULT_EVENTS_CACHESIZE);
+
     /**
      * @brief See IHsmEventDispatcher::start()
-     * @notthreadsafe{Thread safety is not required by HierarchicalStateMachine::initialize() which uses this API.}
+     * @details Moves dispatcher to it's thread if needed.
+     * @notthreadsafe{Thread safety is not required by HierarchicalStateMachine::initialize() which uses this API. Must be
+     * called from the thread dispatcher was created in.}
      */
     bool start() override;
 
@@ -57,15 +96,23 @@ protected:
     void startTimerImpl(const TimerID_t timerID, const unsigned int intervalMs, const bool isSingleShot) override;
     void stopTimerImpl(const TimerID_t timerID) override;
 
-private slots:
-    void onTimerEvent();
+    // adds timer deadline to mTimersHeap. must be called with mRunningTimersSync locked
+    void scheduleTimer(const TimerID_t timerID, const std::chrono::time_point<std::chrono::steady_clock>& elapseAfter);
+    // calls handlers of all timers which elapsed before now
+    void dispatchExpiredTimers(const std::chrono::time_point<std::chrono::steady_clock>& now);
+    // restarts mNativeTimer for the nearest deadline. must be called from dispatcher's thread
+    void updateNativeTimer();
+    // request dispatcher's thread to call updateNativeTimer()
+    void notifyTimersChanged();
+
+    void timerEvent(QTimerEvent* ev) override;
 
 protected:
     /**
      * @copydoc HsmEventDispatcherBase::HsmEventDispatcherBase()
-     * @details Uses default GLib content.
+     * @param dispatcherThread thread to use for dispatching. nullptr means main thread.
     */
-    explicit HsmEventDispatcherQt(const size_t eventsCacheSize);
+    HsmEventDispatcherQt(QThread* dispatcherThread, const size_t eventsCacheSize);
 
     /**
      * @brief Destructor.
@@ -81,7 +128,15 @@ protected:
 
 private:
     static QEvent::Type mQtDispatchEventType;
-    std::map<TimerID_t, QTimer*> mNativeTimerHandlers; // protected by mRunningTimersSync
+    QThread* mDispatcherThread = nullptr;
+    // single native timer used for all HSM timers. accessed only from dispatcher's thread
+    QBasicTimer mNativeTimer;
+    // set when timers were started or stopped from a different thread
+    std::atomic<bool> mTimersChanged{false};
+    std::map<TimerID_t, RunningTimerInfo> mRunningTimers;  // protected by mRunningTimersSync
+    // min-heap of timer deadlines. entries of stopped and restarted timers are removed lazily
+    std::vector<TimerDeadline> mTimersHeap;  // protected by mRunningTimersSync
+    unsigned int mTimersGeneration = 0;      // protected by mRunningTimersSync
 };
 
 } // namespace hsmcpp
@@ -4,6 +4,7 @@
 #ifndef HSMCPP_HSMEVENTDISPATCHERSTD_HPP
 #define HSMCPP_HSMEVENTDISPATCHERSTD_HPP
 
+#include <atomic>
 #include <chrono>
 #include <map>
 #include <thread>
@@ -11,6 +12,11 @@
 #include "HsmEventDispatcherBase.hpp"
 #include "os/ConditionVariable.hpp"
 
+#if defined(__unix__) || defined(__APPLE__)
+  // dispatcher thread sleeps on a self-pipe instead of a condition variable. Writing to a pipe is async-signal-safe
+  #define HSM_STD_DISPATCHER_WAKEUP_PIPE
+#endif
+
 namespace hsmcpp {
 
 /**
@@ -28,12 +34,15 @@ public:
     /**
      * @brief Create dispatcher instance.
      * @param eventsCacheSize size of the queue preallocated for delayed events
+     * @param resource memory resource used by internal containers. Global heap is used if nullptr. Resource must be
+     * thread-safe and must outlive the dispatcher.
      * @return New dispatcher instance.
      *
      * @threadsafe{Instance can be safely created and destroyed from any thread.}
      */
     // cppcheck-suppress misra-c2012-17.8 ; false positive. setting default parameter value is not parameter modification
-    static std::shared_ptr<HsmEventDispatcherSTD> create(const size_t eventsCacheSize = DISPATCHER_DEFAULT_EVENTS_CACHESIZE);
+    static std::shared_ptr<HsmEventDispatcherSTD> create(const size_t eventsCacheSize = DISPATCHER_DEFAULT_EVENTS_CACHESIZE,
+                                                         HsmMemoryResource* resource = nullptr);
 
     /**
      * @brief See IHsmEventDispatcher::emitEvent()
@@ -44,6 +53,7 @@ public:
     /**
      * @copydoc IHsmEventDispatcher::start()
      * @details Function starts a new std::thread for dispatching events. Thread can be stopped by calling stop().
+     * On POSIX platforms function fails if dispatcher wasn't able to create its wakeup pipe.
      *
      * @notthreadsafe{This API is intended to be called only once during startup.}
      */
@@ -68,11 +78,57 @@ public:
      */
     void join();
 
+    /**
+     * @brief Pins dispatcher thread to a CPU core.
+     * @details Can be called before or after start(). If dispatcher is not running yet, affinity is applied when thread is
+     * started. Timers thread is not affected.
+     *
+     * @remark Supported only on Linux. On other platforms function always returns false.
+     *
+     * @param cpuIndex index of the CPU core
+     * @return true if affinity was applied (or will be applied on start), false otherwise
+     *
+     * @notthreadsafe{Must be called on the same thread as start().}
+     */
+    bool setCpuAffinity(const int cpuIndex);
+
+    /**
+     * @brief Sets scheduling policy and priority of dispatcher thread.
+     * @details Can be called before or after start(). If dispatcher is not running yet, settings are applied when thread is
+     * started. Timers thread is not affected.
+     *
+     * @remark Supported only on Linux. On other platforms function always returns false. Real-time policies usually require
+     * additional privileges.
+     *
+     * @param policy scheduling policy (SCHED_OTHER, SCHED_FIFO, SCHED_RR, etc.)
+     * @param priority thread priority. Allowed values depend on the policy.
+     * @return true if settings were applied (or will be applied on start), false otherwise
+     *
+     * @notthreadsafe{Must be called on the same thread as start().}
+     */
+    bool setThreadScheduling(const int policy, const int priority);
+
+    /**
+     * @brief Enables low-latency mode in which dispatcher thread busy-polls for new events before going to sleep.
+     * @details By default dispatcher thread sleeps as soon as there are no pending events, so each new event has to wake it up
+     * (this usually costs tens of microseconds). With busy polling enabled, dispatcher keeps checking for new events for
+     * the specified time before going to sleep. While dispatcher is polling, producers don't need to wake it up.
+     *
+     * @remark Busy polling keeps one CPU core fully loaded while dispatcher is idle. It's recommended to combine it with
+     * setCpuAffinity().
+     *
+     * @param pollingTimeUs max time (in microseconds) to wait for new events before going to sleep. 0 disables busy polling
+     * (default).
+     *
+     * @threadsafe{ }
+     */
+    void setBusyPolling(const unsigned int pollingTimeUs);
+
 protected:
     /**
      * @copydoc HsmEventDispatcherBase::HsmEventDispatcherBase()
      */
-    explicit HsmEventDispatcherSTD(const size_t eventsCacheSize);
+    explicit HsmEventDispatcherSTD(const size_t eventsCacheSize, HsmMemoryResource* resource = nullptr);
 
     /**
      * @brief Destructor
@@ -97,8 +153,21 @@ protected:
      */
     void stopTimerImpl(const TimerID_t timerID) override;
 
+    /**
+     * @brief See HsmEventDispatcherBase::notifyDispatcherAboutEvent()
+     * @details On POSIX platforms writes to the wakeup pipe, so it's async-signal-safe. On other platforms notifies
+     * condition variable while holding mEmitSync.
+     *
+     * @threadsafe{Can be called from signal handlers on POSIX platforms.}
+     */
     void notifyDispatcherAboutEvent() override;
     void doDispatching();
+#if defined(HSM_STD_DISPATCHER_WAKEUP_PIPE)
+    // blocks dispatcher thread until wakeup pipe has data and consumes all pending notifications
+    void waitForWakeup();
+#endif
+    // returns true if new events were received while busy polling
+    bool pollForEvents();
 
     void notifyTimersThread();
     void handleTimers();
@@ -106,11 +175,23 @@ protected:
 private:
     std::thread mDispatcherThread;
     std::thread mTimersThread;
-    // NOTE: ideally it would be better to use a semaphore here, but there are no semaphores in C++11
+#if defined(HSM_STD_DISPATCHER_WAKEUP_PIPE)
+    // [0] - read end used by dispatcher thread, [1] - write end used by notifyDispatcherAboutEvent(). Both are non-blocking
+    int mWakeupPipe[2] = {-1, -1};
+#else
     ConditionVariable mEmitEvent;
+#endif
     ConditionVariable mTimerEvent;
     bool mNotifiedTimersThread = false;
-    std::map<TimerID_t, RunningTimerInfo> mRunningTimers; // protected by mRunningTimersSync
+    int mCpuAffinity = -1;
+    int mSchedulingPolicy = -1;
+    int mSchedulingPriority = 0;
+    std::atomic<unsigned int> mBusyPollingUs{0};
+    // set by dispatcher thread while it's busy polling for events
+    std::atomic<bool> mIsPolling{false};
+    // used instead of regular notification to wakeup dispatcher thread while it's busy polling
+    std::atomic<bool> mPollingWakeup{false};
+    HsmMap_t<TimerID_t, RunningTimerInfo> mRunningTimers; // protected by mRunningTimersSync
 };
 
 }  // namespace hsmcpp
@@ -0,0 +1,130 @@
+// Copyright (C) 2024 Igor Krechetov
+// Distributed under MIT license. See file LICENSE for details
+
+#ifndef HSMCPP_HSMGROUP_HPP
+#define HSMCPP_HSMGROUP_HPP
+
+#include <memory>
+
+#include "HsmTypes.hpp"
+#include "hsm.hpp"
+#include "variant.hpp"
+
+namespace hsmcpp {
+
+class IHsmEventDispatcher;
+
+/**
+ * @brief Group of HSM instances which can receive the same event with a single call.
+ * @details Sending the same event to many HSMs with HierarchicalStateMachine::transition() costs one arguments vector and one
+ * dispatcher event per HSM. HsmGroup::broadcast() instead creates a single reference-counted event which is added to the
+ * group's own queue and emits a single dispatcher event. Fan-out to members happens later on the group's dispatcher thread:
+ * each member gets the event (sharing the same arguments object) in its own queue and processes it in its own dispatch
+ * slot. Group delivers event to a single member per dispatch slot, so broadcasting to a large group doesn't delay other
+ * handlers of the dispatcher (fairness policies of the dispatcher are respected).
+ *
+ * Members keep their own queue settings: limits, coalescing and TTL are applied when the event is added to member's queue.
+ *
+ * @remark Members don't need to use the same dispatcher as the group.
+ * @warning Group doesn't own its members. HSM must be removed from the group before it's destroyed.
+ */
+class HsmGroup {
+public:
+    /**
+     * @brief Constructor.
+     *
+     * @param dispatcher dispatcher used to deliver broadcast events to members
+     */
+    explicit HsmGroup(const std::shared_ptr<IHsmEventDispatcher>& dispatcher);
+
+    /**
+     * @brief Destructor. Pending broadcasts which were not delivered yet are discarded.
+     */
+    ~HsmGroup();
+
+    HsmGroup(const HsmGroup&) = delete;
+    HsmGroup& operator=(const HsmGroup&) = delete;
+
+    /**
+     * @brief Check if group was successfully registered with a dispatcher.
+     *
+     * @return true if group can be used for broadcasting events
+     *
+     * @threadsafe{ }
+     */
+    bool isValid() const;
+
+    /**
+     * @brief Add HSM to the group.
+     *
+     * @param hsm HSM instance to add
+     * @return false if HSM is already a member of the group
+     *
+     * @threadsafe{ }
+     */
+    bool addMember(HierarchicalStateMachine& hsm);
+
+    /**
+     * @brief Remove HSM from the group.
+     * @details Broadcasts which were already delivered to HSM's queue are not affected.
+     *
+     * @param hsm HSM instance to remove
+     *
+     * @threadsafe{ }
+     */
+    void removeMember(HierarchicalStateMachine& hsm);
+
+    /**
+     * @brief Get number of HSM instances in the group.
+     *
+     * @return number of members
+     *
+     * @threadsafe{ }
+     */
+    size_t getMembersCount() const;
+
+    /**
+     * @brief Send event to all members of the group.
+     * @details Caller's cost doesn't depend on the number of members. Event is delivered to HSMs which are members of the group
+     * when group starts delivering it (on the dispatcher's thread) and weren't removed before their turn came. Broadcasts
+     * are delivered in the same order as they were sent.
+     *
+     * @param event ID of event to send to members
+     * @param args (optional) arguments to pass to the callbacks. Same instance of arguments is shared by all members.
+     *
+     * @return false if group is not valid
+     *
+     * @threadsafe{ }
+     */
+    template <typename... Args>
+    bool broadcast(const EventID_t event, Args&&... args);
+
+    /**
+     * @brief Send event to all members of the group.
+     * @details See broadcast() for details.
+     *
+     * @param event ID of event to send to members
+     * @param args arguments to pass to the callbacks
+     *
+     * @return false if group is not valid
+     *
+     * @threadsafe{ }
+     */
+    bool broadcastWithArgsArray(const EventID_t event, VariantVector_t&& args);
+
+private:
+    class Impl;
+    std::shared_ptr<Impl> mImpl;
+};
+
+template <typename... Args>
+bool HsmGroup::broadcast(const EventID_t event, Args&&... args) {
+    VariantVector_t eventArgs;
+
+    HierarchicalStateMachine::makeVariantList(eventArgs, std::forward<Args>(args)...);
+    return broadcastWithArgsArray(event, std::move(eventArgs));
+}
+
+}  // namespace hsmcpp
+
+#endif  // HSMCPP_HSMGROUP_HPP
@@ -0,0 +1,231 @@
+// Copyright (C) 2024 Igor Krechetov
+// Distributed under MIT license. See file LICENSE for details
+
+#ifndef HSMCPP_HSMMEMORYRESOURCE_HPP
+#define HSMCPP_HSMMEMORYRESOURCE_HPP
+
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#if (__cplusplus >= 201703L) && defined(__has_include)
+  #if __has_include(<memory_resource>)
+    #include <memory_resource>
+    #define HSM_HAS_STD_PMR
+  #endif
+#endif
+
+namespace hsmcpp {
+
+/**
+ * @brief Source of memory for internal containers of HierarchicalStateMachine and HsmEventDispatcherBase.
+ * @details Interface follows std::pmr::memory_resource, but is available in C++11 builds. Use HsmPmrMemoryResource to
+ * pass any std::pmr::memory_resource (for example std::pmr::monotonic_buffer_resource or
+ * std::pmr::synchronized_pool_resource) when building with C++17.
+ *
+ * @warning Resource must outlive all objects which use it.
+ */
+class HsmMemoryResource {
+public:
+    virtual ~HsmMemoryResource() = default;
+
+    /**
+     * @brief Allocate memory.
+     *
+     * @param bytes size of memory block
+     * @param alignment alignment of memory block
+     *
+     * @return pointer to allocated memory. Throws std::bad_alloc (or terminates if exceptions are disabled) if memory
+     * can't be allocated
+     */
+    void* allocate(const size_t bytes, const size_t alignment = alignof(std::max_align_t));
+
+    /**
+     * @brief Release memory which was allocated with allocate().
+     * @details bytes and alignment must be the same as were used for allocation.
+     */
+    void deallocate(void* p, const size_t bytes, const size_t alignment = alignof(std::max_align_t));
+
+    /**
+     * @brief Check if memory allocated by this resource can be released by other resource and vice versa.
+     */
+    bool isEqual(const HsmMemoryResource& other) const noexcept;
+
+protected:
+    virtual void* doAllocate(const size_t bytes, const size_t alignment) = 0;
+    virtual void doDeallocate(void* p, const size_t bytes, const size_t alignment) = 0;
+    virtual bool doIsEqual(const HsmMemoryResource& other) const noexcept;
+};
+
+/**
+ * @brief Returns resource which uses global operator new and operator delete.
+ * @details This resource is used by all objects which were not given an explicit memory resource.
+ *
+ * @threadsafe{ }
+ */
+HsmMemoryResource* getDefaultMemoryResource();
+
+/**
+ * @brief Arena which releases memory only when it's destroyed.
+ * @details Allocation only moves a pointer inside of the current memory block. deallocate() does nothing. When current
+ * block is exhausted a new one is requested from upstream resource (each next block is twice as big as the previous
+ * one).
+ *
+ * Arena is best suited for data which is created once and lives as long as the HSM itself (like HSM structure).
+ *
+ * @notthreadsafe{Arena must not be used by multiple threads at the same time.}
+ */
+class HsmMonotonicMemoryResource : public HsmMemoryResource {
+public:
+    /**
+     * @brief Constructs arena which requests all memory from upstream resource.
+     *
+     * @param initialSize size of the first memory block
+     * @param upstream resource used to allocate memory blocks. getDefaultMemoryResource() is used if nullptr
+     */
+    explicit HsmMonotonicMemoryResource(const size_t initialSize = 1024, HsmMemoryResource* upstream = nullptr);
+
+    /**
+     * @brief Constructs arena which uses provided buffer as the first memory block.
+     *
+     * @param buffer external buffer. Must stay valid while arena exists
+     * @param bufferSize size of the buffer in bytes
+     * @param upstream resource used to allocate additional memory blocks. getDefaultMemoryResource() is used if nullptr
+     */
+    HsmMonotonicMemoryResource(void* buffer, const size_t bufferSize, HsmMemoryResource* upstream = nullptr);
+
+    HsmMonotonicMemoryResource(const HsmMonotonicMemoryResource&) = delete;
+    HsmMonotonicMemoryResource& operator=(const HsmMonotonicMemoryResource&) = delete;
+
+    /**
+     * @brief Destructor. Releases all memory blocks.
+     */
+    ~HsmMonotonicMemoryResource() override;
+
+    /**
+     * @brief Release all memory blocks allocated from upstream resource.
+     * @warning All objects which use this arena must be destroyed before calling release().
+     */
+    void release();
+
+protected:
+    void* doAllocate(const size_t bytes, const size_t alignment) override;
+    void doDeallocate(void* p, const size_t bytes, const size_t alignment) override;
+
+private:
+    struct BlockHeader {
+        BlockHeader* previous = nullptr;
+        size_t size = 0;
+    };
+
+    void allocateBlock(const size_t minSize);
+
+private:
+    HsmMemoryResource* mUpstream = nullptr;
+    void* mInitialBuffer = nullptr;
+    size_t mInitialBufferSize = 0;
+    BlockHeader* mLastBlock = nullptr;
+    unsigned char* mCurrent = nullptr;
+    size_t mAvailable = 0;
+    size_t mNextBlockSize = 0;
+};
+
+#ifdef HSM_HAS_STD_PMR
+/**
+ * @brief Adapter which allows to use std::pmr::memory_resource with hsmcpp.
+ * @details Available only when hsmcpp headers are included from C++17 code. Library itself can still be built as C++11.
+ *
+ * Usage example:
+ * \code{.cpp}
+ * std::pmr::monotonic_buffer_resource arena;
+ * std::pmr::synchronized_pool_resource pool;
+ * HsmPmrMemoryResource structureResource(&arena);
+ * HsmPmrMemoryResource runtimeResource(&pool);
+ * MyHsm hsm(&structureResource, &runtimeResource);
+ * \endcode
+ */
+class HsmPmrMemoryResource : public HsmMemoryResource {
+public:
+    explicit HsmPmrMemoryResource(std::pmr::memory_resource* resource)
+        : mResource(resource) {}
+
+protected:
+    void* doAllocate(const size_t bytes, const size_t alignment) override {
+        return mResource->allocate(bytes, alignment);
+    }
+
+    void doDeallocate(void* p, const size_t bytes, const size_t alignment) override {
+        mResource->deallocate(p, bytes, alignment);
+    }
+
+private:
+    std::pmr::memory_resource* mResource;
+};
+#endif  // HSM_HAS_STD_PMR
+
+/**
+ * @brief STL compatible allocator which allocates memory from HsmMemoryResource.
+ * @details Similar to std::pmr::polymorphic_allocator: resource is not propagated on copy or move assignment of
+ * containers. Moving items between containers which use different resources copies them.
+ */
+template <typename T>
+class HsmAllocator {
+public:
+    using value_type = T;
+
+    HsmAllocator() noexcept
+        : mResource(getDefaultMemoryResource()) {}
+
+    // cppcheck-suppress misra-c2012-17.8 ; implicit conversion from resource is intended (same as in std::pmr)
+    HsmAllocator(HsmMemoryResource* resource) noexcept  // NOLINT(google-explicit-constructor)
+        : mResource((nullptr != resource) ? resource : getDefaultMemoryResource()) {}
+
+    template <typename U>
+    // NOLINTNEXTLINE(google-explicit-constructor)
+    HsmAllocator(const HsmAllocator<U>& other) noexcept
+        : mResource(other.resource()) {}
+
+    T* allocate(const size_t count) {
+        return static_cast<T*>(mResource->allocate(count * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* p, const size_t count) {
+        mResource->deallocate(p, count * sizeof(T), alignof(T));
+    }
+
+    HsmMemoryResource* resource() const noexcept {
+        return mResource;
+    }
+
+private:
+    HsmMemoryResource* mResource;
+};
+
+template <typename T, typename U>
+bool operator==(const HsmAllocator<T>& left, const HsmAllocator<U>& right) noexcept {
+    return left.resource()->isEqual(*right.resource());
+}
+
+template <typename T, typename U>
+bool operator!=(const HsmAllocator<T>& left, const HsmAllocator<U>& right) noexcept {
+    return !(left == right);
+}
+
+template <typename T>
+using HsmList_t = std::list<T, HsmAllocator<T>>;  ///< std::list which uses HsmMemoryResource
+template <typename T>
+using HsmVector_t = std::vector<T, HsmAllocator<T>>;  ///< std::vector which uses HsmMemoryResource
+template <typename K, typename V, typename Compare = std::less<K>>
+using HsmMap_t = std::map<K, V, Compare, HsmAllocator<std::pair<const K, V>>>;  ///< std::map which uses HsmMemoryResource
+template <typename K, typename V, typename Compare = std::less<K>>
+using HsmMultimap_t = std::multimap<K, V, Compare, HsmAllocator<std::pair<const K, V>>>;  ///< std::multimap which uses HsmMemoryResource
+template <typename K, typename V, typename Hash = std::hash<K>>
+using HsmUnorderedMap_t = std::unordered_map<K, V, Hash, std::equal_to<K>, HsmAllocator<std::pair<const K, V>>>;  ///< std::unordered_map which uses HsmMemoryResource
+
+}  // namespace hsmcpp
+
+#endif  // HSMCPP_HSMMEMORYRESOURCE_HPP
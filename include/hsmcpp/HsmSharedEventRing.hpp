@@ -0,0 +1,192 @@
+// Copyright (C) 2024 Igor Krechetov
+// Distributed under MIT license. See file LICENSE for details
+
+#ifndef HSMCPP_HSMSHAREDEVENTRING_HPP
+#define HSMCPP_HSMSHAREDEVENTRING_HPP
+
+#include <memory>
+#include <string>
+
+#include "HsmTypes.hpp"
+
+namespace hsmcpp {
+
+class HierarchicalStateMachine;
+
+/**
+ * @brief Shared-memory ring which allows other processes to send events to HSM instances.
+ * @details Ring is a POSIX shared memory object (shm_open) with a fixed number of fixed-size slots. Each slot carries
+ * target ID, event ID and an opaque payload (up to maxPayloadSize bytes). Any number of processes can post events into the
+ * ring (multi-producer), but only the process which created it receives them (single consumer).
+ *
+ * Posting an event is lock-free: producer claims a slot, copies payload into it and publishes it. Consumer is woken up with
+ * a futex only if it was sleeping, so under load no syscalls are made on either side.
+ *
+ * Receiver process binds target IDs to HSM instances with bindTarget() and calls startReceiving(). Received events are
+ * passed to HierarchicalStateMachine::transitionWithArgsArray() of the bound HSM. If payload is not empty it's passed as a
+ * single ByteArray_t argument.
+ *
+ * Usage example:
+ * \code{.cpp}
+ * // receiver process
+ * auto ring = HsmSharedEventRing::create("/myapp_events", 256, 64);
+ * ring->bindTarget(1, hsm);
+ * ring->startReceiving();
+ *
+ * // sender process
+ * auto ring = HsmSharedEventRing::open("/myapp_events");
+ * ring->post(1, MyEvents::E1, data.data(), data.size());
+ * \endcode
+ *
+ * @remark Futex wakeups are only available on Linux. On other POSIX systems receiver polls the ring with a 1 ms interval.
+ * @warning If producer process terminates in the middle of post() the slot it claimed is never published and receiver
+ * will stop at it. Ring must be recreated in this case.
+ */
+class HsmSharedEventRing {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 256;          ///< default number of slots in the ring
+    static constexpr size_t DEFAULT_MAX_PAYLOAD_SIZE = 64;  ///< default max size of event payload (in bytes)
+
+    /**
+     * @brief Create a new ring and become its receiver.
+     * @details By default function fails if shared memory object with the same name already exists (for example, it
+     * belongs to a running receiver). Object is removed when returned instance is destroyed.
+     *
+     * @param name name of POSIX shared memory object (must start with '/')
+     * @param capacity number of slots in the ring. Minimal value is 2
+     * @param maxPayloadSize maximum size of event payload (in bytes)
+     * @param replaceExisting if true, existing object with the same name is removed first. Use it to recover after a
+     * receiver which didn't exit properly
+     *
+     * @return new ring instance or nullptr in case of error. errno is set to EEXIST if object already exists
+     *
+     * @threadsafe{ }
+     */
+    static std::shared_ptr<HsmSharedEventRing> create(const std::string& name,
+                                                      const size_t capacity = DEFAULT_CAPACITY,
+                                                      const size_t maxPayloadSize = DEFAULT_MAX_PAYLOAD_SIZE,
+                                                      const bool replaceExisting = false);
+
+    /**
+     * @brief Open existing ring to post events into it.
+     *
+     * @param name name of POSIX shared memory object which was passed to create()
+     *
+     * @details Ring geometry (capacity, slot size) is validated once and cached. Later modifications of ring header by
+     * other processes are ignored.
+     *
+     * @return ring instance or nullptr if ring doesn't exist or is not valid
+     *
+     * @threadsafe{ }
+     */
+    static std::shared_ptr<HsmSharedEventRing> open(const std::string& name);
+
+    /**
+     * @brief Destructor. Stops receiving events and unmaps shared memory. Shared memory object is removed if instance was
+     * created with create() and its name wasn't taken over by another ring (see replaceExisting parameter of create()).
+     */
+    ~HsmSharedEventRing();
+
+    HsmSharedEventRing(const HsmSharedEventRing&) = delete;
+    HsmSharedEventRing& operator=(const HsmSharedEventRing&) = delete;
+
+    /**
+     * @brief Check if this instance is a receiver of the ring.
+     *
+     * @return true if instance was created with create()
+     *
+     * @threadsafe{ }
+     */
+    bool isReceiver() const;
+
+    /**
+     * @brief Get number of slots in the ring.
+     *
+     * @threadsafe{ }
+     */
+    size_t capacity() const;
+
+    /**
+     * @brief Get maximum size of payload which can be sent with post().
+     *
+     * @threadsafe{ }
+     */
+    size_t maxPayloadSize() const;
+
+    /**
+     * @brief Send event to the HSM bound to targetId in receiver process.
+     * @details Copies payload into a free slot and wakes up receiver if it's sleeping. Function never blocks.
+     *
+     * @param targetId ID which receiver used in bindTarget()
+     * @param event ID of event to send
+     * @param payload (optional) pointer to payload data
+     * @param payloadSize size of payload data
+     *
+     * @return false if ring is full or payload is bigger than maxPayloadSize()
+     *
+     * @threadsafe{ }
+     */
+    bool post(const uint32_t targetId, const EventID_t event, const void* payload = nullptr, const size_t payloadSize = 0);
+
+    /**
+     * @brief Bind target ID to HSM instance.
+     * @details Events which were received for targets without a bound HSM are discarded and counted in
+     * getStats().droppedEvents.
+     *
+     * @param targetId ID used by senders
+     * @param hsm HSM instance which will receive events
+     *
+     * @return false if instance is not a receiver or targetId is already bound
+     *
+     * @threadsafe{ }
+     */
+    bool bindTarget(const uint32_t targetId, HierarchicalStateMachine& hsm);
+
+    /**
+     * @brief Remove binding created with bindTarget().
+     *
+     * @param targetId ID used by senders
+     *
+     * @threadsafe{ }
+     */
+    void unbindTarget(const uint32_t targetId);
+
+    /**
+     * @brief Start a thread which receives events from the ring and delivers them to bound HSMs.
+     *
+     * @return false if instance is not a receiver or thread couldn't be started
+     *
+     * @threadsafe{ }
+     */
+    bool startReceiving();
+
+    /**
+     * @brief Stop receiver thread. Events which are still in the ring are not discarded.
+     *
+     * @notthreadsafe{Must not be called from the receiver thread (for example, from HSM callbacks)}
+     */
+    void stopReceiving();
+
+    /**
+     * @brief Get ring statistics.
+     * @details pendingEvents is the number of events waiting in the ring. droppedEvents includes events rejected by post()
+     * in all processes because ring was full, events received for unbound targets and events discarded because their
+     * slot was corrupted.
+     *
+     * @return ring statistics
+     *
+     * @threadsafe{ }
+     */
+    EventsQueueStats getStats() const;
+
+private:
+    class Impl;
+
+    explicit HsmSharedEventRing(const std::shared_ptr<Impl>& impl);
+
+    std::shared_ptr<Impl> mImpl;
+};
+
+}  // namespace hsmcpp
+
+#endif  // HSMCPP_HSMSHAREDEVENTRING_HPP
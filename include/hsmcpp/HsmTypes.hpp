@@ -8,6 +8,8 @@
 #ifndef HSMCPP_HSMTYPES_HPP
 #define HSMCPP_HSMTYPES_HPP
 
+#include <cstddef>
+#include <cstdint>
 #include <functional>
 
 #include "variant.hpp"
@@ -19,6 +21,31 @@ using HandlerID_t = int32_t;  ///< Handler ID returned by dispatchers for events
 using TimerID_t = int32_t;
 using EventID_t = int32_t;  ///< Type representing HSM event ID. Used when working with HierarchicalStateMachine class.
 using StateID_t = int32_t;  ///< Type representing HSM state ID. Used when working with HierarchicalStateMachine class.
+/** Type representing subscription ID returned by HierarchicalStateMachine::subscribeStateChanges(). */
+using SubscriptionID_t = int32_t;
+/** Type identifying payload type of an event. Use HsmPayloadType<T>::id() to get ID of a specific type. */
+using PayloadTypeID_t = const void*;
+
+/**
+ * @brief Provides unique ID for an event payload type without relying on RTTI.
+ * @details See HierarchicalStateMachine::registerEventPayload() for details.
+ * @tparam Payload event payload type
+ */
+template <typename Payload>
+struct HsmPayloadType {
+    /**
+     * @brief Returns ID of the Payload type.
+     */
+    static PayloadTypeID_t id() {
+        return &marker;
+    }
+
+private:
+    static const char marker;
+};
+
+template <typename Payload>
+const char HsmPayloadType<Payload>::marker = 0;
 
 /** This macro can be used to indicate to sync API of HierarchicalStateMachine to wait indefinitely for an operation to finish. */
 constexpr int HSM_WAIT_INDEFINITELY = 0;
@@ -34,6 +61,12 @@ constexpr hsmcpp::TimerID_t INVALID_HSM_TIMER_ID = static_cast<hsmcpp::TimerID_t
 
 /** Invalid dispatcher handler ID. Used in relation with HandlerID_t type. */
 constexpr hsmcpp::HandlerID_t INVALID_HSM_DISPATCHER_HANDLER_ID = 0;
+/** Invalid state changes subscription ID. Used in relation with SubscriptionID_t type. */
+constexpr hsmcpp::SubscriptionID_t INVALID_HSM_SUBSCRIPTION_ID = 0;
+
+/** Value for queue size limits which indicates that queue is not limited. Used with
+ * HierarchicalStateMachine::setPendingEventsLimit() and HsmEventDispatcherBase::setPendingEventsLimit(). */
+constexpr size_t HSM_QUEUE_UNLIMITED = 0;
 
 /**
  * Function type for HierarchicalStateMachine transition callbacks.
@@ -88,6 +121,8 @@ using HsmTransitionFailedCallback_t = std::function<void(const std::list<StateID
 #define HsmStateExitCallbackPtr_t(_class, _func) bool (_class::*_func)()
 // cppcheck-suppress misra-c2012-20.7
 #define HsmTransitionFailedCallbackPtr_t(_class, _func) void (_class::*_func)(const std::list<StateID_t>&, const EventID_t, const VariantVector_t&)
+// cppcheck-suppress misra-c2012-20.7
+#define HsmEventDroppedCallbackPtr_t(_class, _func) void (_class::*_func)(const EventID_t, const VariantVector_t&, const EventDropReason)
 
 /**
  * @enum HistoryType
@@ -132,6 +167,132 @@ enum class StateAction {
     TRANSITION,     ///< **Arguments**: EventID_t eventID
 };
 
+/**
+ * @enum QueueOverflowPolicy
+ * @brief Defines what happens with a new event when pending events queue reached it's limit.
+ * @details See HierarchicalStateMachine::setPendingEventsLimit() for details.
+ */
+enum class QueueOverflowPolicy {
+    BLOCK,        ///< block producer until queue has free space or timeout expires (new event is dropped on timeout)
+    DROP_NEWEST,  ///< drop new event
+    DROP_OLDEST,  ///< drop the oldest pending event to free space for the new one
+    COALESCE      ///< replace the most recent pending event with the same ID (new event is dropped if there is no such event)
+};
+
+/**
+ * @enum DispatcherFairnessPolicy
+ * @brief Defines in which order dispatcher calls event handlers which have pending events.
+ * @details See HsmEventDispatcherBase::setFairnessPolicy() for details.
+ */
+enum class DispatcherFairnessPolicy {
+    FIFO,                ///< handlers are called in the same order as events were emitted (default)
+    ROUND_ROBIN,         ///< each handler with pending events is called once per dispatching round
+    DEFICIT_ROUND_ROBIN  ///< each handler with pending events gets a service time quota per dispatching round
+};
+
+/**
+ * @enum ShardPlacementPolicy
+ * @brief Defines how HsmDispatcherGroup selects a dispatcher for a new HSM.
+ */
+enum class ShardPlacementPolicy {
+    HASH,         ///< dispatcher is selected based on a user provided key (same key always maps to the same dispatcher)
+    LEAST_LOADED  ///< dispatcher with the smallest number of attached HSMs is selected
+};
+
+/**
+ * @enum EventDropReason
+ * Defines why an event was removed from the pending events queue without being processed.
+ */
+enum class EventDropReason {
+    QUEUE_OVERFLOW,  ///< event was dropped because pending events queue reached it's limit
+    COALESCED,       ///< event was replaced by a newer event with the same ID
+    EXPIRED          ///< event spent more time in the queue than it's TTL allows
+};
+
+/**
+ * Function type for HierarchicalStateMachine dropped event callbacks. Callback is called whenever an event was removed from
+ * the pending events queue without being processed.
+ *
+ * @param EventID_t id of the event which was dropped
+ * @param VariantVector_t \c args value provided in HierarchicalStateMachine::transition() or similar API
+ * @param EventDropReason reason why event was dropped
+ */
+using HsmEventDroppedCallback_t = std::function<void(const EventID_t, const VariantVector_t&, const EventDropReason)>;
+
+/**
+ * @enum TransitionResult
+ * Defines outcome of an asynchronous transition.
+ */
+enum class TransitionResult {
+    SUCCEEDED,  ///< event was processed and transition was successfully finished
+    FAILED,     ///< event was processed, but no matching transitions were found or transition failed
+    CANCELED    ///< event was removed from the queue without being processed (dropped, expired, canceled, etc.)
+};
+
+/**
+ * Function type for HierarchicalStateMachine::transitionAsync() completion callbacks.
+ *
+ * @param EventID_t id of the event which was sent with transitionAsync()
+ * @param TransitionResult outcome of the transition
+ */
+using HsmTransitionCompletedCallback_t = std::function<void(const EventID_t, const TransitionResult)>;
+
+/**
+ * Function type for executors used to deliver transitionAsync() completion callbacks. Executor must run provided task
+ * (immediately or later) on any thread of it's choice.
+ *
+ * @param std::function<void()> task to execute
+ */
+using HsmCompletionExecutor_t = std::function<void(std::function<void()>)>;
+
+/**
+ * Function type for HierarchicalStateMachine::waitForStateAsync() callbacks.
+ *
+ * @param StateID_t id of the state which was awaited
+ * @param bool true if state became active, false if timeout expired or HSM was released
+ */
+using HsmStateWaitCallback_t = std::function<void(const StateID_t, const bool)>;
+
+/**
+ * Function type for HierarchicalStateMachine::subscribeStateChanges() callbacks.
+ *
+ * @param StateID_t id of the state which was activated or deactivated
+ * @param bool true if state became active, false if state became inactive
+ */
+using HsmStateSubscriptionCallback_t = std::function<void(const StateID_t, const bool)>;
+
+/**
+ * Function type for filtering pending events.
+ *
+ * @param EventID_t id of the pending event
+ * @param VariantVector_t \c args value provided in HierarchicalStateMachine::transition() or similar API
+ * @return true if event matches the filter
+ */
+using HsmEventFilterCallback_t = std::function<bool(const EventID_t, const VariantVector_t&)>;
+
+/**
+ * @brief Contains statistics of a pending events queue.
+ * @details Can be used for monitoring purposes. Counters are cumulative since object creation.
+ */
+struct EventsQueueStats {
+    size_t pendingEvents = 0;      ///< current number of events in the queue
+    size_t maxPendingEvents = 0;   ///< highest number of events which were in the queue at the same time
+    uint64_t droppedEvents = 0;    ///< number of events dropped due to queue overflow
+    uint64_t coalescedEvents = 0;  ///< number of pending events which were replaced by newer events with the same ID
+    uint64_t expiredEvents = 0;    ///< number of events which were discarded because their TTL expired
+    uint64_t canceledEvents = 0;   ///< number of events which were removed with cancelPendingEvents()
+};
+
+/**
+ * @brief Contains service time statistics of a dispatcher event handler.
+ * @details See HsmEventDispatcherBase::getHandlerServiceStats() for details.
+ */
+struct HandlerServiceStats {
+    uint64_t calls = 0;               ///< number of measured handler calls
+    uint64_t totalServiceTimeUs = 0;  ///< total time spent in the handler (microseconds)
+    uint64_t maxServiceTimeUs = 0;    ///< longest handler call (microseconds)
+};
+
 }  // namespace hsmcpp
 
-#endif  // HSMCPP_HSMTYPES_HPP
\ No newline at end of file
+#endif  // HSMCPP_HSMTYPES_HPP
@@ -0,0 +1,353 @@
+// Copyright (C) 2024 Igor Krechetov
+// Distributed under MIT license. See file LICENSE for details
+
+#ifndef HSMCPP_VARIANTSERIALIZER_HPP
+#define HSMCPP_VARIANTSERIALIZER_HPP
+
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "variant.hpp"
+
+namespace hsmcpp {
+
+class VariantViewIterator;
+
+/**
+ * @brief Read-only view of a Variant value encoded by VariantSerializer.
+ * @details View points directly into the encoded buffer and doesn't copy any data. Strings and byte arrays can be accessed
+ * with data() and size(). Items of containers are returned as views too.
+ *
+ * Whole buffer is validated by parse(), so accessing a valid view never reads outside of the buffer.
+ *
+ * @warning View doesn't own the buffer. Buffer must stay alive and unchanged while view (or any of its items) is used.
+ */
+class VariantView {
+public:
+    /**
+     * @brief Constructs an invalid view.
+     */
+    VariantView() = default;
+
+    /**
+     * @brief Creates a view of the value encoded with VariantSerializer::serialize().
+     *
+     * @param data encoded data
+     * @param size size of encoded data in bytes
+     *
+     * @return view of the value or invalid view if data is malformed or was encoded with unsupported format version
+     */
+    static VariantView parse(const unsigned char* data, const size_t size);
+
+    /**
+     * @brief Check if view points to a valid value.
+     */
+    bool isValid() const;
+
+    /**
+     * @brief Get type of the encoded value.
+     * @return type of the value or Variant::Type::UNKNOWN if view is not valid
+     */
+    Variant::Type getType() const;
+
+    /**
+     * @brief Returns numeric value of the view.
+     * @details Supported types: numeric types, Type::DOUBLE and Type::BOOL.
+     * @return numeric value or 0 if type is not supported
+     */
+    int64_t toInt64() const;
+
+    /**
+     * @brief Returns numeric value of the view.
+     * @copydetails toInt64()
+     */
+    uint64_t toUInt64() const;
+
+    /**
+     * @brief Returns numeric value of the view.
+     * @copydetails toInt64()
+     */
+    double toDouble() const;
+
+    /**
+     * @brief Returns boolean value of the view.
+     * @copydetails toInt64()
+     */
+    bool toBool() const;
+
+    /**
+     * @brief Returns a copy of the string value.
+     * @return string value or empty string if type is not Type::STRING
+     */
+    std::string toString() const;
+
+    /**
+     * @brief Returns pointer to encoded data of Type::STRING, Type::BYTEARRAY or Type::CUSTOM value.
+     * @remark Strings are not null-terminated.
+     * @return pointer into the encoded buffer or nullptr for other types
+     */
+    const unsigned char* data() const;
+
+    /**
+     * @brief Returns size (in bytes) of data().
+     */
+    size_t size() const;
+
+    /**
+     * @brief Returns number of items in Type::LIST or Type::VECTOR or number of key-value pairs in Type::MAP.
+     */
+    size_t count() const;
+
+    /**
+     * @brief Returns iterator to the first item of Type::LIST, Type::VECTOR, Type::MAP or Type::PAIR.
+     * @details See VariantViewIterator for details. For other types begin() is equal to end().
+     */
+    VariantViewIterator begin() const;
+
+    /**
+     * @brief Returns iterator which follows the last item of a container.
+     */
+    VariantViewIterator end() const;
+
+    /**
+     * @brief Returns item of Type::LIST or Type::VECTOR.
+     * @remark Complexity is linear in the number of encoded bytes before the item. Use begin() and end() to access all
+     * items.
+     *
+     * @param index index of the item
+     * @return view of the item or invalid view if index or type are not valid
+     */
+    VariantView at(const size_t index) const;
+
+    /**
+     * @brief Returns key of Type::MAP item.
+     * @copydetails at()
+     */
+    VariantView key(const size_t index) const;
+
+    /**
+     * @brief Returns value of Type::MAP item.
+     * @copydetails at()
+     */
+    VariantView value(const size_t index) const;
+
+    /**
+     * @brief Returns first element of Type::PAIR.
+     */
+    VariantView first() const;
+
+    /**
+     * @brief Returns second element of Type::PAIR.
+     */
+    VariantView second() const;
+
+    /**
+     * @brief Returns number of bytes used to encode this value (including nested values).
+     */
+    size_t encodedSize() const;
+
+private:
+    friend class VariantSerializer;
+    friend class VariantViewIterator;
+
+    VariantView child(const size_t index) const;
+    static size_t parseValue(const unsigned char* data, const size_t size, const unsigned int depth, VariantView& view);
+
+    Variant::Type mType = Variant::Type::UNKNOWN;
+    const unsigned char* mEncoded = nullptr;  // beginning of the encoded value
+    size_t mEncodedSize = 0;
+    uint64_t mScalar = 0;                     // numeric values (zigzag-decoded for signed types)
+    const unsigned char* mPayload = nullptr;  // bytes of STRING/BYTEARRAY/CUSTOM or first item of a container
+    size_t mPayloadSize = 0;                  // bytes of STRING/BYTEARRAY/CUSTOM or encoded size of container items
+    size_t mCount = 0;                        // number of encoded child values
+};
+
+/**
+ * @brief Forward iterator over items of a container view.
+ * @details Each item is parsed only once, so iterating over all items is linear in the encoded size (unlike calling
+ * VariantView::at() in a loop). Items of Type::MAP are returned as a flat sequence: key of the first pair, its value,
+ * key of the second pair, etc.
+ *
+ * @remark Item returned by dereferencing the iterator is owned by the iterator and is changed when iterator is
+ * incremented. Copy it if it's needed later (views are cheap to copy).
+ *
+ * Usage example:
+ * \code{.cpp}
+ * for (const VariantView& item : view) {
+ *     sum += item.toInt64();
+ * }
+ * \endcode
+ */
+class VariantViewIterator {
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = VariantView;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const VariantView*;
+    using reference = const VariantView&;
+
+    /**
+     * @brief Constructs end iterator.
+     */
+    VariantViewIterator() = default;
+
+    reference operator*() const;
+    pointer operator->() const;
+    VariantViewIterator& operator++();
+    VariantViewIterator operator++(int);
+    bool operator==(const VariantViewIterator& other) const;
+    bool operator!=(const VariantViewIterator& other) const;
+
+private:
+    friend class VariantView;
+
+    VariantViewIterator(const unsigned char* data, const size_t size, const size_t itemsCount);
+    void parseItem();
+
+    const unsigned char* mData = nullptr;  // beginning of the current item
+    size_t mSize = 0;                      // number of bytes from the current item till the end of container
+    size_t mItemsLeft = 0;                 // number of items left (including current one)
+    VariantView mItem;
+};
+
+/**
+ * @brief Compact binary encoding of Variant and VariantVector_t.
+ * @details Encoded data starts with format version byte which is followed by a single value. Each value starts with one
+ * byte containing its Variant::Type:
+ *  \li integers are stored as LEB128 varints (signed types are zigzag-encoded first)
+ *  \li Type::DOUBLE is stored as 8 bytes (IEEE 754, little-endian)
+ *  \li Type::BOOL is stored as 1 byte
+ *  \li Type::STRING, Type::BYTEARRAY and Type::CUSTOM are stored as varint length followed by raw bytes
+ *  \li Type::LIST, Type::VECTOR and Type::MAP are stored as varint items count followed by items (map items are stored as
+ *      key followed by value)
+ *  \li Type::PAIR is stored as first value followed by second value
+ *
+ * VariantVector_t is encoded as a Type::VECTOR value, so it can be decoded both as VariantVector_t or as Variant.
+ *
+ * Variant doesn't know the actual type of Type::CUSTOM values, so they can be encoded only if custom type handlers were
+ * provided. Encoder must write a self-describing representation (for example, prefixed with application-specific type ID)
+ * which decoder will be able to recognize.
+ *
+ * Usage example:
+ * \code{.cpp}
+ * VariantSerializer serializer;
+ * ByteArray_t buffer;
+ *
+ * serializer.serialize(args, buffer);
+ * ...
+ * VariantVector_t decodedArgs;
+ * serializer.deserialize(buffer.data(), buffer.size(), decodedArgs);
+ * \endcode
+ *
+ * @remark Nesting of containers is limited to MAX_NESTING_DEPTH levels to protect decoder from malicious input.
+ */
+class VariantSerializer {
+public:
+    static constexpr unsigned char FORMAT_VERSION = 1;      ///< current version of encoding format
+    static constexpr unsigned int MAX_NESTING_DEPTH = 32;  ///< maximum nesting level of containers
+
+    /**
+     * @brief Encodes value of Type::CUSTOM variant.
+     *
+     * @param value variant of Type::CUSTOM
+     * @param output buffer to append encoded data to
+     *
+     * @return false if value can't be encoded
+     */
+    using CustomEncoderFunc_t = std::function<bool(const Variant& value, ByteArray_t& output)>;
+
+    /**
+     * @brief Decodes data which was created by CustomEncoderFunc_t.
+     *
+     * @param data encoded data
+     * @param size size of encoded data
+     * @param output decoded value
+     *
+     * @return false if data can't be decoded
+     */
+    using CustomDecoderFunc_t = std::function<bool(const unsigned char* data, const size_t size, Variant& output)>;
+
+public:
+    VariantSerializer() = default;
+
+    /**
+     * @brief Constructs serializer with custom type handlers.
+     * @copydetails setCustomTypeHandlers()
+     */
+    VariantSerializer(const CustomEncoderFunc_t& encoder, const CustomDecoderFunc_t& decoder);
+
+    /**
+     * @brief Set handlers used to encode and decode Type::CUSTOM values.
+     *
+     * @param encoder custom values encoder
+     * @param decoder custom values decoder
+     *
+     * @notthreadsafe{Handlers must not be changed while serializer is used by other threads}
+     */
+    void setCustomTypeHandlers(const CustomEncoderFunc_t& encoder, const CustomDecoderFunc_t& decoder);
+
+    /**
+     * @brief Encode a single value.
+     *
+     * @param value value to encode
+     * @param output buffer to append encoded data to. In case of an error buffer is restored to its original size.
+     *
+     * @return false if value contains Type::CUSTOM which couldn't be encoded or nesting is too deep
+     *
+     * @threadsafe{ }
+     */
+    bool serialize(const Variant& value, ByteArray_t& output) const;
+
+    /**
+     * @brief Encode event arguments.
+     * @copydetails serialize(const Variant&, ByteArray_t&) const
+     */
+    bool serialize(const VariantVector_t& values, ByteArray_t& output) const;
+
+    /**
+     * @brief Decode a single value.
+     *
+     * @param data encoded data
+     * @param size size of encoded data
+     * @param output decoded value
+     *
+     * @return false if data is malformed or contains Type::CUSTOM values which couldn't be decoded
+     *
+     * @threadsafe{ }
+     */
+    bool deserialize(const unsigned char* data, const size_t size, Variant& output) const;
+
+    /**
+     * @brief Decode event arguments.
+     * @details Data must contain a value of Type::VECTOR.
+     * @copydetails deserialize(const unsigned char*, const size_t, Variant&) const
+     */
+    bool deserialize(const unsigned char* data, const size_t size, VariantVector_t& output) const;
+
+    /**
+     * @brief Convert view to a Variant object.
+     *
+     * @param view valid view
+     * @param output decoded value
+     *
+     * @return false if view is not valid or contains Type::CUSTOM values which couldn't be decoded
+     *
+     * @threadsafe{ }
+     */
+    bool toVariant(const VariantView& view, Variant& output) const;
+
+private:
+    bool encodeValue(const Variant& value, const unsigned int depth, ByteArray_t& output) const;
+    bool encodeVector(const VariantVector_t& values, const unsigned int depth, ByteArray_t& output) const;
+
+private:
+    CustomEncoderFunc_t mCustomEncoder;
+    CustomDecoderFunc_t mCustomDecoder;
+};
+
+}  // namespace hsmcpp
+
+#endif  // HSMCPP_VARIANTSERIALIZER_HPP
@@ -4,9 +4,12 @@
 #ifndef HSMCPP_HSM_HPP
 #define HSMCPP_HSM_HPP
 
+#include <functional>
 #include <list>
 #include <memory>
 #include <string>
+#include <type_traits>
+#include <utility>
 
 #include "HsmTypes.hpp"
 #include "variant.hpp"
@@ -14,6 +17,9 @@
 namespace hsmcpp {
 
 class IHsmEventDispatcher;
+class HsmMemoryResource;
+class HsmGroup;
+class HsmDispatcherGroup;
 
 /**
  * @brief Implements a Hierarchical State Machine (HSM) for event-driven systems.
@@ -41,6 +47,29 @@ public:
      */
     explicit HierarchicalStateMachine(const StateID_t initialState);
 
+    /**
+     * @brief Constructor which allocates internal containers of the HSM from custom memory resources.
+     *
+     * @details Structure of the HSM (states, substates, transitions, actions, timers, history, etc.) is allocated from
+     * structureResource. It's modified only during HSM setup, so an arena (HsmMonotonicMemoryResource,
+     * std::pmr::monotonic_buffer_resource) is a good fit. Objects which are created and destroyed while HSM is running
+     * (pending events with their arguments, running timers, state waiters, etc.) are allocated from runtimeResource.
+     * Use a pool for it (for example std::pmr::synchronized_pool_resource).
+     *
+     * Active states list returned by getActiveStates(), temporary objects of transition logic and user callbacks still
+     * use the global heap.
+     *
+     * @param initialState The initial state of the HSM.
+     * @param structureResource resource for HSM structure. Global heap is used if nullptr
+     * @param runtimeResource resource for runtime objects. Global heap is used if nullptr. Resource must be thread-safe if
+     * HSM is accessed from multiple threads.
+     *
+     * @warning Both resources must outlive the HSM.
+     */
+    HierarchicalStateMachine(const StateID_t initialState,
+                             HsmMemoryResource* structureResource,
+                             HsmMemoryResource* runtimeResource);
+
     /**
      * @brief Destructor.
 
@@ -114,6 +143,28 @@ public:
      */
     void release();
 
+    /**
+     * @brief Moves initialized HSM to a different dispatcher.
+     * @details Registers HSM's handlers with the new dispatcher and unregisters them from the old one. Events which are already
+     * in HSM's queue are preserved and will be processed by the new dispatcher. Timers started by HSM are restarted in the new
+     * dispatcher with their remaining time (repeating timers keep their interval after the first expiration).
+     *
+     * If HSM is currently processing an event on the old dispatcher's thread, function blocks until it's done.
+     *
+     * Events enqueued with transitionInterruptSafe() which were not processed yet by the old dispatcher are forwarded to
+     * HSM's queue once old dispatcher handles them. For this HSM keeps its enqueued events handler registered in the old
+     * dispatcher until release() is called.
+     *
+     * @warning Timer IDs must be unique within the new dispatcher.
+     *
+     * @param dispatcher new dispatcher for the HSM. HSM doesn't take ownership of the dispatcher.
+     * @return true if HSM was moved to the new dispatcher (or already uses it), false otherwise. Returns false if called
+     * from HSM callbacks (on platforms without STL such calls are not detected and result in a deadlock).
+     *
+     * @threadsafe{Must not be called from HSM callbacks. Uses IHsmEventDispatcher::start() of the new dispatcher.}
+     */
+    bool migrate(const std::weak_ptr<IHsmEventDispatcher>& dispatcher);
+
     /**
      * @brief Registers a callback function to be called when a transition fails.
      * @details Transition failure is usually caused by:
@@ -137,6 +188,26 @@ public:
     void registerFailedTransitionCallback(HsmHandlerClass* handler,
                                           HsmTransitionFailedCallbackPtr_t(HsmHandlerClass, onFailedTransition));
 
+    /**
+     * @brief Registers a callback function to be called when a pending event is dropped without being processed.
+     * @details Events can be dropped when pending events queue reaches it's limit (see setPendingEventsLimit()). Callback is
+     * executed on the thread which caused the event to be dropped (usually the one calling transition()).
+     *
+     * @param onEventDropped The callback function to be called when event is dropped.
+     *
+     * @concurrencysafe{ }
+     */
+    void registerDroppedEventCallback(HsmEventDroppedCallback_t onEventDropped);
+
+    /**
+     * @brief Registers a class member as a callback function to be called when a pending event is dropped.
+     * @copydetails registerDroppedEventCallback()
+     *
+     * @param handler Pointer to an object whose class members will be used as callbacks.
+     */
+    template <class HsmHandlerClass>
+    void registerDroppedEventCallback(HsmHandlerClass* handler, HsmEventDroppedCallbackPtr_t(HsmHandlerClass, onEventDropped));
+
     /**
      * @brief Registers a new state and optional state callbacks.
      *
@@ -311,6 +382,63 @@ public:
      */
     void registerTimer(const TimerID_t timerID, const EventID_t event);
 
+    /**
+     * @brief Registers event as coalesced (latest-wins).
+     * @details When a new event with this ID is sent while another event with the same ID is still pending, the pending
+     * event is replaced by the new one (including it's arguments) instead of adding one more event to the queue. Replaced
+     * event keeps it's position in the queue. Useful for level-style events (sensor readings, configuration updates, etc.)
+     * where only the latest value matters.
+     *
+     * Replaced events are reported to the callback registered by registerDroppedEventCallback() with
+     * EventDropReason::COALESCED. Synchronous transitions which were waiting for a replaced event are unblocked and return
+     * false.
+     *
+     * @remark Replacing a pending event takes constant time and doesn't require free space in the queue even if
+     * setPendingEventsLimit() was used.
+     *
+     * @param event ID of the event
+     *
+     * @notthreadsafe{Calling thing API from multiple threads can cause data races and will result in undefined behavior}
+     */
+    void registerCoalescedEvent(const EventID_t event);
+
+    /**
+     * @brief Sets time-to-live for events with specified ID.
+     * @details Events which spent more than ttlMs milliseconds in the pending events queue are considered outdated. They
+     * are discarded right before dispatching without executing any transitions or callbacks. This allows to cheaply shed
+     * load when HSM is not able to keep up with incoming events.
+     *
+     * Expired events are reported to the callback registered by registerDroppedEventCallback() with
+     * EventDropReason::EXPIRED and are counted in EventsQueueStats::expiredEvents. Synchronous transitions which were
+     * waiting for an expired event are unblocked and return false.
+     *
+     * @remark TTL is applied only to events added after this call. Internal events (entry points, history, final
+     * states) never expire.
+     *
+     * @param event ID of the event
+     * @param ttlMs maximum time (in milliseconds) event can spend in the queue. Use HSM_WAIT_INDEFINITELY to remove TTL.
+     *
+     * @threadsafe{ }
+     */
+    void registerEventTTL(const EventID_t event, const int ttlMs);
+
+    /**
+     * @brief Declares type of the payload carried by an event.
+     * @details Events with a registered payload type can be sent with transitionWithPayload(). Payload is moved into the
+     * pending events queue as is (without converting it to a list of Variant objects) and callbacks created with
+     * withPayload() receive it as "const Payload&". Only the payload object itself is allocated on the heap.
+     *
+     * Regular transition() API and callbacks which expect VariantVector_t can still be used with such events. Events sent
+     * with transitionWithPayload() are passed to these callbacks with an empty arguments list.
+     *
+     * @tparam Payload type of the payload. Must be copy or move constructible.
+     * @param event ID of the event
+     *
+     * @notthreadsafe{Calling thing API from multiple threads can cause data races and will result in undefined behavior}
+     */
+    template <typename Payload>
+    void registerEventPayload(const EventID_t event);
+
     // TODO: add support for transition actions
     /**
      * @brief Registers a state action with optional arguments.
@@ -425,18 +553,101 @@ public:
      * @brief Get the list of currently active states.
      *
      * @return list of currently active states.
+     *
+     * @notthreadsafe{Returned list is modified by the dispatcher. Use getActiveStatesSnapshot() to access active states
+     * from other threads}
      */
     const std::list<StateID_t>& getActiveStates() const;
 
+    /**
+     * @brief Get a copy of currently active states.
+     * @details Active states are published by the dispatcher after every change, so this function doesn't require any locks
+     * and never blocks HSM from processing events. Returned list is always consistent (it never contains a partially
+     * applied change), but could become outdated immediately after the call.
+     *
+     * @return copy of currently active states.
+     *
+     * @threadsafe{ }
+     */
+    std::list<StateID_t> getActiveStatesSnapshot() const;
+
     /**
      * @brief Check if a state is active.
-     * @details This function checks if a specific state is currently active in the HSM.
+     * @details This function checks if a specific state is currently active in the HSM. Same as getActiveStatesSnapshot(),
+     * it doesn't block HSM from processing events.
      *
      * @param state ID of the state to check
      * @return True if the state is active, false otherwise.
+     *
+     * @threadsafe{ }
      */
     bool isStateActive(const StateID_t state) const;
 
+    /**
+     * @brief Get notified when a state becomes active.
+     * @details Callback is called exactly once:
+     *      \li immediately (on the caller's thread) if state is already active
+     *      \li on the dispatcher's thread with true when state becomes active
+     *      \li on the dispatcher's thread with false when timeoutMs expires
+     *      \li with false if HSM is not initialized or is released before state becomes active
+     *
+     * Waiters are notified directly when HSM changes it's state, so no polling is needed.
+     *
+     * @remark Timeouts are implemented using dispatcher's timers with IDs lower than INVALID_HSM_TIMER_ID. Don't use such IDs
+     * for your own timers if you are using this API.
+     * @warning Callback must not block since it's usually called on the dispatcher's thread.
+     *
+     * @param state ID of the state to wait for
+     * @param timeoutMs maximum time to wait in milliseconds. Use HSM_WAIT_INDEFINITELY to wait indefinitely.
+     * @param onCompleted callback to call when state becomes active or timeout expires
+     *
+     * @threadsafe{ }
+     */
+    void waitForStateAsync(const StateID_t state, const int timeoutMs, HsmStateWaitCallback_t onCompleted);
+
+    /**
+     * @brief Block current thread until a state becomes active.
+     * @details Waiting thread is woken up directly by the dispatcher when state is activated (no polling is used). All
+     * threads waiting on the same HSM share a single notification primitive.
+     *
+     * @warning Calling this function from HSM callbacks will block events processing and will result in a deadlock if
+     * timeoutMs is set to HSM_WAIT_INDEFINITELY.
+     * @remark If HSM was built with HSM_DISABLE_THREADSAFETY this function doesn't block and works same as isStateActive().
+     *
+     * @param state ID of the state to wait for
+     * @param timeoutMs maximum time to wait in milliseconds. Use HSM_WAIT_INDEFINITELY to wait indefinitely.
+     * @return true if state is active, false if timeout expired, HSM is not initialized or was released while waiting.
+     *
+     * @threadsafe{ }
+     */
+    bool waitForState(const StateID_t state, const int timeoutMs = HSM_WAIT_INDEFINITELY);
+
+    /**
+     * @brief Subscribe to activation and deactivation of states.
+     * @details Callback is called on the dispatcher's thread every time one of the states is added to or removed from the
+     * list of active states. It's called in the middle of a transition, before state's own onStateChanged callback.
+     *
+     * @warning Callback must not block or wait for HSM transitions since it's called on the dispatcher's thread.
+     * @remark Callback could be called once more after unsubscribeStateChanges() if it's executed in parallel with
+     * notification.
+     *
+     * @param states list of states to monitor
+     * @param onChanged callback to call when one of the states changes
+     * @return subscription ID or INVALID_HSM_SUBSCRIPTION_ID if states list is empty or callback is not set
+     *
+     * @threadsafe{ }
+     */
+    SubscriptionID_t subscribeStateChanges(const std::list<StateID_t>& states, HsmStateSubscriptionCallback_t onChanged);
+
+    /**
+     * @brief Remove subscription created with subscribeStateChanges().
+     *
+     * @param id subscription ID
+     *
+     * @threadsafe{ }
+     */
+    void unsubscribeStateChanges(const SubscriptionID_t id);
+
     /**
      * @brief Trigger a transition in the HSM.
      * @details This function sends event to HSM to trigger a potential transition. The transition is executed asynchronously,
@@ -468,9 +679,11 @@ public:
      * HSM_WAIT_INDEFINITELY to wait indefinitely.
      * @param args (optional) arguments to pass to the callbacks
      *
-     * @return always returns true if sync=false.
+     * @retval true (if sync=false) event was added to the pending events queue
+     * @retval false (if sync=false) event was dropped because pending events queue reached it's limit
      * @retval true (if sync=true) event was accepted and transition successfully finished
-     * @retval false (if sync=true) no matching transitions were found, transition was canceled or timeoutMs expired
+     * @retval false (if sync=true) no matching transitions were found, transition was canceled, event was dropped or timeoutMs
+     * expired
      *
      * @threadsafe{ }
      */
@@ -493,6 +706,114 @@ public:
                                    const int timeoutMs,
                                    VariantVector_t&& args);
 
+    /**
+     * @brief Trigger a transition in the HSM and get notified when it's finished.
+     * @details Non-blocking alternative to transitionSync(). The event is processed asynchronously and onCompleted callback
+     * is called exactly once with the outcome of the transition:
+     *      \li TransitionResult::SUCCEEDED - transition was successfully finished
+     *      \li TransitionResult::FAILED - no matching transitions were found or transition failed
+     *      \li TransitionResult::CANCELED - event was dropped, replaced, expired or canceled before being processed
+     *
+     * By default the callback is called on the dispatcher's thread. Events which were dropped or canceled are reported on the
+     * thread which caused it (for example the one calling cancelPendingEvents()). Use setCompletionExecutor() to deliver
+     * callbacks somewhere else.
+     *
+     * If HSM is not initialized callback is called immediately with TransitionResult::CANCELED.
+     *
+     * @warning Callback must not block when it's called on the dispatcher's thread since this will block events processing.
+     *
+     * @param event ID of event to send to HSM
+     * @param onCompleted callback to call when transition is finished
+     * @param args (optional) arguments to pass to the callbacks
+     *
+     * @retval true event was added to the pending events queue
+     * @retval false event was dropped or HSM is not initialized
+     *
+     * @threadsafe{ }
+     */
+    template <typename... Args>
+    bool transitionAsync(const EventID_t event, HsmTransitionCompletedCallback_t onCompleted, Args&&... args);
+
+    /**
+     * @brief Trigger a transition in the HSM with arguments passed as a vector and get notified when it's finished.
+     * @copydetails transitionAsync()
+     */
+    bool transitionAsyncWithArgsArray(const EventID_t event, HsmTransitionCompletedCallback_t onCompleted, VariantVector_t&& args);
+
+    /**
+     * @brief Trigger a transition in the HSM with a typed payload.
+     * @details Payload is moved (or copied if it's an lvalue) into the pending events queue. Internal events caused by this
+     * transition (entry points, history and final states) share the same payload object. Use withPayload() to create
+     * callbacks which receive the payload.
+     *
+     * Usage example:
+     * \code{.cpp}
+     * struct Frame {
+     *     uint32_t id;
+     *     std::vector<uint8_t> data;
+     * };
+     *
+     * hsm.registerEventPayload<Frame>(EVENT_FRAME);
+     * hsm.registerTransition(STATE_IDLE, STATE_RECEIVING, EVENT_FRAME, hsm.withPayload<Frame>([](const Frame& frame) {
+     *     ...
+     * }));
+     * ...
+     * hsm.transitionWithPayload(EVENT_FRAME, std::move(frame));
+     * \endcode
+     *
+     * @param event ID of event to send to HSM. Event must be registered with registerEventPayload() using the same type.
+     * @param payload payload of the event
+     * @param sync indicates whether to wait for the transition to complete before returning (see transitionEx())
+     * @param timeoutMs maximum time in milliseconds to wait for the transition to complete if sync is true
+     *
+     * @retval true (if sync=false) event was added to the pending events queue
+     * @retval true (if sync=true) event was accepted and transition successfully finished
+     * @retval false event wasn't registered with this payload type, event was dropped, transition failed or HSM is not
+     * initialized
+     *
+     * @threadsafe{ }
+     */
+    template <typename Payload>
+    bool transitionWithPayload(const EventID_t event,
+                               Payload&& payload,
+                               const bool sync = false,
+                               const int timeoutMs = HSM_WAIT_INDEFINITELY);
+
+    /**
+     * @brief Creates a callback which receives typed event payload.
+     * @details Returned object can be used as a transition, condition, state changed or state entering callback. When
+     * it's triggered by an event sent with transitionWithPayload() func is called with a reference to the event's payload.
+     * If current event doesn't carry a payload of type Payload (for example, state is entered because of a different
+     * event), func is not called and callback returns a default value (false for condition and entering callbacks).
+     *
+     * @remark Payload is valid only while the event is processed. Don't keep references to it after func returns.
+     * @remark Payload is available only on the thread which processes the event. If callback is executed by
+     * isTransitionPossible() on any other thread, func is not called and callback returns a default value. On platforms
+     * without STL (FreeRTOS, Arduino) isTransitionPossible() must not be called from other threads if conditions use
+     * withPayload().
+     * @warning Returned callback must be registered only in this HSM instance.
+     *
+     * @tparam Payload type of the payload
+     * @param func function which accepts "const Payload&" argument
+     *
+     * @return callback which can be passed to registration APIs
+     */
+    template <typename Payload, typename Func>
+    auto withPayload(Func func) -> std::function<decltype(func(std::declval<const Payload&>()))(const VariantVector_t&)>;
+
+    /**
+     * @brief Set executor for transitionAsync() completion callbacks.
+     * @details By default completion callbacks are called directly on the dispatcher's thread. If executor is set, callbacks
+     * are passed to it instead (for example to post them to an application's thread pool or event loop).
+     *
+     * @remark Executor is applied only to transitions which were started after this call.
+     *
+     * @param executor executor to use or nullptr to call completion callbacks on the dispatcher's thread
+     *
+     * @threadsafe{ }
+     */
+    void setCompletionExecutor(HsmCompletionExecutor_t executor);
+
     /**
      * @brief Trigger a transition in the HSM and process it synchronously.
      * @details Convenience wrapper for transitionEx() which tries to execute transition synchronously. Please see
@@ -545,6 +866,37 @@ public:
      */
     bool transitionInterruptSafe(const EventID_t event);
 
+    /**
+     * @brief Remove all pending events with specified ID from the queue.
+     * @details Unlike transitionWithQueueClear() this function doesn't affect events with other IDs. Canceled events are
+     * not processed and are not reported to the callback registered by registerDroppedEventCallback(). Synchronous
+     * transitions which were waiting for a canceled event are unblocked and return false.
+     *
+     * @remark Internal HSM events (entry points, history transitions) are never canceled.
+     * @remark Function returns immediately if there are no pending events with specified ID.
+     *
+     * @param event ID of the events to cancel
+     * @return number of canceled events
+     *
+     * @threadsafe{ }
+     */
+    size_t cancelPendingEvents(const EventID_t event);
+
+    /**
+     * @brief Remove all pending events matching the filter from the queue.
+     * @copydetails cancelPendingEvents(const EventID_t)
+     *
+     * @remark Filter is called without holding internal locks, so it's allowed to call HSM APIs. Events which were added
+     * to the queue after cancelPendingEvents() was called are not checked. Events which HSM started to process while
+     * filter was running can't be canceled anymore.
+     *
+     * @param filter function which returns true for events that should be canceled
+     * @return number of canceled events
+     *
+     * @threadsafe{ }
+     */
+    size_t cancelPendingEvents(HsmEventFilterCallback_t filter);
+
     /**
      * @brief Check if a transition is possible.
      * @details This function checks if a transition can be triggered by the given event and current state.
@@ -556,6 +908,9 @@ public:
      * state from changing after returning from isTransitionPossible(). You would have to use additional synchronization
      * mechanisms to guarantee that state doesn't change between calls to isTransitionPossible() and transition().
      *
+     * @remark Condition callbacks created with withPayload() don't receive a payload when they are executed by this
+     * function (see withPayload()).
+     *
      * @param event ID of event to send to HSM
      * @param args (optional) arguments to pass to the condition callbacks
      * @return True if a transition is possible, false otherwise.
@@ -565,6 +920,49 @@ public:
     template <typename... Args>
     bool isTransitionPossible(const EventID_t event, Args&&... args);
 
+    /**
+     * @brief Limit the size of the pending events queue.
+     * @details By default pending events queue is not limited. Once limit is set, all new events sent with transition() or
+     * similar API are handled according to the selected policy when queue is full:
+     *      \li QueueOverflowPolicy::BLOCK - calling thread is blocked until HSM processes one of the pending events or
+     *      blockTimeoutMs expires. Event is dropped if timeout expired.
+     *      \li QueueOverflowPolicy::DROP_NEWEST - new event is dropped
+     *      \li QueueOverflowPolicy::DROP_OLDEST - the oldest pending event is dropped and new event is added to the queue
+     *      \li QueueOverflowPolicy::COALESCE - the most recent pending event with the same ID is replaced by the new event
+     *      (including it's arguments). If there is no such event then new event is dropped.
+     *
+     * Dropped events are reported with a callback registered by registerDroppedEventCallback(). Synchronous transitions
+     * which were waiting for a dropped event are unblocked and return false.
+     *
+     * @remark Internal HSM events (entry points, history and final state transitions) are never dropped and are not limited.
+     * @remark Events which HSM generates internally on the dispatcher's thread (StateAction::TRANSITION, timer events and
+     * events sent with transitionInterruptSafe()) never block. They are dropped instead if QueueOverflowPolicy::BLOCK is used
+     * and the queue is full. This doesn't apply to transition() and similar API called from HSM callbacks (see warning below).
+     *
+     * @warning Using QueueOverflowPolicy::BLOCK and calling transition() from HSM callbacks will block events processing until
+     * blockTimeoutMs expires. Setting blockTimeoutMs to HSM_WAIT_INDEFINITELY in this case will result in a deadlock.
+     *
+     * @param maxEvents maximum number of events in the queue or HSM_QUEUE_UNLIMITED to remove the limit
+     * @param policy defines how to handle new events when queue is full
+     * @param blockTimeoutMs maximum time in milliseconds to block the caller when QueueOverflowPolicy::BLOCK is used. Use
+     * HSM_WAIT_INDEFINITELY to wait indefinitely.
+     *
+     * @threadsafe{ }
+     */
+    void setPendingEventsLimit(const size_t maxEvents,
+                               const QueueOverflowPolicy policy = QueueOverflowPolicy::DROP_NEWEST,
+                               const int blockTimeoutMs = HSM_WAIT_INDEFINITELY);
+
+    /**
+     * @brief Get statistics of the pending events queue.
+     * @details Can be used to monitor HSM load.
+     *
+     * @return Current queue depth and cumulative counters of dropped and coalesced events.
+     *
+     * @threadsafe{ }
+     */
+    EventsQueueStats getPendingEventsStats() const;
+
     /**
      * @brief Start a timer.
      * @details If timer with this ID is already running it will be restarted with new settings.
@@ -687,16 +1085,32 @@ protected:
 
 private:
     template <typename... Args>
-    void makeVariantList(VariantVector_t& vList, Args&&... args);
+    static void makeVariantList(VariantVector_t& vList, Args&&... args);
 
     bool registerStateActionImpl(const StateID_t state,
                                  const StateActionTrigger actionTrigger,
                                  const StateAction action,
                                  const VariantVector_t& args);
     bool isTransitionPossibleImpl(const EventID_t event, const VariantVector_t& args);
+    void registerEventPayloadImpl(const EventID_t event, const PayloadTypeID_t payloadType);
+    bool transitionWithPayloadImpl(const EventID_t event,
+                                   std::shared_ptr<void>&& payload,
+                                   const PayloadTypeID_t payloadType,
+                                   const bool sync,
+                                   const int timeoutMs);
 
-private:
     class Impl;
+
+    static const void* getCurrentEventPayload(const Impl* impl, const PayloadTypeID_t payloadType);
+
+private:
+    // needs access to Impl to deliver broadcast events
+    friend class HsmGroup;
+    // needs access to Impl to track lifetime of attached HSMs
+    friend class HsmDispatcherGroup;
+    // needs access to Impl to deliver events received from other processes
+    friend class HsmSharedEventRing;
+
     std::shared_ptr<Impl> mImpl;
 };
 
@@ -710,6 +1124,12 @@ void HierarchicalStateMachine::registerFailedTransitionCallback(HsmHandlerClass*
     registerFailedTransitionCallback(std::bind(onFailedTransition, handler, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
 }
 
+template <class HsmHandlerClass>
+void HierarchicalStateMachine::registerDroppedEventCallback(HsmHandlerClass* handler,
+                                                            HsmEventDroppedCallbackPtr_t(HsmHandlerClass, onEventDropped)) {
+    registerDroppedEventCallback(std::bind(onEventDropped, handler, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+}
+
 template <class HsmHandlerClass>
 void HierarchicalStateMachine::registerState(const StateID_t state,
                                              HsmHandlerClass* handler,
@@ -859,6 +1279,42 @@ void HierarchicalStateMachine::registerSelfTransition(const StateID_t state,
     registerSelfTransition(state, onEvent, type, funcTransitionCallback, funcConditionCallback, expectedConditionValue);
 }
 
+template <typename Payload>
+void HierarchicalStateMachine::registerEventPayload(const EventID_t event) {
+    registerEventPayloadImpl(event, HsmPayloadType<Payload>::id());
+}
+
+template <typename Payload>
+bool HierarchicalStateMachine::transitionWithPayload(const EventID_t event,
+                                                     Payload&& payload,
+                                                     const bool sync,
+                                                     const int timeoutMs) {
+    using PayloadValue_t = typename std::decay<Payload>::type;
+
+    return transitionWithPayloadImpl(event,
+                                     std::make_shared<PayloadValue_t>(std::forward<Payload>(payload)),
+                                     HsmPayloadType<PayloadValue_t>::id(),
+                                     sync,
+                                     timeoutMs);
+}
+
+template <typename Payload, typename Func>
+auto HierarchicalStateMachine::withPayload(Func func)
+    -> std::function<decltype(func(std::declval<const Payload&>()))(const VariantVector_t&)> {
+    using Result_t = decltype(func(std::declval<const Payload&>()));
+    // NOTE: callbacks are stored and called only by Impl so it's always valid when callback is executed
+    const Impl* impl = mImpl.get();
+
+    // cppcheck-suppress misra-c2012-13.1 ; false-positive. this is a functor, not initializer list
+    return [impl, func](const VariantVector_t& args) -> Result_t {
+        const Payload* payload = static_cast<const Payload*>(getCurrentEventPayload(impl, HsmPayloadType<Payload>::id()));
+
+        (void)args;
+        // cppcheck-suppress misra-c2012-15.5 ; false-positive. "return" statement belongs to lambda function
+        return ((nullptr != payload) ? func(*payload) : Result_t());
+    };
+}
+
 template <typename... Args>
 void HierarchicalStateMachine::transition(const EventID_t event, Args&&... args) {
     (void)transitionEx(event, false, false, 0, std::forward<Args>(args)...);
@@ -876,6 +1332,15 @@ bool HierarchicalStateMachine::transitionEx(const EventID_t event,
     return transitionExWithArgsArray(event, clearQueue, sync, timeoutMs, std::move(eventArgs));
 }
 
+template <typename... Args>
+bool HierarchicalStateMachine::transitionAsync(const EventID_t event,
+                                               HsmTransitionCompletedCallback_t onCompleted,
+                                               Args&&... args) {
+    VariantVector_t eventArgs;
+
+    makeVariantList(eventArgs, std::forward<Args>(args)...);
+    return transitionAsyncWithArgsArray(event, std::move(onCompleted), std::move(eventArgs));
+}
 template <typename... Args>
 bool HierarchicalStateMachine::transitionSync(const EventID_t event, const int timeoutMs, Args&&... args) {
     return transitionEx(event, false, true, timeoutMs, std::forward<Args>(args)...);
@@ -0,0 +1,14 @@
+// Copyright (C) 2024 Igor Krechetov
+// Distributed under MIT license. See file LICENSE for details
+#ifndef HSMCPP_OS_INTERRUPTSAFEQUEUE_HPP
+#define HSMCPP_OS_INTERRUPTSAFEQUEUE_HPP
+
+#include "os.hpp"
+
+#if defined(STL_AVAILABLE)
+ #include "stl/InterruptSafeQueue.hpp"
+#else
+ #include "common/InterruptSafeQueue.hpp"
+#endif
+
+#endif // HSMCPP_OS_INTERRUPTSAFEQUEUE_HPP
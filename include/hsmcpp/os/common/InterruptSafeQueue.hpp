@@ -0,0 +1,117 @@
+// Copyright (C) 2024 Igor Krechetov
+// Distributed under MIT license. See file LICENSE for details
+#ifndef HSMCPP_OS_COMMON_INTERRUPTSAFEQUEUE_HPP
+#define HSMCPP_OS_COMMON_INTERRUPTSAFEQUEUE_HPP
+
+#include <stddef.h>
+
+#include <memory>
+
+#include "hsmcpp/os/CriticalSection.hpp"
+#include "hsmcpp/os/Mutex.hpp"
+
+namespace hsmcpp {
+
+/**
+ * @brief Fixed capacity queue which can be used from interrupts.
+ * @details Used on platforms without lock-free atomics. All operations are protected with CriticalSection. push() doesn't
+ * use memory allocations.
+ *
+ * @tparam T type of items. Must be default constructible and copyable.
+ */
+template <typename T>
+class InterruptSafeQueue {
+public:
+    explicit InterruptSafeQueue(const size_t capacity)
+        : mCapacity(capacity)
+        , mItems(new T[capacity]) {}
+
+    ~InterruptSafeQueue() = default;
+    InterruptSafeQueue(const InterruptSafeQueue&) = delete;
+    InterruptSafeQueue& operator=(const InterruptSafeQueue&) = delete;
+
+    /**
+     * @brief Add item to the queue.
+     * @return false if queue is full (item is dropped)
+     *
+     * @concurrencysafe{Can be called from multiple threads and from interrupts.}
+     */
+    bool push(const T& item) {
+        bool added = false;
+        CriticalSection cs(mSync);
+
+        if (mSize < mCapacity) {
+            mItems[(mHead + mSize) % mCapacity] = item;
+            ++mSize;
+            added = true;
+        } else {
+            ++mDroppedCount;
+        }
+
+        return added;
+    }
+
+    /**
+     * @brief Take the oldest item from the queue.
+     * @return false if queue is empty
+     *
+     * @notthreadsafe{Must be called only from a single consumer thread.}
+     */
+    bool pop(T& outItem) {
+        bool removed = false;
+        CriticalSection cs(mSync);
+
+        if (mSize > 0u) {
+            outItem = mItems[mHead];
+            mHead = (mHead + 1u) % mCapacity;
+            --mSize;
+            removed = true;
+        }
+
+        return removed;
+    }
+
+    /**
+     * @brief Check if queue has no items.
+     * @threadsafe{Result is approximate if producers are adding items at the same time.}
+     */
+    bool empty() const {
+        return (0u == mSize);
+    }
+
+    /**
+     * @brief Get approximate number of items in the queue.
+     * @threadsafe{ }
+     */
+    size_t size() const {
+        return mSize;
+    }
+
+    /**
+     * @brief Get max number of items in the queue.
+     * @threadsafe{ }
+     */
+    size_t capacity() const {
+        return mCapacity;
+    }
+
+    /**
+     * @brief Get number of items which were dropped because queue was full.
+     * @threadsafe{ }
+     */
+    size_t getDroppedCount() const {
+        return mDroppedCount;
+    }
+
+private:
+    const size_t mCapacity;
+    std::unique_ptr<T[]> mItems;
+    size_t mHead = 0;
+    size_t mSize = 0;
+    size_t mDroppedCount = 0;
+    Mutex mSync;
+};
+
+}  // namespace hsmcpp
+
+#endif  // HSMCPP_OS_COMMON_INTERRUPTSAFEQUEUE_HPP
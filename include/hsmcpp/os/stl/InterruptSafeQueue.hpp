@@ -0,0 +1,152 @@
+// Copyright (C) 2024 Igor Krechetov
+// Distributed under MIT license. See file LICENSE for details
+#ifndef HSMCPP_OS_STL_INTERRUPTSAFEQUEUE_HPP
+#define HSMCPP_OS_STL_INTERRUPTSAFEQUEUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+namespace hsmcpp {
+
+/**
+ * @brief Fixed capacity lock-free queue with multiple producers and a single consumer.
+ * @details Based on a bounded ring of cells with sequence numbers. push() doesn't use locks, system calls or memory
+ * allocations, so it can be called from POSIX signal handlers. Producer which was interrupted by a signal handler in the
+ * middle of push() doesn't block other producers.
+ *
+ * @remark Capacity is at least 2 items (sequence numbers of a single cell can't distinguish full and free states).
+ *
+ * @tparam T type of items. Must be default constructible and copyable.
+ */
+template <typename T>
+class InterruptSafeQueue {
+public:
+    explicit InterruptSafeQueue(const size_t capacity)
+        : mCapacity((capacity < MIN_CAPACITY) ? MIN_CAPACITY : capacity)
+        , mCells(new Cell[mCapacity]) {
+        for (size_t i = 0; i < mCapacity; ++i) {
+            mCells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    ~InterruptSafeQueue() = default;
+    InterruptSafeQueue(const InterruptSafeQueue&) = delete;
+    InterruptSafeQueue& operator=(const InterruptSafeQueue&) = delete;
+
+    /**
+     * @brief Add item to the queue.
+     * @return false if queue is full (item is dropped)
+     *
+     * @concurrencysafe{Can be called from multiple threads and from signal handlers.}
+     */
+    bool push(const T& item) noexcept {
+        bool added = false;
+        bool isFull = false;
+        size_t pos = mEnqueuePos.load(std::memory_order_relaxed);
+
+        while ((false == added) && (false == isFull)) {
+            Cell& cell = mCells[pos % mCapacity];
+            const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+
+            if (sequence == pos) {
+                // cell is free. try to reserve it
+                if (true == mEnqueuePos.compare_exchange_weak(pos, pos + 1u, std::memory_order_relaxed)) {
+                    cell.item = item;
+                    cell.sequence.store(pos + 1u, std::memory_order_release);
+                    added = true;
+                }
+            } else if (sequence < pos) {
+                // cell still contains item from the previous round
+                isFull = true;
+            } else {
+                // another producer reserved this cell
+                pos = mEnqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        if (false == added) {
+            mDroppedCount.fetch_add(1u, std::memory_order_relaxed);
+        }
+
+        return added;
+    }
+
+    /**
+     * @brief Take the oldest item from the queue.
+     * @return false if queue is empty or the oldest item is still being written by a producer
+     *
+     * @notthreadsafe{Must be called only from a single consumer thread.}
+     */
+    bool pop(T& outItem) noexcept {
+        bool removed = false;
+        const size_t pos = mDequeuePos.load(std::memory_order_relaxed);
+        Cell& cell = mCells[pos % mCapacity];
+
+        if (cell.sequence.load(std::memory_order_acquire) == (pos + 1u)) {
+            outItem = cell.item;
+            mDequeuePos.store(pos + 1u, std::memory_order_release);
+            // make cell available for the next round
+            cell.sequence.store(pos + mCapacity, std::memory_order_release);
+            removed = true;
+        }
+
+        return removed;
+    }
+
+    /**
+     * @brief Check if queue has no items.
+     * @threadsafe{Result is approximate if producers are adding items at the same time.}
+     */
+    bool empty() const noexcept {
+        return mEnqueuePos.load(std::memory_order_acquire) == mDequeuePos.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Get approximate number of items in the queue.
+     * @threadsafe{ }
+     */
+    size_t size() const noexcept {
+        const size_t dequeuePos = mDequeuePos.load(std::memory_order_acquire);
+        const size_t enqueuePos = mEnqueuePos.load(std::memory_order_acquire);
+
+        return ((enqueuePos > dequeuePos) ? (enqueuePos - dequeuePos) : 0u);
+    }
+
+    /**
+     * @brief Get max number of items in the queue.
+     * @threadsafe{ }
+     */
+    size_t capacity() const noexcept {
+        return mCapacity;
+    }
+
+    /**
+     * @brief Get number of items which were dropped because queue was full.
+     * @threadsafe{ }
+     */
+    size_t getDroppedCount() const noexcept {
+        return mDroppedCount.load(std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr size_t MIN_CAPACITY = 2;
+
+    struct Cell {
+        std::atomic<size_t> sequence{0};
+        T item;
+    };
+
+    const size_t mCapacity;
+    std::unique_ptr<Cell[]> mCells;
+    std::atomic<size_t> mEnqueuePos{0};
+    std::atomic<size_t> mDequeuePos{0};
+    std::atomic<size_t> mDroppedCount{0};
+};
+
+template <typename T>
+constexpr size_t InterruptSafeQueue<T>::MIN_CAPACITY;
+
+}  // namespace hsmcpp
+
+#endif  // HSMCPP_OS_STL_INTERRUPTSAFEQUEUE_HPP
@@ -9,19 +9,115 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <type_traits>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
+#include "FlatMap.hpp"
+
 namespace hsmcpp {
 
 class Variant;
 
+/**
+ * @brief Keys comparator for VariantMap_t. Orders Variant objects using Variant::compare().
+ */
+struct VariantKeyLess {
+    inline bool operator()(const Variant& left, const Variant& right) const;
+};
+
 using ByteArray_t = std::vector<unsigned char>;
 using VariantVector_t = std::vector<Variant>;
 using VariantList_t = std::list<Variant>;
-using VariantMap_t = std::map<Variant, Variant>;
+using VariantMap_t = FlatMap<Variant, Variant, VariantKeyLess>;  ///< Sorted map stored in a contiguous memory.
+using VariantUnorderedMap_t = std::unordered_map<Variant, Variant>;  ///< Hash map which uses std::hash<Variant>.
 using VariantPair_t = std::pair<Variant, Variant>;  ///< Provides a way to store two values as a single unit.
 
+/**
+ * @brief Read-only view of a contiguous memory buffer. Allows to pass large payloads through HSM without copying them.
+ * @details BufferView never copies the viewed bytes. Copying a view only copies a pointer, a size and a reference to the
+ * owner of the memory. Lifetime of the memory depends on how view was created:
+ *  \li share() moves data into a shared immutable storage. It's released when the last view is destroyed.
+ *  \li view created with an owner keeps owner alive while any copy of the view exists. Owner can be any object which
+ *      controls lifetime of the memory (for example a received network frame).
+ *  \li view created without an owner doesn't control lifetime of the memory. Caller must guarantee that memory stays valid
+ *      and unchanged while the view is used (for example until transitionSync() returns).
+ *
+ * @warning Memory must not be modified while it's viewed.
+ */
+class BufferView {
+public:
+    /**
+     * @brief Constructs an empty view.
+     */
+    BufferView() = default;
+
+    /**
+     * @brief Constructs a view of external memory.
+     *
+     * @param data pointer to the viewed memory
+     * @param size size of the viewed memory in bytes
+     * @param owner (optional) object which keeps memory alive
+     */
+    BufferView(const void* data, const size_t size, std::shared_ptr<const void> owner = nullptr);
+
+    /**
+     * @brief Moves bytes into a shared immutable storage and returns a view of it.
+     */
+    static BufferView share(ByteArray_t&& bytes);
+
+    /**
+     * @brief Moves string into a shared immutable storage and returns a view of it.
+     */
+    static BufferView share(std::string&& str);
+
+    const unsigned char* data() const;
+    size_t size() const;
+    bool empty() const;
+
+    /**
+     * @brief Check if view controls lifetime of the memory.
+     * @return false if view was created without an owner
+     */
+    bool hasOwner() const;
+
+    /**
+     * @brief Returns view of a part of the buffer. New view shares owner with this view.
+     *
+     * @param offset offset of the first byte
+     * @param count number of bytes (truncated to the end of the buffer)
+     *
+     * @return view of the requested range or an empty view if offset is out of range
+     */
+    BufferView subView(const size_t offset, const size_t count) const;
+
+    /**
+     * @brief Returns a copy of the viewed bytes.
+     */
+    ByteArray_t toByteArray() const;
+
+    /**
+     * @brief Returns a copy of the viewed bytes as a string.
+     */
+    std::string toString() const;
+
+    /**
+     * @brief Compares viewed bytes.
+     */
+    bool operator==(const BufferView& other) const;
+
+    /**
+     * @brief Lexicographically compares viewed bytes.
+     */
+    bool operator>(const BufferView& other) const;
+
+private:
+    const unsigned char* mData = nullptr;
+    size_t mSize = 0;
+    std::shared_ptr<const void> mOwner;
+};
+
 // cppcheck-suppress misra-c2012-20.7 ; parentheses are not needed
 #define DEF_CONSTRUCTOR(_val_type, _internal_type)               \
   /** @brief Constructs a new variant with an _val_type value */ \
@@ -81,15 +177,22 @@ using VariantPair_t = std::pair<Variant, Variant>;  ///< Provides a way to store
 class Variant {
 private:
     /**
-     * @brief Handles memory allocation/deallocation for custom types.
-     *
-     * @param void* memory pointer
-     * @param bool true - release memory; false - copy memory
-     * @return new memory pointer if copy was requested or nullptr
+     * @brief Operations which depend on the type of stored data.
+     * @details A single static instance exists for each stored type (see TypeOpsInstance) and is shared by all Variant
+     * objects holding this type. Variant only keeps a pointer to it.
      */
-    // using MemoryHandlerFunc_t = std::function<void*(void*, const bool)>;
-    using MemoryAllocatorFunc_t = std::function<std::shared_ptr<void>(const void*)>;
-    using CompareFunc_t = std::function<int(const void*, const void*)>;
+    struct TypeOps {
+        std::shared_ptr<void> (*copy)(const void* ptr);         ///< allocates a copy of the value
+        void (*destroy)(void* ptr);                            ///< releases value allocated by copy()
+        int (*compare)(const void* left, const void* right);  ///< returns 0 if values are equal, 1 if left is greater
+        std::string (*toString)(const void* ptr);              ///< string representation of custom types
+        size_t (*hash)(const void* ptr);                       ///< hash of custom types
+    };
+
+    template <typename T>
+    struct TypeOpsInstance {
+        static const TypeOps ops;
+    };
 
 public:
     /**
@@ -120,7 +223,10 @@ public:
         MAP,   ///< VariantMap_t
         PAIR,  ///< VariantPair_t
 
-        CUSTOM  ///< any type
+        CUSTOM,  ///< any type
+
+        BYTEARRAY_VIEW,  ///< BufferView with binary data
+        STRING_VIEW      ///< BufferView with a text
     };
 
 public:
@@ -137,6 +243,14 @@ public:
     DEF_MAKE(std::string&, Type::STRING);
     DEF_MAKE(char*, Type::STRING);
     DEF_MAKE(ByteArray_t&, Type::VECTOR);
+    DEF_MAKE(BufferView&, Type::BYTEARRAY_VIEW);
+
+    /**
+     * @brief Creates a Variant object with a value of type Type::STRING_VIEW.
+     * @param v view of the text
+     * @return Newly constructed Variant object.
+     */
+    static Variant makeStringView(const BufferView& v);
 
     /**
      * @brief Creates a Variant object with a value of type Type::VECTOR.
@@ -224,13 +338,22 @@ public:
     DEF_CONSTRUCTOR(double, Type::DOUBLE)
     DEF_CONSTRUCTOR(bool, Type::BOOL)
     DEF_CONSTRUCTOR(std::string&, Type::STRING)
+    /** @brief Constructs a new variant object of type Type::STRING. Moves the string instead of copying it. */
+    explicit Variant(std::string&& v);
     /** @brief Constructs a new variant object of type Type::STRING with an const char* value. */
     explicit Variant(const char* v);
 
     DEF_CONSTRUCTOR(ByteArray_t&, Type::BYTEARRAY)
-    /** @brief Constructs a new variant of type Type::BYTEARRAY. Copies bytesCount bytes from binaryData buffer. */
+    /** @brief Constructs a new variant object of type Type::BYTEARRAY. Moves the bytes instead of copying them. */
+    explicit Variant(ByteArray_t&& v);
+    /**
+     * @brief Constructs a new variant of type Type::BYTEARRAY. Copies bytesCount bytes from binaryData buffer.
+     * @remark Use BufferView to pass data without copying it.
+     */
     explicit Variant(const char* binaryData, const size_t bytesCount);
 
+    DEF_CONSTRUCTOR(BufferView&, Type::BYTEARRAY_VIEW)
+
     DEF_CONSTRUCTOR(VariantVector_t&, Type::VECTOR)
     DEF_CONSTRUCTOR(VariantList_t&, Type::LIST)
     DEF_CONSTRUCTOR(VariantMap_t&, Type::MAP)
@@ -273,6 +396,7 @@ public:
     DEF_OPERATOR_ASSIGN(std::string&, Type::STRING)
     DEF_OPERATOR_ASSIGN(char*, Type::STRING)
     DEF_OPERATOR_ASSIGN(ByteArray_t&, Type::BYTEARRAY)
+    DEF_OPERATOR_ASSIGN(BufferView&, Type::BYTEARRAY_VIEW)
     DEF_OPERATOR_ASSIGN(VariantVector_t&, Type::VECTOR)
     DEF_OPERATOR_ASSIGN(VariantList_t&, Type::LIST)
     DEF_OPERATOR_ASSIGN(VariantMap_t&, Type::MAP)
@@ -342,6 +466,18 @@ public:
      */
     bool isByteArray() const;
 
+    /**
+     * @brief Check if the Variant object contains a Type::STRING_VIEW value
+     * @return true if the Variant object contains a view of a text, false otherwise
+     */
+    bool isStringView() const;
+
+    /**
+     * @brief Check if the Variant object contains a Type::BYTEARRAY_VIEW value
+     * @return true if the Variant object contains a view of binary data, false otherwise
+     */
+    bool isByteArrayView() const;
+
     /**
      * @brief Check if the Variant object contains a vector
      * @return true if the Variant object contains a vector, false otherwise
@@ -385,6 +521,7 @@ public:
      *  \li Type::DOUBLE
      *  \li Type::BOOL - returns 0 if the value is false and 1 if it's true
      *  \li Type::STRING - tries to convert string to number or returns 0
+     *  \li Type::STRING_VIEW - same as Type::STRING
      *
      * @return numeric representation of the Variant object (calling this method on an unsupported variant type returns 0).
      */
@@ -416,6 +553,7 @@ public:
      *  \li Type::DOUBLE
      *  \li Type::BOOL
      *  \li Type::STRING - returns true if string value is "true" or it represents a number different from 0
+     *  \li Type::STRING_VIEW - same as Type::STRING
      *
      * @return boolean representation of the Variant object (calling this method on an unsupported variant type returns false).
      */
@@ -440,6 +578,9 @@ public:
      *  \li Type::VECTOR
      *  \li Type::MAP
      *  \li Type::PAIR
+     *  \li Type::CUSTOM - only if type has "std::string toString() const" method
+     *  \li Type::BYTEARRAY_VIEW
+     *  \li Type::STRING_VIEW
      *
      * @return string representation of the Variant object (calling this method on an unsupported variant type returns an empty
      * string).
@@ -463,9 +604,10 @@ public:
      *  \li Type::BYTEARRAY
      *  \li Type::MAP
      *  \li Type::PAIR
+     *  \li Type::BYTEARRAY_VIEW
+     *  \li Type::STRING_VIEW
      *
-     * @remark This function always returns a copy of data. If you know that internal type is Type::BYTEARRAY and just want to
-     * access data it's better to use toByteArrayPtr() method.
+     * @remark This function always returns a copy of data. Use getBufferView() to access data without copying it.
      *
      * @return byte array representation of the Variant object (calling this method on an unsupported variant type returns an
      * empty vector).
@@ -478,6 +620,16 @@ public:
      */
     std::shared_ptr<ByteArray_t> getByteArray() const;
 
+    /**
+     * @brief Returns view of the stored bytes without copying them.
+     * @details Supported data types are Type::STRING, Type::BYTEARRAY, Type::STRING_VIEW and Type::BYTEARRAY_VIEW. For
+     * Type::STRING and Type::BYTEARRAY returned view keeps internal data alive, but it must not be modified while the
+     * view is used.
+     *
+     * @return view of the data or an empty view if type is not supported
+     */
+    BufferView getBufferView() const;
+
     /**
      * @brief Returns pointer to internal vector data.
      * @return pointer to internal data or nullptr if data type is not Type::VECTOR
@@ -597,8 +749,9 @@ public:
 
     /**
      * @brief Compares this Variant object to another Variant object for equality.
-     * @details Variant uses the == operator of the stored type to check for equality. Variants of different types will always
-     * compare as not equal.
+     * @details Equivalent to (0 == compare(val)). Numeric values are compared exactly by value regardless of their type
+     * (for example int8_t(7), uint32_t(7) and 7.0 are equal, but int8_t(-1) and UINT64_MAX are not). Doubles are compared
+     * without any tolerance. Non-numeric variants of different types always compare as not equal.
      * @param val The Variant object to compare to.
      * @return true if this object is equal to val, false otherwise.
      */
@@ -615,7 +768,8 @@ public:
     /**
      * @brief Checks if this Variant object is greater than another Variant object.
      * @details Operator only compares variants of the same type. Comparing logic depends on the underlying type:
-     *  \li numeric, bool or string values are compared using standard operator >
+     *  \li numeric values of any type are compared by value (same as compare())
+     *  \li bool or string values are compared using standard operator >
      *  \li vector or list values are compared by size (A.size() > B.size())
      *  \li other types are not supported and false is always returned
      *
@@ -651,7 +805,34 @@ public:
      */
     bool operator<=(const Variant& val) const;
 
+    /**
+     * @brief Three-way comparison of Variant objects.
+     * @details Unlike comparison operators, this function defines a strict ordering of all variants (which is used by
+     * VariantMap_t):
+     *  \li numeric values are compared exactly by value (integers are never converted to double) and go before all other
+     *      types. NaN values are equal to each other and go after all other numbers
+     *  \li values of different non-numeric types are ordered by their Variant::Type
+     *  \li values of the same non-numeric type are compared using operators of the stored type
+     *
+     * @param val The Variant object to compare to.
+     * @return 0 if objects are equal, negative value if this object goes before val, positive value otherwise
+     */
+    int compare(const Variant& val) const;
+
+    /**
+     * @brief Calculates hash of the stored value.
+     * @details Variants which are equal according to operator==() have the same hash (for example int8_t(7), uint32_t(7)
+     * and 7.0). Custom types are hashed with std::hash (if it's specialized for the type). Otherwise, all values of custom
+     * type have the same hash.
+     *
+     * @return hash value
+     */
+    size_t hash() const;
+
 private:
+    // needs direct access to internal data to avoid copying it during encoding
+    friend class VariantSerializer;
+
     Variant(std::shared_ptr<void> d, const Type t);
 
     template <typename T>
@@ -662,21 +843,58 @@ private:
     template <typename T>
     void assign(const T& v, const Type t);
 
+    template <typename T>
+    void assignMoved(T&& v, const Type t);
+
     template <typename T>
     inline std::shared_ptr<T> value() const;
 
     template <typename T>
-    void createMemoryAllocator();
+    static std::shared_ptr<void> copyValue(const void* ptr);
+
+    template <typename T>
+    static void destroyValue(void* ptr);
+
+    template <typename T>
+    static int compareValues(const void* left, const void* right);
+
+    template <typename T>
+    static std::string valueToString(const void* ptr);
+
+    // used if type has "std::string toString() const" method
+    template <typename T>
+    static auto customToString(const T& v, const int) -> decltype(std::string(v.toString()));
+
+    template <typename T>
+    static std::string customToString(const T& v, const long);
+
+    template <typename T>
+    static size_t valueHash(const void* ptr);
+
+    // used if std::hash is specialized for the type
+    template <typename T>
+    static auto customHash(const T& v, const int) -> decltype(std::hash<T>()(v));
+
+    template <typename T>
+    static size_t customHash(const T& v, const long);
+
+    int compareNumeric(const Variant& val) const;
 
     void freeMemory();
 
 private:
     Type type = Type::UNKNOWN;
     std::shared_ptr<void> data;
-    MemoryAllocatorFunc_t memoryAllocator;
-    CompareFunc_t compareOperator;
+    const TypeOps* ops = nullptr;
 };
 
+template <typename T>
+const Variant::TypeOps Variant::TypeOpsInstance<T>::ops = {&Variant::copyValue<T>,
+                                                           &Variant::destroyValue<T>,
+                                                           &Variant::compareValues<T>,
+                                                           &Variant::valueToString<T>,
+                                                           &Variant::valueHash<T>};
+
 template <typename T>
 Variant Variant::make(const std::vector<T>& v) {
     return Variant(v);
@@ -709,9 +927,7 @@ Variant Variant::makeCustom(const T& v) {
 
 template <typename T>
 Variant::Variant(const std::vector<T>& v) {
-    std::shared_ptr<VariantVector_t> dest = std::shared_ptr<VariantVector_t>(new VariantVector_t(), [](void* ptr) {
-        delete reinterpret_cast<VariantVector_t*>(ptr);
-    });
+    std::shared_ptr<VariantVector_t> dest(new VariantVector_t(), &destroyValue<VariantVector_t>);
 
     dest->reserve(v.size());
 
@@ -721,13 +937,12 @@ Variant::Variant(const std::vector<T>& v) {
 
     data = std::static_pointer_cast<void>(dest);
     type = Type::VECTOR;
-    createMemoryAllocator<VariantVector_t>();
+    ops = &TypeOpsInstance<VariantVector_t>::ops;
 }
 
 template <typename T>
 Variant::Variant(const std::list<T>& v) {
-    std::shared_ptr<VariantList_t> dest =
-        std::shared_ptr<VariantList_t>(new VariantList_t(), [](void* ptr) { delete reinterpret_cast<VariantList_t*>(ptr); });
+    std::shared_ptr<VariantList_t> dest(new VariantList_t(), &destroyValue<VariantList_t>);
 
     for (auto it = v.begin(); it != v.end(); ++it) {
         dest->emplace_back(*it);
@@ -735,13 +950,14 @@ Variant::Variant(const std::list<T>& v) {
 
     data = std::static_pointer_cast<void>(dest);
     type = Type::LIST;
-    createMemoryAllocator<VariantList_t>();
+    ops = &TypeOpsInstance<VariantList_t>::ops;
 }
 
 template <typename K, typename V>
 Variant::Variant(const std::map<K, V>& v) {
-    std::shared_ptr<VariantMap_t> dest =
-        std::shared_ptr<VariantMap_t>(new VariantMap_t(), [](void* ptr) { delete reinterpret_cast<VariantMap_t*>(ptr); });
+    std::shared_ptr<VariantMap_t> dest(new VariantMap_t(), &destroyValue<VariantMap_t>);
+
+    dest->reserve(v.size());
 
     for (auto it = v.begin(); it != v.end(); ++it) {
         dest->emplace(it->first, it->second);
@@ -749,7 +965,7 @@ Variant::Variant(const std::map<K, V>& v) {
 
     data = std::static_pointer_cast<void>(dest);
     type = Type::MAP;
-    createMemoryAllocator<VariantMap_t>();
+    ops = &TypeOpsInstance<VariantMap_t>::ops;
 }
 
 template <typename TFirst, typename TSecond>
@@ -865,9 +1081,19 @@ Variant::Variant(const T& v, const Type t) {
 template <typename T>
 void Variant::assign(const T& v, const Type t) {
     freeMemory();
-    createMemoryAllocator<T>();
+    ops = &TypeOpsInstance<T>::ops;
     type = t;
-    data = memoryAllocator(&v);
+    data = copyValue<T>(&v);
+}
+
+template <typename T>
+void Variant::assignMoved(T&& v, const Type t) {
+    using Value_t = typename std::decay<T>::type;
+
+    freeMemory();
+    ops = &TypeOpsInstance<Value_t>::ops;
+    type = t;
+    data = std::shared_ptr<void>(new Value_t(std::move(v)), &destroyValue<Value_t>);
 }
 
 template <typename T>
@@ -876,32 +1102,80 @@ inline std::shared_ptr<T> Variant::value() const {
 }
 
 template <typename T>
-void Variant::createMemoryAllocator() {
-    memoryAllocator = [](const void* ptr) {
-        // NOTE: false-positive. "return" statement belongs to lambda function, not parent function
-        // cppcheck-suppress misra-c2012-15.5
-        return ((nullptr != ptr) ? (std::shared_ptr<void>(new T(*reinterpret_cast<const T*>(ptr)),
-                                                          [](void* ptr) { delete reinterpret_cast<const T*>(ptr); }))
-                                 : nullptr);
-    };
+std::shared_ptr<void> Variant::copyValue(const void* ptr) {
+    return ((nullptr != ptr) ? std::shared_ptr<void>(new T(*reinterpret_cast<const T*>(ptr)), &destroyValue<T>) : nullptr);
+}
 
-    // cppcheck-suppress misra-c2012-13.1 ; false-positive. this is a functor, not initializer list
-    compareOperator = [](const void* left, const void* right) {
-        int res = -1;
-        if (*reinterpret_cast<const T*>(left) == *reinterpret_cast<const T*>(right)) {
-            res = 0;
-        } else if (*reinterpret_cast<const T*>(left) > *reinterpret_cast<const T*>(right)) {
-            res = 1;
-        } else {
-            // do nothing
-        }
+template <typename T>
+void Variant::destroyValue(void* ptr) {
+    delete reinterpret_cast<T*>(ptr);
+}
 
-        // NOTE: false-positive. "return" statement belongs to lambda function, not parent function
-        // cppcheck-suppress misra-c2012-15.5
-        return res;
-    };
+template <typename T>
+int Variant::compareValues(const void* left, const void* right) {
+    int res = -1;
+
+    if (*reinterpret_cast<const T*>(left) == *reinterpret_cast<const T*>(right)) {
+        res = 0;
+    } else if (*reinterpret_cast<const T*>(left) > *reinterpret_cast<const T*>(right)) {
+        res = 1;
+    } else {
+        // do nothing
+    }
+
+    return res;
+}
+
+template <typename T>
+std::string Variant::valueToString(const void* ptr) {
+    return customToString<T>(*reinterpret_cast<const T*>(ptr), 0);
+}
+
+template <typename T>
+auto Variant::customToString(const T& v, const int) -> decltype(std::string(v.toString())) {
+    return v.toString();
+}
+
+template <typename T>
+std::string Variant::customToString(const T& v, const long) {
+    (void)v;
+    return std::string();
+}
+
+template <typename T>
+size_t Variant::valueHash(const void* ptr) {
+    return customHash<T>(*reinterpret_cast<const T*>(ptr), 0);
+}
+
+template <typename T>
+auto Variant::customHash(const T& v, const int) -> decltype(std::hash<T>()(v)) {
+    return std::hash<T>()(v);
+}
+
+template <typename T>
+size_t Variant::customHash(const T& v, const long) {
+    (void)v;
+    return 0;
+}
+
+bool VariantKeyLess::operator()(const Variant& left, const Variant& right) const {
+    return (left.compare(right) < 0);
 }
 
 }  // namespace hsmcpp
 
+namespace std {
+
+/**
+ * @brief Allows to use Variant as a key of unordered containers.
+ */
+template <>
+struct hash<hsmcpp::Variant> {
+    size_t operator()(const hsmcpp::Variant& v) const {
+        return v.hash();
+    }
+};
+
+}  // namespace std
+
 #endif  // HSMCPP_VARIANT_HPP
@@ -0,0 +1,209 @@
+// Copyright (C) 2024 Igor Krechetov
+// Distributed under MIT license. See file LICENSE for details
+
+#include "hsmcpp/HsmDispatcherGroup.hpp"
+
+#include <map>
+#include <vector>
+
+#include "HsmImpl.hpp"
+#include "hsmcpp/IHsmEventDispatcher.hpp"
+#include "hsmcpp/hsm.hpp"
+#include "hsmcpp/logging.hpp"
+#include "hsmcpp/os/LockGuard.hpp"
+#include "hsmcpp/os/Mutex.hpp"
+
+namespace hsmcpp {
+
+constexpr const char* HSM_TRACE_CLASS = "HsmDispatcherGroup";
+
+class HsmDispatcherGroup::Impl {
+public:
+    struct MemberInfo {
+        size_t shardIndex = INVALID_HSM_SHARD_INDEX;
+        // NOTE: weak_ptr is used to skip members which were destroyed without being detached from the group
+        std::weak_ptr<HierarchicalStateMachine::Impl> hsm;
+    };
+
+    // removes members which were destroyed. must be called with mSync locked
+    void removeExpiredMembers();
+    // must be called with mSync locked
+    size_t selectShard(const ShardPlacementPolicy policy, const size_t key) const;
+    // must be called with mSync locked
+    size_t getShardLoad(const size_t shardIndex) const;
+
+    std::vector<std::shared_ptr<IHsmEventDispatcher>> mShards;
+    std::map<const HierarchicalStateMachine*, MemberInfo> mMembers;  // protected by mSync
+    mutable Mutex mSync;
+};
+
+void HsmDispatcherGroup::Impl::removeExpiredMembers() {
+    auto it = mMembers.begin();
+
+    while (mMembers.end() != it) {
+        if (true == it->second.hsm.expired()) {
+            HSM_TRACE_WARNING("member was destroyed without being detached from the group");
+            it = mMembers.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+size_t HsmDispatcherGroup::Impl::selectShard(const ShardPlacementPolicy policy, const size_t key) const {
+    size_t shardIndex = INVALID_HSM_SHARD_INDEX;
+
+    if (false == mShards.empty()) {
+        if (ShardPlacementPolicy::HASH == policy) {
+            shardIndex = std::hash<size_t>()(key) % mShards.size();
+        } else {
+            size_t minLoad = 0;
+
+            for (size_t i = 0; i < mShards.size(); ++i) {
+                const size_t curLoad = getShardLoad(i);
+
+                if ((INVALID_HSM_SHARD_INDEX == shardIndex) || (curLoad < minLoad)) {
+                    shardIndex = i;
+                    minLoad = curLoad;
+                }
+            }
+        }
+    }
+
+    return shardIndex;
+}
+
+size_t HsmDispatcherGroup::Impl::getShardLoad(const size_t shardIndex) const {
+    size_t load = 0;
+
+    for (const auto& curMember : mMembers) {
+        if (shardIndex == curMember.second.shardIndex) {
+            ++load;
+        }
+    }
+
+    return load;
+}
+
+// ============================================================================
+// HsmDispatcherGroup
+// ============================================================================
+HsmDispatcherGroup::HsmDispatcherGroup(const size_t shardsCount, const DispatcherFactory_t& factory)
+    : mImpl(new HsmDispatcherGroup::Impl()) {
+    HSM_TRACE_CALL_DEBUG_ARGS("shardsCount=%lu", shardsCount);
+
+    // cppcheck-suppress misra-c2012-14.4 ; false-positive. std::function has a bool() operator
+    if (factory) {
+        mImpl->mShards.reserve(shardsCount);
+
+        for (size_t i = 0; i < shardsCount; ++i) {
+            std::shared_ptr<IHsmEventDispatcher> dispatcher = factory(i);
+
+            // cppcheck-suppress misra-c2012-14.4 ; false-positive. std::shared_ptr has a bool() operator
+            if (dispatcher && (true == dispatcher->start())) {
+                mImpl->mShards.emplace_back(std::move(dispatcher));
+            } else {
+                HSM_TRACE_ERROR("failed to create dispatcher for shard %lu", i);
+            }
+        }
+    }
+}
+
+HsmDispatcherGroup::~HsmDispatcherGroup() = default;
+
+size_t HsmDispatcherGroup::getShardsCount() const {
+    return mImpl->mShards.size();
+}
+
+std::shared_ptr<IHsmEventDispatcher> HsmDispatcherGroup::getShard(const size_t shardIndex) const {
+    std::shared_ptr<IHsmEventDispatcher> shard;
+
+    if (shardIndex < mImpl->mShards.size()) {
+        shard = mImpl->mShards[shardIndex];
+    }
+
+    return shard;
+}
+
+size_t HsmDispatcherGroup::getShardLoad(const size_t shardIndex) const {
+    LockGuard lck(mImpl->mSync);
+
+    mImpl->removeExpiredMembers();
+    return mImpl->getShardLoad(shardIndex);
+}
+
+size_t HsmDispatcherGroup::attach(HierarchicalStateMachine& hsm, const ShardPlacementPolicy policy, const size_t key) {
+    HSM_TRACE_CALL_DEBUG_ARGS("policy=%d, key=%lu", SC2INT(policy), key);
+    size_t shardIndex = INVALID_HSM_SHARD_INDEX;
+    LockGuard lck(mImpl->mSync);
+
+    mImpl->removeExpiredMembers();
+
+    if (mImpl->mMembers.end() == mImpl->mMembers.find(&hsm)) {
+        shardIndex = mImpl->selectShard(policy, key);
+
+        if (INVALID_HSM_SHARD_INDEX != shardIndex) {
+            const std::shared_ptr<IHsmEventDispatcher>& shard = mImpl->mShards[shardIndex];
+            bool placed = false;
+
+            if (true == hsm.isInitialized()) {
+                placed = hsm.migrate(shard);
+            } else {
+                placed = hsm.initialize(shard);
+            }
+
+            if (true == placed) {
+                Impl::MemberInfo newMember;
+
+                newMember.shardIndex = shardIndex;
+                newMember.hsm = hsm.mImpl;
+                mImpl->mMembers.emplace(&hsm, newMember);
+            } else {
+                HSM_TRACE_ERROR("failed to place HSM on shard %lu", shardIndex);
+                shardIndex = INVALID_HSM_SHARD_INDEX;
+            }
+        }
+    } else {
+        HSM_TRACE_ERROR("HSM is already attached to the group");
+    }
+
+    return shardIndex;
+}
+
+void HsmDispatcherGroup::detach(HierarchicalStateMachine& hsm) {
+    LockGuard lck(mImpl->mSync);
+
+    (void)mImpl->mMembers.erase(&hsm);
+}
+
+bool HsmDispatcherGroup::migrate(HierarchicalStateMachine& hsm, const size_t shardIndex) {
+    HSM_TRACE_CALL_DEBUG_ARGS("shardIndex=%lu", shardIndex);
+    bool result = false;
+    LockGuard lck(mImpl->mSync);
+    auto it = mImpl->mMembers.find(&hsm);
+
+    if ((mImpl->mMembers.end() != it) && (shardIndex < mImpl->mShards.size())) {
+        if (true == hsm.migrate(mImpl->mShards[shardIndex])) {
+            it->second.shardIndex = shardIndex;
+            result = true;
+        }
+    } else {
+        HSM_TRACE_ERROR("HSM is not attached or shard index is not valid");
+    }
+
+    return result;
+}
+
+size_t HsmDispatcherGroup::getShardIndex(const HierarchicalStateMachine& hsm) const {
+    size_t shardIndex = INVALID_HSM_SHARD_INDEX;
+    LockGuard lck(mImpl->mSync);
+    auto it = mImpl->mMembers.find(&hsm);
+
+    if ((mImpl->mMembers.end() != it) && (false == it->second.hsm.expired())) {
+        shardIndex = it->second.shardIndex;
+    }
+
+    return shardIndex;
+}
+
+}  // namespace hsmcpp
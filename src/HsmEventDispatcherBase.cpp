@@ -3,21 +3,56 @@
 
 #include "hsmcpp/HsmEventDispatcherBase.hpp"
 
+#include <algorithm>
+
 #include "hsmcpp/logging.hpp"
-#include "hsmcpp/os/CriticalSection.hpp"
 #include "hsmcpp/os/LockGuard.hpp"
+#include "hsmcpp/os/os.hpp"
+
+#if defined(FREERTOS_AVAILABLE)
+  #include <FreeRTOS.h>
+  #include <task.h>
+#elif defined(PLATFORM_ARDUINO)
+  #include <Arduino.h>
+#else
+  #include <chrono>
+#endif
 
 namespace hsmcpp {
 
 constexpr const char* HSM_TRACE_CLASS = "HsmEventDispatcherBase";
 
+namespace {
+
+uint64_t getCurrentTimeUs() {
+#if defined(FREERTOS_AVAILABLE)
+    return static_cast<uint64_t>(xTaskGetTickCount()) * portTICK_PERIOD_MS * 1000u;
+#elif defined(PLATFORM_ARDUINO)
+    return static_cast<uint64_t>(micros());
+#else
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+}  // namespace
+
 HsmEventDispatcherBase::EnqueuedEventInfo::EnqueuedEventInfo(const HandlerID_t newHandlerID, const EventID_t newEventID)
     : handlerID(newHandlerID)
     , eventID(newEventID) {}
 
-HsmEventDispatcherBase::HsmEventDispatcherBase(const size_t eventsCacheSize) {
-    mEnqueuedEvents.reserve(eventsCacheSize);
-}
+HsmEventDispatcherBase::HsmEventDispatcherBase(const size_t eventsCacheSize, HsmMemoryResource* resource)
+    // cppcheck-suppress misra-c2012-10.4 ; false-positive. thinks that ':' is arithmetic operation
+    : mActiveTimers(resource)
+    , mEventHandlers(resource)
+    , mEnqueuedEventHandlers(resource)
+    , mTimerHandlers(resource)
+    , mPendingActions(resource)
+    , mPendingEvents(resource)
+    , mEnqueuedEvents(eventsCacheSize)
+    , mHandlerQuotas(resource)
+    , mHandlerServiceStats(resource)
+    , mDeferredHandlers(resource) {}
 
 void HsmEventDispatcherBase::handleDelete(HsmEventDispatcherBase* dispatcher) {
     if (nullptr != dispatcher) {
@@ -33,6 +68,8 @@ void HsmEventDispatcherBase::handleDelete(HsmEventDispatcherBase* dispatcher) {
 void HsmEventDispatcherBase::stop() {
     HSM_TRACE_CALL_DEBUG();
     mStopDispatcher = true;
+    // NOTE: allow new events to wakeup dispatcher after it's restarted
+    clearPendingWakeup();
     // NOTE: child classes must provide additional logic
 }
 
@@ -57,32 +94,37 @@ void HsmEventDispatcherBase::unregisterEventHandler(const HandlerID_t handlerID)
         LockGuard lck(mHandlersSync);
         mEventHandlers.erase(handlerID);
     }
+    {
+        LockGuard lck(mFairnessSync);
+        mHandlerQuotas.erase(handlerID);
+        mHandlerServiceStats.erase(handlerID);
+    }
 }
 
 void HsmEventDispatcherBase::emitEvent(const HandlerID_t handlerID) {
     HSM_TRACE_CALL_DEBUG();
+    bool wasAdded = false;
 
     {
         LockGuard lck(mEmitSync);
-        mPendingEvents.emplace_back(handlerID);
+        wasAdded = addPendingEvent(handlerID);
     }
 
-    notifyDispatcherAboutEvent();
+    if (true == wasAdded) {
+        wakeupDispatcher();
+    }
 
     // NOTE: this is not a full implementation. child classes must implement additional logic
 }
 
 bool HsmEventDispatcherBase::enqueueEvent(const HandlerID_t handlerID, const EventID_t event) {
-    bool wasAdded = false;
-
-    if (mEnqueuedEvents.size() < mEnqueuedEvents.capacity()) {
-        {
-            CriticalSection cs(mEnqueuedEventsSync);
-            mEnqueuedEvents.emplace_back(handlerID, event);
-        }
+    // NOTE: must not use locks or allocate memory since this function could be called from signal handlers
+    const bool wasAdded = mEnqueuedEvents.push(EnqueuedEventInfo(handlerID, event));
 
-        wasAdded = true;
-        notifyDispatcherAboutEvent();
+    if (true == wasAdded) {
+        // NOTE: wakeup flag is lock-free, so it's safe to use it here. Notification itself must be async-signal-safe (see
+        //       notifyDispatcherAboutEvent())
+        wakeupDispatcher();
     }
 
     return wasAdded;
@@ -96,7 +138,7 @@ void HsmEventDispatcherBase::enqueueAction(ActionHandlerFunc_t actionCallback) {
         mPendingActions.emplace_back(std::move(actionCallback));
     }
 
-    notifyDispatcherAboutEvent();
+    wakeupDispatcher();
 }
 
 HandlerID_t HsmEventDispatcherBase::registerEnqueuedEventHandler(const EnqueuedEventHandlerFunc_t& handler) {
@@ -210,6 +252,66 @@ bool HsmEventDispatcherBase::isTimerRunning(const TimerID_t timerID) {
     return (mActiveTimers.find(timerID) != mActiveTimers.end());
 }
 
+void HsmEventDispatcherBase::setPendingEventsLimit(const size_t maxEvents, const QueueOverflowPolicy policy) {
+    HSM_TRACE_CALL_DEBUG_ARGS("maxEvents=%lu, policy=%d", maxEvents, SC2INT(policy));
+    LockGuard lck(mEmitSync);
+
+    mPendingEventsLimit = maxEvents;
+    mPendingEventsPolicy = policy;
+}
+
+EventsQueueStats HsmEventDispatcherBase::getPendingEventsStats() const {
+    LockGuard lck(mEmitSync);
+    EventsQueueStats stats = mPendingEventsStats;
+
+    stats.pendingEvents = mPendingEvents.size();
+    return stats;
+}
+
+EventsQueueStats HsmEventDispatcherBase::getEnqueuedEventsStats() const {
+    EventsQueueStats stats;
+
+    stats.pendingEvents = mEnqueuedEvents.size();
+    stats.droppedEvents = mEnqueuedEvents.getDroppedCount();
+    return stats;
+}
+
+void HsmEventDispatcherBase::setFairnessPolicy(const DispatcherFairnessPolicy policy, const unsigned int defaultQuotaUs) {
+    HSM_TRACE_CALL_DEBUG_ARGS("policy=%d, defaultQuotaUs=%u", SC2INT(policy), defaultQuotaUs);
+    LockGuard lck(mFairnessSync);
+
+    mFairnessPolicy = policy;
+    mDefaultHandlerQuotaUs = ((defaultQuotaUs > 0u) ? defaultQuotaUs : DISPATCHER_DEFAULT_HANDLER_QUOTA_US);
+}
+
+void HsmEventDispatcherBase::setHandlerQuota(const HandlerID_t handlerID, const unsigned int quotaUs) {
+    HSM_TRACE_CALL_DEBUG_ARGS("handlerID=%d, quotaUs=%u", handlerID, quotaUs);
+    LockGuard lck(mFairnessSync);
+
+    if (quotaUs > 0u) {
+        mHandlerQuotas[handlerID] = quotaUs;
+    } else {
+        mHandlerQuotas.erase(handlerID);
+    }
+}
+
+void HsmEventDispatcherBase::setServiceTimeAccounting(const bool enable) {
+    LockGuard lck(mFairnessSync);
+    mServiceTimeAccounting = enable;
+}
+
+HandlerServiceStats HsmEventDispatcherBase::getHandlerServiceStats(const HandlerID_t handlerID) const {
+    HandlerServiceStats stats;
+    LockGuard lck(mFairnessSync);
+    auto it = mHandlerServiceStats.find(handlerID);
+
+    if (mHandlerServiceStats.end() != it) {
+        stats = it->second;
+    }
+
+    return stats;
+}
+
 int HsmEventDispatcherBase::getNextHandlerID() {
     return mNextHandlerId++;
 }
@@ -286,31 +388,36 @@ void HsmEventDispatcherBase::dispatchEnqueuedEvents() {
     if ((false == mStopDispatcher) && (false == mEnqueuedEvents.empty())) {
         HandlerID_t prevHandlerID = INVALID_HSM_DISPATCHER_HANDLER_ID;
         EnqueuedEventHandlerFunc_t callback;
-        std::vector<EnqueuedEventInfo> currentEvents;
+        EnqueuedEventInfo curEvent;
+        // NOTE: limit number of processed events so that producers which enqueue events at high rate couldn't block
+        //       processing of other events
+        size_t eventsLeft = mEnqueuedEvents.capacity();
+
+        // events are processed in the same order as they were enqueued
+        while ((eventsLeft > 0u) && (false == mStopDispatcher) && (true == mEnqueuedEvents.pop(curEvent))) {
+            if (prevHandlerID != curEvent.handlerID) {
+                callback = getEnqueuedEventHandlerFunc(curEvent.handlerID);
+                prevHandlerID = curEvent.handlerID;
+            }
 
-        {
-            CriticalSection lck(mEnqueuedEventsSync);
+            // cppcheck-suppress misra-c2012-14.4 ; false-positive. std::function has a bool() operator
+            if (callback) {
+                (void)callback(curEvent.eventID);
+            }
 
-            // copy instead of move. we want to keep memory allocated in mEnqueuedEvents
-            currentEvents = mEnqueuedEvents;
-            mEnqueuedEvents.clear();
+            --eventsLeft;
         }
 
-        // need to traverse events in reverse order
-        for (auto it = currentEvents.rbegin(); (it != currentEvents.rend()) && (false == mStopDispatcher); ++it) {
-            if (prevHandlerID != it->handlerID) {
-                callback = getEnqueuedEventHandlerFunc(it->handlerID);
-                prevHandlerID = it->handlerID;
-            }
-
-            callback(it->eventID);
+        // wakeup dispatcher to process remaining events
+        if ((false == mStopDispatcher) && (false == mEnqueuedEvents.empty())) {
+            wakeupDispatcher();
         }
     }
 }
 
 void HsmEventDispatcherBase::dispatchPendingActions() {
     if (false == mPendingActions.empty()) {
-        std::list<ActionHandlerFunc_t> actionsSnapshot;
+        HsmList_t<ActionHandlerFunc_t> actionsSnapshot(mPendingActions.get_allocator());
 
         {
             LockGuard lck(mEmitSync);
@@ -324,8 +431,10 @@ void HsmEventDispatcherBase::dispatchPendingActions() {
 }
 
 void HsmEventDispatcherBase::dispatchPendingEvents() {
-    std::list<HandlerID_t> events;
+    PendingHandlersList_t events(mPendingEvents.get_allocator());
 
+    // NOTE: must be cleared before taking pending events. Events added after this point will notify dispatcher again
+    clearPendingWakeup();
     dispatchPendingActions();
 
     if (false == mPendingEvents.empty()) {
@@ -336,11 +445,85 @@ void HsmEventDispatcherBase::dispatchPendingEvents() {
     dispatchPendingEventsImpl(events);
 }
 
-void HsmEventDispatcherBase::dispatchPendingEventsImpl(const std::list<HandlerID_t>& events) {
+void HsmEventDispatcherBase::wakeupDispatcher() {
+    if (false == mWakeupPending.test_and_set()) {
+        notifyDispatcherAboutEvent();
+    }
+}
+
+void HsmEventDispatcherBase::clearPendingWakeup() {
+    mWakeupPending.clear();
+}
+
+bool HsmEventDispatcherBase::addPendingEvent(const HandlerID_t handlerID) {
+    bool wasAdded = false;
+
+    if ((HSM_QUEUE_UNLIMITED == mPendingEventsLimit) || (mPendingEvents.size() < mPendingEventsLimit)) {
+        mPendingEvents.emplace_back(handlerID);
+        wasAdded = true;
+    } else {
+        const bool isQueued = (std::find(mPendingEvents.begin(), mPendingEvents.end(), handlerID) != mPendingEvents.end());
+
+        if ((true == isQueued) && (QueueOverflowPolicy::COALESCE == mPendingEventsPolicy)) {
+            // handler will be called anyway. no need to wakeup dispatcher
+            ++mPendingEventsStats.coalescedEvents;
+        } else if ((true == isQueued) && (QueueOverflowPolicy::DROP_OLDEST != mPendingEventsPolicy)) {
+            HSM_TRACE_WARNING("pending events limit reached. event for handlerID=%d was dropped", handlerID);
+            ++mPendingEventsStats.droppedEvents;
+        } else {
+            // NOTE: handler without pending entries is always added. HSM emits a single event to process its own
+            //       queue, so dropping it would leave HSM events unprocessed until the next emitEvent() call.
+            mPendingEvents.emplace_back(handlerID);
+            wasAdded = true;
+
+            if (true == dropRedundantPendingEvent()) {
+                if (QueueOverflowPolicy::COALESCE == mPendingEventsPolicy) {
+                    ++mPendingEventsStats.coalescedEvents;
+                } else {
+                    ++mPendingEventsStats.droppedEvents;
+                }
+            }
+        }
+    }
+
+    if (mPendingEvents.size() > mPendingEventsStats.maxPendingEvents) {
+        mPendingEventsStats.maxPendingEvents = mPendingEvents.size();
+    }
+
+    return wasAdded;
+}
+
+bool HsmEventDispatcherBase::dropRedundantPendingEvent() {
+    bool wasDropped = false;
+    HsmMap_t<HandlerID_t, size_t> entriesCount(mPendingEvents.get_allocator());
+
+    for (const HandlerID_t id : mPendingEvents) {
+        ++entriesCount[id];
+    }
+
+    for (auto it = mPendingEvents.begin(); it != mPendingEvents.end(); ++it) {
+        if (entriesCount[*it] > 1U) {
+            HSM_TRACE_WARNING("pending events limit reached. event for handlerID=%d was dropped", *it);
+            (void)mPendingEvents.erase(it);
+            wasDropped = true;
+            break;
+        }
+    }
+
+    return wasDropped;
+}
+
+bool HsmEventDispatcherBase::hasDeferredEvents() const {
+    return (false == mDeferredHandlers.empty());
+}
+
+void HsmEventDispatcherBase::dispatchPendingEventsImpl(const PendingHandlersList_t& events) {
     dispatchEnqueuedEvents();
 
-    if ((false == mStopDispatcher) && (false == events.empty())) {
-        std::map<HandlerID_t, EventHandlerFunc_t> eventHandlersCopy;
+    if ((false == mStopDispatcher) && ((false == events.empty()) || (false == mDeferredHandlers.empty()))) {
+        EventHandlersMap_t eventHandlersCopy(mEventHandlers.get_allocator());
+        DispatcherFairnessPolicy policy = DispatcherFairnessPolicy::FIFO;
+        bool measureTime = false;
 
         {
             // TODO: workaround to prevent recursive lock if registerEventHandler/unregisterEventHandler is called from handler
@@ -348,18 +531,138 @@ void HsmEventDispatcherBase::dispatchPendingEventsImpl(const std::list<HandlerID
             LockGuard lck(mHandlersSync);
             eventHandlersCopy = mEventHandlers;
         }
+        {
+            LockGuard lck(mFairnessSync);
+            policy = mFairnessPolicy;
+            // NOTE: DEFICIT_ROUND_ROBIN can't work without measuring service time
+            measureTime = ((true == mServiceTimeAccounting) || (DispatcherFairnessPolicy::DEFICIT_ROUND_ROBIN == policy));
+        }
 
-        for (auto it = events.begin(); (it != events.end()) && (false == mStopDispatcher); ++it) {
-            auto itHandler = eventHandlersCopy.find(*it);
+        // NOTE: deferred events must be processed even if policy was changed to FIFO
+        if ((DispatcherFairnessPolicy::FIFO != policy) || (false == mDeferredHandlers.empty())) {
+            dispatchFairRound(events, eventHandlersCopy, policy, measureTime);
 
-            if (itHandler != eventHandlersCopy.end()) {
-                // NOTE: if callback returns FALSE it means the handler doesn't want to process more events
-                if (false == itHandler->second()) {
-                    eventHandlersCopy.erase(itHandler);
+            // wakeup dispatcher to process events which didn't fit into this round
+            if ((false == mStopDispatcher) && (false == mDeferredHandlers.empty())) {
+                wakeupDispatcher();
+            }
+        } else {
+            uint64_t serviceTimeUs = 0;
+
+            for (auto it = events.begin(); (it != events.end()) && (false == mStopDispatcher); ++it) {
+                auto itHandler = eventHandlersCopy.find(*it);
+
+                if (itHandler != eventHandlersCopy.end()) {
+                    // NOTE: if callback returns FALSE it means the handler doesn't want to process more events
+                    if (false == callEventHandler(itHandler->first, itHandler->second, measureTime, serviceTimeUs)) {
+                        eventHandlersCopy.erase(itHandler);
+                    }
                 }
             }
         }
     }
 }
 
+bool HsmEventDispatcherBase::callEventHandler(const HandlerID_t handlerID,
+                                              const EventHandlerFunc_t& handler,
+                                              const bool measureTime,
+                                              uint64_t& outServiceTimeUs) {
+    bool handlerIsValid = false;
+
+    if (true == measureTime) {
+        const uint64_t startedAtUs = getCurrentTimeUs();
+
+        handlerIsValid = handler();
+        outServiceTimeUs = getCurrentTimeUs() - startedAtUs;
+
+        LockGuard lck(mFairnessSync);
+        HandlerServiceStats& stats = mHandlerServiceStats[handlerID];
+
+        ++stats.calls;
+        stats.totalServiceTimeUs += outServiceTimeUs;
+
+        if (outServiceTimeUs > stats.maxServiceTimeUs) {
+            stats.maxServiceTimeUs = outServiceTimeUs;
+        }
+    } else {
+        handlerIsValid = handler();
+        outServiceTimeUs = 0;
+    }
+
+    return handlerIsValid;
+}
+
+void HsmEventDispatcherBase::dispatchFairRound(const PendingHandlersList_t& events,
+                                               EventHandlersMap_t& eventHandlers,
+                                               const DispatcherFairnessPolicy policy,
+                                               const bool measureTime) {
+    HsmMap_t<HandlerID_t, unsigned int> quotas(mHandlerQuotas.get_allocator());
+    unsigned int defaultQuotaUs = DISPATCHER_DEFAULT_HANDLER_QUOTA_US;
+
+    if (DispatcherFairnessPolicy::DEFICIT_ROUND_ROBIN == policy) {
+        LockGuard lck(mFairnessSync);
+        quotas = mHandlerQuotas;
+        defaultQuotaUs = mDefaultHandlerQuotaUs;
+    }
+
+    // new events are added to the end of the round. handlers keep their position while they have pending events
+    for (const HandlerID_t handlerID : events) {
+        // NOTE: false-positive. "return" statement belongs to lambda function, not parent function
+        // cppcheck-suppress misra-c2012-15.5
+        auto itDeferred = std::find_if(mDeferredHandlers.begin(), mDeferredHandlers.end(), [&](const DeferredHandlerInfo& info) {
+            return (handlerID == info.handlerID);
+        });
+
+        if (mDeferredHandlers.end() != itDeferred) {
+            ++itDeferred->pendingCalls;
+        } else {
+            DeferredHandlerInfo newHandler;
+
+            newHandler.handlerID = handlerID;
+            newHandler.pendingCalls = 1;
+            mDeferredHandlers.emplace_back(newHandler);
+        }
+    }
+
+    auto it = mDeferredHandlers.begin();
+
+    while ((mDeferredHandlers.end() != it) && (false == mStopDispatcher)) {
+        auto itHandler = eventHandlers.find(it->handlerID);
+        bool handlerIsValid = (eventHandlers.end() != itHandler);
+
+        if (true == handlerIsValid) {
+            uint64_t serviceTimeUs = 0;
+
+            if (DispatcherFairnessPolicy::DEFICIT_ROUND_ROBIN == policy) {
+                auto itQuota = quotas.find(it->handlerID);
+
+                it->deficitUs += static_cast<int64_t>((quotas.end() != itQuota) ? itQuota->second : defaultQuotaUs);
+
+                while ((true == handlerIsValid) && (it->pendingCalls > 0u) && (it->deficitUs > 0) &&
+                       (false == mStopDispatcher)) {
+                    handlerIsValid = callEventHandler(it->handlerID, itHandler->second, measureTime, serviceTimeUs);
+                    --it->pendingCalls;
+                    // NOTE: every call has a cost even if it was too fast to be measured
+                    it->deficitUs -= static_cast<int64_t>((serviceTimeUs > 0u) ? serviceTimeUs : 1u);
+                }
+            } else {
+                handlerIsValid = callEventHandler(it->handlerID, itHandler->second, measureTime, serviceTimeUs);
+                --it->pendingCalls;
+            }
+
+            // NOTE: if callback returns FALSE it means the handler doesn't want to process more events
+            if (false == handlerIsValid) {
+                eventHandlers.erase(itHandler);
+            }
+        }
+
+        // handler's deficit is reset once all its events were processed
+        if ((false == handlerIsValid) || (0u == it->pendingCalls)) {
+            it = mDeferredHandlers.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
 }  // namespace hsmcpp
\ No newline at end of file
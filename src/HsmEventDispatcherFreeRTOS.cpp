@@ -61,13 +61,17 @@ void HsmEventDispatcherFreeRTOS::emitEvent(const HandlerID_t handlerID) {
     if (nullptr != mDispatcherTask) {
         dispatchEnqueuedEvents();
 
+        bool wasAdded = false;
+
         {
             // TODO: this will work only for single-core FreeRTOS
             InterruptsFreeSection lck;
-            mPendingEvents.emplace_back(handlerID);
+            wasAdded = addPendingEvent(handlerID);
         }
 
-        notifyDispatcherAboutEvent();
+        if (true == wasAdded) {
+            wakeupDispatcher();
+        }
     }
 }
 
@@ -229,8 +233,10 @@ void HsmEventDispatcherFreeRTOS::doDispatching(void* pvParameters) {
 
     if (nullptr != pThis) {
         while (false == pThis->mStopDispatcher) {
-            std::list<HandlerID_t> events;
+            PendingHandlersList_t events(pThis->mPendingEvents.get_allocator());
 
+            // NOTE: must be cleared before taking pending events. Events added after this point will notify dispatcher again
+            pThis->clearPendingWakeup();
             pThis->dispatchPendingActions();
 
             {
@@ -243,7 +249,7 @@ void HsmEventDispatcherFreeRTOS::doDispatching(void* pvParameters) {
             pThis->dispatchPendingEventsImpl(events);
 
             if (false == pThis->mStopDispatcher) {
-                if (true == pThis->mPendingEvents.empty()) {
+                if ((true == pThis->mPendingEvents.empty()) && (false == pThis->hasDeferredEvents())) {
                     HSM_TRACE_DEBUG("wait for emit...");
                     ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
                     HSM_TRACE_DEBUG("woke up. pending events=%lu", pThis->mPendingEvents.size());
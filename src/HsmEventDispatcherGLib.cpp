@@ -3,7 +3,8 @@
 
 #include "hsmcpp/HsmEventDispatcherGLib.hpp"
 
-#include <unistd.h>
+#include <algorithm>
+#include <functional>
 
 #include "hsmcpp/logging.hpp"
 #include "hsmcpp/os/CriticalSection.hpp"
@@ -12,6 +13,20 @@ namespace hsmcpp {
 
 constexpr const char* HSM_TRACE_CLASS = "HsmEventDispatcherGLib";
 
+// heap is rebuilt when number of outdated entries becomes bigger than this value
+constexpr size_t TIMERS_HEAP_MAX_OUTDATED = 64;
+
+GSourceFuncs HsmEventDispatcherGLib::sSourceFuncs = {&HsmEventDispatcherGLib::onSourcePrepare,
+                                                     &HsmEventDispatcherGLib::onSourceCheck,
+                                                     &HsmEventDispatcherGLib::onSourceDispatch,
+                                                     nullptr,
+                                                     nullptr,
+                                                     nullptr};
+
+bool HsmEventDispatcherGLib::TimerDeadline::operator>(const TimerDeadline& other) const {
+    return elapseAfterUs > other.elapseAfterUs;
+}
+
 HsmEventDispatcherGLib::HsmEventDispatcherGLib(const size_t eventsCacheSize)
     // NOTE: false-positive. thinks that ':' is arithmetic operation
     // cppcheck-suppress misra-c2012-10.4
@@ -64,41 +79,22 @@ bool HsmEventDispatcherGLib::start() {
     bool result = false;
 
     // check if dispatcher was already started
-    if ((-1) == mPipeFD[0]) {
-        int rc = pipe(mPipeFD);
-
-        if (0 == rc) {
-            mReadChannel = g_io_channel_unix_new(mPipeFD[0]);
-
-            if (nullptr != mReadChannel) {
-                mIoSource = g_io_create_watch(mReadChannel, static_cast<GIOCondition>(G_IO_IN | G_IO_HUP));
-
-                if (nullptr != mIoSource) {
-                    g_source_set_callback(mIoSource, reinterpret_cast<GSourceFunc>(onPipeDataAvailable), this, nullptr);
-                    g_source_attach(mIoSource, mContext);
-                    result = true;
-                } else {
-                    HSM_TRACE_ERROR("failed to create io source");
-                }
-            } else {
-                HSM_TRACE_ERROR("failed to create io channel");
-            }
-        } else {
-            HSM_TRACE_ERROR("failed to create pipe (errno=%d)", errno);
-        }
+    if (nullptr == mSource) {
+        mSource = g_source_new(&sSourceFuncs, sizeof(DispatcherSource));
 
-        if (false == result) {
-            if (nullptr != mReadChannel) {
-                g_io_channel_unref(mReadChannel);
-                mReadChannel = nullptr;
-            }
+        if (nullptr != mSource) {
+            reinterpret_cast<DispatcherSource*>(mSource)->dispatcher = this;
 
-            if ((-1) == mPipeFD[0]) {
-                close(mPipeFD[0]);
-                close(mPipeFD[1]);
-                mPipeFD[0] = -1;
-                mPipeFD[1] = -1;
+            // NOTE: context is needed to wakeup GLib loop from other threads
+            if (nullptr == mContext) {
+                mContext = g_main_context_default();
             }
+
+            mStopDispatcher = false;
+            (void)g_source_attach(mSource, mContext);
+            result = true;
+        } else {
+            HSM_TRACE_ERROR("failed to create dispatcher source");
         }
     } else {
         result = true;
@@ -112,26 +108,17 @@ void HsmEventDispatcherGLib::stop() {
     unregisterAllTimerHandlers();
     unregisterAllEventHandlers();
 
-    if (nullptr != mIoSource) {
-        g_source_destroy(mIoSource);
-        g_source_unref(mIoSource);
-        mIoSource = nullptr;
-    }
-
-    if (nullptr != mReadChannel) {
-        g_io_channel_unref(mReadChannel);
-        mReadChannel = nullptr;
-        close(mPipeFD[0]);
-        close(mPipeFD[1]);
-        mPipeFD[0] = -1;
-        mPipeFD[1] = -1;
+    if (nullptr != mSource) {
+        g_source_destroy(mSource);
+        g_source_unref(mSource);
+        mSource = nullptr;
     }
 }
 
 void HsmEventDispatcherGLib::emitEvent(const HandlerID_t handlerID) {
     HSM_TRACE_CALL();
 
-    if (mPipeFD[1] > 0) {
+    if (nullptr != mSource) {
         HsmEventDispatcherBase::emitEvent(handlerID);
     }
 }
@@ -139,12 +126,8 @@ void HsmEventDispatcherGLib::emitEvent(const HandlerID_t handlerID) {
 void HsmEventDispatcherGLib::unregisterAllTimerHandlers() {
     CriticalSection lckExpired(mRunningTimersSync);
 
-    for (auto it = mNativeTimerHandlers.begin(); it != mNativeTimerHandlers.end(); ++it) {
-        g_source_destroy(it->second);
-        g_source_unref(it->second);
-    }
-
-    mNativeTimerHandlers.clear();
+    mRunningTimers.clear();
+    mTimersHeap.clear();
 }
 
 void HsmEventDispatcherGLib::startTimerImpl(const TimerID_t timerID, const unsigned int intervalMs, const bool isSingleShot) {
@@ -152,100 +135,132 @@ void HsmEventDispatcherGLib::startTimerImpl(const TimerID_t timerID, const unsig
                               SC2INT(timerID),
                               intervalMs,
                               BOOL2INT(isSingleShot));
+
+    {
+        CriticalSection lckExpired(mRunningTimersSync);
+        scheduleTimer(timerID, g_get_monotonic_time() + (static_cast<gint64>(intervalMs) * 1000));
+    }
+
+    // wakeup GLib loop so that it could recalculate poll timeout
+    if (nullptr != mSource) {
+        g_main_context_wakeup(mContext);
+    }
+}
+
+void HsmEventDispatcherGLib::stopTimerImpl(const TimerID_t timerID) {
+    HSM_TRACE_CALL_DEBUG_ARGS("timerID=%d", SC2INT(timerID));
     CriticalSection lckExpired(mRunningTimersSync);
-    auto it = mNativeTimerHandlers.find(timerID);
 
-    if (mNativeTimerHandlers.end() == it) {
-        GSource* timeoutSource = g_timeout_source_new(intervalMs);
+    // NOTE: entry in mTimersHeap will be removed when it reaches the top of the heap
+    mRunningTimers.erase(timerID);
+}
+
+void HsmEventDispatcherGLib::scheduleTimer(const TimerID_t timerID, const gint64 elapseAfterUs) {
+    RunningTimerInfo& timer = mRunningTimers[timerID];
+
+    ++mTimersGeneration;
+    timer.elapseAfterUs = elapseAfterUs;
+    timer.generation = mTimersGeneration;
 
-        g_source_set_callback(timeoutSource,
-                              G_SOURCE_FUNC(&HsmEventDispatcherGLib::onTimerEvent),
-                              new TimerData_t(this, timerID),
-                              &HsmEventDispatcherGLib::onFreeTimerData);
+    if (mTimersHeap.size() > (mRunningTimers.size() + TIMERS_HEAP_MAX_OUTDATED)) {
+        // too many outdated entries (timers are often restarted or stopped). rebuild heap from running timers
+        mTimersHeap.clear();
 
-        g_source_attach(timeoutSource, mContext);
-        mNativeTimerHandlers[timerID] = timeoutSource;
+        for (const auto& curTimer : mRunningTimers) {
+            mTimersHeap.push_back({curTimer.second.elapseAfterUs, curTimer.first, curTimer.second.generation});
+        }
+
+        std::make_heap(mTimersHeap.begin(), mTimersHeap.end(), std::greater<TimerDeadline>());
     } else {
-        HSM_TRACE_ERROR("timer with id=%d already exists", timerID);
+        mTimersHeap.push_back({elapseAfterUs, timerID, timer.generation});
+        std::push_heap(mTimersHeap.begin(), mTimersHeap.end(), std::greater<TimerDeadline>());
     }
 }
 
-void HsmEventDispatcherGLib::stopTimerImpl(const TimerID_t timerID) {
-    HSM_TRACE_CALL_DEBUG_ARGS("timerID=%d", SC2INT(timerID));
+gint64 HsmEventDispatcherGLib::getNextTimerDeadline() {
+    gint64 deadline = -1;
     CriticalSection lckExpired(mRunningTimersSync);
-    auto it = mNativeTimerHandlers.find(timerID);
 
-    if (mNativeTimerHandlers.end() != it) {
-        g_source_destroy(it->second);
-        g_source_unref(it->second);
-        mNativeTimerHandlers.erase(it);
+    while ((-1 == deadline) && (false == mTimersHeap.empty())) {
+        const TimerDeadline& nearest = mTimersHeap.front();
+        auto itTimer = mRunningTimers.find(nearest.timerID);
+
+        if ((mRunningTimers.end() != itTimer) && (itTimer->second.generation == nearest.generation)) {
+            deadline = nearest.elapseAfterUs;
+        } else {
+            // timer was stopped or restarted
+            std::pop_heap(mTimersHeap.begin(), mTimersHeap.end(), std::greater<TimerDeadline>());
+            mTimersHeap.pop_back();
+        }
     }
+
+    return deadline;
 }
 
-gboolean HsmEventDispatcherGLib::onTimerEvent(const TimerData_t* timerData) {
-    bool restartTimer = false;
+void HsmEventDispatcherGLib::dispatchExpiredTimers(const gint64 nowUs) {
+    std::vector<TimerDeadline> expiredTimers;
 
-    if (nullptr != timerData) {
-        restartTimer = (timerData->first->handleTimerEvent(timerData->second) > 0);
+    {
+        CriticalSection lckExpired(mRunningTimersSync);
 
-        if (false == restartTimer) {
-            CriticalSection lckExpired(timerData->first->mRunningTimersSync);
-            auto itTimer = timerData->first->mNativeTimerHandlers.find(timerData->second);
+        while ((false == mTimersHeap.empty()) && (mTimersHeap.front().elapseAfterUs <= nowUs)) {
+            auto itTimer = mRunningTimers.find(mTimersHeap.front().timerID);
 
-            if (timerData->first->mNativeTimerHandlers.end() != itTimer) {
-                g_source_unref(itTimer->second);
-                timerData->first->mNativeTimerHandlers.erase(itTimer);
-            } else {
-                HSM_TRACE_DEF();
-                HSM_TRACE_ERROR("unexpected error. timer not found");
+            if ((mRunningTimers.end() != itTimer) && (itTimer->second.generation == mTimersHeap.front().generation)) {
+                expiredTimers.push_back(mTimersHeap.front());
             }
+
+            std::pop_heap(mTimersHeap.begin(), mTimersHeap.end(), std::greater<TimerDeadline>());
+            mTimersHeap.pop_back();
         }
     }
 
-    return restartTimer;
-}
+    for (auto it = expiredTimers.begin(); (it != expiredTimers.end()) && (false == mStopDispatcher); ++it) {
+        const TimerDeadline& curTimer = *it;
+        // NOTE: timer could be restarted or stopped by one of the previous handlers
+        const unsigned int nextIntervalMs = handleTimerEvent(curTimer.timerID);
+        CriticalSection lckExpired(mRunningTimersSync);
+        auto itTimer = mRunningTimers.find(curTimer.timerID);
 
-void HsmEventDispatcherGLib::onFreeTimerData(void* timerData) {
-    delete reinterpret_cast<TimerData_t*>(timerData);
+        if ((mRunningTimers.end() != itTimer) && (itTimer->second.generation == curTimer.generation)) {
+            if (nextIntervalMs > 0u) {
+                scheduleTimer(curTimer.timerID, nowUs + (static_cast<gint64>(nextIntervalMs) * 1000));
+            } else {
+                mRunningTimers.erase(itTimer);
+            }
+        }
+    }
 }
 
 void HsmEventDispatcherGLib::notifyDispatcherAboutEvent() {
-    std::lock_guard<std::mutex> lck(mPipeSync);
-    char dummy = 1;
+    mEventsReady.store(true);
 
-    // we just need to trigger the callback. there is no need to pass any real data there
-    // TODO: should we check for result?
-    write(mPipeFD[1], &dummy, sizeof(dummy));
+    if (nullptr != mSource) {
+        g_main_context_wakeup(mContext);
+    }
 }
 
-gboolean HsmEventDispatcherGLib::onPipeDataAvailable(GIOChannel* gio, GIOCondition condition, gpointer data) {
+gboolean HsmEventDispatcherGLib::dispatchSource() {
     HSM_TRACE_CALL();
     gboolean continueDispatching = TRUE;
-    HsmEventDispatcherGLib* pThis = static_cast<HsmEventDispatcherGLib*>(data);
-
-    if (false == pThis->mStopDispatcher) {
-        pThis->mDispatchingIterationRunning = true;
 
-        HSM_TRACE_DEBUG("condition=%d, G_IO_HUP=%s, G_IO_IN=%s",
-                        static_cast<int>(condition),
-                        BOOL2STR(condition & G_IO_HUP),
-                        BOOL2STR(condition & G_IO_IN));
+    if (false == mStopDispatcher) {
+        mDispatchingIterationRunning = true;
 
-        if (!(condition & G_IO_HUP)) {
-            char dummy;
-            int bytes = read(pThis->mPipeFD[0], &dummy, sizeof(dummy));
-
-            if (1 == bytes) {
-                pThis->dispatchPendingEvents();
-            }
+        // NOTE: all pending events are processed in a single dispatch. Events emitted after this point will wakeup
+        //       dispatcher again
+        if (true == mEventsReady.exchange(false)) {
+            dispatchPendingEvents();
         }
 
-        if (true == pThis->mStopDispatcher) {
+        dispatchExpiredTimers(g_get_monotonic_time());
+
+        if (true == mStopDispatcher) {
             continueDispatching = FALSE;
-            pThis->mDispatchingDoneEvent.notify_one();
+            mDispatchingDoneEvent.notify_one();
         }
 
-        pThis->mDispatchingIterationRunning = false;
+        mDispatchingIterationRunning = false;
     } else {
         continueDispatching = FALSE;
     }
@@ -253,4 +268,50 @@ gboolean HsmEventDispatcherGLib::onPipeDataAvailable(GIOChannel* gio, GIOConditi
     return continueDispatching;
 }
 
-}  // namespace hsmcpp
\ No newline at end of file
+gboolean HsmEventDispatcherGLib::onSourcePrepare(GSource* source, gint* timeout) {
+    HsmEventDispatcherGLib* pThis = reinterpret_cast<DispatcherSource*>(source)->dispatcher;
+    gboolean ready = (true == pThis->mEventsReady.load()) ? TRUE : FALSE;
+
+    *timeout = -1;
+
+    if (FALSE == ready) {
+        const gint64 nextDeadline = pThis->getNextTimerDeadline();
+
+        if (nextDeadline >= 0) {
+            const gint64 nowUs = g_source_get_time(source);
+
+            if (nextDeadline <= nowUs) {
+                ready = TRUE;
+            } else {
+                // round up to make sure timer is already elapsed when poll times out
+                *timeout = static_cast<gint>(std::min<gint64>((nextDeadline - nowUs + 999) / 1000, G_MAXINT));
+            }
+        }
+    }
+
+    return ready;
+}
+
+gboolean HsmEventDispatcherGLib::onSourceCheck(GSource* source) {
+    HsmEventDispatcherGLib* pThis = reinterpret_cast<DispatcherSource*>(source)->dispatcher;
+    gboolean ready = (true == pThis->mEventsReady.load()) ? TRUE : FALSE;
+
+    if (FALSE == ready) {
+        const gint64 nextDeadline = pThis->getNextTimerDeadline();
+
+        if ((nextDeadline >= 0) && (nextDeadline <= g_source_get_time(source))) {
+            ready = TRUE;
+        }
+    }
+
+    return ready;
+}
+
+gboolean HsmEventDispatcherGLib::onSourceDispatch(GSource* source, GSourceFunc callback, gpointer userData) {
+    (void)callback;
+    (void)userData;
+
+    return reinterpret_cast<DispatcherSource*>(source)->dispatcher->dispatchSource();
+}
+
+}  // namespace hsmcpp
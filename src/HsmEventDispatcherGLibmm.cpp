@@ -4,14 +4,25 @@
 #include "hsmcpp/HsmEventDispatcherGLibmm.hpp"
 
 #include <algorithm>
+#include <climits>
+#include <functional>
+#include <iterator>
 
 #include "hsmcpp/logging.hpp"
 #include "hsmcpp/os/CriticalSection.hpp"
+#include "hsmcpp/os/LockGuard.hpp"
 
 namespace hsmcpp {
 
 constexpr const char* HSM_TRACE_CLASS = "HsmEventDispatcherGLibmm";
 
+// heap is rebuilt when number of outdated entries becomes bigger than this value
+constexpr size_t TIMERS_HEAP_MAX_OUTDATED = 64;
+
+bool HsmEventDispatcherGLibmm::TimerDeadline::operator>(const TimerDeadline& other) const {
+    return elapseAfter > other.elapseAfter;
+}
+
 HsmEventDispatcherGLibmm::HsmEventDispatcherGLibmm(const size_t eventsCacheSize)
     : HsmEventDispatcherBase(eventsCacheSize)
     , mMainContext(Glib::MainContext::get_default()) {
@@ -80,7 +91,7 @@ bool HsmEventDispatcherGLibmm::start() {
             if (mDispatcher) {
                 if (mDispatcherConnection.connected() == false) {
                     mDispatcherConnection =
-                        mDispatcher->connect(sigc::mem_fun(this, &HsmEventDispatcherGLibmm::dispatchPendingEvents));
+                        mDispatcher->connect(sigc::mem_fun(this, &HsmEventDispatcherGLibmm::dispatchEventsBatch));
                 }
 
                 result = true;
@@ -107,14 +118,20 @@ void HsmEventDispatcherGLibmm::stop() {
     mDispatcher.reset();
 }
 
+void HsmEventDispatcherGLibmm::setDispatchBatchSize(const size_t batchSize) {
+    mDispatchBatchSize.store(batchSize);
+}
+
 void HsmEventDispatcherGLibmm::unregisterAllTimerHandlers() {
     CriticalSection cs(mRunningTimersSync);
 
-    for (auto it = mNativeTimerHandlers.begin(); it != mNativeTimerHandlers.end(); ++it) {
-        it->second.disconnect();
-    }
+    mRunningTimers.clear();
+    mTimersHeap.clear();
 
-    mNativeTimerHandlers.clear();
+    if (true == mNativeTimerArmed) {
+        mNativeTimer.disconnect();
+        mNativeTimerArmed = false;
+    }
 }
 
 void HsmEventDispatcherGLibmm::startTimerImpl(const TimerID_t timerID, const unsigned int intervalMs, const bool isSingleShot) {
@@ -123,25 +140,113 @@ void HsmEventDispatcherGLibmm::startTimerImpl(const TimerID_t timerID, const uns
                               intervalMs,
                               BOOL2INT(isSingleShot));
     CriticalSection cs(mRunningTimersSync);
-    auto it = mNativeTimerHandlers.find(timerID);
 
-    if (mNativeTimerHandlers.end() == it) {
-        mNativeTimerHandlers[timerID] = mMainContext->signal_timeout().connect(
-            sigc::bind(sigc::mem_fun(this, &HsmEventDispatcherGLibmm::onTimerEvent), timerID),
-            intervalMs);
-    } else {
-        HSM_TRACE_ERROR("timer with id=%d already exists", timerID);
-    }
+    scheduleTimer(timerID, std::chrono::steady_clock::now() + std::chrono::milliseconds(intervalMs));
+    updateNativeTimer();
 }
 
 void HsmEventDispatcherGLibmm::stopTimerImpl(const TimerID_t timerID) {
     HSM_TRACE_CALL_DEBUG_ARGS("timerID=%d", SC2INT(timerID));
     CriticalSection cs(mRunningTimersSync);
-    auto it = mNativeTimerHandlers.find(timerID);
 
-    if (mNativeTimerHandlers.end() != it) {
-        it->second.disconnect();
-        mNativeTimerHandlers.erase(it);
+    // NOTE: entry in mTimersHeap will be removed when it reaches the top of the heap. Native timer is not changed since it
+    //       will be armed for the next deadline when it elapses
+    mRunningTimers.erase(timerID);
+}
+
+void HsmEventDispatcherGLibmm::scheduleTimer(const TimerID_t timerID,
+                                             const std::chrono::time_point<std::chrono::steady_clock>& elapseAfter) {
+    RunningTimerInfo& timer = mRunningTimers[timerID];
+
+    ++mTimersGeneration;
+    timer.elapseAfter = elapseAfter;
+    timer.generation = mTimersGeneration;
+
+    if (mTimersHeap.size() > (mRunningTimers.size() + TIMERS_HEAP_MAX_OUTDATED)) {
+        // too many outdated entries (timers are often restarted or stopped). rebuild heap from running timers
+        mTimersHeap.clear();
+
+        for (const auto& curTimer : mRunningTimers) {
+            mTimersHeap.push_back({curTimer.second.elapseAfter, curTimer.first, curTimer.second.generation});
+        }
+
+        std::make_heap(mTimersHeap.begin(), mTimersHeap.end(), std::greater<TimerDeadline>());
+    } else {
+        mTimersHeap.push_back({elapseAfter, timerID, timer.generation});
+        std::push_heap(mTimersHeap.begin(), mTimersHeap.end(), std::greater<TimerDeadline>());
+    }
+}
+
+void HsmEventDispatcherGLibmm::updateNativeTimer() {
+    bool hasTimers = false;
+
+    // remove entries of stopped and restarted timers
+    while ((false == hasTimers) && (false == mTimersHeap.empty())) {
+        auto itTimer = mRunningTimers.find(mTimersHeap.front().timerID);
+
+        if ((mRunningTimers.end() != itTimer) && (itTimer->second.generation == mTimersHeap.front().generation)) {
+            hasTimers = true;
+        } else {
+            std::pop_heap(mTimersHeap.begin(), mTimersHeap.end(), std::greater<TimerDeadline>());
+            mTimersHeap.pop_back();
+        }
+    }
+
+    // NOTE: native timer is re-armed only if nearest deadline became earlier. If it elapses too early, it will be armed
+    //       again for the actual deadline
+    if ((true == hasTimers) && (mMainContext) &&
+        ((false == mNativeTimerArmed) || (mTimersHeap.front().elapseAfter < mNativeTimerDeadline))) {
+        const auto remainingUs = std::chrono::duration_cast<std::chrono::microseconds>(mTimersHeap.front().elapseAfter -
+                                                                                       std::chrono::steady_clock::now())
+                                     .count();
+        // round up to make sure timer is already elapsed when native timer fires
+        const unsigned int intervalMs =
+            static_cast<unsigned int>(std::min<int64_t>(std::max<int64_t>((remainingUs + 999) / 1000, 0), UINT_MAX));
+
+        if (true == mNativeTimerArmed) {
+            mNativeTimer.disconnect();
+        }
+
+        ++mNativeTimerGeneration;
+        mNativeTimer = mMainContext->signal_timeout().connect(
+            sigc::bind(sigc::mem_fun(this, &HsmEventDispatcherGLibmm::onTimerEvent), mNativeTimerGeneration),
+            intervalMs);
+        mNativeTimerArmed = true;
+        mNativeTimerDeadline = mTimersHeap.front().elapseAfter;
+    }
+}
+
+void HsmEventDispatcherGLibmm::dispatchExpiredTimers(const std::chrono::time_point<std::chrono::steady_clock>& now) {
+    std::vector<TimerDeadline> expiredTimers;
+
+    {
+        CriticalSection cs(mRunningTimersSync);
+
+        while ((false == mTimersHeap.empty()) && (mTimersHeap.front().elapseAfter <= now)) {
+            auto itTimer = mRunningTimers.find(mTimersHeap.front().timerID);
+
+            if ((mRunningTimers.end() != itTimer) && (itTimer->second.generation == mTimersHeap.front().generation)) {
+                expiredTimers.push_back(mTimersHeap.front());
+            }
+
+            std::pop_heap(mTimersHeap.begin(), mTimersHeap.end(), std::greater<TimerDeadline>());
+            mTimersHeap.pop_back();
+        }
+    }
+
+    for (auto it = expiredTimers.begin(); (it != expiredTimers.end()) && (false == mStopDispatcher); ++it) {
+        // NOTE: timer could be restarted or stopped by one of the previous handlers
+        const unsigned int nextIntervalMs = handleTimerEvent(it->timerID);
+        CriticalSection cs(mRunningTimersSync);
+        auto itTimer = mRunningTimers.find(it->timerID);
+
+        if ((mRunningTimers.end() != itTimer) && (itTimer->second.generation == it->generation)) {
+            if (nextIntervalMs > 0u) {
+                scheduleTimer(it->timerID, now + std::chrono::milliseconds(nextIntervalMs));
+            } else {
+                mRunningTimers.erase(itTimer);
+            }
+        }
     }
 }
 
@@ -149,22 +254,59 @@ void HsmEventDispatcherGLibmm::notifyDispatcherAboutEvent() {
     mDispatcher->emit();
 }
 
-bool HsmEventDispatcherGLibmm::onTimerEvent(const TimerID_t timerID) {
-    HSM_TRACE_CALL_DEBUG_ARGS("timerID=%d", SC2INT(timerID));
-    const bool restartTimer = (handleTimerEvent(timerID) > 0);
+void HsmEventDispatcherGLibmm::dispatchEventsBatch() {
+    HSM_TRACE_CALL_DEBUG();
+    const size_t batchSize = mDispatchBatchSize.load();
+    PendingHandlersList_t events(mPendingEvents.get_allocator());
+    bool hasMoreEvents = false;
 
-    if (false == restartTimer) {
-        CriticalSection cs(mRunningTimersSync);
-        auto itTimer = mNativeTimerHandlers.find(timerID);
+    // NOTE: must be cleared before taking pending events. Events added after this point will notify dispatcher again
+    clearPendingWakeup();
+    dispatchPendingActions();
 
-        if (mNativeTimerHandlers.end() != itTimer) {
-            mNativeTimerHandlers.erase(itTimer);
+    if (false == mPendingEvents.empty()) {
+        LockGuard lck(mEmitSync);
+
+        if ((0u == batchSize) || (mPendingEvents.size() <= batchSize)) {
+            events = std::move(mPendingEvents);
         } else {
-            HSM_TRACE_ERROR("unexpected error. timer not found");
+            auto itBatchEnd = mPendingEvents.begin();
+
+            std::advance(itBatchEnd, batchSize);
+            events.splice(events.end(), mPendingEvents, mPendingEvents.begin(), itBatchEnd);
+            hasMoreEvents = true;
+        }
+    }
+
+    dispatchPendingEventsImpl(events);
+
+    // remaining events will be processed in the next main loop iteration
+    if ((true == hasMoreEvents) && (false == mStopDispatcher)) {
+        wakeupDispatcher();
+    }
+}
+
+bool HsmEventDispatcherGLibmm::onTimerEvent(const unsigned int timeoutGeneration) {
+    HSM_TRACE_CALL_DEBUG_ARGS("timeoutGeneration=%u", timeoutGeneration);
+
+    {
+        CriticalSection cs(mRunningTimersSync);
+
+        // NOTE: source will be removed after returning false. Native timer could be re-armed from a different thread
+        //       while this callback was waiting for dispatch
+        if (timeoutGeneration == mNativeTimerGeneration) {
+            mNativeTimerArmed = false;
         }
     }
 
-    return restartTimer;
+    if (false == mStopDispatcher) {
+        dispatchExpiredTimers(std::chrono::steady_clock::now());
+
+        CriticalSection cs(mRunningTimersSync);
+        updateNativeTimer();
+    }
+
+    return false;
 }
 
-}  // namespace hsmcpp
\ No newline at end of file
+}  // namespace hsmcpp
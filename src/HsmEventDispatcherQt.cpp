@@ -6,7 +6,10 @@
 #include <QAbstractEventDispatcher>
 #include <QCoreApplication>
 #include <QThread>
-#include <QVariant>
+#include <QTimerEvent>
+#include <algorithm>
+#include <climits>
+#include <functional>
 
 #include "hsmcpp/logging.hpp"
 #include "hsmcpp/os/CriticalSection.hpp"
@@ -17,11 +20,19 @@ constexpr const char* HSM_TRACE_CLASS = "HsmEventDispatcherQt";
 
 #define QT_DISPATCH_EVENT (777)
 
+// heap is rebuilt when number of outdated entries becomes bigger than this value
+constexpr size_t TIMERS_HEAP_MAX_OUTDATED = 64;
+
 QEvent::Type HsmEventDispatcherQt::mQtDispatchEventType = QEvent::None;
 
-HsmEventDispatcherQt::HsmEventDispatcherQt(const size_t eventsCacheSize)
+bool HsmEventDispatcherQt::TimerDeadline::operator>(const TimerDeadline& other) const {
+    return elapseAfter > other.elapseAfter;
+}
+
+HsmEventDispatcherQt::HsmEventDispatcherQt(QThread* dispatcherThread, const size_t eventsCacheSize)
     : HsmEventDispatcherBase(eventsCacheSize)
-    , QObject(nullptr) {
+    , QObject(nullptr)
+    , mDispatcherThread(dispatcherThread) {
 }
 
 HsmEventDispatcherQt::~HsmEventDispatcherQt() {
@@ -31,7 +42,12 @@ HsmEventDispatcherQt::~HsmEventDispatcherQt() {
 }
 
 std::shared_ptr<HsmEventDispatcherQt> HsmEventDispatcherQt::create(const size_t eventsCacheSize) {
-    return std::shared_ptr<HsmEventDispatcherQt>(new HsmEventDispatcherQt(eventsCacheSize), &HsmEventDispatcherBase::handleDelete);
+    return create(nullptr, eventsCacheSize);
+}
+
+std::shared_ptr<HsmEventDispatcherQt> HsmEventDispatcherQt::create(QThread* dispatcherThread, const size_t eventsCacheSize) {
+    return std::shared_ptr<HsmEventDispatcherQt>(new HsmEventDispatcherQt(dispatcherThread, eventsCacheSize),
+                                                 &HsmEventDispatcherBase::handleDelete);
 }
 
 bool HsmEventDispatcherQt::deleteSafe() {
@@ -55,9 +71,16 @@ bool HsmEventDispatcherQt::start() {
     }
 
     if (true == result) {
-        // if dispatcher wasn't created on main thread we need to move it there
-        if (QObject::thread() != QCoreApplication::eventDispatcher()->thread()) {
-            QObject::moveToThread(QCoreApplication::eventDispatcher()->thread());
+        QThread* targetThread = mDispatcherThread;
+
+        // use main thread by default
+        if (nullptr == targetThread) {
+            targetThread = QCoreApplication::eventDispatcher()->thread();
+        }
+
+        // if dispatcher wasn't created on it's thread we need to move it there
+        if (QObject::thread() != targetThread) {
+            QObject::moveToThread(targetThread);
         }
     }
 
@@ -81,13 +104,17 @@ void HsmEventDispatcherQt::emitEvent(const HandlerID_t handlerID) {
 }
 
 void HsmEventDispatcherQt::unregisterAllTimerHandlers() {
-    CriticalSection cs(mRunningTimersSync);
+    {
+        CriticalSection cs(mRunningTimersSync);
 
-    for (auto it = mNativeTimerHandlers.begin(); it != mNativeTimerHandlers.end(); ++it) {
-        it->second->deleteLater();
+        mRunningTimers.clear();
+        mTimersHeap.clear();
     }
 
-    mNativeTimerHandlers.clear();
+    // NOTE: if called from a different thread, native timer will be stopped when it elapses next time
+    if (QThread::currentThread() == QObject::thread()) {
+        mNativeTimer.stop();
+    }
 }
 
 void HsmEventDispatcherQt::startTimerImpl(const TimerID_t timerID, const unsigned int intervalMs, const bool isSingleShot) {
@@ -95,75 +122,135 @@ void HsmEventDispatcherQt::startTimerImpl(const TimerID_t timerID, const unsigne
                               SC2INT(timerID),
                               intervalMs,
                               BOOL2INT(isSingleShot));
-    auto it = mNativeTimerHandlers.find(timerID);
 
-    if (mNativeTimerHandlers.end() == it) {
-        auto funcCreateTimer = [=]() {
-            QTimer* newTimer = new QTimer(this);
+    {
+        CriticalSection cs(mRunningTimersSync);
+        scheduleTimer(timerID, std::chrono::steady_clock::now() + std::chrono::milliseconds(intervalMs));
+    }
 
-            newTimer->setProperty("hsmid", QVariant(timerID));
-            connect(newTimer, SIGNAL(timeout()), this, SLOT(onTimerEvent()));
-            newTimer->setSingleShot(isSingleShot);
-            newTimer->start(intervalMs);
+    notifyTimersChanged();
+}
 
-            CriticalSection cs(mRunningTimersSync);
-            mNativeTimerHandlers[timerID] = newTimer;
-        };
+void HsmEventDispatcherQt::stopTimerImpl(const TimerID_t timerID) {
+    HSM_TRACE_CALL_DEBUG_ARGS("timerID=%d", SC2INT(timerID));
+    CriticalSection cs(mRunningTimersSync);
+
+    // NOTE: entry in mTimersHeap will be removed when it reaches the top of the heap. There is no need to update native
+    //       timer right away since it will be restarted for the next deadline when it elapses
+    mRunningTimers.erase(timerID);
+}
 
-        // NOTE: need to make sure that QTimer is started only from Qt main thread
-        QThread* callerThread = QThread::currentThread();
+void HsmEventDispatcherQt::scheduleTimer(const TimerID_t timerID,
+                                         const std::chrono::time_point<std::chrono::steady_clock>& elapseAfter) {
+    RunningTimerInfo& timer = mRunningTimers[timerID];
 
-        if (qApp->thread() != callerThread) {
-            QTimer* mainthreadTimer = new QTimer();
+    ++mTimersGeneration;
+    timer.elapseAfter = elapseAfter;
+    timer.generation = mTimersGeneration;
 
-            mainthreadTimer->moveToThread(qApp->thread());
-            mainthreadTimer->setSingleShot(true);
+    if (mTimersHeap.size() > (mRunningTimers.size() + TIMERS_HEAP_MAX_OUTDATED)) {
+        // too many outdated entries (timers are often restarted or stopped). rebuild heap from running timers
+        mTimersHeap.clear();
 
-            QObject::connect(mainthreadTimer, &QTimer::timeout, [=]() {
-                funcCreateTimer();
-                mainthreadTimer->deleteLater();
-            });
-            QMetaObject::invokeMethod(mainthreadTimer, "start", Qt::QueuedConnection, Q_ARG(int, 0));
-        } else {
-            funcCreateTimer();
+        for (const auto& curTimer : mRunningTimers) {
+            mTimersHeap.push_back({curTimer.second.elapseAfter, curTimer.first, curTimer.second.generation});
         }
+
+        std::make_heap(mTimersHeap.begin(), mTimersHeap.end(), std::greater<TimerDeadline>());
     } else {
-        HSM_TRACE_ERROR("timer with id=%d already exists", timerID);
+        mTimersHeap.push_back({elapseAfter, timerID, timer.generation});
+        std::push_heap(mTimersHeap.begin(), mTimersHeap.end(), std::greater<TimerDeadline>());
     }
 }
 
-void HsmEventDispatcherQt::stopTimerImpl(const TimerID_t timerID) {
-    HSM_TRACE_CALL_DEBUG_ARGS("timerID=%d", SC2INT(timerID));
-    CriticalSection cs(mRunningTimersSync);
-    auto it = mNativeTimerHandlers.find(timerID);
+void HsmEventDispatcherQt::dispatchExpiredTimers(const std::chrono::time_point<std::chrono::steady_clock>& now) {
+    std::vector<TimerDeadline> expiredTimers;
 
-    if (mNativeTimerHandlers.end() != it) {
-        it->second->deleteLater();
-        mNativeTimerHandlers.erase(it);
+    {
+        CriticalSection cs(mRunningTimersSync);
+
+        while ((false == mTimersHeap.empty()) && (mTimersHeap.front().elapseAfter <= now)) {
+            auto itTimer = mRunningTimers.find(mTimersHeap.front().timerID);
+
+            if ((mRunningTimers.end() != itTimer) && (itTimer->second.generation == mTimersHeap.front().generation)) {
+                expiredTimers.push_back(mTimersHeap.front());
+            }
+
+            std::pop_heap(mTimersHeap.begin(), mTimersHeap.end(), std::greater<TimerDeadline>());
+            mTimersHeap.pop_back();
+        }
+    }
+
+    for (auto it = expiredTimers.begin(); (it != expiredTimers.end()) && (false == mStopDispatcher); ++it) {
+        // NOTE: timer could be restarted or stopped by one of the previous handlers
+        const unsigned int nextIntervalMs = handleTimerEvent(it->timerID);
+        CriticalSection cs(mRunningTimersSync);
+        auto itTimer = mRunningTimers.find(it->timerID);
+
+        if ((mRunningTimers.end() != itTimer) && (itTimer->second.generation == it->generation)) {
+            if (nextIntervalMs > 0u) {
+                scheduleTimer(it->timerID, now + std::chrono::milliseconds(nextIntervalMs));
+            } else {
+                mRunningTimers.erase(itTimer);
+            }
+        }
     }
 }
 
-void HsmEventDispatcherQt::onTimerEvent() {
-    QObject* ptrTimer = qobject_cast<QTimer*>(QObject::sender());
+void HsmEventDispatcherQt::updateNativeTimer() {
+    bool hasTimers = false;
+    int intervalMs = 0;
 
-    if (nullptr != ptrTimer) {
-        const TimerID_t timerID = ptrTimer->property("hsmid").toInt();
+    {
+        CriticalSection cs(mRunningTimersSync);
 
-        HSM_TRACE_CALL_DEBUG_ARGS("timerID=%d", SC2INT(timerID));
+        // remove entries of stopped and restarted timers
+        while ((false == hasTimers) && (false == mTimersHeap.empty())) {
+            const TimerDeadline& nearest = mTimersHeap.front();
+            auto itTimer = mRunningTimers.find(nearest.timerID);
 
-        if (0 == handleTimerEvent(timerID)) {
-            // delete timer since it doesn't need to be restarted
-            CriticalSection cs(mRunningTimersSync);
-            auto itTimer = mNativeTimerHandlers.find(timerID);
+            if ((mRunningTimers.end() != itTimer) && (itTimer->second.generation == nearest.generation)) {
+                const auto remainingUs = std::chrono::duration_cast<std::chrono::microseconds>(
+                                             nearest.elapseAfter - std::chrono::steady_clock::now())
+                                             .count();
 
-            if (mNativeTimerHandlers.end() != itTimer) {
-                itTimer->second->deleteLater();
-                mNativeTimerHandlers.erase(itTimer);
+                hasTimers = true;
+                // round up to make sure timer is already elapsed when native timer fires
+                intervalMs = static_cast<int>(std::min<int64_t>(std::max<int64_t>((remainingUs + 999) / 1000, 0), INT_MAX));
             } else {
-                HSM_TRACE_ERROR("unexpected error. timer not found");
+                std::pop_heap(mTimersHeap.begin(), mTimersHeap.end(), std::greater<TimerDeadline>());
+                mTimersHeap.pop_back();
             }
         }
     }
+
+    if (true == hasTimers) {
+        mNativeTimer.start(intervalMs, Qt::PreciseTimer, this);
+    } else {
+        mNativeTimer.stop();
+    }
+}
+
+void HsmEventDispatcherQt::notifyTimersChanged() {
+    if (QThread::currentThread() == QObject::thread()) {
+        updateNativeTimer();
+    } else {
+        // NOTE: QBasicTimer can be used only from dispatcher's thread
+        mTimersChanged.store(true);
+        wakeupDispatcher();
+    }
+}
+
+void HsmEventDispatcherQt::timerEvent(QTimerEvent* ev) {
+    if (ev->timerId() == mNativeTimer.timerId()) {
+        if (false == mStopDispatcher) {
+            dispatchExpiredTimers(std::chrono::steady_clock::now());
+        }
+
+        updateNativeTimer();
+    } else {
+        QObject::timerEvent(ev);
+    }
 }
 
 void HsmEventDispatcherQt::notifyDispatcherAboutEvent() {
@@ -173,9 +260,15 @@ void HsmEventDispatcherQt::notifyDispatcherAboutEvent() {
 void HsmEventDispatcherQt::customEvent(QEvent* ev) {
     HSM_TRACE_CALL_DEBUG();
 
-    if ((false == mStopDispatcher) && (ev->type() == mQtDispatchEventType)) {
-        HsmEventDispatcherBase::dispatchPendingEvents();
+    if (ev->type() == mQtDispatchEventType) {
+        if (false == mStopDispatcher) {
+            HsmEventDispatcherBase::dispatchPendingEvents();
+        }
+
+        if (true == mTimersChanged.exchange(false)) {
+            updateNativeTimer();
+        }
     }
 }
 
-}  // namespace hsmcpp
\ No newline at end of file
+}  // namespace hsmcpp
@@ -3,18 +3,60 @@
 
 #include "hsmcpp/HsmEventDispatcherSTD.hpp"
 
+#if defined(__linux__)
+  #include <pthread.h>
+  #include <sched.h>
+#endif
+
+#if defined(HSM_STD_DISPATCHER_WAKEUP_PIPE)
+  #include <fcntl.h>
+  #include <poll.h>
+  #include <unistd.h>
+
+  #include <cerrno>
+  #include <cstdint>
+#endif
+
 #include "hsmcpp/logging.hpp"
 #include "hsmcpp/os/CriticalSection.hpp"
+#include "hsmcpp/os/LockGuard.hpp"
 
 namespace hsmcpp {
 
 #undef HSM_TRACE_CLASS
 #define HSM_TRACE_CLASS "HsmEventDispatcherSTD"
 
-HsmEventDispatcherSTD::HsmEventDispatcherSTD(const size_t eventsCacheSize)
+namespace {
+// hints CPU that current thread is in a spin loop
+inline void cpuRelax() {
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_ia32_pause();
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__aarch64__) || defined(__arm__))
+    __asm__ __volatile__("yield");
+#else
+    std::this_thread::yield();
+#endif
+}
+}  // namespace
+
+HsmEventDispatcherSTD::HsmEventDispatcherSTD(const size_t eventsCacheSize, HsmMemoryResource* resource)
     // cppcheck-suppress misra-c2012-10.4 ; false-positive. thinks that ':' is arithmetic operation
-    : HsmEventDispatcherBase(eventsCacheSize) {
+    : HsmEventDispatcherBase(eventsCacheSize, resource)
+    , mRunningTimers(resource) {
     HSM_TRACE_CALL_DEBUG();
+
+#if defined(HSM_STD_DISPATCHER_WAKEUP_PIPE)
+    if (0 == pipe(mWakeupPipe)) {
+        for (const int fd : mWakeupPipe) {
+            (void)fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+            (void)fcntl(fd, F_SETFD, FD_CLOEXEC);
+        }
+    } else {
+        HSM_TRACE_ERROR("failed to create wakeup pipe (errno=%d)", errno);
+        mWakeupPipe[0] = -1;
+        mWakeupPipe[1] = -1;
+    }
+#endif
 }
 
 HsmEventDispatcherSTD::~HsmEventDispatcherSTD() {
@@ -22,10 +64,19 @@ HsmEventDispatcherSTD::~HsmEventDispatcherSTD() {
 
     HsmEventDispatcherSTD::stop();
     join();
+
+#if defined(HSM_STD_DISPATCHER_WAKEUP_PIPE)
+    for (const int fd : mWakeupPipe) {
+        if (fd >= 0) {
+            (void)close(fd);
+        }
+    }
+#endif
 }
 
-std::shared_ptr<HsmEventDispatcherSTD> HsmEventDispatcherSTD::create(const size_t eventsCacheSize) {
-    return std::shared_ptr<HsmEventDispatcherSTD>(new HsmEventDispatcherSTD(eventsCacheSize),
+std::shared_ptr<HsmEventDispatcherSTD> HsmEventDispatcherSTD::create(const size_t eventsCacheSize,
+                                                                     HsmMemoryResource* resource) {
+    return std::shared_ptr<HsmEventDispatcherSTD>(new HsmEventDispatcherSTD(eventsCacheSize, resource),
                                                   &HsmEventDispatcherBase::handleDelete);
 }
 
@@ -46,11 +97,29 @@ bool HsmEventDispatcherSTD::start() {
     HSM_TRACE_CALL_DEBUG();
     bool result = false;
 
-    if (false == mDispatcherThread.joinable()) {
+#if defined(HSM_STD_DISPATCHER_WAKEUP_PIPE)
+    const bool canStart = (mWakeupPipe[0] >= 0);
+
+    if (false == canStart) {
+        HSM_TRACE_ERROR("can't start dispatcher without wakeup pipe");
+    }
+#else
+    const bool canStart = true;
+#endif
+
+    if ((true == canStart) && (false == mDispatcherThread.joinable())) {
         HSM_TRACE_DEBUG("starting thread...");
         mStopDispatcher = false;
         mDispatcherThread = std::thread(&HsmEventDispatcherSTD::doDispatching, this);
         result = mDispatcherThread.joinable();
+
+        if ((true == result) && (mCpuAffinity >= 0)) {
+            (void)setCpuAffinity(mCpuAffinity);
+        }
+
+        if ((true == result) && (mSchedulingPolicy >= 0)) {
+            (void)setThreadScheduling(mSchedulingPolicy, mSchedulingPriority);
+        }
     } else {
         result = (mDispatcherThread.get_id() != std::thread::id());
     }
@@ -60,14 +129,83 @@ bool HsmEventDispatcherSTD::start() {
 
 void HsmEventDispatcherSTD::stop() {
     HSM_TRACE_CALL_DEBUG();
-    UniqueLock lck(mEmitSync);
 
-    HsmEventDispatcherBase::stop();
-    unregisterAllEventHandlers();
+    {
+        LockGuard lck(mEmitSync);
+        HsmEventDispatcherBase::stop();
+        unregisterAllEventHandlers();
+    }
+
     notifyDispatcherAboutEvent();
     notifyTimersThread();
 }
 
+bool HsmEventDispatcherSTD::setCpuAffinity(const int cpuIndex) {
+    HSM_TRACE_CALL_DEBUG_ARGS("cpuIndex=%d", cpuIndex);
+    bool result = false;
+
+#if defined(__linux__)
+    if ((cpuIndex >= 0) && (cpuIndex < CPU_SETSIZE)) {
+        mCpuAffinity = cpuIndex;
+
+        if (true == mDispatcherThread.joinable()) {
+            cpu_set_t cpuSet;
+
+            CPU_ZERO(&cpuSet);
+            CPU_SET(cpuIndex, &cpuSet);
+            result = (0 == pthread_setaffinity_np(mDispatcherThread.native_handle(), sizeof(cpuSet), &cpuSet));
+
+            if (false == result) {
+                HSM_TRACE_ERROR("failed to set affinity for cpu %d", cpuIndex);
+            }
+        } else {
+            // will be applied in start()
+            result = true;
+        }
+    }
+#else
+    (void)cpuIndex;
+#endif  // __linux__
+
+    return result;
+}
+
+bool HsmEventDispatcherSTD::setThreadScheduling(const int policy, const int priority) {
+    HSM_TRACE_CALL_DEBUG_ARGS("policy=%d, priority=%d", policy, priority);
+    bool result = false;
+
+#if defined(__linux__)
+    if (policy >= 0) {
+        mSchedulingPolicy = policy;
+        mSchedulingPriority = priority;
+
+        if (true == mDispatcherThread.joinable()) {
+            sched_param param = {};
+
+            param.sched_priority = priority;
+            result = (0 == pthread_setschedparam(mDispatcherThread.native_handle(), policy, &param));
+
+            if (false == result) {
+                HSM_TRACE_ERROR("failed to set scheduling policy=%d, priority=%d", policy, priority);
+            }
+        } else {
+            // will be applied in start()
+            result = true;
+        }
+    }
+#else
+    (void)policy;
+    (void)priority;
+#endif  // __linux__
+
+    return result;
+}
+
+void HsmEventDispatcherSTD::setBusyPolling(const unsigned int pollingTimeUs) {
+    HSM_TRACE_CALL_DEBUG_ARGS("pollingTimeUs=%u", pollingTimeUs);
+    mBusyPollingUs.store(pollingTimeUs);
+}
+
 void HsmEventDispatcherSTD::join() {
     HSM_TRACE_CALL_DEBUG();
 
@@ -125,7 +263,67 @@ void HsmEventDispatcherSTD::stopTimerImpl(const TimerID_t timerID) {
 }
 
 void HsmEventDispatcherSTD::notifyDispatcherAboutEvent() {
-    mEmitEvent.notify();
+    // NOTE: event is always added to the queue before this call. If dispatcher stops polling after mIsPolling was checked,
+    //       it will see the new event when checking the queue and won't go to sleep.
+    if (true == mIsPolling.load()) {
+        mPollingWakeup.store(true);
+    } else {
+#if defined(HSM_STD_DISPATCHER_WAKEUP_PIPE)
+        // NOTE: function could be called from a signal handler. Only async-signal-safe calls are allowed here and errno
+        //       must be preserved
+        const int prevErrno = errno;
+        const uint8_t wakeup = 1u;
+
+        // EAGAIN means that pipe is full. Dispatcher will wakeup anyway in this case
+        while ((write(mWakeupPipe[1], &wakeup, sizeof(wakeup)) < 0) && (EINTR == errno)) {
+        }
+
+        errno = prevErrno;
+#else
+        // NOTE: condition variable doesn't remember notifications. Lock guarantees that dispatcher is either already
+        //       waiting or didn't check the queue yet
+        LockGuard lck(mEmitSync);
+        mEmitEvent.notify();
+#endif
+    }
+}
+
+bool HsmEventDispatcherSTD::pollForEvents() {
+    bool hasEvents = false;
+    const unsigned int pollingTimeUs = mBusyPollingUs.load();
+
+    if (pollingTimeUs > 0u) {
+        const auto pollingDeadline = std::chrono::steady_clock::now() + std::chrono::microseconds(pollingTimeUs);
+
+        mIsPolling.store(true);
+        // NOTE: wakeup could be already pending for events which were processed by the last iteration. In this case
+        //       notifyDispatcherAboutEvent() wouldn't be called for new events
+        clearPendingWakeup();
+
+        {
+            LockGuard lck(mEmitSync);
+            hasEvents = (false == mPendingEvents.empty()) || (false == mEnqueuedEvents.empty()) ||
+                        (false == mPendingActions.empty());
+        }
+
+        while ((false == hasEvents) && (false == mStopDispatcher) && (std::chrono::steady_clock::now() < pollingDeadline)) {
+            hasEvents = mPollingWakeup.exchange(false);
+
+            if (false == hasEvents) {
+                cpuRelax();
+            }
+        }
+
+        mIsPolling.store(false);
+
+        // NOTE: producer could have seen mIsPolling == true right before polling deadline and only set mPollingWakeup.
+        //       It must not be lost since dispatcher will not be notified about it in any other way
+        if (false == hasEvents) {
+            hasEvents = mPollingWakeup.exchange(false);
+        }
+    }
+
+    return hasEvents;
 }
 
 void HsmEventDispatcherSTD::doDispatching() {
@@ -134,26 +332,73 @@ void HsmEventDispatcherSTD::doDispatching() {
     while (false == mStopDispatcher) {
         HsmEventDispatcherBase::dispatchPendingEvents();
 
-        if (false == mStopDispatcher) {
+        if ((false == mStopDispatcher) && (false == pollForEvents())) {
+#if defined(HSM_STD_DISPATCHER_WAKEUP_PIPE)
+            bool isIdle = false;
+
+            {
+                LockGuard lck(mEmitSync);
+
+                // NOTE: pending wakeup must be cleared before checking events queues so that next event will notify
+                //       dispatcher. Fence orders it with the check of mEnqueuedEvents which is modified without a lock
+                clearPendingWakeup();
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                // NOTE: deferred events are only accessed from dispatcher's thread
+                isIdle = (true == mPendingEvents.empty()) && (false == hasDeferredEvents()) &&
+                         (true == mEnqueuedEvents.empty()) && (true == mPendingActions.empty()) &&
+                         (false == mStopDispatcher);
+            }
+
+            if (true == isIdle) {
+                HSM_TRACE_DEBUG("wait for emit...");
+                waitForWakeup();
+            }
+#else
             UniqueLock lck(mEmitSync);
 
-            if (true == mPendingEvents.empty()) {
+            // NOTE: condition variable doesn't remember notifications. Pending wakeup must be cleared before checking
+            //       events queue so that next event will notify dispatcher
+            clearPendingWakeup();
+
+            // NOTE: deferred events are only accessed from dispatcher's thread
+            if ((true == mPendingEvents.empty()) && (false == hasDeferredEvents()) && (true == mPendingActions.empty())) {
                 HSM_TRACE_DEBUG("wait for emit...");
                 // NOTE: false-positive. "A function should have a single point of exit at the end" is not vialated because
                 //       "return" statement belogs to a lamda function, not doDispatching.
                 // cppcheck-suppress misra-c2012-15.5
                 mEmitEvent.wait(lck, [=]() {
                     // cppcheck-suppress misra-c2012-15.5 ; false-positive. "return" statement belongs to lambda function
-                    return (false == mPendingEvents.empty()) || (false == mEnqueuedEvents.empty()) || (true == mStopDispatcher);
+                    return (false == mPendingEvents.empty()) || (false == mEnqueuedEvents.empty()) ||
+                           (false == mPendingActions.empty()) || (true == mStopDispatcher);
                 });
                 HSM_TRACE_DEBUG("woke up. pending events=%lu", mPendingEvents.size());
             }
+#endif
         }
     }
 
     HSM_TRACE_DEBUG("EXIT");
 }
 
+#if defined(HSM_STD_DISPATCHER_WAKEUP_PIPE)
+void HsmEventDispatcherSTD::waitForWakeup() {
+    struct pollfd wakeupFd = {mWakeupPipe[0], POLLIN, 0};
+    uint8_t buffer[64];
+
+    // NOTE: poll() is interrupted by signals. It's safe to retry since pipe keeps notifications until they are read
+    while ((poll(&wakeupFd, 1, -1) < 0) && (EINTR == errno)) {
+    }
+
+    // NOTE: every notification is written after the event was added to the queue, so it's safe to consume all of them.
+    //       Dispatcher will process corresponding events on the next iteration
+    ssize_t bytesRead = 0;
+
+    do {
+        bytesRead = read(mWakeupPipe[0], buffer, sizeof(buffer));
+    } while ((bytesRead > 0) || ((bytesRead < 0) && (EINTR == errno)));
+}
+#endif
+
 void HsmEventDispatcherSTD::notifyTimersThread() {
     HSM_TRACE_CALL_DEBUG();
     mNotifiedTimersThread = true;
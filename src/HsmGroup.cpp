@@ -0,0 +1,252 @@
+// Copyright (C) 2024 Igor Krechetov
+// Distributed under MIT license. See file LICENSE for details
+
+#include "hsmcpp/HsmGroup.hpp"
+
+#include <list>
+#include <map>
+
+#include "HsmImpl.hpp"
+#include "hsmcpp/IHsmEventDispatcher.hpp"
+#include "hsmcpp/hsm.hpp"
+#include "hsmcpp/logging.hpp"
+#include "hsmcpp/os/LockGuard.hpp"
+#include "hsmcpp/os/Mutex.hpp"
+
+namespace hsmcpp {
+
+constexpr const char* HSM_TRACE_CLASS = "HsmGroup";
+
+class HsmGroup::Impl : public std::enable_shared_from_this<HsmGroup::Impl> {
+public:
+    struct BroadcastInfo {
+        EventID_t event = INVALID_HSM_EVENT_ID;
+        // NOTE: shared by all members which received the event
+        std::shared_ptr<VariantVector_t> args;
+        // members which didn't receive the event yet. filled when group starts delivering the event
+        std::list<const HierarchicalStateMachine*> recipients;
+        bool isDeliveryStarted = false;
+    };
+
+    Impl() = default;
+    ~Impl() = default;
+    Impl(const Impl&) = delete;
+    Impl& operator=(const Impl&) = delete;
+
+    void initialize(const std::shared_ptr<IHsmEventDispatcher>& dispatcher);
+    void release();
+    void dispatchBroadcasts();
+    // must be called with mSync locked. returns next member which should receive the first pending broadcast
+    std::shared_ptr<HierarchicalStateMachine::Impl> takeNextRecipient(EventID_t& outEvent,
+                                                                      std::shared_ptr<VariantVector_t>& outArgs);
+
+    std::weak_ptr<IHsmEventDispatcher> mDispatcher;
+    HandlerID_t mEventsHandlerId = INVALID_HSM_DISPATCHER_HANDLER_ID;
+    // NOTE: weak_ptr is used to skip members which were destroyed without being removed from the group
+    std::map<const HierarchicalStateMachine*, std::weak_ptr<HierarchicalStateMachine::Impl>> mMembers;  // protected by mSync
+    std::list<BroadcastInfo> mPendingBroadcasts;  // protected by mSync
+    bool mIsDeliveryScheduled = false;            // protected by mSync
+    mutable Mutex mSync;
+};
+
+void HsmGroup::Impl::initialize(const std::shared_ptr<IHsmEventDispatcher>& dispatcher) {
+    HSM_TRACE_CALL_DEBUG();
+
+    // cppcheck-suppress misra-c2012-14.4 ; false-positive. std::shared_ptr has a bool() operator
+    if (dispatcher && (true == dispatcher->start())) {
+        std::weak_ptr<HsmGroup::Impl> ptrInstance = shared_from_this();
+
+        // cppcheck-suppress misra-c2012-13.1 ; false-positive. this is a functor, not initializer list
+        mEventsHandlerId = dispatcher->registerEventHandler([ptrInstance]() {
+            bool handlerIsValid = false;
+            auto pThis = ptrInstance.lock();
+
+            // cppcheck-suppress misra-c2012-14.4 ; false-positive. std::shared_ptr has a bool() operator
+            if (pThis) {
+                pThis->dispatchBroadcasts();
+                handlerIsValid = true;
+            }
+
+            // NOTE: false-positive. "return" statement belongs to lambda function, not parent function
+            // cppcheck-suppress misra-c2012-15.5
+            return handlerIsValid;
+        });
+
+        if (INVALID_HSM_DISPATCHER_HANDLER_ID != mEventsHandlerId) {
+            mDispatcher = dispatcher;
+        } else {
+            HSM_TRACE_ERROR("failed to register event handler");
+        }
+    } else {
+        HSM_TRACE_ERROR("dispatcher is NULL or failed to start");
+    }
+}
+
+void HsmGroup::Impl::release() {
+    HSM_TRACE_CALL_DEBUG();
+    auto dispatcherPtr = mDispatcher.lock();
+
+    // cppcheck-suppress misra-c2012-14.4 ; false-positive. std::shared_ptr has a bool() operator
+    if (dispatcherPtr) {
+        dispatcherPtr->unregisterEventHandler(mEventsHandlerId);
+        mEventsHandlerId = INVALID_HSM_DISPATCHER_HANDLER_ID;
+        mDispatcher.reset();
+    }
+
+    LockGuard lck(mSync);
+    mPendingBroadcasts.clear();
+    mMembers.clear();
+    mIsDeliveryScheduled = false;
+}
+
+void HsmGroup::Impl::dispatchBroadcasts() {
+    HSM_TRACE_CALL_DEBUG();
+    EventID_t event = INVALID_HSM_EVENT_ID;
+    std::shared_ptr<VariantVector_t> args;
+    std::shared_ptr<HierarchicalStateMachine::Impl> member;
+    bool hasMoreBroadcasts = false;
+
+    {
+        LockGuard lck(mSync);
+
+        member = takeNextRecipient(event, args);
+        hasMoreBroadcasts = (false == mPendingBroadcasts.empty());
+        mIsDeliveryScheduled = hasMoreBroadcasts;
+    }
+
+    // NOTE: member is called without holding mSync since its callbacks (for example dropped event callback) are allowed
+    //       to add or remove group members
+    // cppcheck-suppress misra-c2012-14.4 ; false-positive. std::shared_ptr has a bool() operator
+    if (member) {
+        (void)member->transitionWithSharedArgs(event, args);
+    }
+
+    // NOTE: only one member is handled per dispatch slot to give other dispatcher handlers a chance to run
+    if (true == hasMoreBroadcasts) {
+        auto dispatcherPtr = mDispatcher.lock();
+
+        // cppcheck-suppress misra-c2012-14.4 ; false-positive. std::shared_ptr has a bool() operator
+        if (dispatcherPtr) {
+            dispatcherPtr->emitEvent(mEventsHandlerId);
+        }
+    }
+}
+
+std::shared_ptr<HierarchicalStateMachine::Impl> HsmGroup::Impl::takeNextRecipient(EventID_t& outEvent,
+                                                                                   std::shared_ptr<VariantVector_t>& outArgs) {
+    std::shared_ptr<HierarchicalStateMachine::Impl> member;
+
+    while ((!member) && (false == mPendingBroadcasts.empty())) {
+        BroadcastInfo& curBroadcast = mPendingBroadcasts.front();
+
+        if (false == curBroadcast.isDeliveryStarted) {
+            auto it = mMembers.begin();
+
+            while (mMembers.end() != it) {
+                if (false == it->second.expired()) {
+                    curBroadcast.recipients.push_back(it->first);
+                    ++it;
+                } else {
+                    HSM_TRACE_WARNING("member was destroyed without being removed from the group");
+                    it = mMembers.erase(it);
+                }
+            }
+
+            curBroadcast.isDeliveryStarted = true;
+        }
+
+        if (false == curBroadcast.recipients.empty()) {
+            // member could have been removed after delivery of this broadcast started
+            auto itMember = mMembers.find(curBroadcast.recipients.front());
+
+            curBroadcast.recipients.pop_front();
+
+            if (mMembers.end() != itMember) {
+                member = itMember->second.lock();
+
+                // cppcheck-suppress misra-c2012-14.4 ; false-positive. std::shared_ptr has a bool() operator
+                if (member) {
+                    outEvent = curBroadcast.event;
+                    outArgs = curBroadcast.args;
+                } else {
+                    HSM_TRACE_WARNING("member was destroyed without being removed from the group");
+                    (void)mMembers.erase(itMember);
+                }
+            }
+        }
+
+        if (true == curBroadcast.recipients.empty()) {
+            mPendingBroadcasts.pop_front();
+        }
+    }
+
+    return member;
+}
+
+// ============================================================================
+// HsmGroup
+// ============================================================================
+HsmGroup::HsmGroup(const std::shared_ptr<IHsmEventDispatcher>& dispatcher)
+    : mImpl(std::make_shared<HsmGroup::Impl>()) {
+    mImpl->initialize(dispatcher);
+}
+
+HsmGroup::~HsmGroup() {
+    mImpl->release();
+}
+
+bool HsmGroup::isValid() const {
+    return (false == mImpl->mDispatcher.expired());
+}
+
+bool HsmGroup::addMember(HierarchicalStateMachine& hsm) {
+    LockGuard lck(mImpl->mSync);
+
+    return mImpl->mMembers.emplace(&hsm, hsm.mImpl).second;
+}
+
+void HsmGroup::removeMember(HierarchicalStateMachine& hsm) {
+    LockGuard lck(mImpl->mSync);
+
+    (void)mImpl->mMembers.erase(&hsm);
+}
+
+size_t HsmGroup::getMembersCount() const {
+    LockGuard lck(mImpl->mSync);
+
+    return mImpl->mMembers.size();
+}
+
+bool HsmGroup::broadcastWithArgsArray(const EventID_t event, VariantVector_t&& args) {
+    HSM_TRACE_CALL_DEBUG_ARGS("event=%d, args.size=%lu", SC2INT(event), args.size());
+    bool result = false;
+    auto dispatcherPtr = mImpl->mDispatcher.lock();
+
+    // cppcheck-suppress misra-c2012-14.4 ; false-positive. std::shared_ptr has a bool() operator
+    if (dispatcherPtr) {
+        Impl::BroadcastInfo newBroadcast;
+
+        newBroadcast.event = event;
+        newBroadcast.args = std::make_shared<VariantVector_t>(std::move(args));
+
+        bool needsDispatching = false;
+
+        {
+            LockGuard lck(mImpl->mSync);
+            mImpl->mPendingBroadcasts.emplace_back(std::move(newBroadcast));
+            // NOTE: if delivery is already in progress group's handler will be called again without a new event
+            needsDispatching = (false == mImpl->mIsDeliveryScheduled);
+            mImpl->mIsDeliveryScheduled = true;
+        }
+
+        if (true == needsDispatching) {
+            dispatcherPtr->emitEvent(mImpl->mEventsHandlerId);
+        }
+
+        result = true;
+    }
+
+    return result;
+}
+
+}  // namespace hsmcpp
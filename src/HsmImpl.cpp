@@ -4,6 +4,8 @@
 #include "HsmImpl.hpp"
 
 #include <algorithm>
+#include <iterator>
+#include <limits>
 
 #include "hsmcpp/IHsmEventDispatcher.hpp"
 #include "hsmcpp/logging.hpp"
@@ -15,6 +17,15 @@
   #include "hsmcpp/os/InterruptsFreeSection.hpp"
 #endif
 
+#if defined(FREERTOS_AVAILABLE)
+  #include <FreeRTOS.h>
+  #include <task.h>
+#elif defined(PLATFORM_ARDUINO)
+  #include <Arduino.h>
+#else
+  #include <chrono>
+#endif
+
 #ifdef HSMBUILD_DEBUGGING
   #include <array>
   #include <chrono>
@@ -49,6 +60,17 @@ HSM_TRACE_PREINIT()
 
 constexpr const char* HSM_TRACE_CLASS = "HierarchicalStateMachine";
 
+#ifdef HSM_DISABLE_THREADSAFETY
+  #define HSM_SYNC_STATE_WAITERS()
+  #define HSM_SYNC_DISPATCHER()
+#else
+  #define HSM_SYNC_STATE_WAITERS() LockGuard lck(mStateWaitersSync)
+  #define HSM_SYNC_DISPATCHER() LockGuard lckDispatcher(mDispatcherSync)
+#endif  // HSM_DISABLE_THREADSAFETY
+
+// maximum number of SyncEventLock objects which are kept for reuse by synchronous transitions
+constexpr size_t HSM_SYNC_LOCKS_POOL_SIZE = 32;
+
 // These macroses can't be converted to 'constexpr' template functions
 // NOLINTBEGIN(cppcoreguidelines-macro-usage)
 
@@ -76,10 +98,39 @@ namespace hsmcpp {
 // ============================================================================
 // PUBLIC
 // ============================================================================
-HierarchicalStateMachine::Impl::Impl(HierarchicalStateMachine* parent, const StateID_t initialState)
+HierarchicalStateMachine::Impl::Impl(HierarchicalStateMachine* parent,
+                                     const StateID_t initialState,
+                                     HsmMemoryResource* structureResource,
+                                     HsmMemoryResource* runtimeResource)
     // cppcheck-suppress misra-c2012-10.4 ; false-positive. thinks that ':' is arithmetic operation
     : mParent(parent)
-    , mInitialState(initialState) {
+    , mRuntimeResource(runtimeResource)
+    , mRunningTimers(runtimeResource)
+    , mResumedTimers(runtimeResource)
+    , mMigratedEnqueuedEventsHandlers(runtimeResource)
+    , mInitialState(initialState)
+    , mTransitionsByEvent(structureResource)
+    , mRegisteredStates(structureResource)
+    , mFinalStates(structureResource)
+    , mSubstates(structureResource)
+    , mSubstateEntryPoints(structureResource)
+    , mPendingEvents(runtimeResource)
+    , mCoalescedEvents(runtimeResource)
+    , mEventsTTL(structureResource)
+    , mEventPayloadTypes(structureResource)
+    , mPendingEventsCount(runtimeResource)
+    , mStateWaiters(runtimeResource)
+    , mBlockingStateWaiters(runtimeResource)
+    , mStateSubscriptions(runtimeResource)
+    , mSyncLocksPool(runtimeResource)
+    , mTimers(structureResource)
+    , mHistoryStates(structureResource)
+    , mHistoryData(structureResource)
+    , mRegisteredActions(structureResource)
+#ifdef HSM_ENABLE_SAFE_STRUCTURE
+    , mTopLevelStates(structureResource)
+#endif
+{
     HSM_TRACE_INIT();
 }
 
@@ -96,7 +147,7 @@ void HierarchicalStateMachine::Impl::resetParent() {
 }
 
 void HierarchicalStateMachine::Impl::setInitialState(const StateID_t initialState) {
-    if (true == mDispatcher.expired()) {
+    if (false == isInitialized()) {
         mInitialState = initialState;
     }
 }
@@ -105,7 +156,7 @@ bool HierarchicalStateMachine::Impl::initialize(const std::weak_ptr<IHsmEventDis
     HSM_TRACE_CALL_DEBUG();
     bool result = false;
 
-    if (true == mDispatcher.expired()) {
+    if (false == isInitialized()) {
         auto dispatcherPtr = dispatcher.lock();
 
         // cppcheck-suppress misra-c2012-14.4 ; false-positive. std::shared_ptr has a bool() operator
@@ -121,11 +172,19 @@ bool HierarchicalStateMachine::Impl::initialize(const std::weak_ptr<IHsmEventDis
                 }
 
                 if (false == ptrInstance.expired()) {
-                    mDispatcher = dispatcher;
+                    // NOTE: handlers must be registered without holding mDispatcherSync since dispatcher calls timer handler
+                    //       with it's own lock held
+                    const HandlerID_t eventsHandlerId = createEventHandler(dispatcherPtr, ptrInstance);
+                    const HandlerID_t timerHandlerId = createTimerHandler(dispatcherPtr, ptrInstance);
+                    const HandlerID_t enqueuedEventsHandlerId = createEnqueuedEventHandler(dispatcherPtr, ptrInstance);
 
-                    createEventHandler(dispatcherPtr, ptrInstance);
-                    createTimerHandler(dispatcherPtr, ptrInstance);
-                    createEnqueuedEventHandler(dispatcherPtr, ptrInstance);
+                    {
+                        HSM_SYNC_DISPATCHER();
+                        mDispatcher = dispatcher;
+                        mEventsHandlerId = eventsHandlerId;
+                        mTimerHandlerId = timerHandlerId;
+                        mEnqueuedEventsHandlerId = enqueuedEventsHandlerId;
+                    }
 
                     if ((INVALID_HSM_DISPATCHER_HANDLER_ID != mEventsHandlerId) &&
                         (INVALID_HSM_DISPATCHER_HANDLER_ID != mTimerHandlerId)) {
@@ -158,10 +217,12 @@ bool HierarchicalStateMachine::Impl::initialize(const std::weak_ptr<IHsmEventDis
 }
 
 std::weak_ptr<IHsmEventDispatcher> HierarchicalStateMachine::Impl::dispatcher() const {
+    HSM_SYNC_DISPATCHER();
     return mDispatcher;
 }
 
 bool HierarchicalStateMachine::Impl::isInitialized() const {
+    HSM_SYNC_DISPATCHER();
     return (false == mDispatcher.expired());
 }
 
@@ -171,18 +232,49 @@ void HierarchicalStateMachine::Impl::release() {
 
     disableHsmDebugging();
 
-    auto dispatcherPtr = mDispatcher.lock();
+    std::shared_ptr<IHsmEventDispatcher> dispatcherPtr;
+    HandlerID_t eventsHandlerId = INVALID_HSM_DISPATCHER_HANDLER_ID;
+    HandlerID_t enqueuedEventsHandlerId = INVALID_HSM_DISPATCHER_HANDLER_ID;
+    HandlerID_t timerHandlerId = INVALID_HSM_DISPATCHER_HANDLER_ID;
+    HsmList_t<std::pair<std::weak_ptr<IHsmEventDispatcher>, HandlerID_t>> migratedHandlers(
+        mMigratedEnqueuedEventsHandlers.get_allocator());
 
-    // cppcheck-suppress misra-c2012-14.4 ; false-positive. std::shared_ptr has a bool() operator
-    if (dispatcherPtr) {
-        dispatcherPtr->unregisterEventHandler(mEventsHandlerId);
-        dispatcherPtr->unregisterEnqueuedEventHandler(mEnqueuedEventsHandlerId);
-        dispatcherPtr->unregisterTimerHandler(mTimerHandlerId);
+    {
+        HSM_SYNC_DISPATCHER();
+        dispatcherPtr = mDispatcher.lock();
+        eventsHandlerId = mEventsHandlerId;
+        enqueuedEventsHandlerId = mEnqueuedEventsHandlerId;
+        timerHandlerId = mTimerHandlerId;
         mDispatcher.reset();
         mEventsHandlerId = INVALID_HSM_DISPATCHER_HANDLER_ID;
+        mRunningTimers.clear();
+        mResumedTimers.clear();
+        mHasResumedTimers.clear();
+        migratedHandlers.swap(mMigratedEnqueuedEventsHandlers);
+    }
+
+    for (const auto& curHandler : migratedHandlers) {
+        auto oldDispatcherPtr = curHandler.first.lock();
+
+        // cppcheck-suppress misra-c2012-14.4 ; false-positive. std::shared_ptr has a bool() operator
+        if (oldDispatcherPtr) {
+            oldDispatcherPtr->unregisterEnqueuedEventHandler(curHandler.second);
+        }
+    }
+
+    // cppcheck-suppress misra-c2012-14.4 ; false-positive. std::shared_ptr has a bool() operator
+    if (dispatcherPtr) {
+        dispatcherPtr->unregisterEventHandler(eventsHandlerId);
+        dispatcherPtr->unregisterEnqueuedEventHandler(enqueuedEventsHandlerId);
+        dispatcherPtr->unregisterTimerHandler(timerHandlerId);
+
+        // unblock producers waiting for free space in the queue
+        notifyQueueSpaceAvailable();
 
         // wait for current dispatching to finish if it's ongoing
         mIsDispatching.wait(true);
+
+        cancelStateWaiters(dispatcherPtr);
     }
 }
 
@@ -190,6 +282,10 @@ void HierarchicalStateMachine::Impl::registerFailedTransitionCallback(HsmTransit
     mFailedTransitionCallback = std::move(onFailedTransition);
 }
 
+void HierarchicalStateMachine::Impl::registerDroppedEventCallback(HsmEventDroppedCallback_t onEventDropped) {
+    mDroppedEventCallback = std::move(onEventDropped);
+}
+
 void HierarchicalStateMachine::Impl::registerState(const StateID_t state,
                                                    HsmStateChangedCallback_t onStateChanged,
                                                    HsmStateEnterCallback_t onEntering,
@@ -239,6 +335,25 @@ void HierarchicalStateMachine::Impl::registerTimer(const TimerID_t timerID, cons
     mTimers[timerID] = event;
 }
 
+void HierarchicalStateMachine::Impl::registerCoalescedEvent(const EventID_t event) {
+    HSM_SYNC_EVENTS_QUEUE();
+    (void)mCoalescedEvents.emplace(event, mPendingEvents.end());
+}
+
+void HierarchicalStateMachine::Impl::registerEventTTL(const EventID_t event, const int ttlMs) {
+    HSM_SYNC_EVENTS_QUEUE();
+
+    if (ttlMs > 0) {
+        mEventsTTL[event] = ttlMs;
+    } else {
+        (void)mEventsTTL.erase(event);
+    }
+}
+
+void HierarchicalStateMachine::Impl::registerEventPayload(const EventID_t event, const PayloadTypeID_t payloadType) {
+    mEventPayloadTypes[event] = payloadType;
+}
+
 bool HierarchicalStateMachine::Impl::registerSubstate(const StateID_t parent,
                                                       const StateID_t substate,
                                                       const bool isEntryPoint,
@@ -391,8 +506,135 @@ const std::list<StateID_t>& HierarchicalStateMachine::Impl::getActiveStates() co
     return mActiveStates;
 }
 
+std::list<StateID_t> HierarchicalStateMachine::Impl::getActiveStatesSnapshot() const {
+    return mActiveStatesSnapshot.read();
+}
+
 bool HierarchicalStateMachine::Impl::isStateActive(const StateID_t state) const {
-    return (std::find(mActiveStates.begin(), mActiveStates.end(), state) != mActiveStates.end());
+    return mActiveStatesSnapshot.contains(state);
+}
+
+void HierarchicalStateMachine::Impl::waitForStateAsync(const StateID_t state,
+                                                       const int timeoutMs,
+                                                       HsmStateWaitCallback_t onCompleted) {
+    HSM_TRACE_CALL_DEBUG_ARGS("state=<%s>, timeoutMs=%d", getStateName(state).c_str(), timeoutMs);
+    auto dispatcherPtr = getDispatcher();
+    bool isActive = false;
+    bool isWaiting = false;
+
+    // cppcheck-suppress misra-c2012-14.4 ; false-positive. std::shared_ptr has a bool() operator
+    if (dispatcherPtr && onCompleted) {
+        TimerID_t timerID = INVALID_HSM_TIMER_ID;
+
+        {
+            // NOTE: state change notifications are sent with this lock held, so we can't miss them
+            HSM_SYNC_STATE_WAITERS();
+            isActive = isStateActive(state);
+
+            if (false == isActive) {
+                StateWaiterInfo waiter;
+
+                if (timeoutMs > 0) {
+                    timerID = generateInternalTimerID();
+                }
+
+                waiter.state = state;
+                waiter.timerID = timerID;
+                waiter.onCompleted = std::move(onCompleted);
+                mStateWaiters.emplace_back(std::move(waiter));
+                isWaiting = true;
+            }
+        }
+
+        if (INVALID_HSM_TIMER_ID != timerID) {
+            startTimer(timerID, static_cast<unsigned int>(timeoutMs), true);
+        }
+    }
+
+    // cppcheck-suppress misra-c2012-14.4 ; false-positive. std::function has a bool() operator
+    if ((false == isWaiting) && onCompleted) {
+        onCompleted(state, isActive);
+    }
+}
+
+bool HierarchicalStateMachine::Impl::waitForState(const StateID_t state, const int timeoutMs) {
+    HSM_TRACE_CALL_DEBUG_ARGS("state=<%s>, timeoutMs=%d", getStateName(state).c_str(), timeoutMs);
+    bool isActive = false;
+
+#ifndef HSM_DISABLE_THREADSAFETY
+    UniqueLock lck(mStateWaitersSync);
+
+    isActive = isStateActive(state);
+
+    // NOTE: if HSM is not initialized its state will not change
+    if ((false == isActive) && (true == isInitialized())) {
+        auto itWaiter = mBlockingStateWaiters.emplace(mBlockingStateWaiters.end());
+
+        itWaiter->state = state;
+
+        if (timeoutMs > 0) {
+            // NOTE: false-positive. "return" statement belongs to lambda function, not parent function
+            // cppcheck-suppress [misra-c2012-15.5, misra-c2012-17.7]
+            mStateWaitersChanged.wait_for(lck, timeoutMs, [itWaiter]() { return itWaiter->isDone; });
+        } else {
+            // NOTE: false-positive. "return" statement belongs to lambda function, not parent function
+            // cppcheck-suppress [misra-c2012-15.5, misra-c2012-17.7]
+            mStateWaitersChanged.wait(lck, [itWaiter]() { return itWaiter->isDone; });
+        }
+
+        // NOTE: depending on platform ConditionVariable could return with unlocked mutex. Waiters list must be
+        //       modified only under lock since it's used by other waiters and by notifyStateWaiters()
+        lck.lock();
+        isActive = itWaiter->isActive;
+        mBlockingStateWaiters.erase(itWaiter);
+    }
+#else
+    isActive = isStateActive(state);
+#endif  // HSM_DISABLE_THREADSAFETY
+
+    return isActive;
+}
+
+SubscriptionID_t HierarchicalStateMachine::Impl::subscribeStateChanges(const std::list<StateID_t>& states,
+                                                                       HsmStateSubscriptionCallback_t onChanged) {
+    SubscriptionID_t id = INVALID_HSM_SUBSCRIPTION_ID;
+
+    // cppcheck-suppress misra-c2012-14.4 ; false-positive. std::function has a bool() operator
+    if ((false == states.empty()) && onChanged) {
+        auto callback = std::make_shared<HsmStateSubscriptionCallback_t>(std::move(onChanged));
+        HSM_SYNC_STATE_WAITERS();
+
+        ++mLastSubscriptionID;
+
+        if (INVALID_HSM_SUBSCRIPTION_ID == mLastSubscriptionID) {
+            ++mLastSubscriptionID;
+        }
+
+        id = mLastSubscriptionID;
+
+        for (const StateID_t curState : states) {
+            StateSubscriptionInfo subscription;
+
+            subscription.id = id;
+            subscription.onChanged = callback;
+            (void)mStateSubscriptions.emplace(curState, std::move(subscription));
+        }
+    }
+
+    return id;
+}
+
+void HierarchicalStateMachine::Impl::unsubscribeStateChanges(const SubscriptionID_t id) {
+    HSM_SYNC_STATE_WAITERS();
+    auto it = mStateSubscriptions.begin();
+
+    while (mStateSubscriptions.end() != it) {
+        if (id == it->second.id) {
+            it = mStateSubscriptions.erase(it);
+        } else {
+            ++it;
+        }
+    }
 }
 
 void HierarchicalStateMachine::Impl::transitionWithArgsArray(const EventID_t event, VariantVector_t&& args) {
@@ -406,250 +648,1036 @@ bool HierarchicalStateMachine::Impl::transitionExWithArgsArray(const EventID_t e
                                                                const bool sync,
                                                                const int timeoutMs,
                                                                VariantVector_t&& args) {
-    HSM_TRACE_CALL_DEBUG_ARGS("event=<%s>, clearQueue=%s, sync=%s, args.size=%lu",
-                              getEventName(event).c_str(),
-                              BOOL2STR(clearQueue),
-                              BOOL2STR(sync),
-                              args.size());
+    return transitionExImpl(event, clearQueue, sync, timeoutMs, std::move(args), true);
+}
 
-    bool status = false;
+bool HierarchicalStateMachine::Impl::transitionInterruptSafe(const EventID_t event) {
+    bool res = false;
+    // TODO: this part needs testing with real interrupts. Not sure if it's safe to use weak_ptr.lock()
+    // NOTE: mDispatcherSync is not used here since it's not allowed to block in interrupts
     auto dispatcherPtr = mDispatcher.lock();
 
     // cppcheck-suppress misra-c2012-14.4 ; false-positive. std::shared_ptr has a bool() operator
     if (dispatcherPtr) {
-        PendingEventInfo eventInfo;
+        res = dispatcherPtr->enqueueEvent(mEnqueuedEventsHandlerId, event);
+    }
 
-        eventInfo.id = event;
-        eventInfo.args = std::make_shared<VariantVector_t>(std::move(args));
+    return res;
+}
 
-        if (true == sync) {
-            eventInfo.initLock();
+void HierarchicalStateMachine::Impl::setPendingEventsLimit(const size_t maxEvents,
+                                                           const QueueOverflowPolicy policy,
+                                                           const int blockTimeoutMs) {
+    HSM_TRACE_CALL_DEBUG_ARGS("maxEvents=%lu, policy=%d, blockTimeoutMs=%d", maxEvents, SC2INT(policy), blockTimeoutMs);
+
+    {
+        HSM_SYNC_EVENTS_QUEUE();
+        mPendingEventsLimit = maxEvents;
+        mQueueOverflowPolicy = policy;
+        mQueueBlockTimeoutMs = blockTimeoutMs;
+    }
+
+    // new limit might allow blocked producers to continue
+    notifyQueueSpaceAvailable();
+}
+
+EventsQueueStats HierarchicalStateMachine::Impl::getPendingEventsStats() const {
+    HSM_SYNC_EVENTS_QUEUE();
+    EventsQueueStats stats = mQueueStats;
+
+    stats.pendingEvents = mPendingEvents.size();
+    return stats;
+}
+
+size_t HierarchicalStateMachine::Impl::cancelPendingEvents(const EventID_t event) {
+    HSM_TRACE_CALL_DEBUG_ARGS("event=<%s>", getEventName(event).c_str());
+    PendingEventsList_t canceledEvents(mPendingEvents.get_allocator());
+
+    {
+        HSM_SYNC_EVENTS_QUEUE();
+        auto itCount = mPendingEventsCount.find(event);
+
+        // NOTE: only the number of events is indexed. queue is not scanned if there are no events with this ID and
+        //       scanning stops as soon as all of them were found
+        if ((mPendingEventsCount.end() != itCount) && (itCount->second > 0u)) {
+            removePendingEvents(
+                [event](const PendingEventInfo& curEvent) {
+                    // cppcheck-suppress misra-c2012-15.5 ; false-positive. "return" statement belongs to lambda function
+                    return (event == curEvent.id);
+                },
+                canceledEvents,
+                itCount->second);
         }
+    }
+
+    return notifyEventsCanceled(canceledEvents);
+}
+
+size_t HierarchicalStateMachine::Impl::cancelPendingEvents(HsmEventFilterCallback_t filter) {
+    HSM_TRACE_CALL_DEBUG();
+    PendingEventsList_t canceledEvents(mPendingEvents.get_allocator());
+
+    if (filter) {
+        // NOTE: filter is a user callback, so it's called without holding mEventsSync. Pending events are copied (only
+        //       their IDs and references to arguments) and matching ones are later found by their sequence number since
+        //       queue could change while filter is running.
+        HsmVector_t<PendingEventInfo> candidates(mPendingEvents.get_allocator());
+        HsmVector_t<uint64_t> selectedEvents(HsmAllocator<uint64_t>(mPendingEvents.get_allocator()));
 
         {
             HSM_SYNC_EVENTS_QUEUE();
 
-            if (true == clearQueue) {
-                clearPendingEvents();
+            candidates.reserve(mPendingEvents.size());
+
+            for (const PendingEventInfo& curEvent : mPendingEvents) {
+                if (TransitionBehavior::REGULAR == curEvent.transitionType) {
+                    candidates.emplace_back();
+                    candidates.back().id = curEvent.id;
+                    candidates.back().args = curEvent.args;
+                    candidates.back().sequence = curEvent.sequence;
+                }
+            }
+        }
+
+        for (const PendingEventInfo& curEvent : candidates) {
+            if (true == filter(curEvent.id, curEvent.getArgs())) {
+                selectedEvents.push_back(curEvent.sequence);
             }
+        }
+
+        if (false == selectedEvents.empty()) {
+            HSM_SYNC_EVENTS_QUEUE();
 
-            mPendingEvents.emplace_back(eventInfo);
+            std::sort(selectedEvents.begin(), selectedEvents.end());
+            removePendingEvents(
+                [&selectedEvents](const PendingEventInfo& curEvent) {
+                    // cppcheck-suppress misra-c2012-15.5 ; false-positive. "return" statement belongs to lambda function
+                    return std::binary_search(selectedEvents.begin(), selectedEvents.end(), curEvent.sequence);
+                },
+                canceledEvents,
+                selectedEvents.size());
         }
+    }
 
-        HSM_TRACE_DEBUG("transitionEx: emit");
-        dispatcherPtr->emitEvent(mEventsHandlerId);
+    return notifyEventsCanceled(canceledEvents);
+}
 
-        if (true == sync) {
-            HSM_TRACE_DEBUG("transitionEx: wait...");
-            eventInfo.wait(timeoutMs);
-            status = (HsmEventStatus::DONE_OK == *eventInfo.transitionStatus);
+bool HierarchicalStateMachine::Impl::isTransitionPossible(const EventID_t event, const VariantVector_t& args) {
+    HSM_TRACE_CALL_DEBUG_ARGS("event=<%s>", getEventName(event).c_str());
+    bool possible = false;
+
+    for (const StateID_t& state : mActiveStates) {
+        possible = checkTransitionPossibility(state, event, args);
+
+        if (true == possible) {
+            break;
+        }
+    }
+
+    HSM_TRACE_CALL_RESULT("%d", BOOL2INT(possible));
+    return possible;
+}
+
+void HierarchicalStateMachine::Impl::startTimer(const TimerID_t timerID,
+                                                const unsigned int intervalMs,
+                                                const bool isSingleShot) {
+    std::shared_ptr<IHsmEventDispatcher> dispatcherPtr;
+    HandlerID_t timerHandlerId = INVALID_HSM_DISPATCHER_HANDLER_ID;
+
+    {
+        HSM_SYNC_DISPATCHER();
+        dispatcherPtr = mDispatcher.lock();
+        timerHandlerId = mTimerHandlerId;
+
+        // cppcheck-suppress misra-c2012-14.4 ; false-positive. std::shared_ptr has a bool() operator
+        if (dispatcherPtr && (intervalMs > 0u)) {
+            RunningTimerInfo& timer = mRunningTimers[timerID];
+
+            timer.intervalMs = intervalMs;
+            timer.isSingleShot = isSingleShot;
+            timer.startedAtMs = getCurrentTimeMs();
+            timer.resumeRepeating = false;
+        }
+    }
+
+    // NOTE: dispatcher must not be called with mDispatcherSync locked since it can call timer handler with its own lock held
+    // cppcheck-suppress misra-c2012-14.4 ; false-positive. std::shared_ptr has a bool() operator
+    if (dispatcherPtr) {
+        dispatcherPtr->startTimer(timerHandlerId, timerID, intervalMs, isSingleShot);
+    }
+}
+
+void HierarchicalStateMachine::Impl::restartTimer(const TimerID_t timerID) {
+    std::shared_ptr<IHsmEventDispatcher> dispatcherPtr;
+    RunningTimerInfo timer;
+    bool isRunning = false;
+
+    {
+        HSM_SYNC_DISPATCHER();
+        auto it = mRunningTimers.find(timerID);
+
+        if (mRunningTimers.end() != it) {
+            dispatcherPtr = mDispatcher.lock();
+            timer = it->second;
+            isRunning = true;
+        }
+    }
+
+    if (true == isRunning) {
+        if (true == timer.resumeRepeating) {
+            // dispatcher only knows about the remaining part of the interval
+            startTimer(timerID, timer.intervalMs, false);
+        } else {
+            {
+                HSM_SYNC_DISPATCHER();
+                auto it = mRunningTimers.find(timerID);
+
+                if (mRunningTimers.end() != it) {
+                    it->second.startedAtMs = getCurrentTimeMs();
+                }
+            }
+
+            // cppcheck-suppress misra-c2012-14.4 ; false-positive. std::shared_ptr has a bool() operator
+            if (dispatcherPtr) {
+                dispatcherPtr->restartTimer(timerID);
+            }
+        }
+    }
+}
+
+void HierarchicalStateMachine::Impl::stopTimer(const TimerID_t timerID) {
+    std::shared_ptr<IHsmEventDispatcher> dispatcherPtr;
+
+    {
+        HSM_SYNC_DISPATCHER();
+        dispatcherPtr = mDispatcher.lock();
+        (void)mRunningTimers.erase(timerID);
+    }
+
+    // cppcheck-suppress misra-c2012-14.4 ; false-positive. std::shared_ptr has a bool() operator
+    if (dispatcherPtr) {
+        dispatcherPtr->stopTimer(timerID);
+    }
+}
+
+bool HierarchicalStateMachine::Impl::isTimerRunning(const TimerID_t timerID) {
+    bool running = false;
+    auto dispatcherPtr = getDispatcher();
+
+    // cppcheck-suppress misra-c2012-14.4 ; false-positive. std::shared_ptr has a bool() operator
+    if (dispatcherPtr) {
+        running = dispatcherPtr->isTimerRunning(timerID);
+    }
+
+    return running;
+}
+
+bool HierarchicalStateMachine::Impl::migrate(const std::weak_ptr<IHsmEventDispatcher>& dispatcher) {
+    HSM_TRACE_CALL_DEBUG();
+    bool result = false;
+    auto newDispatcherPtr = dispatcher.lock();
+    auto oldDispatcherPtr = getDispatcher();
+
+    bool isDispatchingThread = false;
+
+#ifdef STL_AVAILABLE
+    isDispatchingThread = (std::this_thread::get_id() == mDispatchingThread.load());
+#endif
+
+    // cppcheck-suppress misra-c2012-14.4 ; false-positive. std::shared_ptr has a bool() operator
+    if (newDispatcherPtr && oldDispatcherPtr) {
+        if (newDispatcherPtr == oldDispatcherPtr) {
+            result = true;
+        } else if (true == isDispatchingThread) {
+            // NOTE: migrate() waits for current dispatching to finish. Doing it from dispatching thread is a deadlock
+            HSM_TRACE_ERROR("migrate() can't be called from HSM callbacks");
+        } else if (true == newDispatcherPtr->start()) {
+            const std::weak_ptr<Impl> ptrInstance = shared_from_this();
+            const HandlerID_t newEventsHandlerId = createEventHandler(newDispatcherPtr, ptrInstance);
+            const HandlerID_t newTimerHandlerId = createTimerHandler(newDispatcherPtr, ptrInstance);
+            const HandlerID_t newEnqueuedEventsHandlerId = createEnqueuedEventHandler(newDispatcherPtr, ptrInstance);
+
+            if ((INVALID_HSM_DISPATCHER_HANDLER_ID != newEventsHandlerId) &&
+                (INVALID_HSM_DISPATCHER_HANDLER_ID != newTimerHandlerId)) {
+                HandlerID_t oldEventsHandlerId = INVALID_HSM_DISPATCHER_HANDLER_ID;
+                HandlerID_t oldEnqueuedEventsHandlerId = INVALID_HSM_DISPATCHER_HANDLER_ID;
+                HandlerID_t oldTimerHandlerId = INVALID_HSM_DISPATCHER_HANDLER_ID;
+
+                // wait for old dispatcher to finish processing current event and prevent it from starting a new one.
+                // pending events stay in HSM's queue and will be processed by the new dispatcher
+                while (true == mIsDispatching.test_and_set()) {
+                    mIsDispatching.wait(true);
+                }
+
+                {
+                    HSM_SYNC_DISPATCHER();
+                    mDispatcher = dispatcher;
+                    oldEventsHandlerId = mEventsHandlerId;
+                    oldEnqueuedEventsHandlerId = mEnqueuedEventsHandlerId;
+                    oldTimerHandlerId = mTimerHandlerId;
+                    mEventsHandlerId = newEventsHandlerId;
+                    mEnqueuedEventsHandlerId = newEnqueuedEventsHandlerId;
+                    mTimerHandlerId = newTimerHandlerId;
+                    // NOTE: events enqueued with transitionInterruptSafe() could still be waiting in the old
+                    //       dispatcher. Its handler stays registered and forwards them to HSM's queue, so they will be
+                    //       processed by the new dispatcher
+                    mMigratedEnqueuedEventsHandlers.emplace_back(oldDispatcherPtr, oldEnqueuedEventsHandlerId);
+                }
+
+                // NOTE: this also stops all timers which were started by HSM in the old dispatcher
+                oldDispatcherPtr->unregisterEventHandler(oldEventsHandlerId);
+                oldDispatcherPtr->unregisterTimerHandler(oldTimerHandlerId);
+
+                restoreTimers(newDispatcherPtr, newTimerHandlerId);
+
+                mIsDispatching.clear();
+                mIsDispatching.notify();
+
+                // old dispatcher could have skipped events while migration was in progress
+                requestDispatching();
+                result = true;
+            } else {
+                HSM_TRACE_ERROR("failed to register event handlers");
+                newDispatcherPtr->unregisterEventHandler(newEventsHandlerId);
+                newDispatcherPtr->unregisterEnqueuedEventHandler(newEnqueuedEventsHandlerId);
+                newDispatcherPtr->unregisterTimerHandler(newTimerHandlerId);
+            }
         } else {
-            // always return true for async transitions
+            HSM_TRACE_ERROR("failed to start dispatcher");
+        }
+    } else {
+        HSM_TRACE_ERROR("dispatcher is NULL or HSM is not initialized");
+    }
+
+    return result;
+}
+
+// ============================================================================
+// PRIVATE
+// ============================================================================
+HandlerID_t HierarchicalStateMachine::Impl::createEventHandler(const std::shared_ptr<IHsmEventDispatcher>& dispatcherPtr,
+                                                        const std::weak_ptr<HierarchicalStateMachine::Impl>& ptrInstance) {
+    // cppcheck-suppress misra-c2012-13.1 ; false-positive. this is a functor, not initializer list
+    return dispatcherPtr->registerEventHandler([ptrInstance]() {
+        bool handlerIsValid = false;
+        auto pThis = ptrInstance.lock();
+
+        // cppcheck-suppress misra-c2012-14.4 ; false-positive. std::shared_ptr has a bool() operator
+        if (pThis && (false == pThis->mStopDispatching)) {
+            pThis->dispatchEvents();
+            handlerIsValid = true;
+        }
+
+        // NOTE: false-positive. "return" statement belongs to lambda function, not parent function
+        // cppcheck-suppress misra-c2012-15.5
+        return handlerIsValid;
+    });
+}
+
+HandlerID_t HierarchicalStateMachine::Impl::createTimerHandler(const std::shared_ptr<IHsmEventDispatcher>& dispatcherPtr,
+                                                        const std::weak_ptr<HierarchicalStateMachine::Impl>& ptrInstance) {
+    // cppcheck-suppress misra-c2012-13.1 ; false-positive. this is a functor, not initializer list
+    return dispatcherPtr->registerTimerHandler([ptrInstance](const TimerID_t timerId) {
+        bool handlerIsValid = false;
+        auto pThis = ptrInstance.lock();
+
+        // cppcheck-suppress misra-c2012-14.4 ; false-positive. std::shared_ptr has a bool() operator
+        if (pThis && (false == pThis->mStopDispatching)) {
+            pThis->dispatchTimerEvent(timerId);
+            handlerIsValid = true;
+        }
+
+        // NOTE: false-positive. "return" statement belongs to lambda function, not parent function
+        // cppcheck-suppress misra-c2012-15.5
+        return handlerIsValid;
+    });
+}
+
+HandlerID_t HierarchicalStateMachine::Impl::createEnqueuedEventHandler(
+    const std::shared_ptr<IHsmEventDispatcher>& dispatcherPtr,
+    const std::weak_ptr<HierarchicalStateMachine::Impl>& ptrInstance) {
+    // cppcheck-suppress misra-c2012-13.1 ; false-positive. this is a functor, not initializer list
+    return dispatcherPtr->registerEnqueuedEventHandler([ptrInstance](const EventID_t event) {
+        bool handlerIsValid = false;
+        auto pThis = ptrInstance.lock();
+
+        // cppcheck-suppress misra-c2012-14.4 ; false-positive. std::shared_ptr has a bool() operator
+        if (pThis && (false == pThis->mStopDispatching)) {
+            pThis->transitionSimple(event);
+            handlerIsValid = true;
+        }
+
+        // NOTE: false-positive. "return" statement belongs to lambda function, not parent function
+        // cppcheck-suppress misra-c2012-15.5
+        return handlerIsValid;
+    });
+}
+
+std::shared_ptr<IHsmEventDispatcher> HierarchicalStateMachine::Impl::getDispatcher() const {
+    HSM_SYNC_DISPATCHER();
+    return mDispatcher.lock();
+}
+
+void HierarchicalStateMachine::Impl::requestDispatching() {
+    std::shared_ptr<IHsmEventDispatcher> dispatcherPtr;
+    HandlerID_t eventsHandlerId = INVALID_HSM_DISPATCHER_HANDLER_ID;
+
+    {
+        HSM_SYNC_DISPATCHER();
+        dispatcherPtr = mDispatcher.lock();
+        eventsHandlerId = mEventsHandlerId;
+    }
+
+    // cppcheck-suppress misra-c2012-14.4 ; false-positive. std::shared_ptr has a bool() operator
+    if (dispatcherPtr) {
+        dispatcherPtr->emitEvent(eventsHandlerId);
+    }
+}
+
+void HierarchicalStateMachine::Impl::restoreTimers(const std::shared_ptr<IHsmEventDispatcher>& dispatcherPtr,
+                                                   const HandlerID_t timerHandlerId) {
+    std::list<std::pair<TimerID_t, unsigned int>> restoredTimers;
+
+    {
+        HSM_SYNC_DISPATCHER();
+        const uint64_t currentTimeMs = getCurrentTimeMs();
+
+        for (auto& curTimer : mRunningTimers) {
+            const uint64_t elapsedMs = currentTimeMs - curTimer.second.startedAtMs;
+            unsigned int remainingMs = 1u;
+
+            if (elapsedMs < static_cast<uint64_t>(curTimer.second.intervalMs)) {
+                remainingMs = curTimer.second.intervalMs - static_cast<unsigned int>(elapsedMs);
+            }
+
+            // repeating timers are started as singleshot to keep their phase and restarted with full interval later
+            if (false == curTimer.second.isSingleShot) {
+                curTimer.second.resumeRepeating = true;
+            }
+
+            restoredTimers.emplace_back(curTimer.first, remainingMs);
+        }
+
+        // timers which were waiting to be resumed are restored together with other repeating timers
+        mResumedTimers.clear();
+        mHasResumedTimers.clear();
+    }
+
+    for (const auto& curTimer : restoredTimers) {
+        HSM_TRACE_DEBUG("restore timer=%d, remainingMs=%u", SC2INT(curTimer.first), curTimer.second);
+        dispatcherPtr->startTimer(timerHandlerId, curTimer.first, curTimer.second, true);
+    }
+}
+
+void HierarchicalStateMachine::Impl::resumeRepeatingTimers() {
+    std::list<std::pair<TimerID_t, unsigned int>> resumedTimers;
+
+    // NOTE: function is called for every dispatched event. Flag is cleared before taking the list, so timers which are
+    //       added after this point will be handled by the next call
+    if (true == mHasResumedTimers.test()) {
+        mHasResumedTimers.clear();
+
+        HSM_SYNC_DISPATCHER();
+
+        for (const TimerID_t curTimerID : mResumedTimers) {
+            auto it = mRunningTimers.find(curTimerID);
+
+            if ((mRunningTimers.end() != it) && (false == it->second.isSingleShot)) {
+                resumedTimers.emplace_back(curTimerID, it->second.intervalMs);
+            }
+        }
+
+        mResumedTimers.clear();
+    }
+
+    for (const auto& curTimer : resumedTimers) {
+        startTimer(curTimer.first, curTimer.second, false);
+    }
+}
+
+void HierarchicalStateMachine::Impl::handleStartup() {
+    HSM_TRACE_CALL_DEBUG_ARGS("mActiveStates.size=%ld", mActiveStates.size());
+    auto dispatcherPtr = getDispatcher();
+
+    // cppcheck-suppress misra-c2012-14.4 ; false-positive. std::shared_ptr has a bool() operator
+    if (dispatcherPtr) {
+        HSM_TRACE_DEBUG("state=<%s>", getStateName(mInitialState).c_str());
+        std::list<StateID_t> entryPoints;
+
+        (void)onStateEntering(mInitialState, VariantVector_t());
+        mActiveStates.emplace_back(mInitialState);
+        publishActiveStates();
+        notifyActiveStateChanged(mInitialState, true);
+        onStateChanged(mInitialState, VariantVector_t());
+
+        if (true == getEntryPoints(mInitialState, INVALID_HSM_EVENT_ID, VariantVector_t(), entryPoints)) {
+            PendingEventInfo entryPointTransitionEvent;
+
+            entryPointTransitionEvent.transitionType = TransitionBehavior::ENTRYPOINT;
+            entryPointTransitionEvent.id = INVALID_HSM_EVENT_ID;
+
+            {
+                HSM_SYNC_EVENTS_QUEUE();
+                mPendingEvents.emplace_front(std::move(entryPointTransitionEvent));
+            }
+        }
+
+        if (false == mPendingEvents.empty()) {
+            requestDispatching();
+        }
+    }
+}
+
+void HierarchicalStateMachine::Impl::transitionSimple(const EventID_t event) {
+    // NOTE: enqueued events are always processed on dispatcher's thread
+    (void)transitionExImpl(event, false, false, 0, VariantVector_t(), false);
+}
+
+bool HierarchicalStateMachine::Impl::transitionWithSharedArgs(const EventID_t event,
+                                                              const std::shared_ptr<VariantVector_t>& args) {
+    HSM_TRACE_CALL_DEBUG_ARGS("event=<%s>", getEventName(event).c_str());
+    bool status = false;
+    auto dispatcherPtr = getDispatcher();
+
+    // cppcheck-suppress misra-c2012-14.4 ; false-positive. std::shared_ptr has a bool() operator
+    if (dispatcherPtr) {
+        PendingEventInfo eventInfo;
+
+        eventInfo.id = event;
+        eventInfo.args = args;
+
+        // NOTE: called from dispatcher's thread so it's not allowed to block
+        const PendingEventResult addResult = addPendingEvent(eventInfo, false, false);
+
+        if (PendingEventResult::ADDED == addResult) {
+            requestDispatching();
+        }
+
+        if (PendingEventResult::DROPPED != addResult) {
             status = true;
+        } else {
+            HSM_TRACE_WARNING("event=<%s> was dropped", getEventName(event).c_str());
+        }
+    } else {
+        HSM_TRACE_ERROR("HSM is not initialized");
+    }
+
+    return status;
+}
+
+bool HierarchicalStateMachine::Impl::transitionAsyncWithArgsArray(const EventID_t event,
+                                                                  HsmTransitionCompletedCallback_t onCompleted,
+                                                                  VariantVector_t&& args) {
+    HsmCompletionExecutor_t executor;
+
+    {
+        HSM_SYNC_EVENTS_QUEUE();
+        executor = mCompletionExecutor;
+    }
+
+    if (executor && onCompleted) {
+        HsmTransitionCompletedCallback_t cbDirect = std::move(onCompleted);
+
+        onCompleted = [executor, cbDirect](const EventID_t completedEvent, const TransitionResult result) {
+            executor([cbDirect, completedEvent, result]() { cbDirect(completedEvent, result); });
+        };
+    }
+
+    return transitionExImpl(event, false, false, 0, std::move(args), true, std::move(onCompleted));
+}
+
+bool HierarchicalStateMachine::Impl::transitionWithPayload(const EventID_t event,
+                                                           std::shared_ptr<void>&& payload,
+                                                           const PayloadTypeID_t payloadType,
+                                                           const bool sync,
+                                                           const int timeoutMs) {
+    bool status = false;
+    const auto it = mEventPayloadTypes.find(event);
+
+    if ((mEventPayloadTypes.end() != it) && (payloadType == it->second)) {
+        PendingEventInfo eventInfo;
+
+        eventInfo.id = event;
+        eventInfo.payload = std::move(payload);
+        eventInfo.payloadType = payloadType;
+        status = sendPendingEvent(eventInfo, false, sync, timeoutMs, true, nullptr);
+    } else {
+        HSM_TRACE_ERROR("event=<%s> wasn't registered with this payload type", getEventName(event).c_str());
+    }
+
+    return status;
+}
+
+const void* HierarchicalStateMachine::Impl::getCurrentEventPayload(const PayloadTypeID_t payloadType) const {
+    const void* payload = nullptr;
+
+    // NOTE: mCurrentEvent must not be accessed by other threads (e.g. condition callbacks executed by
+    //       isTransitionPossible()). Event processed by dispatcher doesn't belong to them anyway.
+    //       Conditions of other events checked from HSM callbacks are executed on the same thread, so event id
+    //       must match too
+    if ((true == isCurrentEventThread()) && (nullptr != mCurrentEvent) && (mEvaluatedEvent == mCurrentEvent->id) &&
+        (payloadType == mCurrentEvent->payloadType)) {
+        payload = mCurrentEvent->payload.get();
+    }
+
+    return payload;
+}
+
+void HierarchicalStateMachine::Impl::setCompletionExecutor(HsmCompletionExecutor_t executor) {
+    HSM_SYNC_EVENTS_QUEUE();
+    mCompletionExecutor = std::move(executor);
+}
+
+bool HierarchicalStateMachine::Impl::transitionExImpl(const EventID_t event,
+                                                      const bool clearQueue,
+                                                      const bool sync,
+                                                      const int timeoutMs,
+                                                      VariantVector_t&& args,
+                                                      const bool canBlock,
+                                                      HsmTransitionCompletedCallback_t onCompleted) {
+    HSM_TRACE_CALL_DEBUG_ARGS("event=<%s>, clearQueue=%s, sync=%s, args.size=%lu",
+                              getEventName(event).c_str(),
+                              BOOL2STR(clearQueue),
+                              BOOL2STR(sync),
+                              args.size());
+    PendingEventInfo eventInfo;
+
+    eventInfo.id = event;
+    eventInfo.args =
+        std::allocate_shared<VariantVector_t>(HsmAllocator<VariantVector_t>(mRuntimeResource), std::move(args));
+
+    return sendPendingEvent(eventInfo, clearQueue, sync, timeoutMs, canBlock, std::move(onCompleted));
+}
+
+bool HierarchicalStateMachine::Impl::sendPendingEvent(PendingEventInfo& eventInfo,
+                                                      const bool clearQueue,
+                                                      const bool sync,
+                                                      const int timeoutMs,
+                                                      const bool canBlock,
+                                                      HsmTransitionCompletedCallback_t onCompleted) {
+    bool status = false;
+    auto dispatcherPtr = getDispatcher();
+
+    // cppcheck-suppress misra-c2012-14.4 ; false-positive. std::shared_ptr has a bool() operator
+    if (dispatcherPtr) {
+        if (true == sync) {
+            eventInfo.initLock(acquireSyncLock());
+        }
+
+        if (onCompleted) {
+            eventInfo.onCompleted = std::allocate_shared<TransitionCompletion>(
+                HsmAllocator<TransitionCompletion>(mRuntimeResource), eventInfo.id, std::move(onCompleted));
+        }
+
+        const PendingEventResult addResult = addPendingEvent(eventInfo, clearQueue, canBlock);
+
+        if (PendingEventResult::DROPPED != addResult) {
+            // NOTE: dispatcher was already notified about event which was replaced
+            if (PendingEventResult::ADDED == addResult) {
+                HSM_TRACE_DEBUG("transitionEx: emit");
+                requestDispatching();
+            }
+
+            if (true == sync) {
+                HSM_TRACE_DEBUG("transitionEx: wait...");
+                status = (HsmEventStatus::DONE_OK == eventInfo.wait(timeoutMs));
+            } else {
+                // always return true for accepted async transitions
+                status = true;
+            }
+        } else {
+            HSM_TRACE_WARNING("event=<%s> was dropped", getEventName(eventInfo.id).c_str());
         }
     } else {
         HSM_TRACE_ERROR("HSM is not initialized");
+
+        // cppcheck-suppress misra-c2012-14.4 ; false-positive. std::function has a bool() operator
+        if (onCompleted) {
+            onCompleted(eventInfo.id, TransitionResult::CANCELED);
+        }
     }
 
     HSM_TRACE_CALL_RESULT("%d", SC2INT(status));
     return status;
 }
 
-bool HierarchicalStateMachine::Impl::transitionInterruptSafe(const EventID_t event) {
-    bool res = false;
-    // TODO: this part needs testing with real interrupts. Not sure if it's safe to use weak_ptr.lock()
-    auto dispatcherPtr = mDispatcher.lock();
+PendingEventResult HierarchicalStateMachine::Impl::addPendingEvent(const PendingEventInfo& eventInfo,
+                                                                   const bool clearQueue,
+                                                                   const bool canBlock) {
+    PendingEventResult result = PendingEventResult::DROPPED;
+    bool wasDropped = false;
+    PendingEventInfo droppedEvent;
+    EventDropReason dropReason = EventDropReason::QUEUE_OVERFLOW;
+    PendingEventsList_t clearedEvents(mPendingEvents.get_allocator());
+    bool waitForSpace = false;
+    uint64_t deadlineMs = 0;
+    bool isDone = false;
+
+#ifndef HSM_DISABLE_THREADSAFETY
+    UniqueLock lckSpace;
+    int blockTimeoutMs = HSM_WAIT_INDEFINITELY;
+
+    if (true == canBlock) {
+        HSM_SYNC_EVENTS_QUEUE();
+        waitForSpace = ((false == clearQueue) && (QueueOverflowPolicy::BLOCK == mQueueOverflowPolicy) &&
+                        (HSM_QUEUE_UNLIMITED != mPendingEventsLimit));
+        blockTimeoutMs = mQueueBlockTimeoutMs;
+    }
+
+    if (true == waitForSpace) {
+        // NOTE: mQueueSpaceSync only guarantees that producers don't miss notifications. It's released while waiting,
+        //       so all woken up producers compete for free space. That's why capacity check and insertion are
+        //       done together under mEventsSync and producer goes back to waiting if it lost
+        lckSpace = UniqueLock(mQueueSpaceSync);
+
+        if (blockTimeoutMs > 0) {
+            deadlineMs = getCurrentTimeMs() + static_cast<uint64_t>(blockTimeoutMs);
+        }
+    }
+#endif  // HSM_DISABLE_THREADSAFETY
+
+    while (false == isDone) {
+        {
+            HSM_SYNC_EVENTS_QUEUE();
+
+            // NOTE: on timeout event is passed to insertPendingEvent() to be dropped according to overflow policy
+            if ((false == waitForSpace) || (true == hasQueueSpace(eventInfo.id)) ||
+                ((0U != deadlineMs) && (getCurrentTimeMs() >= deadlineMs))) {
+                if (true == clearQueue) {
+                    clearPendingEvents(clearedEvents);
+                }
+
+                result = insertPendingEvent(eventInfo, droppedEvent, dropReason, wasDropped);
+
+                if (mPendingEvents.size() > mQueueStats.maxPendingEvents) {
+                    mQueueStats.maxPendingEvents = mPendingEvents.size();
+                }
+
+                isDone = true;
+            }
+        }
+
+#ifndef HSM_DISABLE_THREADSAFETY
+        if (false == isDone) {
+            // NOTE: false-positive. "return" statement belongs to lambda function, not parent function
+            // cppcheck-suppress misra-c2012-15.5
+            auto hasSpace = [&]() {
+                HSM_SYNC_EVENTS_QUEUE();
+                return (true == hasQueueSpace(eventInfo.id));
+            };
+
+            if (0U != deadlineMs) {
+                const uint64_t currentTimeMs = getCurrentTimeMs();
+
+                if (currentTimeMs < deadlineMs) {
+                    (void)mQueueSpaceAvailable.wait_for(lckSpace, static_cast<int>(deadlineMs - currentTimeMs), hasSpace);
+                }
+            } else {
+                mQueueSpaceAvailable.wait(lckSpace, hasSpace);
+            }
+
+            // NOTE: depending on platform ConditionVariable could return with unlocked mutex
+            lckSpace.lock();
+        }
+#endif  // HSM_DISABLE_THREADSAFETY
+    }
+
+#ifndef HSM_DISABLE_THREADSAFETY
+    if (true == lckSpace.owns_lock()) {
+        lckSpace.unlock();
+    }
+#endif  // HSM_DISABLE_THREADSAFETY
+
+    // NOTE: completion callbacks of cleared events are called with CANCELED status. They are allowed to send new
+    //       events to this HSM, so mEventsSync must not be held at this point
+    clearedEvents.clear();
+
+    if (true == clearQueue) {
+        notifyQueueSpaceAvailable();
+    }
 
-    // cppcheck-suppress misra-c2012-14.4 ; false-positive. std::shared_ptr has a bool() operator
-    if (dispatcherPtr) {
-        res = dispatcherPtr->enqueueEvent(mEnqueuedEventsHandlerId, event);
+    if (true == wasDropped) {
+        notifyEventDropped(droppedEvent, dropReason);
     }
 
-    return res;
+    return result;
 }
 
-bool HierarchicalStateMachine::Impl::isTransitionPossible(const EventID_t event, const VariantVector_t& args) {
-    HSM_TRACE_CALL_DEBUG_ARGS("event=<%s>", getEventName(event).c_str());
-    bool possible = false;
+PendingEventResult HierarchicalStateMachine::Impl::insertPendingEvent(const PendingEventInfo& eventInfo,
+                                                                      PendingEventInfo& outDroppedEvent,
+                                                                      EventDropReason& outReason,
+                                                                      bool& outWasDropped) {
+    PendingEventResult result = PendingEventResult::DROPPED;
+    auto itCoalesced = mCoalescedEvents.find(eventInfo.id);
+    auto itInserted = mPendingEvents.end();
+
+    outWasDropped = true;
+
+    if ((mCoalescedEvents.end() != itCoalesced) && (mPendingEvents.end() != itCoalesced->second)) {
+        // latest-wins: pending event is replaced in-place without affecting queue limits
+        outDroppedEvent = std::move(*(itCoalesced->second));
+        *(itCoalesced->second) = eventInfo;
+        itInserted = itCoalesced->second;
+        outReason = EventDropReason::COALESCED;
+        ++mQueueStats.coalescedEvents;
+        result = PendingEventResult::REPLACED;
+    } else if ((HSM_QUEUE_UNLIMITED == mPendingEventsLimit) || (mPendingEvents.size() < mPendingEventsLimit)) {
+        outWasDropped = false;
+        result = PendingEventResult::ADDED;
+    } else if (QueueOverflowPolicy::DROP_OLDEST == mQueueOverflowPolicy) {
+        // NOTE: internal events must never be dropped
+        auto it = std::find_if(mPendingEvents.begin(), mPendingEvents.end(), [](const PendingEventInfo& curEvent) {
+            // cppcheck-suppress misra-c2012-15.5 ; false-positive. "return" statement belongs to lambda function
+            return (TransitionBehavior::REGULAR == curEvent.transitionType);
+        });
 
-    for (const StateID_t& state : mActiveStates) {
-        possible = checkTransitionPossibility(state, event, args);
+        if (mPendingEvents.end() != it) {
+            outDroppedEvent = extractPendingEvent(it);
+            ++mQueueStats.droppedEvents;
+            result = PendingEventResult::ADDED;
+        }
+    } else if (QueueOverflowPolicy::COALESCE == mQueueOverflowPolicy) {
+        auto it = std::find_if(mPendingEvents.rbegin(), mPendingEvents.rend(), [&eventInfo](const PendingEventInfo& curEvent) {
+            // cppcheck-suppress misra-c2012-15.5 ; false-positive. "return" statement belongs to lambda function
+            return ((TransitionBehavior::REGULAR == curEvent.transitionType) && (eventInfo.id == curEvent.id));
+        });
 
-        if (true == possible) {
-            break;
+        if (mPendingEvents.rend() != it) {
+            outDroppedEvent = std::move(*it);
+            *it = eventInfo;
+            itInserted = std::prev(it.base());
+            outReason = EventDropReason::COALESCED;
+            ++mQueueStats.coalescedEvents;
+            result = PendingEventResult::REPLACED;
         }
+    } else {
+        // QueueOverflowPolicy::BLOCK and QueueOverflowPolicy::DROP_NEWEST: new event is dropped
     }
 
-    HSM_TRACE_CALL_RESULT("%d", BOOL2INT(possible));
-    return possible;
-}
+    if (PendingEventResult::ADDED == result) {
+        mPendingEvents.emplace_back(eventInfo);
+        itInserted = std::prev(mPendingEvents.end());
+        ++mPendingEventsCount[eventInfo.id];
 
-void HierarchicalStateMachine::Impl::startTimer(const TimerID_t timerID,
-                                                const unsigned int intervalMs,
-                                                const bool isSingleShot) {
-    auto dispatcherPtr = mDispatcher.lock();
+        if (mCoalescedEvents.end() != itCoalesced) {
+            itCoalesced->second = itInserted;
+        }
+    } else if (PendingEventResult::DROPPED == result) {
+        outDroppedEvent = eventInfo;
+        ++mQueueStats.droppedEvents;
+    } else {
+        // do nothing
+    }
 
-    // cppcheck-suppress misra-c2012-14.4 ; false-positive. std::shared_ptr has a bool() operator
-    if (dispatcherPtr) {
-        dispatcherPtr->startTimer(mTimerHandlerId, timerID, intervalMs, isSingleShot);
+    if (mPendingEvents.end() != itInserted) {
+        itInserted->sequence = ++mLastEventSequence;
     }
-}
 
-void HierarchicalStateMachine::Impl::restartTimer(const TimerID_t timerID) {
-    auto dispatcherPtr = mDispatcher.lock();
+    if ((mPendingEvents.end() != itInserted) && (false == mEventsTTL.empty())) {
+        auto itTTL = mEventsTTL.find(eventInfo.id);
 
-    // cppcheck-suppress misra-c2012-14.4 ; false-positive. std::shared_ptr has a bool() operator
-    if (dispatcherPtr) {
-        dispatcherPtr->restartTimer(timerID);
+        if (mEventsTTL.end() != itTTL) {
+            itInserted->deadlineMs = getCurrentTimeMs() + static_cast<uint64_t>(itTTL->second);
+        }
     }
+
+    return result;
 }
 
-void HierarchicalStateMachine::Impl::stopTimer(const TimerID_t timerID) {
-    auto dispatcherPtr = mDispatcher.lock();
+bool HierarchicalStateMachine::Impl::hasPendingCoalescedEvent(const EventID_t event) const {
+    auto it = mCoalescedEvents.find(event);
 
-    // cppcheck-suppress misra-c2012-14.4 ; false-positive. std::shared_ptr has a bool() operator
-    if (dispatcherPtr) {
-        dispatcherPtr->stopTimer(timerID);
-    }
+    return ((mCoalescedEvents.end() != it) && (mPendingEvents.end() != it->second));
 }
 
-bool HierarchicalStateMachine::Impl::isTimerRunning(const TimerID_t timerID) {
-    bool running = false;
-    auto dispatcherPtr = mDispatcher.lock();
+bool HierarchicalStateMachine::Impl::hasQueueSpace(const EventID_t event) const {
+    return ((HSM_QUEUE_UNLIMITED == mPendingEventsLimit) || (mPendingEvents.size() < mPendingEventsLimit) ||
+            (true == hasPendingCoalescedEvent(event)) || (true == mStopDispatching));
+}
 
-    // cppcheck-suppress misra-c2012-14.4 ; false-positive. std::shared_ptr has a bool() operator
-    if (dispatcherPtr) {
-        running = dispatcherPtr->isTimerRunning(timerID);
-    }
+PendingEventInfo HierarchicalStateMachine::Impl::extractPendingEvent(const PendingEventsList_t::iterator& itEvent) {
+    PendingEventInfo pendingEvent;
 
-    return running;
+    unindexPendingEvent(itEvent);
+    pendingEvent = std::move(*itEvent);
+    (void)mPendingEvents.erase(itEvent);
+
+    return pendingEvent;
 }
 
-// ============================================================================
-// PRIVATE
-// ============================================================================
-void HierarchicalStateMachine::Impl::createEventHandler(const std::shared_ptr<IHsmEventDispatcher>& dispatcherPtr,
-                                                        const std::weak_ptr<HierarchicalStateMachine::Impl>& ptrInstance) {
-    // cppcheck-suppress misra-c2012-13.1 ; false-positive. this is a functor, not initializer list
-    mEventsHandlerId = dispatcherPtr->registerEventHandler([ptrInstance]() {
-        bool handlerIsValid = false;
-        auto pThis = ptrInstance.lock();
+void HierarchicalStateMachine::Impl::unindexPendingEvent(const PendingEventsList_t::iterator& itEvent) {
+    if (false == mCoalescedEvents.empty()) {
+        auto itCoalesced = mCoalescedEvents.find(itEvent->id);
 
-        // cppcheck-suppress misra-c2012-14.4 ; false-positive. std::shared_ptr has a bool() operator
-        if (pThis && (false == pThis->mStopDispatching)) {
-            pThis->dispatchEvents();
-            handlerIsValid = true;
+        if ((mCoalescedEvents.end() != itCoalesced) && (itEvent == itCoalesced->second)) {
+            itCoalesced->second = mPendingEvents.end();
         }
+    }
 
-        // NOTE: false-positive. "return" statement belongs to lambda function, not parent function
-        // cppcheck-suppress misra-c2012-15.5
-        return handlerIsValid;
-    });
+    if (TransitionBehavior::REGULAR == itEvent->transitionType) {
+        auto itCount = mPendingEventsCount.find(itEvent->id);
+
+        if ((mPendingEventsCount.end() != itCount) && (itCount->second > 0u)) {
+            --itCount->second;
+        }
+    }
 }
 
-void HierarchicalStateMachine::Impl::createTimerHandler(const std::shared_ptr<IHsmEventDispatcher>& dispatcherPtr,
-                                                        const std::weak_ptr<HierarchicalStateMachine::Impl>& ptrInstance) {
-    // cppcheck-suppress misra-c2012-13.1 ; false-positive. this is a functor, not initializer list
-    mTimerHandlerId = dispatcherPtr->registerTimerHandler([ptrInstance](const TimerID_t timerId) {
-        bool handlerIsValid = false;
-        auto pThis = ptrInstance.lock();
+void HierarchicalStateMachine::Impl::removePendingEvents(const std::function<bool(const PendingEventInfo&)>& filter,
+                                                         PendingEventsList_t& outCanceledEvents,
+                                                         const size_t maxEvents) {
+    auto it = mPendingEvents.begin();
+    size_t removedEvents = 0;
 
-        // cppcheck-suppress misra-c2012-14.4 ; false-positive. std::shared_ptr has a bool() operator
-        if (pThis && (false == pThis->mStopDispatching)) {
-            pThis->dispatchTimerEvent(timerId);
-            handlerIsValid = true;
+    while ((mPendingEvents.end() != it) && (removedEvents < maxEvents)) {
+        auto itCurrent = it;
+
+        ++it;
+
+        // since ongoing transitions can't be canceled we need to treat internal events as atomic
+        if ((TransitionBehavior::REGULAR == itCurrent->transitionType) && (true == filter(*itCurrent))) {
+            unindexPendingEvent(itCurrent);
+            // NOTE: splice doesn't allocate memory and keeps canceled event object intact
+            outCanceledEvents.splice(outCanceledEvents.end(), mPendingEvents, itCurrent);
+            ++removedEvents;
         }
+    }
 
-        // NOTE: false-positive. "return" statement belongs to lambda function, not parent function
-        // cppcheck-suppress misra-c2012-15.5
-        return handlerIsValid;
-    });
+    mQueueStats.canceledEvents += outCanceledEvents.size();
 }
 
-void HierarchicalStateMachine::Impl::createEnqueuedEventHandler(
-    const std::shared_ptr<IHsmEventDispatcher>& dispatcherPtr,
-    const std::weak_ptr<HierarchicalStateMachine::Impl>& ptrInstance) {
-    // cppcheck-suppress misra-c2012-13.1 ; false-positive. this is a functor, not initializer list
-    mEnqueuedEventsHandlerId = dispatcherPtr->registerEnqueuedEventHandler([ptrInstance](const EventID_t event) {
-        bool handlerIsValid = false;
-        auto pThis = ptrInstance.lock();
+size_t HierarchicalStateMachine::Impl::notifyEventsCanceled(PendingEventsList_t& canceledEvents) {
+    HSM_TRACE_CALL_DEBUG_ARGS("canceledEvents.size()=%ld", canceledEvents.size());
 
-        // cppcheck-suppress misra-c2012-14.4 ; false-positive. std::shared_ptr has a bool() operator
-        if (pThis && (false == pThis->mStopDispatching)) {
-            pThis->transitionSimple(event);
-            handlerIsValid = true;
-        }
+    for (PendingEventInfo& curEvent : canceledEvents) {
+        curEvent.unlock(HsmEventStatus::CANCELED);
+    }
 
-        // NOTE: false-positive. "return" statement belongs to lambda function, not parent function
-        // cppcheck-suppress misra-c2012-15.5
-        return handlerIsValid;
-    });
+    if (false == canceledEvents.empty()) {
+        notifyQueueSpaceAvailable();
+    }
+
+    return canceledEvents.size();
 }
 
-void HierarchicalStateMachine::Impl::handleStartup() {
-    HSM_TRACE_CALL_DEBUG_ARGS("mActiveStates.size=%ld", mActiveStates.size());
-    auto dispatcherPtr = mDispatcher.lock();
+void HierarchicalStateMachine::Impl::notifyEventDropped(PendingEventInfo& droppedEvent, const EventDropReason reason) {
+    HSM_TRACE_CALL_DEBUG_ARGS("event=<%s>, reason=%d", getEventName(droppedEvent.id).c_str(), SC2INT(reason));
 
-    // cppcheck-suppress misra-c2012-14.4 ; false-positive. std::shared_ptr has a bool() operator
-    if (dispatcherPtr) {
-        HSM_TRACE_DEBUG("state=<%s>", getStateName(mInitialState).c_str());
-        std::list<StateID_t> entryPoints;
+    if (mDroppedEventCallback) {
+        mDroppedEventCallback(droppedEvent.id, droppedEvent.getArgs(), reason);
+    }
 
-        (void)onStateEntering(mInitialState, VariantVector_t());
-        mActiveStates.emplace_back(mInitialState);
-        onStateChanged(mInitialState, VariantVector_t());
+    droppedEvent.unlock(HsmEventStatus::CANCELED);
+}
 
-        if (true == getEntryPoints(mInitialState, INVALID_HSM_EVENT_ID, VariantVector_t(), entryPoints)) {
-            PendingEventInfo entryPointTransitionEvent;
+std::shared_ptr<SyncEventLock> HierarchicalStateMachine::Impl::acquireSyncLock() {
+    std::shared_ptr<SyncEventLock> syncLock;
 
-            entryPointTransitionEvent.transitionType = TransitionBehavior::ENTRYPOINT;
-            entryPointTransitionEvent.id = INVALID_HSM_EVENT_ID;
+    {
+        HSM_SYNC_EVENTS_QUEUE();
 
-            {
-                HSM_SYNC_EVENTS_QUEUE();
-                mPendingEvents.emplace_front(std::move(entryPointTransitionEvent));
+        for (const std::shared_ptr<SyncEventLock>& curLock : mSyncLocksPool) {
+            // lock is free when it's referenced only by the pool. nobody else can get a new reference to it while
+            // mEventsSync is locked
+            if (1 == curLock.use_count()) {
+                syncLock = curLock;
+                break;
             }
         }
 
-        if (false == mPendingEvents.empty()) {
-            dispatcherPtr->emitEvent(mEventsHandlerId);
+        if (!syncLock) {
+            syncLock = std::allocate_shared<SyncEventLock>(HsmAllocator<SyncEventLock>(mRuntimeResource));
+
+            if (mSyncLocksPool.size() < HSM_SYNC_LOCKS_POOL_SIZE) {
+                mSyncLocksPool.push_back(syncLock);
+            }
         }
     }
+
+    syncLock->reset();
+    return syncLock;
 }
 
-void HierarchicalStateMachine::Impl::transitionSimple(const EventID_t event) {
-    (void)transitionExWithArgsArray(event, false, false, 0, VariantVector_t());
+bool HierarchicalStateMachine::Impl::isPendingEventExpired(const PendingEventInfo& event) {
+    return ((TransitionBehavior::REGULAR == event.transitionType) && (0u != event.deadlineMs) &&
+            (getCurrentTimeMs() > event.deadlineMs));
+}
+
+uint64_t HierarchicalStateMachine::Impl::getCurrentTimeMs() {
+#if defined(FREERTOS_AVAILABLE)
+    return static_cast<uint64_t>(xTaskGetTickCount()) * portTICK_PERIOD_MS;
+#elif defined(PLATFORM_ARDUINO)
+    return static_cast<uint64_t>(millis());
+#else
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+void HierarchicalStateMachine::Impl::notifyQueueSpaceAvailable() {
+#ifndef HSM_DISABLE_THREADSAFETY
+    {
+        // NOTE: lock is needed to prevent missing notification while producer is checking the queue size
+        LockGuard lck(mQueueSpaceSync);
+    }
+
+    mQueueSpaceAvailable.notify();
+#endif  // HSM_DISABLE_THREADSAFETY
 }
 
 void HierarchicalStateMachine::Impl::dispatchEvents() {
     HSM_TRACE_CALL_DEBUG_ARGS("mPendingEvents.size=%ld", mPendingEvents.size());
-    auto dispatcherPtr = mDispatcher.lock();
+    resumeRepeatingTimers();
 
-    // cppcheck-suppress misra-c2012-14.4 ; false-positive. std::shared_ptr has a bool() operator
-    if (dispatcherPtr && (false == mIsDispatching.test_and_set())) {
+    // NOTE: reference to dispatcher is not kept here since it could end up being the last one after HSM is released
+    if ((true == isInitialized()) && (false == mIsDispatching.test_and_set())) {
         UniqueLock lk = mIsDispatching.lock();
 
+#ifdef STL_AVAILABLE
+        mDispatchingThread.store(std::this_thread::get_id());
+#endif
+
         if (false == mStopDispatching) {
             if (false == mPendingEvents.empty()) {
                 PendingEventInfo pendingEvent;
+                bool notifyProducers = false;
+                bool isExpired = false;
 
                 {
                     HSM_SYNC_EVENTS_QUEUE();
-                    pendingEvent = std::move(mPendingEvents.front());
-                    mPendingEvents.pop_front();
+                    pendingEvent = extractPendingEvent(mPendingEvents.begin());
+                    notifyProducers = ((HSM_QUEUE_UNLIMITED != mPendingEventsLimit) &&
+                                           (QueueOverflowPolicy::BLOCK == mQueueOverflowPolicy));
+                    isExpired = isPendingEventExpired(pendingEvent);
+
+                    if (true == isExpired) {
+                        ++mQueueStats.expiredEvents;
+                    }
                 }
 
-                HsmEventStatus transitiontStatus = doTransition(pendingEvent);
+                if (true == notifyProducers) {
+                    notifyQueueSpaceAvailable();
+                }
+
+                if (false == isExpired) {
+                    HsmEventStatus transitiontStatus = doTransition(pendingEvent);
 
-                HSM_TRACE_DEBUG("unlock with status %d", SC2INT(transitiontStatus));
-                pendingEvent.unlock(transitiontStatus);
+                    HSM_TRACE_DEBUG("unlock with status %d", SC2INT(transitiontStatus));
+                    pendingEvent.unlock(transitiontStatus);
+                } else {
+                    HSM_TRACE_WARNING("event=<%s> expired", getEventName(pendingEvent.id).c_str());
+                    notifyEventDropped(pendingEvent, EventDropReason::EXPIRED);
+                }
             }
 
             if ((false == mStopDispatching) && (false == mPendingEvents.empty())) {
-                dispatcherPtr->emitEvent(mEventsHandlerId);
+                requestDispatching();
             }
         }
 
+#ifdef STL_AVAILABLE
+        mDispatchingThread.store(std::thread::id());
+#endif
         mIsDispatching.clear();
         mIsDispatching.notify();
     }
@@ -657,11 +1685,162 @@ void HierarchicalStateMachine::Impl::dispatchEvents() {
 
 void HierarchicalStateMachine::Impl::dispatchTimerEvent(const TimerID_t id) {
     HSM_TRACE_CALL_DEBUG_ARGS("id=%d", SC2INT(id));
+    bool resumeTimer = false;
+
+    {
+        HSM_SYNC_DISPATCHER();
+        auto itRunning = mRunningTimers.find(id);
+
+        if (mRunningTimers.end() != itRunning) {
+            if (true == itRunning->second.resumeRepeating) {
+                itRunning->second.resumeRepeating = false;
+                itRunning->second.startedAtMs = getCurrentTimeMs();
+                mResumedTimers.push_back(id);
+                (void)mHasResumedTimers.test_and_set();
+                resumeTimer = true;
+            } else if (true == itRunning->second.isSingleShot) {
+                mRunningTimers.erase(itRunning);
+            } else {
+                itRunning->second.startedAtMs = getCurrentTimeMs();
+            }
+        }
+    }
+
+    // NOTE: dispatcher doesn't allow to start timers from timer handler so it's done from events handler
+    if (true == resumeTimer) {
+        requestDispatching();
+    }
+
     auto it = mTimers.find(id);
 
     if (mTimers.end() != it) {
         transitionSimple(it->second);
+    } else {
+        (void)expireStateWaiter(id);
+    }
+}
+
+void HierarchicalStateMachine::Impl::notifyActiveStateChanged(const StateID_t state, const bool isActive) {
+    StateWaitersList_t activatedWaiters(mStateWaiters.get_allocator());
+    std::list<std::shared_ptr<HsmStateSubscriptionCallback_t>> subscribers;
+    bool hasBlockingWaiters = false;
+
+    {
+        HSM_SYNC_STATE_WAITERS();
+
+        if (true == isActive) {
+            auto it = mStateWaiters.begin();
+
+            while (mStateWaiters.end() != it) {
+                auto itCurrent = it;
+
+                ++it;
+
+                if (state == itCurrent->state) {
+                    activatedWaiters.splice(activatedWaiters.end(), mStateWaiters, itCurrent);
+                }
+            }
+
+            for (BlockingStateWaiterInfo& curWaiter : mBlockingStateWaiters) {
+                if ((state == curWaiter.state) && (false == curWaiter.isDone)) {
+                    curWaiter.isDone = true;
+                    curWaiter.isActive = true;
+                    hasBlockingWaiters = true;
+                }
+            }
+        }
+
+        auto itRange = mStateSubscriptions.equal_range(state);
+
+        for (auto it = itRange.first; it != itRange.second; ++it) {
+            subscribers.emplace_back(it->second.onChanged);
+        }
+    }
+
+#ifndef HSM_DISABLE_THREADSAFETY
+    if (true == hasBlockingWaiters) {
+        // NOTE: all blocking waiters share the same condition variable
+        mStateWaitersChanged.notify();
+    }
+#endif  // HSM_DISABLE_THREADSAFETY
+
+    if (false == activatedWaiters.empty()) {
+        for (StateWaiterInfo& curWaiter : activatedWaiters) {
+            if (INVALID_HSM_TIMER_ID != curWaiter.timerID) {
+                stopTimer(curWaiter.timerID);
+            }
+
+            curWaiter.onCompleted(state, true);
+        }
+    }
+
+    for (const std::shared_ptr<HsmStateSubscriptionCallback_t>& curCallback : subscribers) {
+        (*curCallback)(state, isActive);
+    }
+}
+
+bool HierarchicalStateMachine::Impl::expireStateWaiter(const TimerID_t timerID) {
+    StateWaitersList_t expiredWaiters(mStateWaiters.get_allocator());
+
+    {
+        HSM_SYNC_STATE_WAITERS();
+        auto it = std::find_if(mStateWaiters.begin(), mStateWaiters.end(), [timerID](const StateWaiterInfo& curWaiter) {
+            // cppcheck-suppress misra-c2012-15.5 ; false-positive. "return" statement belongs to lambda function
+            return (timerID == curWaiter.timerID);
+        });
+
+        if (mStateWaiters.end() != it) {
+            expiredWaiters.splice(expiredWaiters.end(), mStateWaiters, it);
+        }
+    }
+
+    for (StateWaiterInfo& curWaiter : expiredWaiters) {
+        HSM_TRACE_DEBUG("wait for state <%s> expired", getStateName(curWaiter.state).c_str());
+        curWaiter.onCompleted(curWaiter.state, false);
+    }
+
+    return (false == expiredWaiters.empty());
+}
+
+void HierarchicalStateMachine::Impl::cancelStateWaiters(const std::shared_ptr<IHsmEventDispatcher>& dispatcherPtr) {
+    StateWaitersList_t canceledWaiters(mStateWaiters.get_allocator());
+
+    {
+        HSM_SYNC_STATE_WAITERS();
+        canceledWaiters.swap(mStateWaiters);
+
+        for (BlockingStateWaiterInfo& curWaiter : mBlockingStateWaiters) {
+            curWaiter.isDone = true;
+        }
+    }
+
+#ifndef HSM_DISABLE_THREADSAFETY
+    mStateWaitersChanged.notify();
+#endif  // HSM_DISABLE_THREADSAFETY
+
+    for (StateWaiterInfo& curWaiter : canceledWaiters) {
+        if (INVALID_HSM_TIMER_ID != curWaiter.timerID) {
+            dispatcherPtr->stopTimer(curWaiter.timerID);
+        }
+
+        curWaiter.onCompleted(curWaiter.state, false);
+    }
+}
+
+TimerID_t HierarchicalStateMachine::Impl::generateInternalTimerID() {
+    // NOTE: IDs must be unique across all HSM instances since they can share the same dispatcher
+    static TimerID_t lastTimerID = INVALID_HSM_TIMER_ID;
+#ifndef HSM_DISABLE_THREADSAFETY
+    static Mutex sync;
+    LockGuard lck(sync);
+#endif
+
+    if (std::numeric_limits<TimerID_t>::min() == lastTimerID) {
+        lastTimerID = INVALID_HSM_TIMER_ID;
     }
+
+    --lastTimerID;
+    return lastTimerID;
 }
 
 bool HierarchicalStateMachine::Impl::onStateExiting(const StateID_t state) {
@@ -693,7 +1872,7 @@ bool HierarchicalStateMachine::Impl::onStateEntering(const StateID_t state, cons
 
     // since we can have a situation when same state is entered twice (parallel transitions) there
     // is no need to call callbacks multiple times
-    if (false == isStateActive(state)) {
+    if (false == isStateActiveInternal(state)) {
         auto it = mRegisteredStates.find(state);
 
         if ((mRegisteredStates.end() != it) && it->second.onEntering) {
@@ -724,7 +1903,7 @@ void HierarchicalStateMachine::Impl::onStateChanged(const StateID_t state, const
 
 void HierarchicalStateMachine::Impl::executeStateAction(const StateID_t state, const StateActionTrigger actionTrigger) {
     HSM_TRACE_CALL_DEBUG_ARGS("state=<%s>, actionTrigger=%d", getStateName(state).c_str(), SC2INT(actionTrigger));
-    auto dispatcherPtr = mDispatcher.lock();
+    auto dispatcherPtr = getDispatcher();
     auto itRange = mRegisteredActions.equal_range(std::make_pair(state, actionTrigger));
 
     // cppcheck-suppress misra-c2012-14.4 ; false-positive. std::shared_ptr has a bool() operator
@@ -745,14 +1924,13 @@ void HierarchicalStateMachine::Impl::executeStateAction(const StateID_t state, c
             const StateActionInfo& actionInfo = it->second;
 
             if (StateAction::START_TIMER == actionInfo.action) {
-                dispatcherPtr->startTimer(mTimerHandlerId,
-                                          static_cast<TimerID_t>(actionInfo.actionArgs[0].toInt64()),
-                                          actionInfo.actionArgs[1].toInt64(),
-                                          actionInfo.actionArgs[2].toBool());
+                startTimer(static_cast<TimerID_t>(actionInfo.actionArgs[0].toInt64()),
+                           static_cast<unsigned int>(actionInfo.actionArgs[1].toInt64()),
+                           actionInfo.actionArgs[2].toBool());
             } else if (StateAction::STOP_TIMER == actionInfo.action) {
-                dispatcherPtr->stopTimer(static_cast<TimerID_t>(actionInfo.actionArgs[0].toInt64()));
+                stopTimer(static_cast<TimerID_t>(actionInfo.actionArgs[0].toInt64()));
             } else if (StateAction::RESTART_TIMER == actionInfo.action) {
-                dispatcherPtr->restartTimer(static_cast<TimerID_t>(actionInfo.actionArgs[0].toInt64()));
+                restartTimer(static_cast<TimerID_t>(actionInfo.actionArgs[0].toInt64()));
             } else if (StateAction::TRANSITION == actionInfo.action) {
                 VariantVector_t transitionArgs;
 
@@ -765,7 +1943,13 @@ void HierarchicalStateMachine::Impl::executeStateAction(const StateID_t state, c
                     }
                 }
 
-                transitionWithArgsArray(static_cast<EventID_t>(actionInfo.actionArgs[0].toInt64()), std::move(transitionArgs));
+                // NOTE: state actions are executed on dispatcher's thread so we can't block here
+                (void)transitionExImpl(static_cast<EventID_t>(actionInfo.actionArgs[0].toInt64()),
+                                       false,
+                                       false,
+                                       0,
+                                       std::move(transitionArgs),
+                                       false);
             } else {
                 HSM_TRACE_WARNING("unsupported action <%d>", SC2INT(actionInfo.action));
             }
@@ -977,6 +2161,14 @@ bool HierarchicalStateMachine::Impl::checkTransitionPossibility(const StateID_t
     return possible;
 }
 
+bool HierarchicalStateMachine::Impl::isCurrentEventThread() const {
+#ifdef STL_AVAILABLE
+    return (std::this_thread::get_id() == mCurrentEventThread.load());
+#else
+    return true;
+#endif
+}
+
 bool HierarchicalStateMachine::Impl::findTransitionTarget(const StateID_t fromState,
                                                           const EventID_t event,
                                                           const VariantVector_t& transitionArgs,
@@ -985,6 +2177,13 @@ bool HierarchicalStateMachine::Impl::findTransitionTarget(const StateID_t fromSt
     HSM_TRACE_CALL_DEBUG_ARGS("fromState=<%s>, event=<%s>", getStateName(fromState).c_str(), getEventName(event).c_str());
     bool continueSearch = false;
     StateID_t curState = fromState;
+    const bool isEvaluatingThread = isCurrentEventThread();
+    const EventID_t prevEvaluatedEvent = mEvaluatedEvent;
+
+    // NOTE: mEvaluatedEvent belongs to the thread which processes mCurrentEvent
+    if (true == isEvaluatingThread) {
+        mEvaluatedEvent = event;
+    }
 
     do {
         const auto itRange = mTransitionsByEvent.equal_range(std::make_pair(curState, event));
@@ -1041,6 +2240,10 @@ bool HierarchicalStateMachine::Impl::findTransitionTarget(const StateID_t fromSt
         }
     } while (true == continueSearch);
 
+    if (true == isEvaluatingThread) {
+        mEvaluatedEvent = prevEvaluatedEvent;
+    }
+
     HSM_TRACE_CALL_RESULT("%s", BOOL2STR(outTransitions.empty() == false));
     return (outTransitions.empty() == false);
 }
@@ -1050,11 +2253,19 @@ HsmEventStatus HierarchicalStateMachine::Impl::doTransition(const PendingEventIn
     HsmEventStatus res = HsmEventStatus::DONE_FAILED;
     auto activeStatesSnapshot = mActiveStates;
     std::list<StateID_t> acceptedStates;  // list of states that accepted transitions
+    const PendingEventInfo* prevEvent = mCurrentEvent;
+    const EventID_t prevEvaluatedEvent = mEvaluatedEvent;
+
+    mCurrentEvent = &event;
+#ifdef STL_AVAILABLE
+    mCurrentEventThread.store(std::this_thread::get_id());
+#endif
+    mEvaluatedEvent = event.id;
 
     for (auto it = activeStatesSnapshot.rbegin(); it != activeStatesSnapshot.rend(); ++it) {
         // in case of parallel transitions some states might become inactive after handleSingleTransition()
         // example: [*B, *C] -> D
-        if (true == isStateActive(*it)) {
+        if (true == isStateActiveInternal(*it)) {
             // we don't need to process transitions for active states if their child already processed it
             bool childStateProcessed = false;
 
@@ -1095,7 +2306,7 @@ HsmEventStatus HierarchicalStateMachine::Impl::doTransition(const PendingEventIn
         }
 
         // stop processing other events if HSM was released
-        if (true == mDispatcher.expired()) {
+        if (false == isInitialized()) {
             res = HsmEventStatus::DONE_FAILED;
             break;
         }
@@ -1105,6 +2316,13 @@ HsmEventStatus HierarchicalStateMachine::Impl::doTransition(const PendingEventIn
         mFailedTransitionCallback(activeStatesSnapshot, event.id, event.getArgs());
     }
 
+    mCurrentEvent = prevEvent;
+    mEvaluatedEvent = prevEvaluatedEvent;
+#ifdef STL_AVAILABLE
+    if (nullptr == prevEvent) {
+        mCurrentEventThread.store(std::thread::id());
+    }
+#endif
     HSM_TRACE_CALL_RESULT("%d", SC2INT(res));
     return res;
 }
@@ -1310,6 +2528,12 @@ bool HierarchicalStateMachine::Impl::executeExitTransition(const PendingEventInf
                 for (const auto& curState : outExitedStates) {
                     mActiveStates.remove(curState);
                 }
+
+                publishActiveStates();
+
+                for (const auto& curState : outExitedStates) {
+                    notifyActiveStateChanged(curState, false);
+                }
             }
             // if one of the states blocked ongoing transition we need to rollback
             else {
@@ -1318,6 +2542,7 @@ bool HierarchicalStateMachine::Impl::executeExitTransition(const PendingEventInf
                     // to prevent infinite loops we don't allow state to cancel transition
                     (void)onStateEntering(curState, VariantVector_t());
                     mActiveStates.emplace_back(curState);
+                    publishActiveStates();
                     onStateChanged(curState, VariantVector_t());
                 }
             }
@@ -1469,6 +2694,8 @@ bool HierarchicalStateMachine::Impl::processFinalStateTransition(const PendingEv
 
                 finalStateEvent.transitionType = TransitionBehavior::REGULAR;
                 finalStateEvent.args = event.args;
+                finalStateEvent.payload = event.payload;
+                finalStateEvent.payloadType = event.payloadType;
 
                 if (INVALID_HSM_EVENT_ID != itFinalStateEvent->second) {
                     finalStateEvent.id = itFinalStateEvent->second;
@@ -1479,6 +2706,8 @@ bool HierarchicalStateMachine::Impl::processFinalStateTransition(const PendingEv
                 {
                     HSM_SYNC_EVENTS_QUEUE();
                     mPendingEvents.push_front(finalStateEvent);
+                    mPendingEvents.front().sequence = ++mLastEventSequence;
+                    ++mPendingEventsCount[finalStateEvent.id];
                 }
             }
         }
@@ -1540,7 +2769,7 @@ HsmEventStatus HierarchicalStateMachine::Impl::handleSingleTransition(const Stat
     return res;
 }
 
-void HierarchicalStateMachine::Impl::clearPendingEvents() {
+void HierarchicalStateMachine::Impl::clearPendingEvents(PendingEventsList_t& outClearedEvents) {
     HSM_TRACE_CALL_DEBUG_ARGS("clearPendingEvents: mPendingEvents.size()=%ld", mPendingEvents.size());
 
     for (auto it = mPendingEvents.begin(); (it != mPendingEvents.end()); ++it) {
@@ -1550,7 +2779,15 @@ void HierarchicalStateMachine::Impl::clearPendingEvents() {
         }
     }
 
-    mPendingEvents.clear();
+    outClearedEvents.splice(outClearedEvents.end(), mPendingEvents);
+
+    for (auto& itCoalesced : mCoalescedEvents) {
+        itCoalesced.second = mPendingEvents.end();
+    }
+
+    for (auto& itCount : mPendingEventsCount) {
+        itCount.second = 0;
+    }
 }
 
 bool HierarchicalStateMachine::Impl::hasSubstates(const StateID_t parent) const {
@@ -1584,8 +2821,11 @@ bool HierarchicalStateMachine::Impl::getEntryPoints(const StateID_t state,
 bool HierarchicalStateMachine::Impl::replaceActiveState(const StateID_t oldState, const StateID_t newState) {
     HSM_TRACE_CALL_DEBUG_ARGS("oldState=<%s>, newState=<%s>", getStateName(oldState).c_str(), getStateName(newState).c_str());
 
-    if (false == isSubstateOf(oldState, newState)) {
+    // NOTE: oldState could be already removed by exit logic
+    if ((false == isSubstateOf(oldState, newState)) && (true == isStateActiveInternal(oldState))) {
         mActiveStates.remove(oldState);
+        publishActiveStates();
+        notifyActiveStateChanged(oldState, false);
     }
 
     return addActiveState(newState);
@@ -1595,8 +2835,10 @@ bool HierarchicalStateMachine::Impl::addActiveState(const StateID_t newState) {
     HSM_TRACE_CALL_DEBUG_ARGS("newState=<%s>", getStateName(newState).c_str());
     bool wasAdded = false;
 
-    if (false == isStateActive(newState)) {
+    if (false == isStateActiveInternal(newState)) {
         mActiveStates.emplace_back(newState);
+        publishActiveStates();
+        notifyActiveStateChanged(newState, true);
         wasAdded = true;
     }
 
@@ -1604,6 +2846,14 @@ bool HierarchicalStateMachine::Impl::addActiveState(const StateID_t newState) {
     return wasAdded;
 }
 
+bool HierarchicalStateMachine::Impl::isStateActiveInternal(const StateID_t state) const {
+    return (std::find(mActiveStates.begin(), mActiveStates.end(), state) != mActiveStates.end());
+}
+
+void HierarchicalStateMachine::Impl::publishActiveStates() {
+    mActiveStatesSnapshot.publish(mActiveStates);
+}
+
 #ifdef HSM_ENABLE_SAFE_STRUCTURE
 
 bool HierarchicalStateMachine::Impl::isTopState(const StateID_t state) const {
@@ -7,25 +7,39 @@
 #include <list>
 #include <map>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 #ifdef HSMBUILD_DEBUGGING
   #include <fstream>
 #endif
 
 #include "hsmcpp/hsm.hpp"
+#include "hsmcpp/HsmMemoryResource.hpp"
 #include "hsmcpp/os/Mutex.hpp"
 #include "hsmcpp/os/ConditionVariable.hpp"
 #include "hsmcpp/os/AtomicFlag.hpp"
 #include "hsmcpp/variant.hpp"
 #include "HsmImplTypes.hpp"
 
+#ifdef STL_AVAILABLE
+  #include <atomic>
+  #include <thread>
+#endif
+
 namespace hsmcpp {
 
 class IHsmEventDispatcher;
 
 class HierarchicalStateMachine::Impl : public std::enable_shared_from_this<HierarchicalStateMachine::Impl> {
 public:
-    explicit Impl(HierarchicalStateMachine* parent, const StateID_t initialState);
+    using PendingEventsList_t = HsmList_t<PendingEventInfo>;
+    using StateWaitersList_t = HsmList_t<StateWaiterInfo>;
+
+public:
+    explicit Impl(HierarchicalStateMachine* parent,
+                  const StateID_t initialState,
+                  HsmMemoryResource* structureResource = nullptr,
+                  HsmMemoryResource* runtimeResource = nullptr);
     virtual ~Impl();
 
     void resetParent();
@@ -37,6 +51,7 @@ public:
     bool isInitialized() const;
     void release();
     void registerFailedTransitionCallback(HsmTransitionFailedCallback_t onFailedTransition);
+    void registerDroppedEventCallback(HsmEventDroppedCallback_t onEventDropped);
     void registerState(const StateID_t state,
                        HsmStateChangedCallback_t onStateChanged = nullptr,
                        HsmStateEnterCallback_t onEntering = nullptr,
@@ -58,6 +73,9 @@ public:
                                     HsmTransitionConditionCallback_t conditionCallback = nullptr,
                                     const bool expectedConditionValue = true);
     void registerTimer(const TimerID_t timerID, const EventID_t event);
+    void registerCoalescedEvent(const EventID_t event);
+    void registerEventTTL(const EventID_t event, const int ttlMs);
+    void registerEventPayload(const EventID_t event, const PayloadTypeID_t payloadType);
     bool registerStateAction(const StateID_t state,
                              const StateActionTrigger actionTrigger,
                              const StateAction action,
@@ -76,7 +94,12 @@ public:
                                 const bool expectedConditionValue = true);
     StateID_t getLastActiveState() const;
     const std::list<StateID_t>& getActiveStates() const;
+    std::list<StateID_t> getActiveStatesSnapshot() const;
     bool isStateActive(const StateID_t state) const;
+    void waitForStateAsync(const StateID_t state, const int timeoutMs, HsmStateWaitCallback_t onCompleted);
+    bool waitForState(const StateID_t state, const int timeoutMs);
+    SubscriptionID_t subscribeStateChanges(const std::list<StateID_t>& states, HsmStateSubscriptionCallback_t onChanged);
+    void unsubscribeStateChanges(const SubscriptionID_t id);
 
     void transitionWithArgsArray(const EventID_t event, VariantVector_t&& args);
     bool transitionExWithArgsArray(const EventID_t event,
@@ -84,27 +107,104 @@ public:
                                    const bool sync,
                                    const int timeoutMs,
                                    VariantVector_t&& args);
+    // used by HsmGroup to deliver the same arguments object to multiple HSMs
+    bool transitionWithSharedArgs(const EventID_t event, const std::shared_ptr<VariantVector_t>& args);
+    bool transitionAsyncWithArgsArray(const EventID_t event, HsmTransitionCompletedCallback_t onCompleted, VariantVector_t&& args);
+    bool transitionWithPayload(const EventID_t event,
+                               std::shared_ptr<void>&& payload,
+                               const PayloadTypeID_t payloadType,
+                               const bool sync,
+                               const int timeoutMs);
+    // returns payload of the event which is currently processed or nullptr if event doesn't have payload of requested type.
+    // Returns nullptr if it's called from a thread which doesn't process this event (e.g. from isTransitionPossible())
+    // or if callback is evaluated for a different event (e.g. nested isTransitionPossible() from HSM callbacks)
+    const void* getCurrentEventPayload(const PayloadTypeID_t payloadType) const;
+    void setCompletionExecutor(HsmCompletionExecutor_t executor);
     bool transitionInterruptSafe(const EventID_t event);
+    size_t cancelPendingEvents(const EventID_t event);
+    size_t cancelPendingEvents(HsmEventFilterCallback_t filter);
     bool isTransitionPossible(const EventID_t event, const VariantVector_t& args);
+    void setPendingEventsLimit(const size_t maxEvents, const QueueOverflowPolicy policy, const int blockTimeoutMs);
+    EventsQueueStats getPendingEventsStats() const;
     void startTimer(const TimerID_t timerID, const unsigned int intervalMs, const bool isSingleShot);
     void restartTimer(const TimerID_t timerID);
     void stopTimer(const TimerID_t timerID);
     bool isTimerRunning(const TimerID_t timerID);
+    bool migrate(const std::weak_ptr<IHsmEventDispatcher>& dispatcher);
     bool enableHsmDebugging();
     bool enableHsmDebugging(const std::string& dumpPath);
     void disableHsmDebugging();
 
 private:
-    void createEventHandler(const std::shared_ptr<IHsmEventDispatcher>& dispatcherPtr, const std::weak_ptr<Impl>& ptrInstance);
-    void createTimerHandler(const std::shared_ptr<IHsmEventDispatcher>& dispatcherPtr, const std::weak_ptr<Impl>& ptrInstance);
-    void createEnqueuedEventHandler(const std::shared_ptr<IHsmEventDispatcher>& dispatcherPtr,
-                                    const std::weak_ptr<Impl>& ptrInstance);
+    static HandlerID_t createEventHandler(const std::shared_ptr<IHsmEventDispatcher>& dispatcherPtr,
+                                          const std::weak_ptr<Impl>& ptrInstance);
+    static HandlerID_t createTimerHandler(const std::shared_ptr<IHsmEventDispatcher>& dispatcherPtr,
+                                          const std::weak_ptr<Impl>& ptrInstance);
+    static HandlerID_t createEnqueuedEventHandler(const std::shared_ptr<IHsmEventDispatcher>& dispatcherPtr,
+                                                  const std::weak_ptr<Impl>& ptrInstance);
+
+    // returns dispatcher which is currently used by HSM (it could be changed by migrate() from a different thread)
+    std::shared_ptr<IHsmEventDispatcher> getDispatcher() const;
+    // emits event for HSM's events handler using current dispatcher
+    void requestDispatching();
+    // starts timers from mRunningTimers using their remaining time
+    void restoreTimers(const std::shared_ptr<IHsmEventDispatcher>& dispatcherPtr, const HandlerID_t timerHandlerId);
+    // starts repeating timers which were restored by restoreTimers() and already expired once
+    void resumeRepeatingTimers();
 
     // checks initial state and, if needed, process any automatic initial transitions
     void handleStartup();
 
     void transitionSimple(const EventID_t event);
 
+    // canBlock must be FALSE when called from dispatcher's thread
+    bool transitionExImpl(const EventID_t event,
+                          const bool clearQueue,
+                          const bool sync,
+                          const int timeoutMs,
+                          VariantVector_t&& args,
+                          const bool canBlock,
+                          HsmTransitionCompletedCallback_t onCompleted = nullptr);
+    // adds new external event to the queue and waits for it to be processed if sync is true
+    bool sendPendingEvent(PendingEventInfo& eventInfo,
+                          const bool clearQueue,
+                          const bool sync,
+                          const int timeoutMs,
+                          const bool canBlock,
+                          HsmTransitionCompletedCallback_t onCompleted);
+    PendingEventResult addPendingEvent(const PendingEventInfo& eventInfo, const bool clearQueue, const bool canBlock);
+    // must be called with mEventsSync locked
+    PendingEventResult insertPendingEvent(const PendingEventInfo& eventInfo,
+                                          PendingEventInfo& outDroppedEvent,
+                                          EventDropReason& outReason,
+                                          bool& outWasDropped);
+    // must be called with mEventsSync locked
+    bool hasPendingCoalescedEvent(const EventID_t event) const;
+    // must be called with mEventsSync locked. checks if event could be added without triggering overflow policy
+    bool hasQueueSpace(const EventID_t event) const;
+    // must be called with mEventsSync locked. removes event from mPendingEvents and updates events indexes
+    PendingEventInfo extractPendingEvent(const PendingEventsList_t::iterator& itEvent);
+    // must be called with mEventsSync locked. updates events indexes before event is removed from mPendingEvents
+    void unindexPendingEvent(const PendingEventsList_t::iterator& itEvent);
+    // must be called with mEventsSync locked. moves matching REGULAR events from mPendingEvents to outCanceledEvents.
+    // stops after maxEvents were moved
+    void removePendingEvents(const std::function<bool(const PendingEventInfo&)>& filter,
+                             PendingEventsList_t& outCanceledEvents,
+                             const size_t maxEvents);
+    size_t notifyEventsCanceled(PendingEventsList_t& canceledEvents);
+    void notifyEventDropped(PendingEventInfo& droppedEvent, const EventDropReason reason);
+    void notifyQueueSpaceAvailable();
+    // notifies state waiters and subscribers. must be called every time state is added or removed from mActiveStates
+    void notifyActiveStateChanged(const StateID_t state, const bool isActive);
+    // returns true if timerID belonged to a state waiter
+    bool expireStateWaiter(const TimerID_t timerID);
+    void cancelStateWaiters(const std::shared_ptr<IHsmEventDispatcher>& dispatcherPtr);
+    static TimerID_t generateInternalTimerID();
+    // returns free SyncEventLock object from the pool or creates a new one
+    std::shared_ptr<SyncEventLock> acquireSyncLock();
+    static bool isPendingEventExpired(const PendingEventInfo& event);
+    static uint64_t getCurrentTimeMs();
+
     bool registerSubstate(const StateID_t parent,
                           const StateID_t substate,
                           const bool isEntryPoint,
@@ -130,6 +230,8 @@ private:
     void updateHistory(const StateID_t topLevelState, const std::list<StateID_t>& exitedStates);
 
     bool checkTransitionPossibility(const StateID_t fromState, const EventID_t event, const VariantVector_t& args);
+    // returns true if current thread is processing mCurrentEvent
+    bool isCurrentEventThread() const;
 
     bool findTransitionTarget(const StateID_t fromState,
                               const EventID_t event,
@@ -157,7 +259,9 @@ private:
 
     bool processFinalStateTransition(const PendingEventInfo& event, const StateID_t destinationState);
     HsmEventStatus handleSingleTransition(const StateID_t fromState, const PendingEventInfo& event);
-    void clearPendingEvents();
+    // must be called with mEventsSync locked. moves all pending events to outClearedEvents. They must be destroyed
+    // after mEventsSync is released since their completion callbacks are called from destructor
+    void clearPendingEvents(PendingEventsList_t& outClearedEvents);
 
     bool hasSubstates(const StateID_t parent) const;
     bool hasEntryPoint(const StateID_t state) const;
@@ -171,6 +275,8 @@ private:
     bool replaceActiveState(const StateID_t oldState, const StateID_t newState);
     // returns TRUE if newState was added to a list of active states
     bool addActiveState(const StateID_t newState);
+    bool isStateActiveInternal(const StateID_t state) const;
+    void publishActiveStates();
 
 #ifdef HSM_ENABLE_SAFE_STRUCTURE
     bool isTopState(const StateID_t state) const;
@@ -194,38 +300,88 @@ private:
 
 private:
     HierarchicalStateMachine* mParent = nullptr;
-    std::weak_ptr<IHsmEventDispatcher> mDispatcher;  // protected by mParentSync
-    HandlerID_t mEventsHandlerId = INVALID_HSM_DISPATCHER_HANDLER_ID;
-    HandlerID_t mEnqueuedEventsHandlerId = INVALID_HSM_DISPATCHER_HANDLER_ID;
-    HandlerID_t mTimerHandlerId = INVALID_HSM_DISPATCHER_HANDLER_ID;
+    std::weak_ptr<IHsmEventDispatcher> mDispatcher;                            // protected by mDispatcherSync
+    HandlerID_t mEventsHandlerId = INVALID_HSM_DISPATCHER_HANDLER_ID;          // protected by mDispatcherSync
+    HandlerID_t mEnqueuedEventsHandlerId = INVALID_HSM_DISPATCHER_HANDLER_ID;  // protected by mDispatcherSync
+    HandlerID_t mTimerHandlerId = INVALID_HSM_DISPATCHER_HANDLER_ID;           // protected by mDispatcherSync
+    // NOTE: structure of HSM (registered states, transitions, etc.) is allocated from structure resource. Containers
+    //       which are modified while HSM is running (and pending event arguments) use mRuntimeResource
+    HsmMemoryResource* mRuntimeResource = nullptr;
+    HsmMap_t<TimerID_t, RunningTimerInfo> mRunningTimers;                       // protected by mDispatcherSync
+    HsmList_t<TimerID_t> mResumedTimers;                                        // protected by mDispatcherSync
+    // set when mResumedTimers is not empty. allows dispatchEvents() to skip locking mDispatcherSync
+    AtomicFlag mHasResumedTimers;
+    // enqueued events handlers which were registered in dispatchers used by HSM before migrate(). They forward events
+    // which were enqueued to the old dispatcher and are unregistered in release(). protected by mDispatcherSync
+    HsmList_t<std::pair<std::weak_ptr<IHsmEventDispatcher>, HandlerID_t>> mMigratedEnqueuedEventsHandlers;
     bool mStopDispatching = false;
 
     HsmTransitionFailedCallback_t mFailedTransitionCallback;
+    HsmEventDroppedCallback_t mDroppedEventCallback;
+    HsmCompletionExecutor_t mCompletionExecutor;  // protected by mEventsSync
 
     StateID_t mInitialState;
     std::list<StateID_t> mActiveStates;
-    std::multimap<std::pair<StateID_t, EventID_t>, TransitionInfo> mTransitionsByEvent;  // FROM_STATE, EVENT => TO
-    std::map<StateID_t, StateCallbacks> mRegisteredStates;
-    std::map<StateID_t, EventID_t> mFinalStates;
-    std::multimap<StateID_t, StateID_t> mSubstates;
-    std::multimap<StateID_t, StateEntryPoint> mSubstateEntryPoints;
-    std::list<PendingEventInfo> mPendingEvents;  // protected by mEventsSync
-    std::map<TimerID_t, EventID_t> mTimers;
+    // copy of mActiveStates for reading from other threads. must be published after every change of mActiveStates
+    ActiveStatesSnapshot mActiveStatesSnapshot;
+    HsmMultimap_t<std::pair<StateID_t, EventID_t>, TransitionInfo> mTransitionsByEvent;  // FROM_STATE, EVENT => TO
+    HsmMap_t<StateID_t, StateCallbacks> mRegisteredStates;
+    HsmMap_t<StateID_t, EventID_t> mFinalStates;
+    HsmMultimap_t<StateID_t, StateID_t> mSubstates;
+    HsmMultimap_t<StateID_t, StateEntryPoint> mSubstateEntryPoints;
+    PendingEventsList_t mPendingEvents;  // protected by mEventsSync
+    // event id => pending event or mPendingEvents.end() if there is none. protected by mEventsSync
+    HsmUnorderedMap_t<EventID_t, PendingEventsList_t::iterator> mCoalescedEvents;
+    HsmUnorderedMap_t<EventID_t, int> mEventsTTL;                                // protected by mEventsSync
+    HsmUnorderedMap_t<EventID_t, PayloadTypeID_t> mEventPayloadTypes;
+    // event which is currently processed by doTransition(). accessed only from dispatcher's thread
+    const PendingEventInfo* mCurrentEvent = nullptr;
+    // event which conditions and callbacks are currently executed. differs from mCurrentEvent if conditions are checked
+    // by isTransitionPossible() from HSM callbacks. accessed only from thread which processes mCurrentEvent
+    EventID_t mEvaluatedEvent = INVALID_HSM_EVENT_ID;
+#ifdef STL_AVAILABLE
+    // thread which executes doTransition(). Allows other threads to detect that mCurrentEvent doesn't belong to them
+    std::atomic<std::thread::id> mCurrentEventThread{std::thread::id()};
+    // thread which executes dispatchEvents(). Used to detect calls to migrate() from HSM's own callbacks
+    std::atomic<std::thread::id> mDispatchingThread{std::thread::id()};
+#endif
+    // event id => number of pending REGULAR events with this id. protected by mEventsSync
+    HsmUnorderedMap_t<EventID_t, size_t> mPendingEventsCount;
+    StateWaitersList_t mStateWaiters;  // protected by mStateWaitersSync
+    HsmList_t<BlockingStateWaiterInfo> mBlockingStateWaiters;  // protected by mStateWaitersSync
+    HsmMultimap_t<StateID_t, StateSubscriptionInfo> mStateSubscriptions;  // protected by mStateWaitersSync
+    SubscriptionID_t mLastSubscriptionID = INVALID_HSM_SUBSCRIPTION_ID;  // protected by mStateWaitersSync
+    // reusable objects for synchronous transitions. protected by mEventsSync
+    HsmVector_t<std::shared_ptr<SyncEventLock>> mSyncLocksPool;
+    size_t mPendingEventsLimit = HSM_QUEUE_UNLIMITED;                             // protected by mEventsSync
+    QueueOverflowPolicy mQueueOverflowPolicy = QueueOverflowPolicy::DROP_NEWEST;  // protected by mEventsSync
+    int mQueueBlockTimeoutMs = HSM_WAIT_INDEFINITELY;                             // protected by mEventsSync
+    EventsQueueStats mQueueStats;                                                 // protected by mEventsSync
+    uint64_t mLastEventSequence = 0;                                              // protected by mEventsSync
+    HsmMap_t<TimerID_t, EventID_t> mTimers;
 
     // parent state, history state
-    std::multimap<StateID_t, StateID_t> mHistoryStates;
+    HsmMultimap_t<StateID_t, StateID_t> mHistoryStates;
     // history state id, data
-    std::map<StateID_t, HistoryInfo> mHistoryData;
+    HsmMap_t<StateID_t, HistoryInfo> mHistoryData;
 
-    std::multimap<std::pair<StateID_t, StateActionTrigger>, StateActionInfo> mRegisteredActions;
+    HsmMultimap_t<std::pair<StateID_t, StateActionTrigger>, StateActionInfo> mRegisteredActions;
 
 #ifdef HSM_ENABLE_SAFE_STRUCTURE
-    std::list<StateID_t> mTopLevelStates;  // list of states which are not substates and dont have substates of their own
+    HsmList_t<StateID_t> mTopLevelStates;  // list of states which are not substates and dont have substates of their own
 #endif
 
 #ifndef HSM_DISABLE_THREADSAFETY
     AtomicFlag mIsDispatching;
-    Mutex mEventsSync;
+    // protects dispatcher, handler IDs and running timers
+    mutable Mutex mDispatcherSync;
+    // NOTE: mutable is needed to lock it in const methods
+    mutable Mutex mEventsSync;
+    // used by QueueOverflowPolicy::BLOCK to wait for free space in mPendingEvents
+    Mutex mQueueSpaceSync;
+    ConditionVariable mQueueSpaceAvailable;
+    Mutex mStateWaitersSync;
+    ConditionVariable mStateWaitersChanged;
   #if !defined(HSM_DISABLE_DEBUG_TRACES)
     Mutex mParentSync;
   #endif
@@ -3,7 +3,14 @@
 
 #include "HsmImplTypes.hpp"
 
+#include <algorithm>
+#ifdef STL_AVAILABLE
+  #include <thread>
+#endif
+
 #include "hsmcpp/logging.hpp"
+#include "hsmcpp/os/LockGuard.hpp"
+#include "hsmcpp/os/UniqueLock.hpp"
 
 namespace hsmcpp {
 
@@ -91,17 +98,40 @@ HistoryInfo& HistoryInfo::operator=(HistoryInfo&& src) noexcept {
 // ============================================================================
 constexpr const char* HSM_TRACE_CLASS = "PendingEventInfo";
 
+void SyncEventLock::reset() {
+    LockGuard lck(sync);
+    status = HsmEventStatus::PENDING;
+}
+
+TransitionCompletion::TransitionCompletion(const EventID_t event, HsmTransitionCompletedCallback_t&& callback)
+    : mEvent(event)
+    , mCallback(std::move(callback)) {}
+
+TransitionCompletion::~TransitionCompletion() {
+    // event was destroyed without being processed
+    notify(TransitionResult::CANCELED);
+}
+
+void TransitionCompletion::notify(const TransitionResult result) {
+    // cppcheck-suppress misra-c2012-14.4 ; false-positive. std::function has a bool() operator
+    if ((false == mIsNotified.test_and_set()) && mCallback) {
+        mCallback(mEvent, result);
+    }
+}
+
 PendingEventInfo::PendingEventInfo(PendingEventInfo&& src) noexcept {
     *this = std::move(src);
 }
 
 PendingEventInfo::~PendingEventInfo() {
-    if (true == cvLock.unique()) {
+    if (true == syncLock.unique()) {
         HSM_TRACE_CALL_DEBUG_ARGS("event=<%d> was deleted. releasing lock", SC2INT(id));
         unlock(HsmEventStatus::DONE_FAILED);
-        cvLock.reset();
-        syncProcessed.reset();
+        syncLock.reset();
     }
+
+    // NOTE: if event was removed without being processed (for example when HSM was released) TransitionCompletion
+    //       reports it as canceled once the last copy of the event is destroyed
 }
 
 PendingEventInfo& PendingEventInfo::operator=(PendingEventInfo&& src) noexcept {
@@ -109,11 +139,14 @@ PendingEventInfo& PendingEventInfo::operator=(PendingEventInfo&& src) noexcept {
         transitionType = src.transitionType;
         id = src.id;
         args = std::move(src.args);
-        cvLock = std::move(src.cvLock);
-        syncProcessed = std::move(src.syncProcessed);
-        transitionStatus = std::move(src.transitionStatus);
+        payload = std::move(src.payload);
+        payloadType = src.payloadType;
+        syncLock = std::move(src.syncLock);
+        onCompleted = std::move(src.onCompleted);
         forcedTransitionsInfo = std::move(src.forcedTransitionsInfo);
         ignoreEntryPoints = src.ignoreEntryPoints;
+        deadlineMs = src.deadlineMs;
+        sequence = src.sequence;
 
         src.id = INVALID_HSM_EVENT_ID;
     }
@@ -121,12 +154,9 @@ PendingEventInfo& PendingEventInfo::operator=(PendingEventInfo&& src) noexcept {
     return *this;
 }
 
-void PendingEventInfo::initLock() {
-    if (!cvLock) {
-        cvLock = std::make_shared<Mutex>();
-        syncProcessed = std::make_shared<ConditionVariable>();
-        transitionStatus = std::make_shared<HsmEventStatus>();
-        *transitionStatus = HsmEventStatus::PENDING;
+void PendingEventInfo::initLock(const std::shared_ptr<SyncEventLock>& lock) {
+    if (!syncLock) {
+        syncLock = lock;
     }
 }
 
@@ -134,50 +164,78 @@ void PendingEventInfo::releaseLock() {
     if (true == isSync()) {
         HSM_TRACE_CALL_DEBUG_ARGS("releaseLock");
         unlock(HsmEventStatus::DONE_FAILED);
-        cvLock.reset();
-        syncProcessed.reset();
+        syncLock.reset();
     }
 }
 
 bool PendingEventInfo::isSync() const {
-    return (nullptr != cvLock);
+    return (nullptr != syncLock);
 }
 
-void PendingEventInfo::wait(const int timeoutMs) {
+HsmEventStatus PendingEventInfo::wait(const int timeoutMs) {
+    HsmEventStatus status = HsmEventStatus::DONE_FAILED;
+
     if (true == isSync()) {
-        // NOTE: lock is needed only because we have to use cond variable
-        UniqueLock lck(*cvLock);
+        SyncEventLock* lock = syncLock.get();
+        UniqueLock lck(lock->sync);
 
-        HSM_TRACE_CALL_DEBUG_ARGS("trying to wait... (current status=%d, %p)",
-                                  SC2INT(*transitionStatus),
-                                  transitionStatus.get());
+        HSM_TRACE_CALL_DEBUG_ARGS("trying to wait... (current status=%d, %p)", SC2INT(lock->status), lock);
         if (timeoutMs > 0) {
             // NOTE: false-positive. "return" statement belongs to lambda function, not parent function
             // cppcheck-suppress [misra-c2012-15.5, misra-c2012-17.7]
-            syncProcessed->wait_for(lck, timeoutMs, [=]() { return (HsmEventStatus::PENDING != *transitionStatus); });
+            lock->processed.wait_for(lck, timeoutMs, [lock]() { return (HsmEventStatus::PENDING != lock->status); });
         } else {
             // NOTE: false-positive. "return" statement belongs to lambda function, not parent function
             // cppcheck-suppress [misra-c2012-15.5, misra-c2012-17.7]
-            syncProcessed->wait(lck, [=]() { return (HsmEventStatus::PENDING != *transitionStatus); });
+            lock->processed.wait(lck, [lock]() { return (HsmEventStatus::PENDING != lock->status); });
         }
 
-        HSM_TRACE_DEBUG("unlocked! transitionStatus=%d", SC2INT(*transitionStatus));
+        status = lock->status;
+        HSM_TRACE_DEBUG("unlocked! transitionStatus=%d", SC2INT(status));
     }
+
+    return status;
 }
 
 void PendingEventInfo::unlock(const HsmEventStatus status) {
     HSM_TRACE_CALL_DEBUG_ARGS("try to unlock with status=%d", SC2INT(status));
 
     if (true == isSync()) {
-        HSM_TRACE_DEBUG("SYNC object (%p)", transitionStatus.get());
-        *transitionStatus = status;
+        HSM_TRACE_DEBUG("SYNC object (%p)", syncLock.get());
+
+        {
+            // NOTE: status must be changed under lock to avoid missing notification while waiter checks it
+            LockGuard lck(syncLock->sync);
+            syncLock->status = status;
+        }
 
         if (status != HsmEventStatus::PENDING) {
-            syncProcessed->notify();
+            syncLock->processed.notify();
         }
     } else {
         HSM_TRACE_DEBUG("ASYNC object");
     }
+
+    if (status != HsmEventStatus::PENDING) {
+        notifyCompleted(status);
+    }
+}
+
+void PendingEventInfo::notifyCompleted(const HsmEventStatus status) {
+    // cppcheck-suppress misra-c2012-14.4 ; false-positive. std::shared_ptr has a bool() operator
+    if (onCompleted) {
+        TransitionResult result = TransitionResult::CANCELED;
+
+        if (HsmEventStatus::DONE_OK == status) {
+            result = TransitionResult::SUCCEEDED;
+        } else if (HsmEventStatus::DONE_FAILED == status) {
+            result = TransitionResult::FAILED;
+        } else {
+            // do nothing
+        }
+
+        onCompleted->notify(result);
+    }
 }
 
 const VariantVector_t& PendingEventInfo::getArgs() const {
@@ -185,4 +243,133 @@ const VariantVector_t& PendingEventInfo::getArgs() const {
     return (args ? *args : empty);
 }
 
-}  // namespace hsmcpp
\ No newline at end of file
+// ============================================================================
+// ActiveStatesSnapshot
+// ============================================================================
+#ifdef STL_AVAILABLE
+
+ActiveStatesSnapshot::Buffer::Buffer(const size_t newCapacity)
+    : capacity(newCapacity)
+    , states(new std::atomic<StateID_t>[newCapacity]()) {}
+
+ActiveStatesSnapshot::ActiveStatesSnapshot()
+    : mSequence(0)
+    , mBuffer(nullptr)
+    , mCount(0) {}
+
+ActiveStatesSnapshot::~ActiveStatesSnapshot() = default;
+
+void ActiveStatesSnapshot::publish(const std::list<StateID_t>& activeStates) {
+    const size_t newCount = activeStates.size();
+    Buffer* buffer = mBuffer.load(std::memory_order_relaxed);
+    const uint32_t sequence = mSequence.load(std::memory_order_relaxed);
+
+    // odd sequence value indicates that update is in progress
+    mSequence.store(sequence + 1U, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    if ((nullptr == buffer) || (buffer->capacity < newCount)) {
+        const size_t newCapacity = ((nullptr != buffer) ? (buffer->capacity * 2U) : 8U);
+
+        mBuffers.emplace_back(new Buffer((newCapacity > newCount) ? newCapacity : newCount));
+        buffer = mBuffers.back().get();
+        // NOTE: release is needed to make buffer initialization visible to readers
+        mBuffer.store(buffer, std::memory_order_release);
+    }
+
+    size_t i = 0;
+
+    for (const StateID_t state : activeStates) {
+        buffer->states[i].store(state, std::memory_order_relaxed);
+        ++i;
+    }
+
+    mCount.store(newCount, std::memory_order_relaxed);
+    mSequence.store(sequence + 2U, std::memory_order_release);
+}
+
+bool ActiveStatesSnapshot::contains(const StateID_t state) const {
+    bool found = false;
+    uint32_t sequence = 0;
+
+    do {
+        sequence = beginRead();
+        const Buffer* buffer = mBuffer.load(std::memory_order_acquire);
+        found = false;
+
+        if (nullptr != buffer) {
+            // NOTE: count could belong to a newer buffer if writer is in progress. result will be discarded anyway
+            const size_t count = mCount.load(std::memory_order_relaxed);
+            const size_t safeCount = ((count < buffer->capacity) ? count : buffer->capacity);
+
+            for (size_t i = 0; (i < safeCount) && (false == found); ++i) {
+                found = (buffer->states[i].load(std::memory_order_relaxed) == state);
+            }
+        }
+    } while (false == endRead(sequence));
+
+    return found;
+}
+
+std::list<StateID_t> ActiveStatesSnapshot::read() const {
+    std::list<StateID_t> states;
+    uint32_t sequence = 0;
+
+    do {
+        sequence = beginRead();
+        const Buffer* buffer = mBuffer.load(std::memory_order_acquire);
+        states.clear();
+
+        if (nullptr != buffer) {
+            const size_t count = mCount.load(std::memory_order_relaxed);
+            const size_t safeCount = ((count < buffer->capacity) ? count : buffer->capacity);
+
+            for (size_t i = 0; i < safeCount; ++i) {
+                states.emplace_back(buffer->states[i].load(std::memory_order_relaxed));
+            }
+        }
+    } while (false == endRead(sequence));
+
+    return states;
+}
+
+uint32_t ActiveStatesSnapshot::beginRead() const {
+    uint32_t sequence = mSequence.load(std::memory_order_acquire);
+
+    while (0U != (sequence & 1U)) {
+        std::this_thread::yield();
+        sequence = mSequence.load(std::memory_order_acquire);
+    }
+
+    return sequence;
+}
+
+bool ActiveStatesSnapshot::endRead(const uint32_t startSequence) const {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return (mSequence.load(std::memory_order_relaxed) == startSequence);
+}
+
+#else  // STL_AVAILABLE
+
+ActiveStatesSnapshot::ActiveStatesSnapshot() = default;
+
+ActiveStatesSnapshot::~ActiveStatesSnapshot() = default;
+
+void ActiveStatesSnapshot::publish(const std::list<StateID_t>& activeStates) {
+    LockGuard lck(mSync);
+    mStates = activeStates;
+}
+
+bool ActiveStatesSnapshot::contains(const StateID_t state) const {
+    LockGuard lck(mSync);
+    return (std::find(mStates.begin(), mStates.end(), state) != mStates.end());
+}
+
+std::list<StateID_t> ActiveStatesSnapshot::read() const {
+    LockGuard lck(mSync);
+    return mStates;
+}
+
+#endif  // STL_AVAILABLE
+
+}  // namespace hsmcpp
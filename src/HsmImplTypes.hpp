@@ -10,10 +10,16 @@
 #include <vector>
 
 #include "hsmcpp/HsmTypes.hpp"
+#include "hsmcpp/os/AtomicFlag.hpp"
 #include "hsmcpp/os/ConditionVariable.hpp"
 #include "hsmcpp/os/Mutex.hpp"
+#include "hsmcpp/os/os.hpp"
 #include "hsmcpp/variant.hpp"
 
+#ifdef STL_AVAILABLE
+  #include <atomic>
+#endif
+
 namespace hsmcpp {
 enum class HsmLogAction {
     IDLE,
@@ -30,6 +36,8 @@ enum class HsmEventStatus { PENDING, DONE_OK, DONE_FAILED, CANCELED };
 
 enum class TransitionBehavior { REGULAR, ENTRYPOINT, FORCED };
 
+enum class PendingEventResult { ADDED, REPLACED, DROPPED };
+
 struct StateCallbacks {
     HsmStateChangedCallback_t onStateChanged = nullptr;
     HsmStateEnterCallback_t onEntering = nullptr;
@@ -78,15 +86,49 @@ struct TransitionInfo {
                    const bool conditionValue);
 };
 
+// completion handshake between synchronous transition caller and dispatcher. objects are reused (see
+// HierarchicalStateMachine::Impl::acquireSyncLock) so they must be reset before each use
+struct SyncEventLock {
+    Mutex sync;
+    ConditionVariable processed;
+    HsmEventStatus status = HsmEventStatus::PENDING;  // protected by sync
+
+    void reset();
+};
+
+// completion callback of an asynchronous transition. shared between all copies of the event. callback is called only
+// once: by the first notify() call or with TransitionResult::CANCELED when the last copy of the event is destroyed
+class TransitionCompletion {
+public:
+    TransitionCompletion(const EventID_t event, HsmTransitionCompletedCallback_t&& callback);
+    ~TransitionCompletion();
+    TransitionCompletion(const TransitionCompletion&) = delete;
+    TransitionCompletion& operator=(const TransitionCompletion&) = delete;
+
+    // thread-safe. only the first call has effect
+    void notify(const TransitionResult result);
+
+private:
+    EventID_t mEvent;
+    HsmTransitionCompletedCallback_t mCallback;
+    AtomicFlag mIsNotified;
+};
+
 struct PendingEventInfo {
     TransitionBehavior transitionType = TransitionBehavior::REGULAR;
     EventID_t id = INVALID_HSM_EVENT_ID;
     std::shared_ptr<VariantVector_t> args;
-    std::shared_ptr<Mutex> cvLock;
-    std::shared_ptr<ConditionVariable> syncProcessed;
-    std::shared_ptr<HsmEventStatus> transitionStatus;
+    // typed payload (see HierarchicalStateMachine::transitionWithPayload). shared between all copies of the event
+    std::shared_ptr<void> payload;
+    PayloadTypeID_t payloadType = nullptr;
+    std::shared_ptr<SyncEventLock> syncLock;
+    // shared between all copies of the event to guarantee that callback is called only once
+    std::shared_ptr<TransitionCompletion> onCompleted;
     std::shared_ptr<std::list<TransitionInfo>> forcedTransitionsInfo;
     bool ignoreEntryPoints = false;
+    uint64_t deadlineMs = 0;  // 0 - event never expires
+    // unique number assigned when event is added to the queue. used to find event after queue lock was released
+    uint64_t sequence = 0;
 
     PendingEventInfo() = default;
     PendingEventInfo(const PendingEventInfo& src) = default;
@@ -96,14 +138,85 @@ struct PendingEventInfo {
     PendingEventInfo& operator=(const PendingEventInfo& src) = default;
     PendingEventInfo& operator=(PendingEventInfo&& src) noexcept;
 
-    void initLock();
+    void initLock(const std::shared_ptr<SyncEventLock>& lock);
     void releaseLock();
     bool isSync() const;
-    void wait(const int timeoutMs = HSM_WAIT_INDEFINITELY);
+    HsmEventStatus wait(const int timeoutMs = HSM_WAIT_INDEFINITELY);
     void unlock(const HsmEventStatus status);
+    // calls onCompleted callback if it wasn't called yet by any copy of this event
+    void notifyCompleted(const HsmEventStatus status);
     const VariantVector_t& getArgs() const;
 };
 
+// Copy of active states which can be read from any thread without blocking HSM dispatcher.
+// Published by a single writer (dispatcher thread) using a sequence lock. All slots are atomic so
+// readers never race with the writer; they just retry if sequence changed during the read.
+// On platforms without STL atomics a mutex is used instead.
+class ActiveStatesSnapshot {
+public:
+    ActiveStatesSnapshot();
+    ~ActiveStatesSnapshot();
+    ActiveStatesSnapshot(const ActiveStatesSnapshot&) = delete;
+    ActiveStatesSnapshot& operator=(const ActiveStatesSnapshot&) = delete;
+
+    // must be called only from a single (dispatcher) thread
+    void publish(const std::list<StateID_t>& activeStates);
+
+    bool contains(const StateID_t state) const;
+    std::list<StateID_t> read() const;
+
+private:
+#ifdef STL_AVAILABLE
+    struct Buffer {
+        explicit Buffer(const size_t newCapacity);
+
+        const size_t capacity;
+        std::unique_ptr<std::atomic<StateID_t>[]> states;
+    };
+
+    // returns sequence value at which reading started (always even)
+    uint32_t beginRead() const;
+    bool endRead(const uint32_t startSequence) const;
+
+    std::atomic<uint32_t> mSequence;
+    std::atomic<Buffer*> mBuffer;
+    std::atomic<size_t> mCount;
+    // NOTE: buffers are never freed before destruction since readers could still access them
+    std::list<std::unique_ptr<Buffer>> mBuffers;
+#else
+    mutable Mutex mSync;
+    std::list<StateID_t> mStates;
+#endif
+};
+
+struct StateWaiterInfo {
+    StateID_t state = INVALID_HSM_STATE_ID;
+    TimerID_t timerID = INVALID_HSM_TIMER_ID;
+    HsmStateWaitCallback_t onCompleted;
+};
+
+// waiter of HierarchicalStateMachine::waitForState(). all blocking waiters share the same condition variable
+struct BlockingStateWaiterInfo {
+    StateID_t state = INVALID_HSM_STATE_ID;
+    bool isDone = false;
+    bool isActive = false;
+};
+
+struct StateSubscriptionInfo {
+    SubscriptionID_t id = INVALID_HSM_SUBSCRIPTION_ID;
+    // NOTE: shared_ptr allows to call callback without holding a lock (even if unsubscribe was called in parallel)
+    std::shared_ptr<HsmStateSubscriptionCallback_t> onChanged;
+};
+
+// timer started by HSM. used to restart timers when HSM is moved to a different dispatcher
+struct RunningTimerInfo {
+    unsigned int intervalMs = 0;
+    bool isSingleShot = false;
+    uint64_t startedAtMs = 0;  // time when timer was started or when it last expired
+    // repeating timer was restarted as singleshot for the remaining time and must be started as repeating after it expires
+    bool resumeRepeating = false;
+};
+
 struct HistoryInfo {
     HistoryType type = HistoryType::SHALLOW;
     StateID_t defaultTarget = INVALID_HSM_STATE_ID;
@@ -0,0 +1,130 @@
+// Copyright (C) 2024 Igor Krechetov
+// Distributed under MIT license. See file LICENSE for details
+
+#include "hsmcpp/HsmMemoryResource.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <new>
+
+namespace hsmcpp {
+
+namespace {
+
+class NewDeleteMemoryResource : public HsmMemoryResource {
+protected:
+    void* doAllocate(const size_t bytes, const size_t alignment) override {
+        (void)alignment;
+        // NOTE: C++11 doesn't have aligned operator new. Memory is aligned for any standard type
+        return ::operator new(bytes);
+    }
+
+    void doDeallocate(void* p, const size_t bytes, const size_t alignment) override {
+        (void)bytes;
+        (void)alignment;
+        ::operator delete(p);
+    }
+};
+
+// returns number of bytes which must be skipped to align ptr
+size_t alignmentPadding(const unsigned char* ptr, const size_t alignment) {
+    const uintptr_t misalignment = reinterpret_cast<uintptr_t>(ptr) % alignment;
+
+    return ((0U == misalignment) ? 0U : (alignment - misalignment));
+}
+
+}  // namespace
+
+// =================================================================================================================
+// HsmMemoryResource
+void* HsmMemoryResource::allocate(const size_t bytes, const size_t alignment) {
+    return doAllocate(bytes, alignment);
+}
+
+void HsmMemoryResource::deallocate(void* p, const size_t bytes, const size_t alignment) {
+    doDeallocate(p, bytes, alignment);
+}
+
+bool HsmMemoryResource::isEqual(const HsmMemoryResource& other) const noexcept {
+    return (this == &other) || (true == doIsEqual(other));
+}
+
+bool HsmMemoryResource::doIsEqual(const HsmMemoryResource& other) const noexcept {
+    return (this == &other);
+}
+
+HsmMemoryResource* getDefaultMemoryResource() {
+    static NewDeleteMemoryResource defaultResource;
+
+    return &defaultResource;
+}
+
+// =================================================================================================================
+// HsmMonotonicMemoryResource
+HsmMonotonicMemoryResource::HsmMonotonicMemoryResource(const size_t initialSize, HsmMemoryResource* upstream)
+    : mUpstream((nullptr != upstream) ? upstream : getDefaultMemoryResource())
+    , mNextBlockSize(std::max(initialSize, sizeof(BlockHeader))) {}
+
+HsmMonotonicMemoryResource::HsmMonotonicMemoryResource(void* buffer, const size_t bufferSize, HsmMemoryResource* upstream)
+    : mUpstream((nullptr != upstream) ? upstream : getDefaultMemoryResource())
+    , mInitialBuffer(buffer)
+    , mInitialBufferSize(bufferSize)
+    , mCurrent(static_cast<unsigned char*>(buffer))
+    , mAvailable(bufferSize)
+    , mNextBlockSize(std::max(bufferSize * 2U, sizeof(BlockHeader))) {}
+
+HsmMonotonicMemoryResource::~HsmMonotonicMemoryResource() {
+    release();
+}
+
+void HsmMonotonicMemoryResource::release() {
+    while (nullptr != mLastBlock) {
+        BlockHeader* previous = mLastBlock->previous;
+
+        mUpstream->deallocate(mLastBlock, mLastBlock->size, alignof(std::max_align_t));
+        mLastBlock = previous;
+    }
+
+    mCurrent = static_cast<unsigned char*>(mInitialBuffer);
+    mAvailable = mInitialBufferSize;
+}
+
+void* HsmMonotonicMemoryResource::doAllocate(const size_t bytes, const size_t alignment) {
+    size_t padding = alignmentPadding(mCurrent, alignment);
+
+    if ((nullptr == mCurrent) || ((padding + bytes) > mAvailable)) {
+        allocateBlock(bytes + alignment);
+        padding = alignmentPadding(mCurrent, alignment);
+    }
+
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    unsigned char* result = mCurrent + padding;
+
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    mCurrent = result + bytes;
+    mAvailable -= (padding + bytes);
+
+    return result;
+}
+
+void HsmMonotonicMemoryResource::doDeallocate(void* p, const size_t bytes, const size_t alignment) {
+    // NOTE: memory is released only when arena is destroyed
+    (void)p;
+    (void)bytes;
+    (void)alignment;
+}
+
+void HsmMonotonicMemoryResource::allocateBlock(const size_t minSize) {
+    const size_t blockSize = std::max(mNextBlockSize, minSize + sizeof(BlockHeader));
+    BlockHeader* block = new (mUpstream->allocate(blockSize, alignof(std::max_align_t))) BlockHeader();
+
+    block->previous = mLastBlock;
+    block->size = blockSize;
+    mLastBlock = block;
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    mCurrent = reinterpret_cast<unsigned char*>(block) + sizeof(BlockHeader);
+    mAvailable = blockSize - sizeof(BlockHeader);
+    mNextBlockSize = blockSize * 2U;
+}
+
+}  // namespace hsmcpp
@@ -0,0 +1,532 @@
+// Copyright (C) 2024 Igor Krechetov
+// Distributed under MIT license. See file LICENSE for details
+
+#include "hsmcpp/HsmSharedEventRing.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <new>
+#include <thread>
+
+#if defined(__linux__)
+  #include <linux/futex.h>
+  #include <sys/syscall.h>
+#else
+  #include <chrono>
+#endif
+
+#include "HsmImpl.hpp"
+#include "hsmcpp/hsm.hpp"
+#include "hsmcpp/logging.hpp"
+#include "hsmcpp/os/LockGuard.hpp"
+#include "hsmcpp/os/Mutex.hpp"
+
+namespace hsmcpp {
+
+constexpr const char* HSM_TRACE_CLASS = "HsmSharedEventRing";
+
+constexpr size_t HsmSharedEventRing::DEFAULT_CAPACITY;
+constexpr size_t HsmSharedEventRing::DEFAULT_MAX_PAYLOAD_SIZE;
+
+namespace {
+
+constexpr uint32_t RING_MAGIC = 0x48534D52U;  // "HSMR"
+constexpr uint32_t RING_VERSION = 1U;
+constexpr size_t RING_MIN_CAPACITY = 2U;
+constexpr size_t CACHE_LINE_SIZE = 64U;
+
+// NOTE: everything below is placed in shared memory. Only address-free (lock-free) atomics can be used here
+struct RingHeader {
+    std::atomic<uint32_t> magic;  // written last by creator
+    uint32_t version;
+    uint32_t capacity;
+    uint32_t maxPayloadSize;
+    uint32_t slotStride;
+
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> enqueuePos;
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> dequeuePos;  // modified only by receiver
+    alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> wakeupSeq;  // futex word
+    std::atomic<uint32_t> receiverWaiting;
+    std::atomic<uint64_t> droppedEvents;
+};
+
+struct SlotHeader {
+    std::atomic<uint64_t> sequence;
+    uint32_t targetId;
+    EventID_t event;
+    uint32_t payloadSize;
+    uint32_t reserved;
+    // payload follows
+};
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "shared memory ring requires lock-free 32-bit atomics");
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "shared memory ring requires lock-free 64-bit atomics");
+
+constexpr size_t alignSize(const size_t value, const size_t alignment) {
+    return ((value + alignment - 1U) / alignment) * alignment;
+}
+
+constexpr size_t ringHeaderSize() {
+    return alignSize(sizeof(RingHeader), CACHE_LINE_SIZE);
+}
+
+size_t slotStrideFor(const size_t maxPayloadSize) {
+    return alignSize(sizeof(SlotHeader) + maxPayloadSize, alignof(SlotHeader));
+}
+
+size_t ringMemorySize(const size_t capacity, const size_t slotStride) {
+    return ringHeaderSize() + (capacity * slotStride);
+}
+
+// checks that ring geometry is consistent and fits into memorySize bytes
+bool isValidGeometry(const size_t capacity, const size_t maxPayloadSize, const size_t slotStride, const size_t memorySize) {
+    return (capacity >= RING_MIN_CAPACITY) && (maxPayloadSize <= UINT32_MAX) && (slotStride == slotStrideFor(maxPayloadSize)) &&
+           (capacity <= ((SIZE_MAX - ringHeaderSize()) / slotStride)) && (ringMemorySize(capacity, slotStride) == memorySize);
+}
+
+void futexWait(std::atomic<uint32_t>* futexWord, const uint32_t expectedValue) {
+#if defined(__linux__)
+    // NOTE: non-private futex is used because the word is shared between processes
+    (void)syscall(SYS_futex, reinterpret_cast<uint32_t*>(futexWord), FUTEX_WAIT, expectedValue, nullptr, nullptr, 0);
+#else
+    (void)futexWord;
+    (void)expectedValue;
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+#endif
+}
+
+void futexWake(std::atomic<uint32_t>* futexWord) {
+#if defined(__linux__)
+    (void)syscall(SYS_futex, reinterpret_cast<uint32_t*>(futexWord), FUTEX_WAKE, 1, nullptr, nullptr, 0);
+#else
+    (void)futexWord;
+#endif
+}
+
+}  // namespace
+
+class HsmSharedEventRing::Impl {
+public:
+    Impl(const std::string& name,
+         const bool isReceiver,
+         void* memory,
+         const size_t memorySize,
+         const size_t capacity,
+         const size_t maxPayloadSize,
+         const struct stat& fileInfo);
+    ~Impl();
+    Impl(const Impl&) = delete;
+    Impl& operator=(const Impl&) = delete;
+
+    SlotHeader* getSlot(const uint64_t pos) const;
+    bool isEmpty() const;
+    void wakeupReceiver();
+    void doReceiving();
+    size_t receiveEvents();
+    void waitForEvents();
+
+    const std::string mName;
+    const bool mIsReceiver;
+    void* const mMemory;
+    const size_t mMemorySize;
+    RingHeader* const mHeader;
+    uint8_t* const mSlots;
+    // NOTE: geometry is validated once and cached. Header in shared memory could be modified by other processes, so it
+    //       must not be used to calculate addresses
+    const size_t mCapacity;
+    const size_t mMaxPayloadSize;
+    const size_t mSlotStride;
+    // identity of shared memory object. Name could be reused by a new ring if this one was replaced
+    const dev_t mDevice;
+    const ino_t mInode;
+
+    std::map<uint32_t, std::weak_ptr<HierarchicalStateMachine::Impl>> mTargets;  // protected by mSync
+    Mutex mSync;
+    std::thread mReceiverThread;
+    std::atomic<bool> mIsReceiving{false};
+    std::atomic<uint64_t> mUndeliveredEvents{0};
+};
+
+HsmSharedEventRing::Impl::Impl(const std::string& name,
+                               const bool isReceiver,
+                               void* memory,
+                               const size_t memorySize,
+                               const size_t capacity,
+                               const size_t maxPayloadSize,
+                               const struct stat& fileInfo)
+    : mName(name)
+    , mIsReceiver(isReceiver)
+    , mMemory(memory)
+    , mMemorySize(memorySize)
+    , mHeader(static_cast<RingHeader*>(memory))
+    , mSlots(static_cast<uint8_t*>(memory) + ringHeaderSize())
+    , mCapacity(capacity)
+    , mMaxPayloadSize(maxPayloadSize)
+    , mSlotStride(slotStrideFor(maxPayloadSize))
+    , mDevice(fileInfo.st_dev)
+    , mInode(fileInfo.st_ino) {}
+
+HsmSharedEventRing::Impl::~Impl() {
+    (void)munmap(mMemory, mMemorySize);
+
+    if (true == mIsReceiver) {
+        // NOTE: ring could have been replaced by create(replaceExisting=true). In this case name belongs to the new ring
+        //       and must not be removed
+        const int fd = shm_open(mName.c_str(), O_RDONLY, 0);
+
+        if (fd >= 0) {
+            struct stat info = {};
+            const bool isSameObject = ((0 == fstat(fd, &info)) && (mDevice == info.st_dev) && (mInode == info.st_ino));
+
+            (void)close(fd);
+
+            if (true == isSameObject) {
+                (void)shm_unlink(mName.c_str());
+            } else {
+                HSM_TRACE_DEBUG("shared memory <%s> was replaced. skip unlink", mName.c_str());
+            }
+        }
+    }
+}
+
+SlotHeader* HsmSharedEventRing::Impl::getSlot(const uint64_t pos) const {
+    return reinterpret_cast<SlotHeader*>(mSlots + ((pos % mCapacity) * mSlotStride));
+}
+
+bool HsmSharedEventRing::Impl::isEmpty() const {
+    const uint64_t pos = mHeader->dequeuePos.load(std::memory_order_relaxed);
+
+    return (getSlot(pos)->sequence.load(std::memory_order_acquire) != (pos + 1U));
+}
+
+void HsmSharedEventRing::Impl::wakeupReceiver() {
+    (void)mHeader->wakeupSeq.fetch_add(1U, std::memory_order_release);
+    futexWake(&mHeader->wakeupSeq);
+}
+
+void HsmSharedEventRing::Impl::doReceiving() {
+    HSM_TRACE_CALL_DEBUG();
+
+    while (true == mIsReceiving.load(std::memory_order_acquire)) {
+        if (0U == receiveEvents()) {
+            waitForEvents();
+        }
+    }
+}
+
+size_t HsmSharedEventRing::Impl::receiveEvents() {
+    size_t receivedCount = 0;
+    uint64_t pos = mHeader->dequeuePos.load(std::memory_order_relaxed);
+    SlotHeader* slot = getSlot(pos);
+
+    while ((receivedCount < mCapacity) && (slot->sequence.load(std::memory_order_acquire) == (pos + 1U))) {
+        const uint32_t targetId = slot->targetId;
+        const EventID_t event = slot->event;
+        // NOTE: slot is written by other processes. Value is read once so that it can't change after validation
+        const size_t payloadSize = slot->payloadSize;
+        const bool isValidSlot = (payloadSize <= mMaxPayloadSize);
+        VariantVector_t args;
+
+        if ((true == isValidSlot) && (payloadSize > 0U)) {
+            const uint8_t* payload = reinterpret_cast<const uint8_t*>(slot) + sizeof(SlotHeader);
+
+            args.emplace_back(ByteArray_t(payload, payload + payloadSize));
+        }
+
+        // release slot to producers before delivering the event
+        slot->sequence.store(pos + mCapacity, std::memory_order_release);
+        ++pos;
+        mHeader->dequeuePos.store(pos, std::memory_order_relaxed);
+        ++receivedCount;
+
+        std::shared_ptr<HierarchicalStateMachine::Impl> target;
+
+        if (false == isValidSlot) {
+            HSM_TRACE_ERROR("discarded event with invalid payload size %lu (target=%u)", payloadSize, targetId);
+        } else {
+            LockGuard lck(mSync);
+            auto it = mTargets.find(targetId);
+
+            if (mTargets.end() != it) {
+                target = it->second.lock();
+            }
+        }
+
+        // NOTE: HSM is called without holding mSync
+        // cppcheck-suppress misra-c2012-14.4 ; false-positive. std::shared_ptr has a bool() operator
+        if (target) {
+            target->transitionWithArgsArray(event, std::move(args));
+        } else {
+            HSM_TRACE_WARNING("event wasn't delivered to target=%u", targetId);
+            (void)mUndeliveredEvents.fetch_add(1U, std::memory_order_relaxed);
+        }
+
+        slot = getSlot(pos);
+    }
+
+    return receivedCount;
+}
+
+void HsmSharedEventRing::Impl::waitForEvents() {
+    const uint32_t wakeupSeq = mHeader->wakeupSeq.load(std::memory_order_acquire);
+
+    // NOTE: pairs with the fence in post(). Either producer sees receiverWaiting flag and wakes us up or we see its event
+    mHeader->receiverWaiting.store(1U, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if ((true == isEmpty()) && (true == mIsReceiving.load(std::memory_order_acquire))) {
+        futexWait(&mHeader->wakeupSeq, wakeupSeq);
+    }
+
+    mHeader->receiverWaiting.store(0U, std::memory_order_relaxed);
+}
+
+// ============================================================================================================
+std::shared_ptr<HsmSharedEventRing> HsmSharedEventRing::create(const std::string& name,
+                                                               const size_t capacity,
+                                                               const size_t maxPayloadSize,
+                                                               const bool replaceExisting) {
+    HSM_TRACE_CALL_DEBUG_ARGS("name=%s, capacity=%lu, maxPayloadSize=%lu, replaceExisting=%d",
+                              name.c_str(),
+                              capacity,
+                              maxPayloadSize,
+                              BOOL2INT(replaceExisting));
+    std::shared_ptr<HsmSharedEventRing> ring;
+    const size_t ringCapacity = ((capacity < RING_MIN_CAPACITY) ? RING_MIN_CAPACITY : capacity);
+    const size_t slotStride = slotStrideFor(maxPayloadSize);
+    const size_t memorySize = ringMemorySize(ringCapacity, slotStride);
+    int fd = -1;
+
+    if ((ringCapacity > UINT32_MAX) || (false == isValidGeometry(ringCapacity, maxPayloadSize, slotStride, memorySize))) {
+        HSM_TRACE_ERROR("invalid ring geometry (capacity=%lu, maxPayloadSize=%lu)", ringCapacity, maxPayloadSize);
+        errno = EINVAL;
+    } else {
+        if (true == replaceExisting) {
+            // remove leftovers of a receiver which didn't exit properly
+            (void)shm_unlink(name.c_str());
+        }
+
+        fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR);
+    }
+
+    if (fd >= 0) {
+        struct stat info = {};
+        void* memory = MAP_FAILED;
+
+        if ((0 == fstat(fd, &info)) && (0 == ftruncate(fd, static_cast<off_t>(memorySize)))) {
+            memory = mmap(nullptr, memorySize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        }
+
+        (void)close(fd);
+
+        if (MAP_FAILED != memory) {
+            RingHeader* header = new (memory) RingHeader();
+
+            header->version = RING_VERSION;
+            header->capacity = static_cast<uint32_t>(ringCapacity);
+            header->maxPayloadSize = static_cast<uint32_t>(maxPayloadSize);
+            header->slotStride = static_cast<uint32_t>(slotStride);
+            header->enqueuePos.store(0U, std::memory_order_relaxed);
+            header->dequeuePos.store(0U, std::memory_order_relaxed);
+            header->wakeupSeq.store(0U, std::memory_order_relaxed);
+            header->receiverWaiting.store(0U, std::memory_order_relaxed);
+            header->droppedEvents.store(0U, std::memory_order_relaxed);
+
+            auto impl = std::make_shared<Impl>(name, true, memory, memorySize, ringCapacity, maxPayloadSize, info);
+
+            for (size_t i = 0; i < ringCapacity; ++i) {
+                SlotHeader* slot = new (impl->getSlot(i)) SlotHeader();
+
+                slot->sequence.store(i, std::memory_order_relaxed);
+            }
+
+            // publish initialized ring to other processes
+            header->magic.store(RING_MAGIC, std::memory_order_release);
+            ring = std::shared_ptr<HsmSharedEventRing>(new HsmSharedEventRing(impl));
+        } else {
+            HSM_TRACE_ERROR("failed to map shared memory <%s>", name.c_str());
+            (void)shm_unlink(name.c_str());
+        }
+    } else if (EEXIST == errno) {
+        HSM_TRACE_ERROR("shared memory <%s> already exists", name.c_str());
+        // NOTE: restore errno in case it was modified by logging
+        errno = EEXIST;
+    } else {
+        HSM_TRACE_ERROR("failed to create shared memory <%s>", name.c_str());
+    }
+
+    return ring;
+}
+
+std::shared_ptr<HsmSharedEventRing> HsmSharedEventRing::open(const std::string& name) {
+    HSM_TRACE_CALL_DEBUG_ARGS("name=%s", name.c_str());
+    std::shared_ptr<HsmSharedEventRing> ring;
+    const int fd = shm_open(name.c_str(), O_RDWR, 0);
+
+    if (fd >= 0) {
+        struct stat info = {};
+        void* memory = MAP_FAILED;
+        size_t memorySize = 0;
+
+        if ((0 == fstat(fd, &info)) && (static_cast<size_t>(info.st_size) >= ringHeaderSize())) {
+            memorySize = static_cast<size_t>(info.st_size);
+            memory = mmap(nullptr, memorySize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        }
+
+        (void)close(fd);
+
+        if (MAP_FAILED != memory) {
+            const RingHeader* header = static_cast<const RingHeader*>(memory);
+            const bool isInitialized = (RING_MAGIC == header->magic.load(std::memory_order_acquire)) &&
+                                       (RING_VERSION == header->version);
+            // NOTE: geometry is read only once. Impl uses validated copy of these values
+            const size_t capacity = header->capacity;
+            const size_t maxPayloadSize = header->maxPayloadSize;
+            const size_t slotStride = header->slotStride;
+
+            if ((true == isInitialized) && (true == isValidGeometry(capacity, maxPayloadSize, slotStride, memorySize))) {
+                ring = std::shared_ptr<HsmSharedEventRing>(new HsmSharedEventRing(
+                    std::make_shared<Impl>(name, false, memory, memorySize, capacity, maxPayloadSize, info)));
+            } else {
+                HSM_TRACE_ERROR("shared memory <%s> is not a valid ring", name.c_str());
+                (void)munmap(memory, memorySize);
+            }
+        }
+    } else {
+        HSM_TRACE_ERROR("failed to open shared memory <%s>", name.c_str());
+    }
+
+    return ring;
+}
+
+HsmSharedEventRing::HsmSharedEventRing(const std::shared_ptr<Impl>& impl)
+    : mImpl(impl) {}
+
+HsmSharedEventRing::~HsmSharedEventRing() {
+    stopReceiving();
+}
+
+bool HsmSharedEventRing::isReceiver() const {
+    return mImpl->mIsReceiver;
+}
+
+size_t HsmSharedEventRing::capacity() const {
+    return mImpl->mCapacity;
+}
+
+size_t HsmSharedEventRing::maxPayloadSize() const {
+    return mImpl->mMaxPayloadSize;
+}
+
+bool HsmSharedEventRing::post(const uint32_t targetId, const EventID_t event, const void* payload, const size_t payloadSize) {
+    RingHeader* header = mImpl->mHeader;
+    SlotHeader* slot = nullptr;
+    bool isFull = false;
+
+    if ((payloadSize <= mImpl->mMaxPayloadSize) && ((nullptr != payload) || (0U == payloadSize))) {
+        uint64_t pos = header->enqueuePos.load(std::memory_order_relaxed);
+
+        while ((nullptr == slot) && (false == isFull)) {
+            SlotHeader* candidate = mImpl->getSlot(pos);
+            const uint64_t sequence = candidate->sequence.load(std::memory_order_acquire);
+            const int64_t diff = static_cast<int64_t>(sequence) - static_cast<int64_t>(pos);
+
+            if (0 == diff) {
+                if (true == header->enqueuePos.compare_exchange_weak(pos, pos + 1U, std::memory_order_relaxed)) {
+                    slot = candidate;
+                }
+            } else if (diff < 0) {
+                isFull = true;
+            } else {
+                pos = header->enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        if (nullptr != slot) {
+            slot->targetId = targetId;
+            slot->event = event;
+            slot->payloadSize = static_cast<uint32_t>(payloadSize);
+
+            if (payloadSize > 0U) {
+                (void)memcpy(reinterpret_cast<uint8_t*>(slot) + sizeof(SlotHeader), payload, payloadSize);
+            }
+
+            slot->sequence.store(pos + 1U, std::memory_order_release);
+
+            // NOTE: pairs with the fence in waitForEvents(). Syscall is made only if receiver is sleeping
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            if (0U != header->receiverWaiting.load(std::memory_order_relaxed)) {
+                mImpl->wakeupReceiver();
+            }
+        } else {
+            (void)header->droppedEvents.fetch_add(1U, std::memory_order_relaxed);
+        }
+    }
+
+    return (nullptr != slot);
+}
+
+bool HsmSharedEventRing::bindTarget(const uint32_t targetId, HierarchicalStateMachine& hsm) {
+    bool result = false;
+
+    if (true == mImpl->mIsReceiver) {
+        LockGuard lck(mImpl->mSync);
+
+        result = mImpl->mTargets.emplace(targetId, hsm.mImpl).second;
+    }
+
+    return result;
+}
+
+void HsmSharedEventRing::unbindTarget(const uint32_t targetId) {
+    LockGuard lck(mImpl->mSync);
+
+    (void)mImpl->mTargets.erase(targetId);
+}
+
+bool HsmSharedEventRing::startReceiving() {
+    HSM_TRACE_CALL_DEBUG();
+    bool result = false;
+
+    if ((true == mImpl->mIsReceiver) && (false == mImpl->mReceiverThread.joinable())) {
+        mImpl->mIsReceiving.store(true, std::memory_order_release);
+        mImpl->mReceiverThread = std::thread(&HsmSharedEventRing::Impl::doReceiving, mImpl.get());
+        result = mImpl->mReceiverThread.joinable();
+    }
+
+    return result;
+}
+
+void HsmSharedEventRing::stopReceiving() {
+    HSM_TRACE_CALL_DEBUG();
+
+    if (true == mImpl->mReceiverThread.joinable()) {
+        mImpl->mIsReceiving.store(false, std::memory_order_release);
+        mImpl->wakeupReceiver();
+        mImpl->mReceiverThread.join();
+    }
+}
+
+EventsQueueStats HsmSharedEventRing::getStats() const {
+    EventsQueueStats stats;
+    const RingHeader* header = mImpl->mHeader;
+    const uint64_t enqueuePos = header->enqueuePos.load(std::memory_order_relaxed);
+    const uint64_t dequeuePos = header->dequeuePos.load(std::memory_order_relaxed);
+
+    stats.pendingEvents = ((enqueuePos > dequeuePos) ? static_cast<size_t>(enqueuePos - dequeuePos) : 0U);
+    stats.droppedEvents = header->droppedEvents.load(std::memory_order_relaxed) +
+                          mImpl->mUndeliveredEvents.load(std::memory_order_relaxed);
+
+    return stats;
+}
+
+}  // namespace hsmcpp
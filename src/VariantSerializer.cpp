@@ -0,0 +1,731 @@
+// Copyright (C) 2024 Igor Krechetov
+// Distributed under MIT license. See file LICENSE for details
+
+#include "hsmcpp/VariantSerializer.hpp"
+
+#include <cstring>
+
+namespace hsmcpp {
+
+constexpr unsigned char VariantSerializer::FORMAT_VERSION;
+constexpr unsigned int VariantSerializer::MAX_NESTING_DEPTH;
+
+namespace {
+
+constexpr size_t VARINT_MAX_BYTES = 10U;
+constexpr size_t DOUBLE_SIZE = 8U;
+
+void writeVarint(uint64_t value, ByteArray_t& output) {
+    while (value >= 0x80U) {
+        output.push_back(static_cast<unsigned char>(value | 0x80U));
+        value >>= 7U;
+    }
+
+    output.push_back(static_cast<unsigned char>(value));
+}
+
+// returns number of consumed bytes or 0 if data is malformed
+size_t readVarint(const unsigned char* data, const size_t size, uint64_t& value) {
+    size_t consumed = 0;
+    bool completed = false;
+
+    value = 0;
+
+    while ((false == completed) && (consumed < size) && (consumed < VARINT_MAX_BYTES)) {
+        const uint64_t curByte = data[consumed];
+
+        value |= (curByte & 0x7FU) << (7U * consumed);
+        completed = (0U == (curByte & 0x80U));
+        ++consumed;
+    }
+
+    return ((true == completed) ? consumed : 0U);
+}
+
+inline uint64_t zigzagEncode(const int64_t value) {
+    return (static_cast<uint64_t>(value) << 1U) ^ static_cast<uint64_t>(value >> 63);
+}
+
+inline int64_t zigzagDecode(const uint64_t value) {
+    return static_cast<int64_t>(value >> 1U) ^ -static_cast<int64_t>(value & 1U);
+}
+
+void writeDouble(const double value, ByteArray_t& output) {
+    uint64_t bits = 0;
+
+    (void)memcpy(&bits, &value, sizeof(bits));
+
+    for (size_t i = 0; i < DOUBLE_SIZE; ++i) {
+        output.push_back(static_cast<unsigned char>(bits >> (8U * i)));
+    }
+}
+
+double readDouble(const uint64_t bits) {
+    double value = 0.0;
+
+    (void)memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+void writeBytes(const unsigned char* data, const size_t size, ByteArray_t& output) {
+    writeVarint(size, output);
+
+    if (size > 0U) {
+        output.insert(output.end(), data, data + size);
+    }
+}
+
+inline bool isContainerType(const Variant::Type type) {
+    return (Variant::Type::LIST == type) || (Variant::Type::VECTOR == type) || (Variant::Type::MAP == type) ||
+           (Variant::Type::PAIR == type);
+}
+
+// reads value header (type, scalar value, payload size or items count). For containers payload points to the first item.
+// returns number of consumed bytes or 0 if data is malformed
+size_t readHeader(const unsigned char* data, const size_t size, Variant::Type& type, uint64_t& scalar, uint64_t& length) {
+    size_t consumed = 0;
+
+    scalar = 0;
+    length = 0;
+
+    if ((size > 0U) && (data[0] <= static_cast<unsigned char>(Variant::Type::CUSTOM))) {
+        const unsigned char* cursor = data + 1;
+        const size_t available = size - 1U;
+
+        type = static_cast<Variant::Type>(data[0]);
+
+        switch (type) {
+            case Variant::Type::UNKNOWN:
+                consumed = 1U;
+                break;
+            case Variant::Type::BYTE_1:
+            case Variant::Type::BYTE_2:
+            case Variant::Type::BYTE_4:
+            case Variant::Type::BYTE_8:
+            case Variant::Type::UBYTE_1:
+            case Variant::Type::UBYTE_2:
+            case Variant::Type::UBYTE_4:
+            case Variant::Type::UBYTE_8: {
+                const size_t varintSize = readVarint(cursor, available, scalar);
+
+                consumed = ((varintSize > 0U) ? (1U + varintSize) : 0U);
+                break;
+            }
+            case Variant::Type::DOUBLE:
+                if (available >= DOUBLE_SIZE) {
+                    for (size_t i = 0; i < DOUBLE_SIZE; ++i) {
+                        scalar |= static_cast<uint64_t>(cursor[i]) << (8U * i);
+                    }
+
+                    consumed = 1U + DOUBLE_SIZE;
+                }
+                break;
+            case Variant::Type::BOOL:
+                if ((available > 0U) && (cursor[0] <= 1U)) {
+                    scalar = cursor[0];
+                    consumed = 2U;
+                }
+                break;
+            case Variant::Type::STRING:
+            case Variant::Type::BYTEARRAY:
+            case Variant::Type::CUSTOM: {
+                const size_t varintSize = readVarint(cursor, available, length);
+
+                if ((varintSize > 0U) && (length <= (available - varintSize))) {
+                    consumed = 1U + varintSize;
+                }
+                break;
+            }
+            case Variant::Type::LIST:
+            case Variant::Type::VECTOR:
+            case Variant::Type::MAP: {
+                const size_t varintSize = readVarint(cursor, available, length);
+                const uint64_t encodedItems = ((Variant::Type::MAP == type) ? (length * 2U) : length);
+
+                // NOTE: each item takes at least 1 byte. this protects from huge allocations caused by malformed data
+                if ((varintSize > 0U) && (length <= (available - varintSize)) && (encodedItems <= (available - varintSize))) {
+                    consumed = 1U + varintSize;
+                }
+                break;
+            }
+            case Variant::Type::PAIR:
+                length = 1U;
+                consumed = 1U;
+                break;
+            default:
+                // do nothing
+                break;
+        }
+    }
+
+    return consumed;
+}
+
+// number of encoded child values
+inline size_t getChildrenCount(const Variant::Type type, const uint64_t length) {
+    size_t count = 0;
+
+    if ((Variant::Type::MAP == type) || (Variant::Type::PAIR == type)) {
+        count = static_cast<size_t>(length * 2U);
+    } else if (true == isContainerType(type)) {
+        count = static_cast<size_t>(length);
+    } else {
+        // do nothing
+    }
+
+    return count;
+}
+
+}  // namespace
+
+// =================================================================================================================
+// VariantView
+VariantView VariantView::parse(const unsigned char* data, const size_t size) {
+    VariantView view;
+
+    if ((nullptr != data) && (size > 1U) && (VariantSerializer::FORMAT_VERSION == data[0])) {
+        if (0U == parseValue(data + 1, size - 1U, 0, view)) {
+            view = VariantView();
+        }
+    }
+
+    return view;
+}
+
+size_t VariantView::parseValue(const unsigned char* data, const size_t size, const unsigned int depth, VariantView& view) {
+    uint64_t length = 0;
+    size_t consumed = readHeader(data, size, view.mType, view.mScalar, length);
+
+    if (consumed > 0U) {
+        view.mEncoded = data;
+        view.mPayload = data + consumed;
+
+        if (true == isContainerType(view.mType)) {
+            view.mCount = getChildrenCount(view.mType, length);
+
+            if (depth < VariantSerializer::MAX_NESTING_DEPTH) {
+                size_t itemsSize = 0;
+                size_t i = 0;
+
+                while ((consumed > 0U) && (i < view.mCount)) {
+                    VariantView item;
+                    const size_t itemSize = parseValue(view.mPayload + itemsSize, size - consumed - itemsSize, depth + 1U, item);
+
+                    if (itemSize > 0U) {
+                        itemsSize += itemSize;
+                        ++i;
+                    } else {
+                        consumed = 0;
+                    }
+                }
+
+                view.mPayloadSize = itemsSize;
+            } else {
+                consumed = 0;
+            }
+        } else {
+            view.mCount = 0;
+            view.mPayloadSize = static_cast<size_t>(length);
+        }
+
+        if (consumed > 0U) {
+            consumed += view.mPayloadSize;
+            view.mEncodedSize = consumed;
+        }
+    }
+
+    return consumed;
+}
+
+bool VariantView::isValid() const {
+    return (nullptr != mEncoded);
+}
+
+Variant::Type VariantView::getType() const {
+    return mType;
+}
+
+int64_t VariantView::toInt64() const {
+    int64_t result = 0;
+
+    switch (mType) {
+        case Variant::Type::BYTE_1:
+        case Variant::Type::BYTE_2:
+        case Variant::Type::BYTE_4:
+        case Variant::Type::BYTE_8:
+            result = zigzagDecode(mScalar);
+            break;
+        case Variant::Type::UBYTE_1:
+        case Variant::Type::UBYTE_2:
+        case Variant::Type::UBYTE_4:
+        case Variant::Type::UBYTE_8:
+        case Variant::Type::BOOL:
+            result = static_cast<int64_t>(mScalar);
+            break;
+        case Variant::Type::DOUBLE:
+            result = static_cast<int64_t>(readDouble(mScalar));
+            break;
+        default:
+            // do nothing
+            break;
+    }
+
+    return result;
+}
+
+uint64_t VariantView::toUInt64() const {
+    uint64_t result = 0;
+
+    if (Variant::Type::DOUBLE == mType) {
+        result = static_cast<uint64_t>(readDouble(mScalar));
+    } else {
+        result = static_cast<uint64_t>(toInt64());
+    }
+
+    return result;
+}
+
+double VariantView::toDouble() const {
+    double result = 0.0;
+
+    if (Variant::Type::DOUBLE == mType) {
+        result = readDouble(mScalar);
+    } else if ((Variant::Type::UBYTE_1 <= mType) && (Variant::Type::UBYTE_8 >= mType)) {
+        result = static_cast<double>(mScalar);
+    } else {
+        result = static_cast<double>(toInt64());
+    }
+
+    return result;
+}
+
+bool VariantView::toBool() const {
+    return (0 != toInt64()) || ((Variant::Type::DOUBLE == mType) && (0.0 != readDouble(mScalar)));
+}
+
+std::string VariantView::toString() const {
+    std::string result;
+
+    if (Variant::Type::STRING == mType) {
+        result.assign(reinterpret_cast<const char*>(mPayload), mPayloadSize);
+    }
+
+    return result;
+}
+
+const unsigned char* VariantView::data() const {
+    const unsigned char* result = nullptr;
+
+    if ((Variant::Type::STRING == mType) || (Variant::Type::BYTEARRAY == mType) || (Variant::Type::CUSTOM == mType)) {
+        result = mPayload;
+    }
+
+    return result;
+}
+
+size_t VariantView::size() const {
+    return ((nullptr != data()) ? mPayloadSize : 0U);
+}
+
+size_t VariantView::count() const {
+    size_t result = 0;
+
+    if ((Variant::Type::LIST == mType) || (Variant::Type::VECTOR == mType)) {
+        result = mCount;
+    } else if (Variant::Type::MAP == mType) {
+        result = mCount / 2U;
+    } else {
+        // do nothing
+    }
+
+    return result;
+}
+
+VariantView VariantView::at(const size_t index) const {
+    return (((Variant::Type::LIST == mType) || (Variant::Type::VECTOR == mType)) ? child(index) : VariantView());
+}
+
+VariantView VariantView::key(const size_t index) const {
+    return ((Variant::Type::MAP == mType) ? child(index * 2U) : VariantView());
+}
+
+VariantView VariantView::value(const size_t index) const {
+    return ((Variant::Type::MAP == mType) ? child((index * 2U) + 1U) : VariantView());
+}
+
+VariantView VariantView::first() const {
+    return ((Variant::Type::PAIR == mType) ? child(0U) : VariantView());
+}
+
+VariantView VariantView::second() const {
+    return ((Variant::Type::PAIR == mType) ? child(1U) : VariantView());
+}
+
+size_t VariantView::encodedSize() const {
+    return mEncodedSize;
+}
+
+VariantViewIterator VariantView::begin() const {
+    return (true == isContainerType(mType)) ? VariantViewIterator(mPayload, mPayloadSize, mCount) : VariantViewIterator();
+}
+
+VariantViewIterator VariantView::end() const {
+    return VariantViewIterator();
+}
+
+VariantView VariantView::child(const size_t index) const {
+    VariantView item;
+
+    if (index < mCount) {
+        VariantViewIterator it = begin();
+
+        for (size_t i = 0; i < index; ++i) {
+            ++it;
+        }
+
+        item = *it;
+    }
+
+    return item;
+}
+
+// =================================================================================================================
+// VariantViewIterator
+VariantViewIterator::VariantViewIterator(const unsigned char* data, const size_t size, const size_t itemsCount)
+    : mData(data)
+    , mSize(size)
+    , mItemsLeft(itemsCount) {
+    parseItem();
+}
+
+void VariantViewIterator::parseItem() {
+    mItem = VariantView();
+
+    if (mItemsLeft > 0U) {
+        // NOTE: data was validated when parent view was created so items can't fail to parse
+        (void)VariantView::parseValue(mData, mSize, 0, mItem);
+    }
+}
+
+VariantViewIterator::reference VariantViewIterator::operator*() const {
+    return mItem;
+}
+
+VariantViewIterator::pointer VariantViewIterator::operator->() const {
+    return &mItem;
+}
+
+VariantViewIterator& VariantViewIterator::operator++() {
+    if (mItemsLeft > 0U) {
+        mData += mItem.mEncodedSize;
+        mSize -= mItem.mEncodedSize;
+        --mItemsLeft;
+        parseItem();
+    }
+
+    return *this;
+}
+
+VariantViewIterator VariantViewIterator::operator++(int) {
+    VariantViewIterator prev = *this;
+
+    (void)++(*this);
+    return prev;
+}
+
+bool VariantViewIterator::operator==(const VariantViewIterator& other) const {
+    // NOTE: end iterator doesn't point to any item
+    return (mItem.mEncoded == other.mItem.mEncoded);
+}
+
+bool VariantViewIterator::operator!=(const VariantViewIterator& other) const {
+    return (false == (*this == other));
+}
+
+// =================================================================================================================
+// VariantSerializer
+VariantSerializer::VariantSerializer(const CustomEncoderFunc_t& encoder, const CustomDecoderFunc_t& decoder)
+    : mCustomEncoder(encoder)
+    , mCustomDecoder(decoder) {}
+
+void VariantSerializer::setCustomTypeHandlers(const CustomEncoderFunc_t& encoder, const CustomDecoderFunc_t& decoder) {
+    mCustomEncoder = encoder;
+    mCustomDecoder = decoder;
+}
+
+bool VariantSerializer::serialize(const Variant& value, ByteArray_t& output) const {
+    const size_t originalSize = output.size();
+
+    output.push_back(FORMAT_VERSION);
+
+    const bool result = encodeValue(value, 0, output);
+
+    if (false == result) {
+        output.resize(originalSize);
+    }
+
+    return result;
+}
+
+bool VariantSerializer::serialize(const VariantVector_t& values, ByteArray_t& output) const {
+    const size_t originalSize = output.size();
+
+    output.push_back(FORMAT_VERSION);
+
+    const bool result = encodeVector(values, 0, output);
+
+    if (false == result) {
+        output.resize(originalSize);
+    }
+
+    return result;
+}
+
+bool VariantSerializer::deserialize(const unsigned char* data, const size_t size, Variant& output) const {
+    return toVariant(VariantView::parse(data, size), output);
+}
+
+bool VariantSerializer::deserialize(const unsigned char* data, const size_t size, VariantVector_t& output) const {
+    bool result = false;
+    const VariantView view = VariantView::parse(data, size);
+
+    if (Variant::Type::VECTOR == view.getType()) {
+        Variant decoded;
+
+        if (true == toVariant(view, decoded)) {
+            output = std::move(*decoded.getVector());
+            result = true;
+        }
+    }
+
+    return result;
+}
+
+bool VariantSerializer::toVariant(const VariantView& view, Variant& output) const {
+    bool result = view.isValid();
+    // NOTE: invalid view has Type::UNKNOWN. output is not modified in this case
+    const Variant::Type type = ((true == result) ? view.mType : Variant::Type::CUSTOM);
+
+    switch (type) {
+        case Variant::Type::UNKNOWN:
+            output.clear();
+            break;
+        case Variant::Type::BYTE_1:
+            output = static_cast<int8_t>(view.toInt64());
+            break;
+        case Variant::Type::BYTE_2:
+            output = static_cast<int16_t>(view.toInt64());
+            break;
+        case Variant::Type::BYTE_4:
+            output = static_cast<int32_t>(view.toInt64());
+            break;
+        case Variant::Type::BYTE_8:
+            output = view.toInt64();
+            break;
+        case Variant::Type::UBYTE_1:
+            output = static_cast<uint8_t>(view.mScalar);
+            break;
+        case Variant::Type::UBYTE_2:
+            output = static_cast<uint16_t>(view.mScalar);
+            break;
+        case Variant::Type::UBYTE_4:
+            output = static_cast<uint32_t>(view.mScalar);
+            break;
+        case Variant::Type::UBYTE_8:
+            output = view.mScalar;
+            break;
+        case Variant::Type::DOUBLE:
+            output = view.toDouble();
+            break;
+        case Variant::Type::BOOL:
+            output = view.toBool();
+            break;
+        case Variant::Type::STRING:
+            output = view.toString();
+            break;
+        case Variant::Type::BYTEARRAY:
+            output = ByteArray_t(view.mPayload, view.mPayload + view.mPayloadSize);
+            break;
+        case Variant::Type::LIST:
+        case Variant::Type::VECTOR:
+        case Variant::Type::MAP:
+        case Variant::Type::PAIR: {
+            std::vector<Variant> items;
+
+            items.reserve(view.mCount);
+
+            for (auto it = view.begin(); (true == result) && (it != view.end()); ++it) {
+                items.emplace_back();
+                result = toVariant(*it, items.back());
+            }
+
+            if (true == result) {
+                if (Variant::Type::VECTOR == view.mType) {
+                    output = Variant(VariantVector_t());
+                    *output.getVector() = std::move(items);
+                } else if (Variant::Type::LIST == view.mType) {
+                    output = Variant(VariantList_t());
+                    output.getList()->assign(std::make_move_iterator(items.begin()), std::make_move_iterator(items.end()));
+                } else if (Variant::Type::MAP == view.mType) {
+                    std::shared_ptr<VariantMap_t> map;
+
+                    output = Variant(VariantMap_t());
+                    map = output.getMap();
+                    map->reserve(items.size() / 2U);
+
+                    for (size_t i = 0; i < items.size(); i += 2U) {
+                        (void)map->emplace(std::move(items[i]), std::move(items[i + 1U]));
+                    }
+                } else {
+                    output = Variant(std::make_pair(std::move(items[0]), std::move(items[1])));
+                }
+            }
+            break;
+        }
+        case Variant::Type::CUSTOM:
+            // cppcheck-suppress misra-c2012-14.4 ; false-positive. std::function has a bool() operator
+            result = (result && mCustomDecoder && mCustomDecoder(view.mPayload, view.mPayloadSize, output));
+            break;
+        default:
+            result = false;
+            break;
+    }
+
+    return result;
+}
+
+bool VariantSerializer::encodeValue(const Variant& value, const unsigned int depth, ByteArray_t& output) const {
+    bool result = true;
+    const Variant::Type type = value.getType();
+    // NOTE: views are encoded as regular strings and byte arrays. Decoder always creates owning values
+    Variant::Type encodedType = type;
+
+    if (Variant::Type::STRING_VIEW == type) {
+        encodedType = Variant::Type::STRING;
+    } else if (Variant::Type::BYTEARRAY_VIEW == type) {
+        encodedType = Variant::Type::BYTEARRAY;
+    } else {
+        // do nothing
+    }
+
+    output.push_back(static_cast<unsigned char>(encodedType));
+
+    switch (type) {
+        case Variant::Type::UNKNOWN:
+            break;
+        case Variant::Type::BYTE_1:
+        case Variant::Type::BYTE_2:
+        case Variant::Type::BYTE_4:
+        case Variant::Type::BYTE_8:
+            writeVarint(zigzagEncode(value.toInt64()), output);
+            break;
+        case Variant::Type::UBYTE_1:
+        case Variant::Type::UBYTE_2:
+        case Variant::Type::UBYTE_4:
+        case Variant::Type::UBYTE_8:
+            writeVarint(value.toUInt64(), output);
+            break;
+        case Variant::Type::DOUBLE:
+            writeDouble(value.toDouble(), output);
+            break;
+        case Variant::Type::BOOL:
+            output.push_back(((true == value.toBool()) ? 1U : 0U));
+            break;
+        case Variant::Type::STRING: {
+            const std::shared_ptr<std::string> str = value.value<std::string>();
+
+            writeBytes(reinterpret_cast<const unsigned char*>(str->data()), str->size(), output);
+            break;
+        }
+        case Variant::Type::BYTEARRAY: {
+            const std::shared_ptr<ByteArray_t> bytes = value.getByteArray();
+
+            writeBytes(bytes->data(), bytes->size(), output);
+            break;
+        }
+        case Variant::Type::BYTEARRAY_VIEW:
+        case Variant::Type::STRING_VIEW: {
+            const BufferView view = value.getBufferView();
+
+            writeBytes(view.data(), view.size(), output);
+            break;
+        }
+        case Variant::Type::LIST:
+            if (depth < MAX_NESTING_DEPTH) {
+                const std::shared_ptr<VariantList_t> items = value.getList();
+
+                writeVarint(items->size(), output);
+
+                for (auto it = items->begin(); (true == result) && (it != items->end()); ++it) {
+                    result = encodeValue(*it, depth + 1U, output);
+                }
+            } else {
+                result = false;
+            }
+            break;
+        case Variant::Type::VECTOR:
+            // type byte will be written by encodeVector()
+            output.pop_back();
+            result = encodeVector(*value.getVector(), depth, output);
+            break;
+        case Variant::Type::MAP:
+            if (depth < MAX_NESTING_DEPTH) {
+                const std::shared_ptr<VariantMap_t> items = value.getMap();
+
+                writeVarint(items->size(), output);
+
+                for (auto it = items->begin(); (true == result) && (it != items->end()); ++it) {
+                    result = (encodeValue(it->first, depth + 1U, output) && encodeValue(it->second, depth + 1U, output));
+                }
+            } else {
+                result = false;
+            }
+            break;
+        case Variant::Type::PAIR:
+            if (depth < MAX_NESTING_DEPTH) {
+                const std::shared_ptr<VariantPair_t> items = value.getPair();
+
+                result = (encodeValue(items->first, depth + 1U, output) && encodeValue(items->second, depth + 1U, output));
+            } else {
+                result = false;
+            }
+            break;
+        case Variant::Type::CUSTOM: {
+            // cppcheck-suppress misra-c2012-14.4 ; false-positive. std::function has a bool() operator
+            if (mCustomEncoder) {
+                ByteArray_t customData;
+
+                result = mCustomEncoder(value, customData);
+
+                if (true == result) {
+                    writeBytes(customData.data(), customData.size(), output);
+                }
+            } else {
+                result = false;
+            }
+            break;
+        }
+        default:
+            result = false;
+            break;
+    }
+
+    return result;
+}
+
+bool VariantSerializer::encodeVector(const VariantVector_t& values, const unsigned int depth, ByteArray_t& output) const {
+    bool result = (depth < MAX_NESTING_DEPTH);
+
+    if (true == result) {
+        output.push_back(static_cast<unsigned char>(Variant::Type::VECTOR));
+        writeVarint(values.size(), output);
+
+        for (auto it = values.begin(); (true == result) && (it != values.end()); ++it) {
+            result = encodeValue(*it, depth + 1U, output);
+        }
+    }
+
+    return result;
+}
+
+}  // namespace hsmcpp
@@ -10,6 +10,11 @@ namespace hsmcpp {
 HierarchicalStateMachine::HierarchicalStateMachine(const StateID_t initialState)
     : mImpl(new HierarchicalStateMachine::Impl(this, initialState)) {}
 
+HierarchicalStateMachine::HierarchicalStateMachine(const StateID_t initialState,
+                                                   HsmMemoryResource* structureResource,
+                                                   HsmMemoryResource* runtimeResource)
+    : mImpl(new HierarchicalStateMachine::Impl(this, initialState, structureResource, runtimeResource)) {}
+
 HierarchicalStateMachine::~HierarchicalStateMachine() {
     mImpl->release();
     mImpl->resetParent();
@@ -35,10 +40,18 @@ void HierarchicalStateMachine::release() {
     mImpl->release();
 }
 
+bool HierarchicalStateMachine::migrate(const std::weak_ptr<IHsmEventDispatcher>& dispatcher) {
+    return mImpl->migrate(dispatcher);
+}
+
 void HierarchicalStateMachine::registerFailedTransitionCallback(HsmTransitionFailedCallback_t onFailedTransition) {
     mImpl->registerFailedTransitionCallback(std::move(onFailedTransition));
 }
 
+void HierarchicalStateMachine::registerDroppedEventCallback(HsmEventDroppedCallback_t onEventDropped) {
+    mImpl->registerDroppedEventCallback(std::move(onEventDropped));
+}
+
 void HierarchicalStateMachine::registerState(const StateID_t state,
                                              HsmStateChangedCallback_t onStateChanged,
                                              HsmStateEnterCallback_t onEntering,
@@ -78,6 +91,18 @@ void HierarchicalStateMachine::registerTimer(const TimerID_t timerID, const Even
     mImpl->registerTimer(timerID, event);
 }
 
+void HierarchicalStateMachine::registerCoalescedEvent(const EventID_t event) {
+    mImpl->registerCoalescedEvent(event);
+}
+
+void HierarchicalStateMachine::registerEventTTL(const EventID_t event, const int ttlMs) {
+    mImpl->registerEventTTL(event, ttlMs);
+}
+
+void HierarchicalStateMachine::registerEventPayloadImpl(const EventID_t event, const PayloadTypeID_t payloadType) {
+    mImpl->registerEventPayload(event, payloadType);
+}
+
 void HierarchicalStateMachine::registerTransition(const StateID_t fromState,
                                                   const StateID_t toState,
                                                   const EventID_t onEvent,
@@ -114,10 +139,33 @@ const std::list<StateID_t>& HierarchicalStateMachine::getActiveStates() const {
     return mImpl->getActiveStates();
 }
 
+std::list<StateID_t> HierarchicalStateMachine::getActiveStatesSnapshot() const {
+    return mImpl->getActiveStatesSnapshot();
+}
+
 bool HierarchicalStateMachine::isStateActive(const StateID_t state) const {
     return mImpl->isStateActive(state);
 }
 
+void HierarchicalStateMachine::waitForStateAsync(const StateID_t state,
+                                                 const int timeoutMs,
+                                                 HsmStateWaitCallback_t onCompleted) {
+    mImpl->waitForStateAsync(state, timeoutMs, std::move(onCompleted));
+}
+
+bool HierarchicalStateMachine::waitForState(const StateID_t state, const int timeoutMs) {
+    return mImpl->waitForState(state, timeoutMs);
+}
+
+SubscriptionID_t HierarchicalStateMachine::subscribeStateChanges(const std::list<StateID_t>& states,
+                                                                 HsmStateSubscriptionCallback_t onChanged) {
+    return mImpl->subscribeStateChanges(states, std::move(onChanged));
+}
+
+void HierarchicalStateMachine::unsubscribeStateChanges(const SubscriptionID_t id) {
+    mImpl->unsubscribeStateChanges(id);
+}
+
 void HierarchicalStateMachine::transitionWithArgsArray(const EventID_t event, VariantVector_t&& args) {
     return mImpl->transitionWithArgsArray(event, std::move(args));
 }
@@ -130,10 +178,38 @@ bool HierarchicalStateMachine::transitionExWithArgsArray(const EventID_t event,
     return mImpl->transitionExWithArgsArray(event, clearQueue, sync, timeoutMs, std::move(args));
 }
 
+bool HierarchicalStateMachine::transitionAsyncWithArgsArray(const EventID_t event,
+                                                            HsmTransitionCompletedCallback_t onCompleted,
+                                                            VariantVector_t&& args) {
+    return mImpl->transitionAsyncWithArgsArray(event, std::move(onCompleted), std::move(args));
+}
+
+void HierarchicalStateMachine::setCompletionExecutor(HsmCompletionExecutor_t executor) {
+    mImpl->setCompletionExecutor(std::move(executor));
+}
+
 bool HierarchicalStateMachine::transitionInterruptSafe(const EventID_t event) {
     return mImpl->transitionInterruptSafe(event);
 }
 
+size_t HierarchicalStateMachine::cancelPendingEvents(const EventID_t event) {
+    return mImpl->cancelPendingEvents(event);
+}
+
+size_t HierarchicalStateMachine::cancelPendingEvents(HsmEventFilterCallback_t filter) {
+    return mImpl->cancelPendingEvents(std::move(filter));
+}
+
+void HierarchicalStateMachine::setPendingEventsLimit(const size_t maxEvents,
+                                                     const QueueOverflowPolicy policy,
+                                                     const int blockTimeoutMs) {
+    mImpl->setPendingEventsLimit(maxEvents, policy, blockTimeoutMs);
+}
+
+EventsQueueStats HierarchicalStateMachine::getPendingEventsStats() const {
+    return mImpl->getPendingEventsStats();
+}
+
 void HierarchicalStateMachine::startTimer(const TimerID_t timerID, const unsigned int intervalMs, const bool isSingleShot) {
     mImpl->startTimer(timerID, intervalMs, isSingleShot);
 }
@@ -186,6 +262,18 @@ bool HierarchicalStateMachine::isTransitionPossibleImpl(const EventID_t event, c
     return mImpl->isTransitionPossible(event, args);
 }
 
+bool HierarchicalStateMachine::transitionWithPayloadImpl(const EventID_t event,
+                                                         std::shared_ptr<void>&& payload,
+                                                         const PayloadTypeID_t payloadType,
+                                                         const bool sync,
+                                                         const int timeoutMs) {
+    return mImpl->transitionWithPayload(event, std::move(payload), payloadType, sync, timeoutMs);
+}
+
+const void* HierarchicalStateMachine::getCurrentEventPayload(const Impl* impl, const PayloadTypeID_t payloadType) {
+    return impl->getCurrentEventPayload(payloadType);
+}
+
 bool HierarchicalStateMachine::registerStateActionImpl(const StateID_t state,
                                                        const StateActionTrigger actionTrigger,
                                                        const StateAction action,
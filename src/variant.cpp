@@ -3,7 +3,10 @@
 
 #include "hsmcpp/variant.hpp"
 
+#include <algorithm>
+#include <cmath>
 #include <cstring>
+#include <limits>
 
 #include "hsmcpp/os/os.hpp"
 
@@ -33,6 +36,198 @@
 
 namespace hsmcpp {
 
+namespace {
+
+constexpr double gTwoPow63 = 9223372036854775808.0;
+constexpr double gTwoPow64 = 18446744073709551616.0;
+
+template <typename T>
+int compareScalars(const T left, const T right) {
+    int result = 0;
+
+    if (left < right) {
+        result = -1;
+    } else if (right < left) {
+        result = 1;
+    } else {
+        // do nothing
+    }
+
+    return result;
+}
+
+// NOTE: NaN values are equal to each other and go after all other numbers. This makes ordering of doubles total
+int compareDoubles(const double left, const double right) {
+    int result = 0;
+    const bool leftIsNan = std::isnan(left);
+    const bool rightIsNan = std::isnan(right);
+
+    if ((true == leftIsNan) || (true == rightIsNan)) {
+        result = ((leftIsNan == rightIsNan) ? 0 : ((true == leftIsNan) ? 1 : -1));
+    } else {
+        result = compareScalars(left, right);
+    }
+
+    return result;
+}
+
+// exact comparison of double and integer values. Integer is never converted to double since it could lose precision
+int compareDoubleWithInt64(const double left, const int64_t right) {
+    int result = 0;
+
+    if ((true == std::isnan(left)) || (left >= gTwoPow63)) {
+        result = 1;
+    } else if (left < -gTwoPow63) {
+        result = -1;
+    } else {
+        const double integralPart = std::trunc(left);
+
+        result = compareScalars(static_cast<int64_t>(integralPart), right);
+
+        if (0 == result) {
+            // compare fractional part
+            result = compareScalars(left, integralPart);
+        }
+    }
+
+    return result;
+}
+
+int compareDoubleWithUInt64(const double left, const uint64_t right) {
+    int result = 0;
+
+    if ((true == std::isnan(left)) || (left >= gTwoPow64)) {
+        result = 1;
+    } else if (left < 0.0) {
+        result = -1;
+    } else {
+        const double integralPart = std::trunc(left);
+
+        result = compareScalars(static_cast<uint64_t>(integralPart), right);
+
+        if (0 == result) {
+            result = compareScalars(left, integralPart);
+        }
+    }
+
+    return result;
+}
+
+inline size_t combineHash(const size_t seed, const size_t value) {
+    return seed ^ (value + static_cast<size_t>(0x9e3779b9U) + (seed << 6U) + (seed >> 2U));
+}
+
+// FNV-1a
+size_t hashBytes(const unsigned char* bytes, const size_t size) {
+    uint64_t result = 14695981039346656037ULL;
+
+    for (size_t i = 0; i < size; ++i) {
+        result = (result ^ static_cast<uint64_t>(bytes[i])) * 1099511628211ULL;
+    }
+
+    return static_cast<size_t>(result);
+}
+
+// NOTE: must be consistent with Variant::compare(). Integral doubles have the same hash as equal integers
+size_t hashDouble(const double value) {
+    size_t result = 0;
+
+    if (true == std::isnan(value)) {
+        // all NaN values are equal
+        result = std::hash<double>()(std::numeric_limits<double>::quiet_NaN());
+    } else if (std::trunc(value) != value) {
+        result = std::hash<double>()(value);
+    } else if ((value >= -gTwoPow63) && (value < gTwoPow63)) {
+        result = std::hash<int64_t>()(static_cast<int64_t>(value));
+    } else if ((value >= 0.0) && (value < gTwoPow64)) {
+        // same as hash of uint64_t values
+        result = std::hash<int64_t>()(static_cast<int64_t>(static_cast<uint64_t>(value)));
+    } else {
+        result = std::hash<double>()(value);
+    }
+
+    return result;
+}
+
+template <typename Container>
+size_t hashItems(const Container& items, const size_t seed) {
+    size_t result = seed;
+
+    for (const Variant& item : items) {
+        result = combineHash(result, item.hash());
+    }
+
+    return result;
+}
+
+}  // namespace
+
+// =================================================================================================================
+// BufferView
+BufferView::BufferView(const void* data, const size_t size, std::shared_ptr<const void> owner)
+    : mData(static_cast<const unsigned char*>(data))
+    , mSize(size)
+    , mOwner(std::move(owner)) {}
+
+BufferView BufferView::share(ByteArray_t&& bytes) {
+    const std::shared_ptr<const ByteArray_t> storage = std::make_shared<const ByteArray_t>(std::move(bytes));
+
+    return BufferView(storage->data(), storage->size(), storage);
+}
+
+BufferView BufferView::share(std::string&& str) {
+    const std::shared_ptr<const std::string> storage = std::make_shared<const std::string>(std::move(str));
+
+    return BufferView(storage->data(), storage->size(), storage);
+}
+
+const unsigned char* BufferView::data() const {
+    return mData;
+}
+
+size_t BufferView::size() const {
+    return mSize;
+}
+
+bool BufferView::empty() const {
+    return (0U == mSize);
+}
+
+bool BufferView::hasOwner() const {
+    return (nullptr != mOwner);
+}
+
+BufferView BufferView::subView(const size_t offset, const size_t count) const {
+    BufferView result;
+
+    if (offset < mSize) {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        result = BufferView(mData + offset, std::min(count, mSize - offset), mOwner);
+    }
+
+    return result;
+}
+
+ByteArray_t BufferView::toByteArray() const {
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    return ((mSize > 0U) ? ByteArray_t(mData, mData + mSize) : ByteArray_t());
+}
+
+std::string BufferView::toString() const {
+    return ((mSize > 0U) ? std::string(reinterpret_cast<const char*>(mData), mSize) : std::string());
+}
+
+bool BufferView::operator==(const BufferView& other) const {
+    return (mSize == other.mSize) && ((mData == other.mData) || (0 == std::memcmp(mData, other.mData, mSize)));
+}
+
+bool BufferView::operator>(const BufferView& other) const {
+    const size_t commonSize = std::min(mSize, other.mSize);
+    const int res = ((commonSize > 0U) ? std::memcmp(mData, other.mData, commonSize) : 0);
+
+    return ((res > 0) || ((0 == res) && (mSize > other.mSize)));
+}
+
 // =================================================================================================================
 // make()
 IMPL_MAKE(int8_t)
@@ -47,6 +242,7 @@ IMPL_MAKE(double)
 IMPL_MAKE(bool)
 IMPL_MAKE(std::string&)
 IMPL_MAKE(ByteArray_t&)
+IMPL_MAKE(BufferView&)
 IMPL_MAKE(VariantVector_t&)
 IMPL_MAKE(VariantList_t&)
 IMPL_MAKE(VariantMap_t&)
@@ -61,6 +257,13 @@ Variant Variant::make(const char* binaryData, const size_t bytesCount) {
     return Variant(binaryData, bytesCount);
 }
 
+Variant Variant::makeStringView(const BufferView& v) {
+    Variant result;
+
+    result.assign(v, Type::STRING_VIEW);
+    return result;
+}
+
 // =================================================================================================================
 // Constructors
 Variant::Variant(std::shared_ptr<void> d, const Type t)
@@ -91,11 +294,20 @@ IMPL_CONSTRUCTOR(double, Type::DOUBLE)
 IMPL_CONSTRUCTOR(bool, Type::BOOL)
 IMPL_CONSTRUCTOR(std::string&, Type::STRING)
 IMPL_CONSTRUCTOR(ByteArray_t&, Type::BYTEARRAY)
+IMPL_CONSTRUCTOR(BufferView&, Type::BYTEARRAY_VIEW)
 IMPL_CONSTRUCTOR(VariantVector_t&, Type::VECTOR)
 IMPL_CONSTRUCTOR(VariantList_t&, Type::LIST)
 IMPL_CONSTRUCTOR(VariantMap_t&, Type::MAP)
 IMPL_CONSTRUCTOR(VariantPair_t&, Type::PAIR)
 
+Variant::Variant(std::string&& v) {
+    assignMoved(std::move(v), Type::STRING);
+}
+
+Variant::Variant(ByteArray_t&& v) {
+    assignMoved(std::move(v), Type::BYTEARRAY);
+}
+
 Variant::Variant(const char* v)
     // cppcheck-suppress misra-c2012-10.4 : false-positive. thinks that ':' is arithmetic operation
     : Variant(std::string(v)) {}
@@ -118,6 +330,7 @@ IMPL_OPERATOR_ASSIGN(double, Type::DOUBLE)
 IMPL_OPERATOR_ASSIGN(bool, Type::BOOL)
 IMPL_OPERATOR_ASSIGN(std::string&, Type::STRING)
 IMPL_OPERATOR_ASSIGN(ByteArray_t&, Type::BYTEARRAY)
+IMPL_OPERATOR_ASSIGN(BufferView&, Type::BYTEARRAY_VIEW)
 IMPL_OPERATOR_ASSIGN(VariantVector_t&, Type::VECTOR)
 IMPL_OPERATOR_ASSIGN(VariantList_t&, Type::LIST)
 IMPL_OPERATOR_ASSIGN(VariantMap_t&, Type::MAP)
@@ -130,11 +343,10 @@ Variant& Variant::operator=(const char* v) {
 
 Variant& Variant::operator=(const Variant& v) {
     if (false == isSameObject(v)) {
-        if ((Type::UNKNOWN != v.type) && (v.memoryAllocator)) {
-            data = v.memoryAllocator(v.data.get());
+        if ((Type::UNKNOWN != v.type) && (nullptr != v.ops)) {
+            data = v.ops->copy(v.data.get());
             type = v.type;
-            memoryAllocator = v.memoryAllocator;
-            compareOperator = v.compareOperator;
+            ops = v.ops;
         } else {
             freeMemory();
         }
@@ -147,10 +359,10 @@ Variant& Variant::operator=(Variant&& v) noexcept {
     if (false == isSameObject(v)) {
         data = std::move(v.data);
         type = v.type;
-        memoryAllocator = std::move(v.memoryAllocator);
-        compareOperator = std::move(v.compareOperator);
+        ops = v.ops;
 
         v.type = Type::UNKNOWN;
+        v.ops = nullptr;
     }
 
     return *this;
@@ -170,15 +382,9 @@ bool Variant::operator>(const Variant& val) const {
 
     if ((data != val.data) && (data) && (val.data)) {
         if (isNumeric() && val.isNumeric()) {
-            if ((Type::DOUBLE == type) || (Type::DOUBLE == val.type)) {
-                isGreater = toDouble() > val.toDouble();
-            } else if (isUnsignedNumeric() || val.isUnsignedNumeric()) {
-                isGreater = toUInt64() > val.toUInt64();
-            } else {
-                isGreater = toInt64() > val.toInt64();
-            }
+            isGreater = (compareNumeric(val) > 0);
         } else if (type == val.type) {
-            isGreater = (1 == compareOperator(data.get(), val.data.get()));
+            isGreater = (1 == ops->compare(data.get(), val.data.get()));
         } else {
             // do nothing
         }
@@ -200,32 +406,102 @@ bool Variant::operator<=(const Variant& val) const {
 }
 
 bool Variant::operator==(const Variant& val) const {
-    constexpr double comparePrecision = 0.00000001;
-    bool equal = false;
+    // NOTE: must stay consistent with hash() and ordering of VariantMap_t
+    return (0 == compare(val));
+}
+
+int Variant::compare(const Variant& val) const {
+    int result = 0;
 
     if (data != val.data) {
-        if ((data) && (val.data)) {
-            if (isNumeric() && val.isNumeric()) {
-                if ((Type::DOUBLE == type) || (Type::DOUBLE == val.type)) {
-                    // compare with precision for double
-                    // cppcheck-suppress misra-c2012-10.4 : false positive. both operands have type double
-                    equal = (std::abs(toDouble() - val.toDouble()) < comparePrecision);
-                } else if (isUnsignedNumeric() || val.isUnsignedNumeric()) {
-                    equal = (toUInt64() == val.toUInt64());
-                } else {
-                    equal = (toInt64() == val.toInt64());
+        const bool numeric = isNumeric();
+        const bool valNumeric = val.isNumeric();
+
+        if ((true == numeric) && (true == valNumeric)) {
+            result = compareNumeric(val);
+        } else if (numeric != valNumeric) {
+            result = ((true == numeric) ? -1 : 1);
+        } else if (type != val.type) {
+            result = ((static_cast<int>(type) < static_cast<int>(val.type)) ? -1 : 1);
+        } else if ((!data) || (!val.data)) {
+            result = ((!data) ? -1 : 1);
+        } else {
+            result = ops->compare(data.get(), val.data.get());
+        }
+    }
+
+    return result;
+}
+
+size_t Variant::hash() const {
+    size_t result = 0;
+
+    if (data) {
+        switch (type) {
+            case Type::BYTE_1:
+            case Type::BYTE_2:
+            case Type::BYTE_4:
+            case Type::BYTE_8:
+                result = std::hash<int64_t>()(toInt64());
+                break;
+            case Type::UBYTE_1:
+            case Type::UBYTE_2:
+            case Type::UBYTE_4:
+            case Type::UBYTE_8:
+                // NOTE: positive signed values have the same hash
+                result = std::hash<int64_t>()(static_cast<int64_t>(toUInt64()));
+                break;
+            case Type::DOUBLE:
+                result = hashDouble(*value<double>());
+                break;
+            case Type::BOOL:
+                result = std::hash<bool>()(*value<bool>());
+                break;
+            case Type::STRING:
+                result = std::hash<std::string>()(*value<std::string>());
+                break;
+            case Type::BYTEARRAY: {
+                const std::shared_ptr<ByteArray_t> bytes = value<ByteArray_t>();
+
+                result = hashBytes(bytes->data(), bytes->size());
+                break;
+            }
+            case Type::BYTEARRAY_VIEW:
+            case Type::STRING_VIEW: {
+                const std::shared_ptr<BufferView> view = value<BufferView>();
+
+                result = hashBytes(view->data(), view->size());
+                break;
+            }
+            case Type::VECTOR:
+                result = hashItems(*value<VariantVector_t>(), static_cast<size_t>(type));
+                break;
+            case Type::LIST:
+                result = hashItems(*value<VariantList_t>(), static_cast<size_t>(type));
+                break;
+            case Type::MAP:
+                result = static_cast<size_t>(type);
+
+                for (const auto& item : *value<VariantMap_t>()) {
+                    result = combineHash(combineHash(result, item.first.hash()), item.second.hash());
                 }
-            } else if (val.type == type) {
-                equal = (0 == compareOperator(data.get(), val.data.get()));
-            } else {
-                // do nothing
+                break;
+            case Type::PAIR: {
+                const std::shared_ptr<VariantPair_t> pair = value<VariantPair_t>();
+
+                result = combineHash(combineHash(static_cast<size_t>(type), pair->first.hash()), pair->second.hash());
+                break;
             }
+            case Type::CUSTOM:
+                result = ops->hash(data.get());
+                break;
+            default:
+                // do nothing
+                break;
         }
-    } else {
-        equal = true;
     }
 
-    return equal;
+    return result;
 }
 
 void Variant::clear() {
@@ -244,6 +520,14 @@ bool Variant::isByteArray() const {
     return (type == Type::BYTEARRAY);
 }
 
+bool Variant::isStringView() const {
+    return (type == Type::STRING_VIEW);
+}
+
+bool Variant::isByteArrayView() const {
+    return (type == Type::BYTEARRAY_VIEW);
+}
+
 bool Variant::isVector() const {
     return (type == Type::VECTOR);
 }
@@ -429,6 +713,13 @@ std::string Variant::toString() const {
             result = std::string("(") + value<VariantPair_t>()->first.toString() + std::string(", ") +
                      value<VariantPair_t>()->second.toString() + std::string(")");
             break;
+        case Type::CUSTOM:
+            result = ops->toString(data.get());
+            break;
+        case Type::BYTEARRAY_VIEW:
+        case Type::STRING_VIEW:
+            result = value<BufferView>()->toString();
+            break;
         default:
             break;
     }
@@ -475,6 +766,7 @@ int64_t Variant::toInt64() const {
             break;
 
         case Type::STRING:
+        case Type::STRING_VIEW:
             HSM_TRY {
                 result = std::stoll(toString());
             }
@@ -534,6 +826,7 @@ uint64_t Variant::toUInt64() const {
             break;
 
         case Type::STRING:
+        case Type::STRING_VIEW:
             HSM_TRY {
                 result = std::stoull(toString());
             }
@@ -593,6 +886,7 @@ double Variant::toDouble() const {
             break;
 
         case Type::STRING:
+        case Type::STRING_VIEW:
             HSM_TRY {
                 result = std::stod(toString());
             }
@@ -618,7 +912,7 @@ bool Variant::toBool() const {
 
     if (Type::BOOL == type) {
         result = *value<bool>();
-    } else if (Type::STRING == type) {
+    } else if ((Type::STRING == type) || (Type::STRING_VIEW == type)) {
         const std::string strValue = toString();
 
         if (strValue != "true") {
@@ -681,6 +975,10 @@ ByteArray_t Variant::toByteArray() const {
         case Type::BYTEARRAY:
             result = *(value<ByteArray_t>());
             break;
+        case Type::BYTEARRAY_VIEW:
+        case Type::STRING_VIEW:
+            result = value<BufferView>()->toByteArray();
+            break;
         case Type::VECTOR: {
             std::shared_ptr<VariantVector_t> data = value<VariantVector_t>();
 
@@ -734,6 +1032,34 @@ std::shared_ptr<ByteArray_t> Variant::getByteArray() const {
     return result;
 }
 
+BufferView Variant::getBufferView() const {
+    BufferView result;
+
+    switch (type) {
+        case Type::STRING: {
+            const std::shared_ptr<std::string> str = value<std::string>();
+
+            result = BufferView(str->data(), str->size(), str);
+            break;
+        }
+        case Type::BYTEARRAY: {
+            const std::shared_ptr<ByteArray_t> bytes = value<ByteArray_t>();
+
+            result = BufferView(bytes->data(), bytes->size(), bytes);
+            break;
+        }
+        case Type::BYTEARRAY_VIEW:
+        case Type::STRING_VIEW:
+            result = *value<BufferView>();
+            break;
+        default:
+            // do nothing
+            break;
+    }
+
+    return result;
+}
+
 std::shared_ptr<VariantVector_t> Variant::getVector() const {
     std::shared_ptr<VariantVector_t> result;
 
@@ -778,11 +1104,32 @@ bool Variant::isSameObject(const Variant& val) const {
     return ((val.data.get() == data.get()) && data);
 }
 
+int Variant::compareNumeric(const Variant& val) const {
+    int result = 0;
+
+    if ((Type::DOUBLE == type) && (Type::DOUBLE == val.type)) {
+        result = compareDoubles(*value<double>(), *val.value<double>());
+    } else if (Type::DOUBLE == type) {
+        result = (val.isUnsignedNumeric() ? compareDoubleWithUInt64(*value<double>(), val.toUInt64())
+                                          : compareDoubleWithInt64(*value<double>(), val.toInt64()));
+    } else if (Type::DOUBLE == val.type) {
+        result = -val.compareNumeric(*this);
+    } else if (isUnsignedNumeric() == val.isUnsignedNumeric()) {
+        result = (isUnsignedNumeric() ? compareScalars(toUInt64(), val.toUInt64()) : compareScalars(toInt64(), val.toInt64()));
+    } else if (isUnsignedNumeric()) {
+        // NOTE: negative signed values are smaller than any unsigned value
+        result = ((val.toInt64() < 0) ? 1 : compareScalars(toUInt64(), val.toUInt64()));
+    } else {
+        result = ((toInt64() < 0) ? -1 : compareScalars(toUInt64(), val.toUInt64()));
+    }
+
+    return result;
+}
+
 void Variant::freeMemory() {
     data.reset();
     type = Type::UNKNOWN;
-    memoryAllocator = nullptr;
-    compareOperator = nullptr;
+    ops = nullptr;
 }
 
 }  // namespace hsmcpp
\ No newline at end of file
@@ -0,0 +1,82 @@
+// Copyright (C) 2024 Igor Krechetov
+// Distributed under MIT license. See file LICENSE for details
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include <hsmcpp/HsmEventDispatcherSTD.hpp>
+
+using namespace hsmcpp;
+
+// time between events. dispatcher becomes idle after each event
+constexpr int EVENTS_INTERVAL_US = 100;
+
+void runBenchmark(const char* name, const unsigned int busyPollingUs, const int cpuIndex, const int iterations) {
+    std::shared_ptr<HsmEventDispatcherSTD> dispatcher = HsmEventDispatcherSTD::create();
+    std::atomic<bool> handled(false);
+    std::chrono::time_point<std::chrono::steady_clock> emitTime;
+    std::vector<int64_t> latencies;
+
+    latencies.reserve(iterations);
+    dispatcher->setBusyPolling(busyPollingUs);
+
+    if (cpuIndex >= 0) {
+        (void)dispatcher->setCpuAffinity(cpuIndex);
+    }
+
+    const HandlerID_t handlerId = dispatcher->registerEventHandler([&]() {
+        const auto handleTime = std::chrono::steady_clock::now();
+
+        latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(handleTime - emitTime).count());
+        handled.store(true);
+        return true;
+    });
+
+    dispatcher->start();
+
+    for (int i = 0; i < iterations; ++i) {
+        std::this_thread::sleep_for(std::chrono::microseconds(EVENTS_INTERVAL_US));
+        handled.store(false);
+        emitTime = std::chrono::steady_clock::now();
+        dispatcher->emitEvent(handlerId);
+
+        while (false == handled.load()) {
+            std::this_thread::yield();
+        }
+    }
+
+    dispatcher->stop();
+    dispatcher->join();
+
+    std::sort(latencies.begin(), latencies.end());
+
+    const size_t count = latencies.size();
+
+    printf("%s (busy polling: %u us, cpu: %d)\n", name, busyPollingUs, cpuIndex);
+    printf("    events: %lu\n", count);
+
+    if (count > 0u) {
+        printf("    p50: %.1f us\n", static_cast<double>(latencies[count / 2]) / 1000.0);
+        printf("    p99: %.1f us\n", static_cast<double>(latencies[(count * 99) / 100]) / 1000.0);
+        printf("    max: %.1f us\n\n", static_cast<double>(latencies.back()) / 1000.0);
+    }
+}
+
+int main(const int argc, const char** argv) {
+    const int iterations = ((argc > 1) ? std::atoi(argv[1]) : 10000);
+    const int cpuIndex = ((argc > 2) ? std::atoi(argv[2]) : -1);
+
+    printf("\nThis utility measures latency between emitEvent() and event handler call for HsmEventDispatcherSTD.\n");
+    printf("Events are emitted every %d us so dispatcher is idle when each event arrives.\n", EVENTS_INTERVAL_US);
+    printf("Usage: benchmark_dispatcher_latency [iterations] [cpu index for dispatcher thread]\n");
+    printf("------------------------------------------------------------------\n\n");
+
+    runBenchmark("default", 0, cpuIndex, iterations);
+    runBenchmark("busy polling", 2 * EVENTS_INTERVAL_US, cpuIndex, iterations);
+
+    return 0;
+}
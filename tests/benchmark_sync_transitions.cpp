@@ -0,0 +1,150 @@
+// Copyright (C) 2024 Igor Krechetov
+// Distributed under MIT license. See file LICENSE for details
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include <hsmcpp/HsmEventDispatcherSTD.hpp>
+#include <hsmcpp/hsm.hpp>
+
+using namespace hsmcpp;
+
+namespace States {
+    const hsmcpp::StateID_t OFF = 0;
+    const hsmcpp::StateID_t ON = 1;
+}
+
+namespace Events {
+    const hsmcpp::EventID_t SWITCH = 0;
+    const hsmcpp::EventID_t READING = 1;        // arguments are passed as Variant
+    const hsmcpp::EventID_t READING_TYPED = 2;  // arguments are passed as SensorReading payload
+}
+
+struct SensorReading {
+    int32_t sensorId = 0;
+    double value = 0.0;
+    uint64_t timestamp = 0;
+};
+
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+std::atomic<uint64_t> gAllocationsCount(0);
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+volatile uint64_t gSink = 0;
+
+void* operator new(std::size_t size) {
+    gAllocationsCount.fetch_add(1, std::memory_order_relaxed);
+    void* ptr = std::malloc(size);
+
+    if (nullptr == ptr) {
+        throw std::bad_alloc();
+    }
+
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+void runBenchmark(const char* name,
+                  const int threadsCount,
+                  const int iterations,
+                  const std::function<bool(int)>& sendEvent) {
+    std::vector<std::thread> producers;
+    std::atomic<int> failedTransitions(0);
+
+    const uint64_t allocationsBefore = gAllocationsCount.load();
+    const auto timeStart = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < threadsCount; ++i) {
+        producers.emplace_back([&]() {
+            for (int n = 0; n < iterations; ++n) {
+                if (false == sendEvent(n)) {
+                    ++failedTransitions;
+                }
+            }
+        });
+    }
+
+    for (std::thread& curThread : producers) {
+        curThread.join();
+    }
+
+    const auto duration = std::chrono::steady_clock::now() - timeStart;
+    const uint64_t allocations = gAllocationsCount.load() - allocationsBefore;
+    const double total = static_cast<double>(threadsCount * iterations);
+
+    printf("%s: threads=%d, transitions=%.0f, failed=%d\n", name, threadsCount, total, failedTransitions.load());
+    printf("    avg round trip: %.0f ns\n",
+           static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count()) / total);
+    printf("    heap allocations per transition: %.2f\n\n", static_cast<double>(allocations) / total);
+}
+
+int main(const int argc, const char** argv) {
+    const int iterations = ((argc > 1) ? std::atoi(argv[1]) : 20000);
+
+    printf("\nThis utility measures performance of synchronous transitions (transitionSync).\n");
+    printf("Allocations include event arguments and dispatcher bookkeeping, not only sync handshake.\n");
+    printf("------------------------------------------------------------------\n\n");
+
+    std::shared_ptr<HsmEventDispatcherSTD> dispatcher = HsmEventDispatcherSTD::create();
+    std::shared_ptr<HierarchicalStateMachine> hsm = std::make_shared<HierarchicalStateMachine>(States::OFF);
+
+    hsm->registerState(States::OFF);
+    hsm->registerState(States::ON);
+    hsm->registerTransition(States::OFF, States::ON, Events::SWITCH);
+    hsm->registerTransition(States::ON, States::OFF, Events::SWITCH);
+    hsm->registerEventPayload<SensorReading>(Events::READING_TYPED);
+    hsm->registerSelfTransition(States::OFF, Events::READING, TransitionType::INTERNAL_TRANSITION, [](const VariantVector_t& args) {
+        gSink = gSink + static_cast<uint64_t>(args[0].toInt64() + args[1].toDouble()) + args[2].toUInt64();
+    });
+    hsm->registerSelfTransition(States::OFF,
+                                Events::READING_TYPED,
+                                TransitionType::INTERNAL_TRANSITION,
+                                hsm->withPayload<SensorReading>([](const SensorReading& reading) {
+                                    gSink = gSink + static_cast<uint64_t>(reading.sensorId + reading.value) + reading.timestamp;
+                                }));
+    hsm->initialize(dispatcher);
+
+    const auto sendSwitch = [&](const int n) {
+        (void)n;
+        // cppcheck-suppress misra-c2012-15.5 ; false-positive. "return" statement belongs to lambda function
+        return hsm->transitionSync(Events::SWITCH, HSM_WAIT_INDEFINITELY);
+    };
+    const auto sendReading = [&](const int n) {
+        // cppcheck-suppress misra-c2012-15.5 ; false-positive. "return" statement belongs to lambda function
+        return hsm->transitionSync(Events::READING, HSM_WAIT_INDEFINITELY, n, 21.5, static_cast<uint64_t>(n));
+    };
+    const auto sendTypedReading = [&](const int n) {
+        SensorReading reading;
+
+        reading.sensorId = n;
+        reading.value = 21.5;
+        reading.timestamp = static_cast<uint64_t>(n);
+        // cppcheck-suppress misra-c2012-15.5 ; false-positive. "return" statement belongs to lambda function
+        return hsm->transitionWithPayload(Events::READING_TYPED, std::move(reading), true, HSM_WAIT_INDEFINITELY);
+    };
+
+    // warm up
+    runBenchmark("switch", 1, 1000, sendSwitch);
+
+    runBenchmark("switch", 1, iterations, sendSwitch);
+    runBenchmark("switch", 4, iterations / 4, sendSwitch);
+    runBenchmark("3 Variant args", 1, iterations, sendReading);
+    runBenchmark("typed payload", 1, iterations, sendTypedReading);
+
+    hsm->release();
+    dispatcher->stop();
+    dispatcher->join();
+
+    return 0;
+}
@@ -0,0 +1,91 @@
+// Copyright (C) 2024 Igor Krechetov
+// Distributed under MIT license. See file LICENSE for details
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+
+#include <hsmcpp/VariantSerializer.hpp>
+
+using namespace hsmcpp;
+
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+volatile size_t gSink = 0;
+
+// returns average duration of a single iteration in nanoseconds
+double measure(const int iterations, const std::function<void()>& func) {
+    const auto timeStart = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < iterations; ++i) {
+        func();
+    }
+
+    const auto duration = std::chrono::steady_clock::now() - timeStart;
+
+    return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count()) / iterations;
+}
+
+void runBenchmark(const char* name, const VariantVector_t& args, const int iterations) {
+    const VariantSerializer serializer;
+    ByteArray_t buffer;
+    std::string text;
+    VariantVector_t decodedArgs;
+
+    // similar to how HSM execution log writes event arguments
+    const double toStringNs = measure(iterations, [&]() {
+        text.clear();
+
+        for (const Variant& arg : args) {
+            text += arg.toString();
+            text += " ";
+        }
+
+        gSink = gSink + text.size();
+    });
+    const double serializeNs = measure(iterations, [&]() {
+        buffer.clear();
+        (void)serializer.serialize(args, buffer);
+        gSink = gSink + buffer.size();
+    });
+    const double deserializeNs = measure(iterations, [&]() {
+        (void)serializer.deserialize(buffer.data(), buffer.size(), decodedArgs);
+        gSink = gSink + decodedArgs.size();
+    });
+    const double parseViewNs = measure(iterations, [&]() {
+        gSink = gSink + VariantView::parse(buffer.data(), buffer.size()).count();
+    });
+
+    printf("%s\n", name);
+    printf("    toString():    %8.1f ns, %lu bytes\n", toStringNs, text.size());
+    printf("    serialize():   %8.1f ns, %lu bytes\n", serializeNs, buffer.size());
+    printf("    deserialize(): %8.1f ns\n", deserializeNs);
+    printf("    parse view:    %8.1f ns\n\n", parseViewNs);
+}
+
+int main(const int argc, const char** argv) {
+    const int iterations = ((argc > 1) ? std::atoi(argv[1]) : 100000);
+    VariantVector_t scalarArgs = {Variant(static_cast<int32_t>(42)), Variant(static_cast<uint64_t>(1234567)), Variant(3.14),
+                                  Variant(true)};
+    VariantVector_t stringArgs = {Variant("device/sensor/temperature"), Variant(ByteArray_t(64, 0xAB))};
+    VariantMap_t settings;
+    VariantVector_t nestedArgs;
+
+    for (int i = 0; i < 10; ++i) {
+        settings.emplace(Variant("key" + std::to_string(i)), Variant(i * 100));
+    }
+
+    nestedArgs.emplace_back(settings);
+    nestedArgs.emplace_back(VariantList_t(8, Variant(static_cast<int16_t>(-5))));
+    nestedArgs.emplace_back(VariantPair_t(Variant("id"), Variant(static_cast<uint8_t>(7))));
+
+    printf("\nThis utility compares binary serialization of event arguments with toString() based logging.\n");
+    printf("Usage: benchmark_variant_serialization [iterations]\n");
+    printf("------------------------------------------------------------------\n\n");
+
+    runBenchmark("scalars", scalarArgs, iterations);
+    runBenchmark("string and bytearray", stringArgs, iterations);
+    runBenchmark("containers", nestedArgs, iterations);
+
+    return 0;
+}
@@ -1,5 +1,8 @@
 // Copyright (C) 2021 Igor Krechetov
 // Distributed under MIT license. See file LICENSE for details
+#include <future>
+#include <list>
+#include <mutex>
 #include <thread>
 
 #include "hsm/ABCHsm.hpp"
@@ -556,6 +559,96 @@ TEST_F(ABCHsm, transition_sync_deadlock) {
     ASSERT_TRUE(compareStateLists(getActiveStates(), {AbcState::C}));
 }
 
+TEST_F(ABCHsm, transition_async_callback) {
+    TEST_DESCRIPTION("Completion callback of async transition is called on dispatcher thread with transition result");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    std::promise<TransitionResult> resultE1;
+    std::promise<TransitionResult> resultE3;
+    std::thread::id callbackThread;
+
+    registerState(AbcState::A);
+    registerState(AbcState::B);
+    registerTransition(AbcState::A, AbcState::B, AbcEvent::E1);
+
+    initializeHsm();
+
+    //-------------------------------------------
+    // ACTIONS
+    ASSERT_TRUE(transitionAsync(
+        AbcEvent::E1,
+        [&](const hsmcpp::EventID_t, const TransitionResult result) {
+            callbackThread = std::this_thread::get_id();
+            resultE1.set_value(result);
+        },
+        1));
+    // no transition for E3 in state B
+    ASSERT_TRUE(transitionAsync(AbcEvent::E3, [&](const hsmcpp::EventID_t, const TransitionResult result) {
+        resultE3.set_value(result);
+    }));
+
+    auto futureE1 = resultE1.get_future();
+    auto futureE3 = resultE3.get_future();
+
+    ASSERT_EQ(futureE1.wait_for(std::chrono::milliseconds(TIMEOUT_SYNC_TRANSITION)), std::future_status::ready);
+    ASSERT_EQ(futureE3.wait_for(std::chrono::milliseconds(TIMEOUT_SYNC_TRANSITION)), std::future_status::ready);
+
+    //-------------------------------------------
+    // VALIDATION
+    EXPECT_EQ(futureE1.get(), TransitionResult::SUCCEEDED);
+    EXPECT_EQ(futureE3.get(), TransitionResult::FAILED);
+    EXPECT_NE(callbackThread, std::this_thread::get_id());
+    EXPECT_TRUE(compareStateLists(getActiveStates(), {AbcState::B}));
+}
+
+TEST_F(ABCHsm, transition_async_executor) {
+    TEST_DESCRIPTION("Completion callbacks of async transitions are posted to executor if it was set");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    std::mutex tasksSync;
+    std::list<std::function<void()>> tasks;
+    std::list<TransitionResult> results;
+
+    registerState(AbcState::A);
+    registerState(AbcState::B);
+    registerTransition(AbcState::A, AbcState::B, AbcEvent::E1);
+
+    initializeHsm();
+    setCompletionExecutor([&](std::function<void()> task) {
+        std::lock_guard<std::mutex> lck(tasksSync);
+        tasks.push_back(std::move(task));
+    });
+
+    //-------------------------------------------
+    // ACTIONS
+    ASSERT_TRUE(transitionAsync(AbcEvent::E1, [&](const hsmcpp::EventID_t, const TransitionResult result) {
+        results.push_back(result);
+    }));
+    // flush events queue
+    ASSERT_FALSE(transitionSync(AbcEvent::E3, TIMEOUT_SYNC_TRANSITION));
+
+    const bool resultsEmptyBeforeExecution = results.empty();
+    std::list<std::function<void()>> pendingTasks;
+
+    {
+        std::lock_guard<std::mutex> lck(tasksSync);
+        pendingTasks.swap(tasks);
+    }
+
+    for (auto& task : pendingTasks) {
+        task();
+    }
+
+    //-------------------------------------------
+    // VALIDATION
+    EXPECT_TRUE(resultsEmptyBeforeExecution);
+    ASSERT_EQ(pendingTasks.size(), 1);
+    ASSERT_EQ(results.size(), 1);
+    EXPECT_EQ(results.front(), TransitionResult::SUCCEEDED);
+}
+
 
 // NOTE: test is obsolete with introduction of parallel feature
 // TEST_F(TrafficLightHsm, transition_conditional_multiple_valid)
@@ -1,5 +1,9 @@
 // Copyright (C) 2021 Igor Krechetov
 // Distributed under MIT license. See file LICENSE for details
+#include <atomic>
+#include <thread>
+#include <vector>
+
 #include "hsm/ABCHsm.hpp"
 #ifndef WIN32
   #include <signal.h>
@@ -60,6 +64,189 @@ TEST_F(ABCHsm, multithreaded_entrypoint_cancelation) {
     ASSERT_TRUE(compareStateLists(getActiveStates(), {AbcState::C}));
 }
 
+TEST_F(ABCHsm, multithreaded_active_states_snapshot) {
+    TEST_DESCRIPTION("active states could be read from other threads while dispatcher is changing them");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    const int transitionsCount = 2000;
+    const int readersCount = 4;
+    std::atomic<bool> stopReaders(false);
+    std::atomic<int> invalidSnapshots(0);
+    std::vector<std::thread> readers;
+
+    registerState(AbcState::A);
+    registerState(AbcState::B);
+    registerState(AbcState::C);
+
+    ASSERT_TRUE(registerSubstateEntryPoint(AbcState::P1, AbcState::B));
+    ASSERT_TRUE(registerSubstate(AbcState::P1, AbcState::C));
+
+    registerTransition(AbcState::A, AbcState::P1, AbcEvent::E1);
+    registerTransition(AbcState::B, AbcState::C, AbcEvent::E1);
+    registerTransition(AbcState::P1, AbcState::A, AbcEvent::E2);
+
+    initializeHsm();
+
+    for (int i = 0; i < readersCount; ++i) {
+        readers.emplace_back([&]() {
+            while (false == stopReaders.load()) {
+                std::list<StateID_t> states = getActiveStatesSnapshot();
+
+                // every snapshot must match one of the configurations which dispatcher went through
+                // NOTE: compareStateLists() is not used because it prints mismatches
+                states.sort();
+
+                if ((states != std::list<StateID_t>()) && (states != std::list<StateID_t>({AbcState::A})) &&
+                    (states != std::list<StateID_t>({AbcState::P1})) &&
+                    (states != std::list<StateID_t>({AbcState::B, AbcState::P1})) &&
+                    (states != std::list<StateID_t>({AbcState::C, AbcState::P1}))) {
+                    ++invalidSnapshots;
+                }
+
+                // result could be already outdated, but call must be safe
+                (void)isStateActive(AbcState::B);
+            }
+        });
+    }
+
+    //-------------------------------------------
+    // ACTIONS
+    int failedTransitions = 0;
+
+    for (int i = 0; i < transitionsCount; ++i) {
+        // A -> [P1 -> B] -> C -> A
+        if ((false == transitionSync(AbcEvent::E1, TIMEOUT_SYNC_TRANSITION)) ||
+            (false == transitionSync(AbcEvent::E1, TIMEOUT_SYNC_TRANSITION)) ||
+            (false == transitionSync(AbcEvent::E2, TIMEOUT_SYNC_TRANSITION))) {
+            ++failedTransitions;
+        }
+    }
+
+    stopReaders = true;
+
+    for (std::thread& curThread : readers) {
+        curThread.join();
+    }
+
+    //-------------------------------------------
+    // VALIDATION
+    EXPECT_EQ(failedTransitions, 0);
+    EXPECT_EQ(invalidSnapshots.load(), 0);
+    EXPECT_TRUE(compareStateLists(getActiveStatesSnapshot(), {AbcState::A}));
+    EXPECT_TRUE(isStateActive(AbcState::A));
+    EXPECT_FALSE(isStateActive(AbcState::P1));
+}
+
+TEST_F(ABCHsm, multithreaded_wait_for_state) {
+    TEST_DESCRIPTION("multiple threads could block until state becomes active");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    const int waitersCount = 4;
+    std::atomic<int> activatedWaiters(0);
+    std::atomic<int> startedWaiters(0);
+    std::vector<std::thread> waiters;
+
+    registerState(AbcState::A);
+    registerState(AbcState::B);
+    registerState(AbcState::C);
+    registerTransition(AbcState::A, AbcState::B, AbcEvent::E1);
+
+    initializeHsm();
+
+    //-------------------------------------------
+    // ACTIONS
+    // already active state doesn't block
+    EXPECT_TRUE(waitForState(AbcState::A, 1));
+    // state C is never activated
+    EXPECT_FALSE(waitForState(AbcState::C, 50));
+
+    for (int i = 0; i < waitersCount; ++i) {
+        waiters.emplace_back([&]() {
+            ++startedWaiters;
+
+            if (true == waitForState(AbcState::B, TIMEOUT_SYNC_TRANSITION)) {
+                ++activatedWaiters;
+            }
+        });
+    }
+
+    while (startedWaiters.load() < waitersCount) {
+        std::this_thread::yield();
+    }
+
+    transition(AbcEvent::E1);
+
+    for (std::thread& curThread : waiters) {
+        curThread.join();
+    }
+
+    //-------------------------------------------
+    // VALIDATION
+    EXPECT_EQ(activatedWaiters.load(), waitersCount);
+    EXPECT_TRUE(compareStateLists(getActiveStates(), {AbcState::B}));
+}
+
+TEST_F(ABCHsm, multithreaded_wait_for_state_stress) {
+    TEST_DESCRIPTION("concurrent waiters for different states should not corrupt each other while HSM is changing states");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    // state E is never activated. Its waiters always time out
+    const std::vector<StateID_t> states = {AbcState::A, AbcState::B, AbcState::C, AbcState::D, AbcState::E};
+    const int waitIterations = 100;
+    const int transitionsCount = 2000;
+    std::atomic<int> finishedWaiters(0);
+    std::atomic<int> activatedWaiters(0);
+    int failedTransitions = 0;
+    std::vector<std::thread> waiters;
+
+    registerState(AbcState::A);
+    registerState(AbcState::B);
+    registerState(AbcState::C);
+    registerState(AbcState::D);
+    registerTransition(AbcState::A, AbcState::B, AbcEvent::E1);
+    registerTransition(AbcState::B, AbcState::C, AbcEvent::E1);
+    registerTransition(AbcState::C, AbcState::D, AbcEvent::E1);
+    registerTransition(AbcState::D, AbcState::A, AbcEvent::E1);
+
+    initializeHsm();
+
+    //-------------------------------------------
+    // ACTIONS
+    // two waiters per state. Short timeouts make waiters leave the list while others are being notified
+    for (int i = 0; i < (2 * static_cast<int>(states.size())); ++i) {
+        const StateID_t waitedState = states[static_cast<size_t>(i) % states.size()];
+
+        waiters.emplace_back([&, waitedState, i]() {
+            for (int j = 0; j < waitIterations; ++j) {
+                if (true == waitForState(waitedState, 1 + ((i + j) % 3))) {
+                    ++activatedWaiters;
+                }
+            }
+
+            ++finishedWaiters;
+        });
+    }
+
+    for (int i = 0; (i < transitionsCount) && (finishedWaiters.load() < static_cast<int>(waiters.size())); ++i) {
+        if (false == transitionSync(AbcEvent::E1, TIMEOUT_SYNC_TRANSITION)) {
+            ++failedTransitions;
+        }
+    }
+
+    for (std::thread& curThread : waiters) {
+        curThread.join();
+    }
+
+    //-------------------------------------------
+    // VALIDATION
+    EXPECT_EQ(failedTransitions, 0);
+    EXPECT_GT(activatedWaiters.load(), 0);
+    EXPECT_TRUE(waitForState(getActiveStates().front(), TIMEOUT_SYNC_TRANSITION));
+}
+
 // NOTE: Disable tests because we don't have signals on Windows platfroms
 #ifndef WIN32
 ABCHsm *gABCHsmInstance = nullptr;
@@ -1,8 +1,13 @@
 // Copyright (C) 2021 Igor Krechetov
 // Distributed under MIT license. See file LICENSE for details
 #include "hsm/ABCHsm.hpp"
+#include <atomic>
 #include <chrono>
+#include <future>
+#include <memory>
 #include <thread>
+#include <utility>
+#include <vector>
 
 TEST_F(ABCHsm, callbacks_class_pointers) {
     TEST_DESCRIPTION("test that all callbacks work when specified as class members");
@@ -125,6 +130,188 @@ TEST_F(ABCHsm, callbacks_lambdas) {
     EXPECT_EQ(argsConditionTrue, expectedArgs);
 }
 
+TEST_F(ABCHsm, callbacks_typed_payload) {
+    TEST_DESCRIPTION("callbacks created with withPayload() should receive typed payload of the event without copying it");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    struct Frame {
+        int id = 0;
+        std::unique_ptr<std::vector<uint8_t>> data;  // makes payload move-only
+    };
+    Frame frame;
+    const std::vector<uint8_t>* frameData = nullptr;
+    const std::vector<uint8_t>* transitionData = nullptr;
+    int conditionCounter = 0;
+    int transitionCounter = 0;
+    int stateBEnterCounter = 0;
+    int stateBCounter = 0;
+    int stateCCounter = 0;
+    int frameId = 0;
+    VariantVector_t argsE2;
+
+    frame.id = 7;
+    frame.data.reset(new std::vector<uint8_t>(1024, 0xAB));
+    frameData = frame.data.get();
+
+    registerEventPayload<Frame>(AbcEvent::E1);
+    registerState(AbcState::A);
+    registerState(AbcState::B,
+                  withPayload<Frame>([&](const Frame& payload) {
+                      ++stateBCounter;
+                      frameId = payload.id;
+                  }),
+                  withPayload<Frame>([&](const Frame& payload) {
+                      ++stateBEnterCounter;
+                      return (nullptr != payload.data);
+                  }),
+                  nullptr);
+    registerState(AbcState::C, withPayload<Frame>([&](const Frame& payload) {
+                      (void)payload;
+                      ++stateCCounter;
+                  }));
+
+    registerTransition(AbcState::A,
+                       AbcState::B,
+                       AbcEvent::E1,
+                       withPayload<Frame>([&](const Frame& payload) {
+                           ++transitionCounter;
+                           transitionData = payload.data.get();
+                       }),
+                       withPayload<Frame>([&](const Frame& payload) {
+                           ++conditionCounter;
+                           return (7 == payload.id);
+                       }));
+    registerTransition(AbcState::B, AbcState::C, AbcEvent::E2, [&](const VariantVector_t& args) { argsE2 = args; });
+
+    initializeHsm();
+
+    //-------------------------------------------
+    // ACTIONS
+    // event is not registered or has a different payload type
+    EXPECT_FALSE(transitionWithPayload(AbcEvent::E2, frameId));
+    EXPECT_FALSE(transitionWithPayload(AbcEvent::E1, std::string("wrong type")));
+
+    ASSERT_TRUE(transitionWithPayload(AbcEvent::E1, std::move(frame), true, TIMEOUT_SYNC_TRANSITION));
+    // untyped events still work with Variant callbacks
+    ASSERT_TRUE(transitionSync(AbcEvent::E2, TIMEOUT_SYNC_TRANSITION, "test"));
+
+    //-------------------------------------------
+    // VALIDATION
+    ASSERT_TRUE(compareStateLists(getActiveStates(), {AbcState::C}));
+    EXPECT_EQ(conditionCounter, 1);
+    EXPECT_EQ(transitionCounter, 1);
+    EXPECT_EQ(stateBEnterCounter, 1);
+    EXPECT_EQ(stateBCounter, 1);
+    EXPECT_EQ(frameId, 7);
+    EXPECT_EQ(transitionData, frameData);
+
+    // event E2 doesn't have a payload
+    EXPECT_EQ(stateCCounter, 0);
+    ASSERT_EQ(argsE2.size(), 1);
+    EXPECT_EQ(argsE2[0].toString(), "test");
+}
+
+TEST_F(ABCHsm, callbacks_typed_payload_other_thread) {
+    TEST_DESCRIPTION("payload of the event processed by dispatcher must not be visible to callbacks executed by "
+                     "isTransitionPossible() on other threads");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    std::promise<void> transitionStarted;
+    std::promise<void> unblockTransition;
+    std::shared_future<void> unblockFuture = unblockTransition.get_future().share();
+    std::atomic<int> payloadConditionCalls(0);
+
+    registerEventPayload<int>(AbcEvent::E1);
+    registerState(AbcState::A);
+    registerState(AbcState::B);
+    registerState(AbcState::C);
+    registerTransition(AbcState::A,
+                       AbcState::B,
+                       AbcEvent::E1,
+                       nullptr,
+                       withPayload<int>([&](const int& payload) {
+                           transitionStarted.set_value();
+                           unblockFuture.wait();
+                           return (7 == payload);
+                       }));
+    // E2 doesn't have a payload. Condition must never see payload of E1
+    registerTransition(AbcState::A,
+                       AbcState::C,
+                       AbcEvent::E2,
+                       nullptr,
+                       withPayload<int>([&](const int& payload) {
+                           ++payloadConditionCalls;
+                           return (7 == payload);
+                       }));
+
+    initializeHsm();
+
+    //-------------------------------------------
+    // ACTIONS
+    ASSERT_TRUE(transitionWithPayload(AbcEvent::E1, 7));
+    ASSERT_EQ(transitionStarted.get_future().wait_for(std::chrono::milliseconds(TIMEOUT_SYNC_TRANSITION)),
+              std::future_status::ready);
+
+    // dispatcher is checking condition of E1 right now and state A is still active
+    const bool isPossible = isTransitionPossible(AbcEvent::E2);
+
+    unblockTransition.set_value();
+
+    //-------------------------------------------
+    // VALIDATION
+    EXPECT_FALSE(isPossible);
+    EXPECT_EQ(payloadConditionCalls.load(), 0);
+    EXPECT_TRUE(waitForState(AbcState::B, TIMEOUT_SYNC_TRANSITION));
+}
+
+TEST_F(ABCHsm, callbacks_typed_payload_nested_query) {
+    TEST_DESCRIPTION("payload of the event processed by dispatcher must not be visible to conditions of other events "
+                     "checked by isTransitionPossible() from HSM callbacks");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    bool nestedPossible = true;
+    int payloadConditionCalls = 0;
+    int transitionPayload = 0;
+
+    registerEventPayload<int>(AbcEvent::E1);
+    registerState(AbcState::A);
+    registerState(AbcState::B);
+    registerState(AbcState::C);
+    registerTransition(AbcState::A,
+                       AbcState::B,
+                       AbcEvent::E1,
+                       withPayload<int>([&](const int& payload) { transitionPayload = payload; }),
+                       withPayload<int>([&](const int& payload) {
+                           nestedPossible = isTransitionPossible(AbcEvent::E2);
+                           return (7 == payload);
+                       }));
+    // E2 doesn't have a payload. Condition must never see payload of E1 even though it has the same type
+    registerTransition(AbcState::A,
+                       AbcState::C,
+                       AbcEvent::E2,
+                       nullptr,
+                       withPayload<int>([&](const int& payload) {
+                           ++payloadConditionCalls;
+                           return (7 == payload);
+                       }));
+
+    initializeHsm();
+
+    //-------------------------------------------
+    // ACTIONS
+    ASSERT_TRUE(transitionWithPayload(AbcEvent::E1, 7, true, TIMEOUT_SYNC_TRANSITION));
+
+    //-------------------------------------------
+    // VALIDATION
+    EXPECT_FALSE(nestedPossible);
+    EXPECT_EQ(payloadConditionCalls, 0);
+    EXPECT_EQ(transitionPayload, 7);
+    ASSERT_EQ(getLastActiveState(), AbcState::B);
+}
+
 TEST_F(ABCHsm, callbacks_entering_substates) {
     TEST_DESCRIPTION("when entering a state with substates, HSM should only call it's onEnter, onState callbacks");
 
@@ -233,3 +420,67 @@ TEST_F(ABCHsm, callbacks_initial_state) {
     EXPECT_EQ(mStateCounterA, 1);
     EXPECT_EQ(mStateCounterAEnter, 1);
 }
+
+TEST_F(ABCHsm, callbacks_state_subscription) {
+    TEST_DESCRIPTION("subscribers are notified when monitored states are activated or deactivated");
+    /*
+    @startuml
+    left to right direction
+    title callbacks_state_subscription
+
+    A -> P1: E1
+    state P1 {
+        [*] -> B
+        B -> C: E1
+    }
+    P1 -> A: E2
+    @enduml
+    */
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    std::vector<std::pair<StateID_t, bool>> changes;
+
+    registerState(AbcState::A);
+    registerState(AbcState::B);
+    registerState(AbcState::C);
+
+    ASSERT_TRUE(registerSubstateEntryPoint(AbcState::P1, AbcState::B));
+    ASSERT_TRUE(registerSubstate(AbcState::P1, AbcState::C));
+
+    registerTransition(AbcState::A, AbcState::P1, AbcEvent::E1);
+    registerTransition(AbcState::B, AbcState::C, AbcEvent::E1);
+    registerTransition(AbcState::P1, AbcState::A, AbcEvent::E2);
+
+    EXPECT_EQ(subscribeStateChanges({}, [](const StateID_t, const bool) {}), INVALID_HSM_SUBSCRIPTION_ID);
+    EXPECT_EQ(subscribeStateChanges({AbcState::A}, nullptr), INVALID_HSM_SUBSCRIPTION_ID);
+
+    const SubscriptionID_t id =
+        subscribeStateChanges({AbcState::A, AbcState::B, AbcState::P1}, [&](const StateID_t state, const bool isActive) {
+            changes.emplace_back(state, isActive);
+        });
+
+    ASSERT_NE(id, INVALID_HSM_SUBSCRIPTION_ID);
+    initializeHsm();
+
+    //-------------------------------------------
+    // ACTIONS
+    ASSERT_TRUE(transitionSync(AbcEvent::E1, TIMEOUT_SYNC_TRANSITION));
+    ASSERT_TRUE(transitionSync(AbcEvent::E1, TIMEOUT_SYNC_TRANSITION));
+    ASSERT_TRUE(transitionSync(AbcEvent::E2, TIMEOUT_SYNC_TRANSITION));
+
+    unsubscribeStateChanges(id);
+    ASSERT_TRUE(transitionSync(AbcEvent::E1, TIMEOUT_SYNC_TRANSITION));
+
+    //-------------------------------------------
+    // VALIDATION
+    const std::vector<std::pair<StateID_t, bool>> expectedChanges = {{AbcState::A, true},
+                                                                     {AbcState::A, false},
+                                                                     {AbcState::P1, true},
+                                                                     {AbcState::B, true},
+                                                                     {AbcState::B, false},
+                                                                     {AbcState::P1, false},
+                                                                     {AbcState::A, true}};
+
+    EXPECT_EQ(changes, expectedChanges);
+}
@@ -1,10 +1,15 @@
 // Copyright (C) 2021 Igor Krechetov
 // Distributed under MIT license. See file LICENSE for details
+#include <atomic>
+#include <cerrno>
 #include <chrono>
+#include <condition_variable>
+#include <mutex>
 #include <thread>
 
 #include "TestsCommon.hpp"
 #include "hsm/ABCHsm.hpp"
+#include "hsmcpp/HsmEventDispatcherBase.hpp"
 
 class TestHsm: public HierarchicalStateMachine {
 public:
@@ -420,3 +425,558 @@ TEST(dispatchers, instance_ownership) {
 }
 
 // TODO: glib/glibmm dispatchers with custom context
+
+namespace {
+// emits events for "flood" handler and measures how many of them were processed before "quiet" handler was called
+size_t measureQuietHandlerDelay(const DispatcherFairnessPolicy policy, HandlerServiceStats& outFloodStats) {
+    constexpr int FLOOD_EVENTS_COUNT = 2000;
+    std::shared_ptr<hsmcpp::IHsmEventDispatcher> dispatcher;
+    std::shared_ptr<HsmEventDispatcherBase> dispatcherBase;
+    std::atomic<size_t> floodCalls(0);
+    std::atomic<size_t> floodCallsBeforeQuiet(0);
+    std::atomic<bool> quietCalled(false);
+    std::mutex syncQuiet;
+    std::condition_variable quietDone;
+    HandlerID_t floodHandler = INVALID_HSM_DISPATCHER_HANDLER_ID;
+    HandlerID_t quietHandler = INVALID_HSM_DISPATCHER_HANDLER_ID;
+    size_t floodCallsAtEmit = 0;
+
+    executeOnMainThread([&]() {
+        dispatcher = CREATE_DISPATCHER();
+        return true;
+    });
+
+    dispatcherBase = std::dynamic_pointer_cast<HsmEventDispatcherBase>(dispatcher);
+    EXPECT_TRUE(dispatcherBase);
+    dispatcherBase->setFairnessPolicy(policy);
+    dispatcherBase->setServiceTimeAccounting(true);
+
+    floodHandler = dispatcher->registerEventHandler([&]() {
+        ++floodCalls;
+        // simulate HSM which keeps processing events
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+        return true;
+    });
+    quietHandler = dispatcher->registerEventHandler([&]() {
+        floodCallsBeforeQuiet = floodCalls.load();
+        quietCalled = true;
+        std::lock_guard<std::mutex> lck(syncQuiet);
+        quietDone.notify_all();
+        return true;
+    });
+
+    EXPECT_TRUE(dispatcher->start());
+
+    // keep dispatcher busy with flood events before "quiet" handler emits its event
+    for (int i = 0; i < FLOOD_EVENTS_COUNT; ++i) {
+        dispatcher->emitEvent(floodHandler);
+    }
+
+    floodCallsAtEmit = floodCalls.load();
+    dispatcher->emitEvent(quietHandler);
+
+    {
+        std::unique_lock<std::mutex> lck(syncQuiet);
+        EXPECT_TRUE(quietDone.wait_for(lck, std::chrono::seconds(10), [&]() { return quietCalled.load(); }));
+    }
+
+    outFloodStats = dispatcherBase->getHandlerServiceStats(floodHandler);
+
+    executeOnMainThread([&]() {
+        dispatcherBase.reset();
+        dispatcher.reset();
+        return true;
+    });
+
+    return floodCallsBeforeQuiet.load() - floodCallsAtEmit;
+}
+}  // namespace
+
+TEST(dispatchers, fairness_round_robin) {
+    TEST_DESCRIPTION("quiet handler is not starved by a handler which floods dispatcher with events");
+
+    //-------------------------------------------
+    // ACTIONS
+    HandlerServiceStats floodStats;
+    const size_t fifoDelay = measureQuietHandlerDelay(DispatcherFairnessPolicy::FIFO, floodStats);
+    const size_t roundRobinDelay = measureQuietHandlerDelay(DispatcherFairnessPolicy::ROUND_ROBIN, floodStats);
+
+    //-------------------------------------------
+    // VALIDATION
+    // with FIFO policy quiet handler waits until all flood events are processed
+    EXPECT_GT(fifoDelay, 1000);
+    // with round-robin at most one flood event is processed per round (plus the round which was already running)
+    EXPECT_LE(roundRobinDelay, 2);
+    EXPECT_GT(floodStats.calls, 0);
+    EXPECT_GE(floodStats.totalServiceTimeUs, floodStats.calls * 100);
+}
+
+TEST(dispatchers, fairness_deficit_round_robin) {
+    TEST_DESCRIPTION("handler can't exceed it's service time quota while other handlers have pending events");
+
+    //-------------------------------------------
+    // ACTIONS
+    HandlerServiceStats floodStats;
+    const size_t delay = measureQuietHandlerDelay(DispatcherFairnessPolicy::DEFICIT_ROUND_ROBIN, floodStats);
+
+    //-------------------------------------------
+    // VALIDATION
+    // each flood call takes at least 100us. default quota is 1000us
+    EXPECT_LE(delay, 2 * (DISPATCHER_DEFAULT_HANDLER_QUOTA_US / 100));
+    EXPECT_GT(floodStats.calls, 0);
+    EXPECT_GE(floodStats.maxServiceTimeUs, 100);
+}
+
+#ifdef TEST_HSM_STD
+TEST(dispatchers, std_busy_polling) {
+    TEST_DESCRIPTION("events are delivered while dispatcher is busy polling and after it went to sleep");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    const int eventsCount = 100;
+    std::shared_ptr<HsmEventDispatcherSTD> dispatcher = HsmEventDispatcherSTD::create();
+    std::atomic<int> handledEvents(0);
+
+    dispatcher->setBusyPolling(1000);
+
+    const HandlerID_t handlerId = dispatcher->registerEventHandler([&]() {
+        ++handledEvents;
+        return true;
+    });
+
+    ASSERT_TRUE(dispatcher->start());
+
+    //-------------------------------------------
+    // ACTIONS
+    for (int i = 0; i < eventsCount; ++i) {
+        // alternate between events which arrive during polling and after dispatcher went to sleep
+        std::this_thread::sleep_for(std::chrono::microseconds(((i % 2) == 0) ? 10 : 2000));
+        dispatcher->emitEvent(handlerId);
+    }
+
+    //-------------------------------------------
+    // VALIDATION
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(TIMEOUT_SYNC_TRANSITION);
+
+    while ((handledEvents.load() < eventsCount) && (std::chrono::steady_clock::now() < deadline)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    EXPECT_EQ(handledEvents.load(), eventsCount);
+
+    dispatcher->stop();
+    dispatcher->join();
+}
+#endif  // TEST_HSM_STD
+
+#ifdef TEST_HSM_STD
+TEST(dispatchers, std_busy_polling_actions) {
+    TEST_DESCRIPTION("actions enqueued around the end of busy polling window must not be delayed until next event");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    const int actionsCount = 200;
+    const int pollingTimeUs = 500;
+    std::shared_ptr<HsmEventDispatcherSTD> dispatcher = HsmEventDispatcherSTD::create();
+    std::atomic<int> handledActions(0);
+    int delayedActions = 0;
+
+    dispatcher->setBusyPolling(pollingTimeUs);
+    ASSERT_TRUE(dispatcher->start());
+
+    //-------------------------------------------
+    // ACTIONS
+    for (int i = 0; i < actionsCount; ++i) {
+        // only actions are sent to dispatcher. Delay is spread around the end of polling window
+        std::this_thread::sleep_for(std::chrono::microseconds(pollingTimeUs - 100 + ((i * 7) % 200)));
+        dispatcher->enqueueAction([&]() { ++handledActions; });
+
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(100);
+
+        while ((handledActions.load() <= i) && (std::chrono::steady_clock::now() < deadline)) {
+            std::this_thread::yield();
+        }
+
+        if (handledActions.load() <= i) {
+            ++delayedActions;
+            break;
+        }
+    }
+
+    //-------------------------------------------
+    // VALIDATION
+    EXPECT_EQ(delayedActions, 0);
+    EXPECT_EQ(handledActions.load(), actionsCount);
+
+    dispatcher->stop();
+    dispatcher->join();
+}
+#endif  // TEST_HSM_STD
+
+#ifdef TEST_HSM_STD
+class NotificationsCounterDispatcher : public HsmEventDispatcherSTD {
+public:
+    NotificationsCounterDispatcher()
+        : HsmEventDispatcherSTD(DISPATCHER_DEFAULT_EVENTS_CACHESIZE) {}
+
+    ~NotificationsCounterDispatcher() override = default;
+
+    std::atomic<int> notificationsCount{0};
+
+protected:
+    void notifyDispatcherAboutEvent() override {
+        ++notificationsCount;
+        HsmEventDispatcherSTD::notifyDispatcherAboutEvent();
+    }
+};
+
+TEST(dispatchers, std_wakeup_coalescing) {
+    TEST_DESCRIPTION("burst of events emitted while dispatcher is busy results in a single dispatcher notification");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    const int eventsCount = 1000;
+    std::shared_ptr<NotificationsCounterDispatcher> dispatcher(new NotificationsCounterDispatcher(),
+                                                               [](NotificationsCounterDispatcher* ptr) { delete ptr; });
+    std::atomic<int> handledEvents(0);
+    std::atomic<bool> handlerBlocked(false);
+    std::atomic<bool> unblockHandler(false);
+
+    const HandlerID_t blockingHandlerId = dispatcher->registerEventHandler([&]() {
+        handlerBlocked.store(true);
+
+        while (false == unblockHandler.load()) {
+            std::this_thread::yield();
+        }
+
+        return true;
+    });
+    const HandlerID_t handlerId = dispatcher->registerEventHandler([&]() {
+        ++handledEvents;
+        return true;
+    });
+
+    ASSERT_TRUE(dispatcher->start());
+
+    //-------------------------------------------
+    // ACTIONS
+    dispatcher->emitEvent(blockingHandlerId);
+
+    while (false == handlerBlocked.load()) {
+        std::this_thread::yield();
+    }
+
+    const int notificationsBefore = dispatcher->notificationsCount.load();
+
+    for (int i = 0; i < eventsCount; ++i) {
+        dispatcher->emitEvent(handlerId);
+    }
+
+    const int burstNotifications = dispatcher->notificationsCount.load() - notificationsBefore;
+
+    unblockHandler.store(true);
+
+    // events emitted after dispatcher processed the burst must wake it up again
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(TIMEOUT_SYNC_TRANSITION);
+
+    while ((handledEvents.load() < eventsCount) && (std::chrono::steady_clock::now() < deadline)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    dispatcher->emitEvent(handlerId);
+
+    while ((handledEvents.load() < (eventsCount + 1)) && (std::chrono::steady_clock::now() < deadline)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    //-------------------------------------------
+    // VALIDATION
+    EXPECT_EQ(burstNotifications, 1);
+    EXPECT_EQ(handledEvents.load(), eventsCount + 1);
+
+    dispatcher->stop();
+    dispatcher->join();
+}
+#endif  // TEST_HSM_STD
+
+#ifdef TEST_HSM_STD
+#include <signal.h>
+#include <sys/time.h>
+
+namespace {
+std::atomic<HsmEventDispatcherBase*> gSignalDispatcher(nullptr);
+HandlerID_t gSignalHandlerId = INVALID_HSM_DISPATCHER_HANDLER_ID;
+std::atomic<int> gSignalEnqueued(0);
+std::atomic<int> gSignalFailed(0);
+
+void onAlarmSignal(int signo) {
+    (void)signo;
+    HsmEventDispatcherBase* dispatcher = gSignalDispatcher.load();
+
+    if (nullptr != dispatcher) {
+        if (true == dispatcher->enqueueEvent(gSignalHandlerId, 1)) {
+            ++gSignalEnqueued;
+        } else {
+            ++gSignalFailed;
+        }
+    }
+}
+}  // namespace
+
+TEST(dispatchers, std_enqueue_from_signal_handler) {
+    TEST_DESCRIPTION("events enqueued from SIGALRM handler at high rate are all either handled or reported as dropped. "
+                     "Signal is delivered to dispatcher threads while they are processing events or waiting for them");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    std::shared_ptr<HsmEventDispatcherSTD> dispatcher = HsmEventDispatcherSTD::create(64);
+    std::atomic<int> handledEvents(0);
+    struct sigaction act = {};
+    struct sigaction prevAct = {};
+    sigset_t alarmMask;
+    sigset_t prevMask;
+
+    gSignalHandlerId = dispatcher->registerEnqueuedEventHandler([&](const EventID_t event) {
+        (void)event;
+        ++handledEvents;
+        return true;
+    });
+    gSignalEnqueued = 0;
+    gSignalFailed = 0;
+
+    ASSERT_TRUE(dispatcher->start());
+
+    act.sa_handler = &onAlarmSignal;
+    act.sa_flags = SA_RESTART;
+    ASSERT_EQ(sigaction(SIGALRM, &act, &prevAct), 0);
+    gSignalDispatcher = dispatcher.get();
+
+    // block signal only on the test thread (after dispatcher started, so that its threads don't inherit the mask).
+    // This way all signals are handled by dispatcher's own threads
+    sigemptyset(&alarmMask);
+    sigaddset(&alarmMask, SIGALRM);
+    ASSERT_EQ(pthread_sigmask(SIG_BLOCK, &alarmMask, &prevMask), 0);
+
+    //-------------------------------------------
+    // ACTIONS
+    struct itimerval alarmTimer = {};
+
+    alarmTimer.it_interval.tv_usec = 500;
+    alarmTimer.it_value.tv_usec = 500;
+    ASSERT_EQ(setitimer(ITIMER_REAL, &alarmTimer, nullptr), 0);
+
+    const auto injectUntil = std::chrono::steady_clock::now() + std::chrono::milliseconds(300);
+
+    while (std::chrono::steady_clock::now() < injectUntil) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    alarmTimer = {};
+    ASSERT_EQ(setitimer(ITIMER_REAL, &alarmTimer, nullptr), 0);
+    // NOTE: signal could still be pending for the test thread. It will be handled by onAlarmSignal() after unblocking
+    ASSERT_EQ(pthread_sigmask(SIG_SETMASK, &prevMask, nullptr), 0);
+    gSignalDispatcher = nullptr;
+    ASSERT_EQ(sigaction(SIGALRM, &prevAct, nullptr), 0);
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(TIMEOUT_SYNC_TRANSITION);
+
+    while ((handledEvents.load() < gSignalEnqueued.load()) && (std::chrono::steady_clock::now() < deadline)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    //-------------------------------------------
+    // VALIDATION
+    const EventsQueueStats stats = dispatcher->getEnqueuedEventsStats();
+
+    EXPECT_GT(gSignalEnqueued.load(), 50);
+    EXPECT_EQ(handledEvents.load(), gSignalEnqueued.load());
+    EXPECT_EQ(stats.droppedEvents, static_cast<uint64_t>(gSignalFailed.load()));
+    EXPECT_EQ(stats.pendingEvents, 0u);
+
+    dispatcher->stop();
+    dispatcher->join();
+}
+#endif  // TEST_HSM_STD
+
+#if defined(TEST_HSM_STD) && defined(__linux__)
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "hsmcpp/HsmSharedEventRing.hpp"
+
+TEST(dispatchers, shared_ring_two_processes) {
+    TEST_DESCRIPTION("events posted by other processes into shared memory ring are delivered to bound HSMs in order");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    constexpr int eventsPerProducer = 2000;
+    const std::string ringName = "/hsmcpp_test_ring_" + std::to_string(getpid());
+    std::shared_ptr<HsmEventDispatcherSTD> dispatcher = HsmEventDispatcherSTD::create();
+    std::shared_ptr<HsmSharedEventRing> ring = HsmSharedEventRing::create(ringName, 32, sizeof(uint32_t));
+    HierarchicalStateMachine hsm1(AbcState::A);
+    HierarchicalStateMachine hsm2(AbcState::A);
+    std::atomic<int> receivedEvents[2] = {{0}, {0}};
+    std::atomic<int> outOfOrderEvents(0);
+
+    ASSERT_TRUE(ring != nullptr);
+    ASSERT_TRUE(ring->isReceiver());
+
+    for (int i = 0; i < 2; ++i) {
+        HierarchicalStateMachine& hsm = ((0 == i) ? hsm1 : hsm2);
+        auto onTransition = [&, i](const VariantVector_t& args) {
+            const int expected = receivedEvents[i].load();
+
+            if ((1 == args.size()) && (sizeof(uint32_t) == args[0].toByteArray().size())) {
+                uint32_t index = 0;
+
+                memcpy(&index, args[0].toByteArray().data(), sizeof(index));
+
+                if (static_cast<uint32_t>(expected) != index) {
+                    ++outOfOrderEvents;
+                }
+            } else {
+                ++outOfOrderEvents;
+            }
+
+            ++receivedEvents[i];
+        };
+
+        hsm.registerState(AbcState::A);
+        hsm.registerState(AbcState::B);
+        hsm.registerTransition(AbcState::A, AbcState::B, AbcEvent::E1, onTransition);
+        hsm.registerTransition(AbcState::B, AbcState::A, AbcEvent::E1, onTransition);
+        ASSERT_TRUE(hsm.initialize(dispatcher));
+        ASSERT_TRUE(ring->bindTarget(i + 1, hsm));
+    }
+
+    ASSERT_FALSE(ring->bindTarget(1, hsm2));
+    ASSERT_TRUE(ring->startReceiving());
+
+    //-------------------------------------------
+    // ACTIONS
+    pid_t producers[2] = {-1, -1};
+
+    for (int i = 0; i < 2; ++i) {
+        producers[i] = fork();
+        ASSERT_NE(producers[i], -1);
+
+        if (0 == producers[i]) {
+            std::shared_ptr<HsmSharedEventRing> producerRing = HsmSharedEventRing::open(ringName);
+            int exitCode = 1;
+
+            if ((producerRing != nullptr) && (false == producerRing->isReceiver())) {
+                for (uint32_t index = 0; index < static_cast<uint32_t>(eventsPerProducer); ++index) {
+                    // ring is small, so producer has to wait for receiver from time to time
+                    while (false == producerRing->post(i + 1, AbcEvent::E1, &index, sizeof(index))) {
+                        std::this_thread::yield();
+                    }
+                }
+
+                exitCode = 0;
+            }
+
+            _exit(exitCode);
+        }
+    }
+
+    for (int i = 0; i < 2; ++i) {
+        int status = -1;
+
+        ASSERT_EQ(waitpid(producers[i], &status, 0), producers[i]);
+        EXPECT_TRUE(WIFEXITED(status));
+        EXPECT_EQ(WEXITSTATUS(status), 0);
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(TIMEOUT_SYNC_TRANSITION * 10);
+
+    while (((receivedEvents[0].load() < eventsPerProducer) || (receivedEvents[1].load() < eventsPerProducer)) &&
+           (std::chrono::steady_clock::now() < deadline)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    //-------------------------------------------
+    // VALIDATION
+    EXPECT_EQ(receivedEvents[0].load(), eventsPerProducer);
+    EXPECT_EQ(receivedEvents[1].load(), eventsPerProducer);
+    EXPECT_EQ(outOfOrderEvents.load(), 0);
+    EXPECT_EQ(ring->getStats().pendingEvents, 0u);
+    EXPECT_EQ(HsmSharedEventRing::open("/hsmcpp_test_ring_missing"), nullptr);
+
+    ring->stopReceiving();
+    ring.reset();
+    EXPECT_EQ(HsmSharedEventRing::open(ringName), nullptr);
+
+    dispatcher->stop();
+    dispatcher->join();
+}
+
+TEST(dispatchers, shared_ring_create_existing) {
+    TEST_DESCRIPTION("ring owned by another receiver must not be replaced unless caller explicitly asks for it");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    const std::string ringName = "/hsmcpp_test_ring_existing_" + std::to_string(getpid());
+    std::shared_ptr<HsmSharedEventRing> ring = HsmSharedEventRing::create(ringName, 4, 8);
+
+    ASSERT_TRUE(ring != nullptr);
+
+    //-------------------------------------------
+    // ACTIONS
+    errno = 0;
+    std::shared_ptr<HsmSharedEventRing> duplicateRing = HsmSharedEventRing::create(ringName, 16, 32);
+    const int duplicateErrno = errno;
+    std::shared_ptr<HsmSharedEventRing> producerRing = HsmSharedEventRing::open(ringName);
+
+    //-------------------------------------------
+    // VALIDATION
+    EXPECT_EQ(duplicateRing, nullptr);
+    EXPECT_EQ(duplicateErrno, EEXIST);
+    // existing ring is still usable
+    ASSERT_TRUE(producerRing != nullptr);
+    EXPECT_EQ(producerRing->capacity(), 4u);
+    EXPECT_EQ(producerRing->maxPayloadSize(), 8u);
+    EXPECT_TRUE(producerRing->post(1, AbcEvent::E1));
+    EXPECT_EQ(ring->getStats().pendingEvents, 1u);
+    EXPECT_FALSE(producerRing->post(1, AbcEvent::E1, "123456789", 9));
+
+    // receiver which didn't exit properly could be replaced
+    ring.reset();
+    ring = HsmSharedEventRing::create(ringName, 4, 8);
+    ASSERT_TRUE(ring != nullptr);
+    duplicateRing = HsmSharedEventRing::create(ringName, 16, 32, true);
+    ASSERT_TRUE(duplicateRing != nullptr);
+    EXPECT_EQ(duplicateRing->capacity(), 16u);
+    EXPECT_EQ(duplicateRing->getStats().pendingEvents, 0u);
+}
+
+TEST(dispatchers, shared_ring_destroy_replaced) {
+    TEST_DESCRIPTION("destroying replaced ring must not remove shared memory of the ring which replaced it");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    const std::string ringName = "/hsmcpp_test_ring_replaced_" + std::to_string(getpid());
+    std::shared_ptr<HsmSharedEventRing> oldRing = HsmSharedEventRing::create(ringName, 4, 8);
+    std::shared_ptr<HsmSharedEventRing> newRing = HsmSharedEventRing::create(ringName, 16, 32, true);
+
+    ASSERT_TRUE(oldRing != nullptr);
+    ASSERT_TRUE(newRing != nullptr);
+
+    //-------------------------------------------
+    // ACTIONS
+    oldRing.reset();
+    std::shared_ptr<HsmSharedEventRing> producerRing = HsmSharedEventRing::open(ringName);
+
+    //-------------------------------------------
+    // VALIDATION
+    ASSERT_TRUE(producerRing != nullptr);
+    EXPECT_EQ(producerRing->capacity(), 16u);
+    EXPECT_TRUE(producerRing->post(1, AbcEvent::E1));
+    EXPECT_EQ(newRing->getStats().pendingEvents, 1u);
+
+    // owner of the name still removes it
+    producerRing.reset();
+    newRing.reset();
+    EXPECT_EQ(HsmSharedEventRing::open(ringName), nullptr);
+}
+#endif  // TEST_HSM_STD && __linux__
@@ -0,0 +1,599 @@
+// Copyright (C) 2024 Igor Krechetov
+// Distributed under MIT license. See file LICENSE for details
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include "hsm/ABCHsm.hpp"
+#include "hsmcpp/HsmEventDispatcherBase.hpp"
+
+namespace {
+struct DroppedEventInfo {
+    hsmcpp::EventID_t event;
+    VariantVector_t args;
+    EventDropReason reason;
+};
+}  // namespace
+
+// registers A -> B -> C structure where exiting A blocks dispatcher until unblockNextStep() is called
+#define SETUP_BLOCKING_HSM()                                                                          \
+  registerState<ABCHsm>(AbcState::A, this, nullptr, nullptr, &ABCHsm::onSyncAExit);                   \
+  registerState(AbcState::B);                                                                         \
+  registerState(AbcState::C);                                                                         \
+  registerTransition(AbcState::A, AbcState::B, AbcEvent::E1);                                         \
+  registerTransition(AbcState::B, AbcState::C, AbcEvent::E2);                                         \
+  registerTransition(AbcState::C, AbcState::B, AbcEvent::E2);                                         \
+  registerSelfTransition(AbcState::B, AbcEvent::E3, TransitionType::INTERNAL_TRANSITION);             \
+  registerSelfTransition(AbcState::C, AbcEvent::E3, TransitionType::INTERNAL_TRANSITION);             \
+  registerDroppedEventCallback(                                                                       \
+      [&](const hsmcpp::EventID_t event, const VariantVector_t& args, const EventDropReason reason) { \
+        droppedEvents.push_back({event, args, reason});                                               \
+      });                                                                                             \
+  initializeHsm();                                                                                    \
+  transition(AbcEvent::E1);                                                                           \
+  ASSERT_TRUE(waitAsyncOperation(false))
+
+TEST_F(ABCHsm, events_queue_drop_newest) {
+    TEST_DESCRIPTION("New events are dropped when queue is full and DROP_NEWEST policy is used");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    std::vector<DroppedEventInfo> droppedEvents;
+
+    SETUP_BLOCKING_HSM();
+    setPendingEventsLimit(2, QueueOverflowPolicy::DROP_NEWEST);
+
+    //-------------------------------------------
+    // ACTIONS
+    EXPECT_TRUE(transitionEx(AbcEvent::E2, false, false, 0, 1));
+    EXPECT_TRUE(transitionEx(AbcEvent::E2, false, false, 0, 2));
+    EXPECT_FALSE(transitionEx(AbcEvent::E2, false, false, 0, 3));
+    EXPECT_FALSE(transitionSync(AbcEvent::E3, TIMEOUT_SYNC_TRANSITION));
+
+    const EventsQueueStats stats = getPendingEventsStats();
+
+    setPendingEventsLimit(HSM_QUEUE_UNLIMITED);
+    unblockNextStep();
+    ASSERT_TRUE(transitionSync(AbcEvent::E3, TIMEOUT_SYNC_TRANSITION));
+
+    //-------------------------------------------
+    // VALIDATION
+    EXPECT_EQ(stats.pendingEvents, 2);
+    EXPECT_EQ(stats.maxPendingEvents, 2);
+    EXPECT_EQ(stats.droppedEvents, 2);
+    EXPECT_EQ(stats.coalescedEvents, 0);
+
+    ASSERT_EQ(droppedEvents.size(), 2);
+    EXPECT_EQ(droppedEvents[0].event, AbcEvent::E2);
+    EXPECT_EQ(droppedEvents[0].reason, EventDropReason::QUEUE_OVERFLOW);
+    ASSERT_EQ(droppedEvents[0].args.size(), 1);
+    EXPECT_EQ(droppedEvents[0].args[0].toInt64(), 3);
+    EXPECT_EQ(droppedEvents[1].event, AbcEvent::E3);
+
+    // E2 was processed twice: A -> B -> C -> B
+    EXPECT_TRUE(compareStateLists(getActiveStates(), {AbcState::B}));
+}
+
+TEST_F(ABCHsm, events_queue_drop_oldest) {
+    TEST_DESCRIPTION("Oldest events are dropped when queue is full and DROP_OLDEST policy is used");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    std::vector<DroppedEventInfo> droppedEvents;
+
+    SETUP_BLOCKING_HSM();
+    setPendingEventsLimit(2, QueueOverflowPolicy::DROP_OLDEST);
+
+    //-------------------------------------------
+    // ACTIONS
+    EXPECT_TRUE(transitionEx(AbcEvent::E2, false, false, 0, 1));
+    EXPECT_TRUE(transitionEx(AbcEvent::E3, false, false, 0, 2));
+    EXPECT_TRUE(transitionEx(AbcEvent::E2, false, false, 0, 3));
+
+    const EventsQueueStats stats = getPendingEventsStats();
+
+    setPendingEventsLimit(HSM_QUEUE_UNLIMITED);
+    unblockNextStep();
+    ASSERT_TRUE(transitionSync(AbcEvent::E3, TIMEOUT_SYNC_TRANSITION));
+
+    //-------------------------------------------
+    // VALIDATION
+    EXPECT_EQ(stats.pendingEvents, 2);
+    EXPECT_EQ(stats.droppedEvents, 1);
+
+    ASSERT_EQ(droppedEvents.size(), 1);
+    EXPECT_EQ(droppedEvents[0].event, AbcEvent::E2);
+    EXPECT_EQ(droppedEvents[0].reason, EventDropReason::QUEUE_OVERFLOW);
+    ASSERT_EQ(droppedEvents[0].args.size(), 1);
+    EXPECT_EQ(droppedEvents[0].args[0].toInt64(), 1);
+
+    // E2 was processed once: A -> B -> C
+    EXPECT_TRUE(compareStateLists(getActiveStates(), {AbcState::C}));
+}
+
+TEST_F(ABCHsm, events_queue_coalesce) {
+    TEST_DESCRIPTION("Pending event with the same ID is replaced when queue is full and COALESCE policy is used");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    std::vector<DroppedEventInfo> droppedEvents;
+
+    SETUP_BLOCKING_HSM();
+    setPendingEventsLimit(2, QueueOverflowPolicy::COALESCE);
+
+    //-------------------------------------------
+    // ACTIONS
+    EXPECT_TRUE(transitionEx(AbcEvent::E2, false, false, 0, 1));
+    EXPECT_TRUE(transitionEx(AbcEvent::E3, false, false, 0));
+    EXPECT_TRUE(transitionEx(AbcEvent::E2, false, false, 0, 2));
+    EXPECT_TRUE(transitionEx(AbcEvent::E2, false, false, 0, 3));
+    // there is no pending E1 to replace
+    EXPECT_FALSE(transitionEx(AbcEvent::E1, false, false, 0));
+
+    const EventsQueueStats stats = getPendingEventsStats();
+
+    setPendingEventsLimit(HSM_QUEUE_UNLIMITED);
+    unblockNextStep();
+    ASSERT_TRUE(transitionSync(AbcEvent::E3, TIMEOUT_SYNC_TRANSITION));
+
+    //-------------------------------------------
+    // VALIDATION
+    EXPECT_EQ(stats.pendingEvents, 2);
+    EXPECT_EQ(stats.droppedEvents, 1);
+    EXPECT_EQ(stats.coalescedEvents, 2);
+
+    ASSERT_EQ(droppedEvents.size(), 3);
+    EXPECT_EQ(droppedEvents[0].event, AbcEvent::E2);
+    EXPECT_EQ(droppedEvents[0].reason, EventDropReason::COALESCED);
+    EXPECT_EQ(droppedEvents[0].args[0].toInt64(), 1);
+    EXPECT_EQ(droppedEvents[1].reason, EventDropReason::COALESCED);
+    EXPECT_EQ(droppedEvents[1].args[0].toInt64(), 2);
+    EXPECT_EQ(droppedEvents[2].event, AbcEvent::E1);
+    EXPECT_EQ(droppedEvents[2].reason, EventDropReason::QUEUE_OVERFLOW);
+
+    EXPECT_TRUE(compareStateLists(getActiveStates(), {AbcState::C}));
+}
+
+TEST_F(ABCHsm, events_queue_block) {
+    TEST_DESCRIPTION("Producer is blocked when queue is full and BLOCK policy is used");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    std::vector<DroppedEventInfo> droppedEvents;
+
+    SETUP_BLOCKING_HSM();
+    setPendingEventsLimit(1, QueueOverflowPolicy::BLOCK, 100);
+
+    //-------------------------------------------
+    // ACTIONS
+    EXPECT_TRUE(transitionEx(AbcEvent::E2, false, false, 0));
+
+    // timeout expires while dispatcher is still blocked
+    auto timeStart = std::chrono::steady_clock::now();
+    EXPECT_FALSE(transitionEx(AbcEvent::E2, false, false, 0));
+    auto blockedMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - timeStart);
+
+    // producer is unblocked once dispatcher processes pending event
+    setPendingEventsLimit(1, QueueOverflowPolicy::BLOCK, HSM_WAIT_INDEFINITELY);
+
+    bool blockedProducerResult = false;
+    std::thread producer([&]() { blockedProducerResult = transitionEx(AbcEvent::E2, false, false, 0); });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    unblockNextStep();
+    producer.join();
+    ASSERT_TRUE(transitionSync(AbcEvent::E3, TIMEOUT_SYNC_TRANSITION));
+
+    //-------------------------------------------
+    // VALIDATION
+    EXPECT_GE(blockedMs.count(), 90);
+    EXPECT_TRUE(blockedProducerResult);
+    EXPECT_EQ(getPendingEventsStats().droppedEvents, 1);
+    ASSERT_EQ(droppedEvents.size(), 1);
+    EXPECT_EQ(droppedEvents[0].reason, EventDropReason::QUEUE_OVERFLOW);
+
+    EXPECT_TRUE(compareStateLists(getActiveStates(), {AbcState::B}));
+}
+
+TEST_F(ABCHsm, events_queue_block_multiple_producers) {
+    TEST_DESCRIPTION("Producers blocked on a full queue must not steal free space from each other and drop events");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    const int producersCount = 8;
+    const int eventsPerProducer = 50;
+    std::vector<DroppedEventInfo> droppedEvents;
+    std::atomic<int> startedProducers(0);
+    std::atomic<int> acceptedEvents(0);
+    std::vector<std::thread> producers;
+
+    SETUP_BLOCKING_HSM();
+    setPendingEventsLimit(1, QueueOverflowPolicy::BLOCK, HSM_WAIT_INDEFINITELY);
+    EXPECT_TRUE(transitionEx(AbcEvent::E3, false, false, 0));
+
+    //-------------------------------------------
+    // ACTIONS
+    for (int i = 0; i < producersCount; ++i) {
+        producers.emplace_back([&]() {
+            ++startedProducers;
+
+            for (int j = 0; j < eventsPerProducer; ++j) {
+                if (true == transitionEx(AbcEvent::E3, false, false, 0)) {
+                    ++acceptedEvents;
+                }
+            }
+        });
+    }
+
+    while (startedProducers.load() < producersCount) {
+        std::this_thread::yield();
+    }
+
+    // let all producers block on the full queue
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    unblockNextStep();
+
+    for (std::thread& curThread : producers) {
+        curThread.join();
+    }
+
+    ASSERT_TRUE(transitionSync(AbcEvent::E3, TIMEOUT_SYNC_TRANSITION));
+
+    //-------------------------------------------
+    // VALIDATION
+    EXPECT_EQ(acceptedEvents.load(), producersCount * eventsPerProducer);
+    EXPECT_EQ(getPendingEventsStats().droppedEvents, 0);
+    EXPECT_TRUE(droppedEvents.empty());
+    EXPECT_TRUE(compareStateLists(getActiveStates(), {AbcState::B}));
+}
+
+TEST_F(ABCHsm, events_queue_dispatcher_coalesce) {
+    TEST_DESCRIPTION("Dispatcher can coalesce pending events without affecting HSM events processing");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    std::vector<DroppedEventInfo> droppedEvents;
+
+    SETUP_BLOCKING_HSM();
+
+    auto dispatcher = std::dynamic_pointer_cast<HsmEventDispatcherBase>(gDispatcher);
+    ASSERT_TRUE(dispatcher);
+    const EventsQueueStats statsBefore = dispatcher->getPendingEventsStats();
+
+    dispatcher->setPendingEventsLimit(1, QueueOverflowPolicy::COALESCE);
+
+    //-------------------------------------------
+    // ACTIONS
+    for (int i = 0; i < 5; ++i) {
+        transition(AbcEvent::E2);
+    }
+
+    const EventsQueueStats statsAfter = dispatcher->getPendingEventsStats();
+
+    unblockNextStep();
+    const bool flushResult = transitionSync(AbcEvent::E3, TIMEOUT_SYNC_TRANSITION);
+    dispatcher->setPendingEventsLimit(HSM_QUEUE_UNLIMITED);
+
+    //-------------------------------------------
+    // VALIDATION
+    ASSERT_TRUE(flushResult);
+    EXPECT_GT(statsAfter.coalescedEvents, statsBefore.coalescedEvents);
+    EXPECT_TRUE(droppedEvents.empty());
+
+    // all 5 E2 events were processed: A -> B -> C -> B -> C -> B -> C
+    EXPECT_TRUE(compareStateLists(getActiveStates(), {AbcState::C}));
+}
+
+TEST_F(ABCHsm, events_queue_dispatcher_overflow) {
+    TEST_DESCRIPTION("Dispatcher overflow policies never drop the only pending event of HSM");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    const QueueOverflowPolicy policies[] = {QueueOverflowPolicy::DROP_NEWEST,
+                                            QueueOverflowPolicy::DROP_OLDEST,
+                                            QueueOverflowPolicy::COALESCE};
+
+    registerState(AbcState::A);
+    registerState(AbcState::B);
+    registerTransition(AbcState::A, AbcState::B, AbcEvent::E1);
+    registerTransition(AbcState::B, AbcState::A, AbcEvent::E1);
+    initializeHsm();
+
+    auto dispatcher = std::dynamic_pointer_cast<HsmEventDispatcherBase>(gDispatcher);
+    ASSERT_TRUE(dispatcher);
+
+    for (const QueueOverflowPolicy policy : policies) {
+        std::promise<void> handlerStarted;
+        std::promise<void> unblockHandler;
+        std::shared_future<void> unblockFuture = unblockHandler.get_future().share();
+        bool isFirstCall = true;
+        const StateID_t targetState = (true == isStateActive(AbcState::A) ? AbcState::B : AbcState::A);
+        const HandlerID_t blockingHandler = dispatcher->registerEventHandler([&]() {
+            if (true == isFirstCall) {
+                isFirstCall = false;
+                handlerStarted.set_value();
+                unblockFuture.wait();
+            }
+            return true;
+        });
+
+        dispatcher->setPendingEventsLimit(1, policy);
+        dispatcher->emitEvent(blockingHandler);
+        ASSERT_EQ(handlerStarted.get_future().wait_for(std::chrono::milliseconds(TIMEOUT_SYNC_TRANSITION)),
+                  std::future_status::ready);
+
+        //-------------------------------------------
+        // ACTIONS
+        // dispatcher is busy and its queue is full with events of another handler
+        dispatcher->emitEvent(blockingHandler);
+        const bool wasAccepted = transitionEx(AbcEvent::E1, false, false, 0);
+
+        const EventsQueueStats stats = dispatcher->getPendingEventsStats();
+
+        unblockHandler.set_value();
+
+        //-------------------------------------------
+        // VALIDATION
+        EXPECT_TRUE(wasAccepted);
+        EXPECT_EQ(stats.pendingEvents, 2);
+        // NOTE: transition() is not called again, so HSM can process E1 only if its dispatcher event wasn't dropped
+        EXPECT_TRUE(waitForState(targetState, TIMEOUT_SYNC_TRANSITION)) << "policy=" << static_cast<int>(policy);
+
+        dispatcher->setPendingEventsLimit(HSM_QUEUE_UNLIMITED);
+        dispatcher->unregisterEventHandler(blockingHandler);
+    }
+}
+
+TEST_F(ABCHsm, events_queue_coalesced_event) {
+    TEST_DESCRIPTION("Pending instance of registered coalesced event is replaced by the latest one (latest-wins)");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    std::vector<DroppedEventInfo> droppedEvents;
+
+    registerState<ABCHsm>(AbcState::A, this, nullptr, nullptr, &ABCHsm::onSyncAExit);
+    registerState(AbcState::B);
+    registerState(AbcState::C);
+    registerTransition(AbcState::A, AbcState::B, AbcEvent::E1);
+    registerTransition<ABCHsm>(AbcState::B, AbcState::C, AbcEvent::E2, this, &ABCHsm::onE2Transition);
+    registerSelfTransition(AbcState::B, AbcEvent::E3, TransitionType::INTERNAL_TRANSITION);
+    registerSelfTransition(AbcState::C, AbcEvent::E3, TransitionType::INTERNAL_TRANSITION);
+    registerCoalescedEvent(AbcEvent::E2);
+    registerDroppedEventCallback([&](const hsmcpp::EventID_t event, const VariantVector_t& args, const EventDropReason reason) {
+        droppedEvents.push_back({event, args, reason});
+    });
+    initializeHsm();
+    transition(AbcEvent::E1);
+    ASSERT_TRUE(waitAsyncOperation(false));
+
+    //-------------------------------------------
+    // ACTIONS
+    EXPECT_TRUE(transitionEx(AbcEvent::E2, false, false, 0, 1));
+    EXPECT_TRUE(transitionEx(AbcEvent::E3, false, false, 0));
+    EXPECT_TRUE(transitionEx(AbcEvent::E2, false, false, 0, 2));
+    EXPECT_TRUE(transitionEx(AbcEvent::E2, false, false, 0, 3));
+
+    const EventsQueueStats stats = getPendingEventsStats();
+
+    unblockNextStep();
+    ASSERT_TRUE(transitionSync(AbcEvent::E3, TIMEOUT_SYNC_TRANSITION));
+
+    //-------------------------------------------
+    // VALIDATION
+    EXPECT_EQ(stats.pendingEvents, 2);
+    EXPECT_EQ(stats.droppedEvents, 0);
+    EXPECT_EQ(stats.coalescedEvents, 2);
+
+    ASSERT_EQ(droppedEvents.size(), 2);
+    EXPECT_EQ(droppedEvents[0].event, AbcEvent::E2);
+    EXPECT_EQ(droppedEvents[0].reason, EventDropReason::COALESCED);
+    EXPECT_EQ(droppedEvents[0].args[0].toInt64(), 1);
+    EXPECT_EQ(droppedEvents[1].reason, EventDropReason::COALESCED);
+    EXPECT_EQ(droppedEvents[1].args[0].toInt64(), 2);
+
+    // only the latest E2 was processed
+    EXPECT_EQ(mTransitionCounterE2, 1);
+    ASSERT_EQ(mTransitionArgsE2.size(), 1);
+    EXPECT_EQ(mTransitionArgsE2[0].toInt64(), 3);
+    EXPECT_TRUE(compareStateLists(getActiveStates(), {AbcState::C}));
+}
+
+TEST_F(ABCHsm, events_queue_ttl) {
+    TEST_DESCRIPTION("Events which spent in the queue more time than their TTL are discarded without processing");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    std::vector<DroppedEventInfo> droppedEvents;
+
+    SETUP_BLOCKING_HSM();
+    registerEventTTL(AbcEvent::E2, 200);
+
+    //-------------------------------------------
+    // ACTIONS
+    EXPECT_TRUE(transitionEx(AbcEvent::E2, false, false, 0, 1));
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    EXPECT_TRUE(transitionEx(AbcEvent::E2, false, false, 0, 2));
+
+    unblockNextStep();
+    ASSERT_TRUE(transitionSync(AbcEvent::E3, TIMEOUT_SYNC_TRANSITION));
+
+    //-------------------------------------------
+    // VALIDATION
+    const EventsQueueStats stats = getPendingEventsStats();
+
+    EXPECT_EQ(stats.expiredEvents, 1);
+    EXPECT_EQ(stats.droppedEvents, 0);
+
+    ASSERT_EQ(droppedEvents.size(), 1);
+    EXPECT_EQ(droppedEvents[0].event, AbcEvent::E2);
+    EXPECT_EQ(droppedEvents[0].reason, EventDropReason::EXPIRED);
+    ASSERT_EQ(droppedEvents[0].args.size(), 1);
+    EXPECT_EQ(droppedEvents[0].args[0].toInt64(), 1);
+
+    // only second E2 was processed: A -> B -> C
+    EXPECT_TRUE(compareStateLists(getActiveStates(), {AbcState::C}));
+}
+
+TEST_F(ABCHsm, events_queue_cancel) {
+    TEST_DESCRIPTION("Pending events can be selectively canceled by ID or by filter");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    std::vector<DroppedEventInfo> droppedEvents;
+
+    SETUP_BLOCKING_HSM();
+
+    //-------------------------------------------
+    // ACTIONS
+    EXPECT_TRUE(transitionEx(AbcEvent::E2, false, false, 0, 1));
+    EXPECT_TRUE(transitionEx(AbcEvent::E3, false, false, 0));
+    EXPECT_TRUE(transitionEx(AbcEvent::E2, false, false, 0, 2));
+
+    bool syncResult = true;
+    std::thread syncProducer([&]() { syncResult = transitionSync(AbcEvent::E2, TIMEOUT_SYNC_TRANSITION, 3); });
+
+    while (getPendingEventsStats().pendingEvents < 4) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    const size_t canceledById = cancelPendingEvents(AbcEvent::E2);
+    syncProducer.join();
+
+    // nothing to cancel
+    const size_t canceledNothing = cancelPendingEvents(AbcEvent::E1);
+
+    EXPECT_TRUE(transitionEx(AbcEvent::E2, false, false, 0, 5));
+    EXPECT_TRUE(transitionEx(AbcEvent::E2, false, false, 0, 6));
+    const size_t canceledByFilter = cancelPendingEvents([](const hsmcpp::EventID_t event, const VariantVector_t& args) {
+        return (AbcEvent::E2 == event) && (false == args.empty()) && (5 == args[0].toInt64());
+    });
+
+    const EventsQueueStats stats = getPendingEventsStats();
+
+    unblockNextStep();
+    ASSERT_TRUE(transitionSync(AbcEvent::E3, TIMEOUT_SYNC_TRANSITION));
+
+    //-------------------------------------------
+    // VALIDATION
+    EXPECT_EQ(canceledById, 3);
+    EXPECT_EQ(canceledNothing, 0);
+    EXPECT_EQ(canceledByFilter, 1);
+    EXPECT_FALSE(syncResult);
+
+    EXPECT_EQ(stats.pendingEvents, 2);
+    EXPECT_EQ(stats.canceledEvents, 4);
+    EXPECT_EQ(stats.droppedEvents, 0);
+    EXPECT_TRUE(droppedEvents.empty());
+
+    // only E2 with argument 6 was processed: A -> B -> C
+    EXPECT_TRUE(compareStateLists(getActiveStates(), {AbcState::C}));
+}
+
+TEST_F(ABCHsm, events_queue_cancel_filter_reentrant) {
+    TEST_DESCRIPTION("Cancel filter is allowed to call HSM API. Events added while filter is running are not canceled");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    std::vector<DroppedEventInfo> droppedEvents;
+    size_t filterCalls = 0;
+    size_t pendingEventsInFilter = 0;
+
+    SETUP_BLOCKING_HSM();
+
+    //-------------------------------------------
+    // ACTIONS
+    EXPECT_TRUE(transitionEx(AbcEvent::E2, false, false, 0, 1));
+    EXPECT_TRUE(transitionEx(AbcEvent::E2, false, false, 0, 2));
+
+    const size_t canceledEvents = cancelPendingEvents([&](const hsmcpp::EventID_t event, const VariantVector_t& args) {
+        ++filterCalls;
+        pendingEventsInFilter = getPendingEventsStats().pendingEvents;
+        // new event has the same ID and arguments, but it must not be affected by this cancel request
+        (void)transitionEx(AbcEvent::E2, false, false, 0, 1);
+        return (AbcEvent::E2 == event) && (1 == args[0].toInt64());
+    });
+
+    const EventsQueueStats stats = getPendingEventsStats();
+
+    unblockNextStep();
+    ASSERT_TRUE(transitionSync(AbcEvent::E3, TIMEOUT_SYNC_TRANSITION));
+
+    //-------------------------------------------
+    // VALIDATION
+    EXPECT_EQ(filterCalls, 2);
+    EXPECT_GE(pendingEventsInFilter, 2);
+    EXPECT_EQ(canceledEvents, 1);
+    EXPECT_EQ(stats.pendingEvents, 3);
+    EXPECT_EQ(stats.canceledEvents, 1);
+
+    // E2 with argument 2 and two new E2 events were processed: A -> B -> C -> B -> C
+    EXPECT_TRUE(compareStateLists(getActiveStates(), {AbcState::C}));
+}
+
+TEST_F(ABCHsm, events_queue_async_canceled) {
+    TEST_DESCRIPTION("Completion callback of async transition reports events which were removed from the queue");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    std::vector<DroppedEventInfo> droppedEvents;
+    std::vector<TransitionResult> results;
+
+    SETUP_BLOCKING_HSM();
+    setPendingEventsLimit(1, QueueOverflowPolicy::DROP_NEWEST);
+
+    auto onCompleted = [&](const hsmcpp::EventID_t, const TransitionResult result) { results.push_back(result); };
+
+    //-------------------------------------------
+    // ACTIONS
+    EXPECT_TRUE(transitionAsync(AbcEvent::E2, onCompleted));
+    // queue is full
+    EXPECT_FALSE(transitionAsync(AbcEvent::E2, onCompleted));
+    EXPECT_EQ(cancelPendingEvents(AbcEvent::E2), 1);
+
+    setPendingEventsLimit(HSM_QUEUE_UNLIMITED);
+    unblockNextStep();
+    ASSERT_TRUE(transitionSync(AbcEvent::E3, TIMEOUT_SYNC_TRANSITION));
+
+    //-------------------------------------------
+    // VALIDATION
+    ASSERT_EQ(results.size(), 2);
+    EXPECT_EQ(results[0], TransitionResult::CANCELED);
+    EXPECT_EQ(results[1], TransitionResult::CANCELED);
+    EXPECT_TRUE(compareStateLists(getActiveStates(), {AbcState::B}));
+}
+
+TEST_F(ABCHsm, events_queue_clear_repost_from_callback) {
+    TEST_DESCRIPTION("Completion callback of event removed by clearQueue could send new events to the same HSM");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    std::vector<DroppedEventInfo> droppedEvents;
+    std::vector<TransitionResult> results;
+    bool repostResult = false;
+
+    SETUP_BLOCKING_HSM();
+
+    //-------------------------------------------
+    // ACTIONS
+    EXPECT_TRUE(transitionAsync(AbcEvent::E3, [&](const hsmcpp::EventID_t, const TransitionResult result) {
+        results.push_back(result);
+
+        if (TransitionResult::CANCELED == result) {
+            repostResult = transitionAsync(AbcEvent::E2, nullptr);
+        }
+    }));
+    EXPECT_TRUE(transitionEx(AbcEvent::E2, true, false, 0));
+
+    unblockNextStep();
+    ASSERT_TRUE(transitionSync(AbcEvent::E3, TIMEOUT_SYNC_TRANSITION));
+
+    //-------------------------------------------
+    // VALIDATION
+    ASSERT_EQ(results.size(), 1);
+    EXPECT_EQ(results[0], TransitionResult::CANCELED);
+    EXPECT_TRUE(repostResult);
+    // E2 (B -> C) followed by re-posted E2 (C -> B)
+    EXPECT_TRUE(compareStateLists(getActiveStates(), {AbcState::B}));
+}
@@ -0,0 +1,197 @@
+// Copyright (C) 2024 Igor Krechetov
+// Distributed under MIT license. See file LICENSE for details
+#include <hsmcpp/HsmCoroutines.hpp>
+
+#ifdef HSM_COROUTINES_AVAILABLE
+#include <exception>
+#include <future>
+#include <functional>
+#include <list>
+#include <thread>
+
+#include "hsm/ABCHsm.hpp"
+
+namespace {
+
+// minimal eagerly started coroutine which reports completion through a promise
+struct TestTask {
+    struct promise_type {
+        TestTask get_return_object() noexcept {
+            return {};
+        }
+        std::suspend_never initial_suspend() noexcept {
+            return {};
+        }
+        std::suspend_never final_suspend() noexcept {
+            return {};
+        }
+        void return_void() noexcept {}
+        void unhandled_exception() {
+            std::terminate();
+        }
+    };
+};
+
+TestTask runTransitions(hsmcpp::HierarchicalStateMachine& hsm, std::promise<std::list<TransitionResult>>& done) {
+    std::list<TransitionResult> results;
+
+    results.push_back(co_await transitionAwait(hsm, AbcEvent::E1, 1, "arg"));
+    // no transition for E3 in state B
+    results.push_back(co_await transitionAwait(hsm, AbcEvent::E3));
+    results.push_back(co_await transitionAwait(hsm, AbcEvent::E1));
+    done.set_value(results);
+}
+
+TestTask runStateWait(hsmcpp::HierarchicalStateMachine& hsm,
+                      const hsmcpp::StateID_t state,
+                      const int timeoutMs,
+                      std::promise<bool>& done) {
+    done.set_value(co_await waitForStateAwait(hsm, state, timeoutMs));
+}
+
+TestTask runTransitionWithExecutor(hsmcpp::HierarchicalStateMachine& hsm,
+                                   HsmCompletionExecutor_t executor,
+                                   std::promise<TransitionResult>& done) {
+    done.set_value(co_await transitionAwaitWithExecutor(hsm, executor, AbcEvent::E1));
+}
+
+}  // namespace
+
+TEST_F(ABCHsm, coroutine_transition_await) {
+    TEST_DESCRIPTION("Coroutine is suspended until transition is processed and receives transition result");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    std::promise<std::list<TransitionResult>> done;
+
+    registerState(AbcState::A);
+    registerState(AbcState::B);
+    registerState(AbcState::C);
+    registerTransition(AbcState::A, AbcState::B, AbcEvent::E1);
+    registerTransition(AbcState::B, AbcState::C, AbcEvent::E1);
+
+    initializeHsm();
+
+    //-------------------------------------------
+    // ACTIONS
+    (void)runTransitions(*this, done);
+
+    auto future = done.get_future();
+
+    ASSERT_EQ(future.wait_for(std::chrono::milliseconds(TIMEOUT_SYNC_TRANSITION)), std::future_status::ready);
+
+    //-------------------------------------------
+    // VALIDATION
+    EXPECT_EQ(future.get(),
+              std::list<TransitionResult>({TransitionResult::SUCCEEDED, TransitionResult::FAILED, TransitionResult::SUCCEEDED}));
+    EXPECT_TRUE(compareStateLists(getActiveStates(), {AbcState::C}));
+}
+
+TEST_F(ABCHsm, coroutine_transition_await_executor) {
+    TEST_DESCRIPTION("Coroutine is resumed using provided executor");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    std::promise<TransitionResult> done;
+    std::promise<std::function<void()>> postedTask;
+
+    registerState(AbcState::A);
+    registerState(AbcState::B);
+    registerTransition(AbcState::A, AbcState::B, AbcEvent::E1);
+
+    initializeHsm();
+
+    //-------------------------------------------
+    // ACTIONS
+    (void)runTransitionWithExecutor(
+        *this,
+        [&](std::function<void()> task) { postedTask.set_value(std::move(task)); },
+        done);
+
+    auto futureTask = postedTask.get_future();
+    auto future = done.get_future();
+
+    ASSERT_EQ(futureTask.wait_for(std::chrono::milliseconds(TIMEOUT_SYNC_TRANSITION)), std::future_status::ready);
+
+    // coroutine must not be resumed until executor runs the task
+    EXPECT_EQ(future.wait_for(std::chrono::milliseconds(0)), std::future_status::timeout);
+
+    futureTask.get()();
+
+    //-------------------------------------------
+    // VALIDATION
+    ASSERT_EQ(future.wait_for(std::chrono::milliseconds(0)), std::future_status::ready);
+    EXPECT_EQ(future.get(), TransitionResult::SUCCEEDED);
+}
+
+TEST_F(ABCHsm, coroutine_transition_await_not_initialized) {
+    TEST_DESCRIPTION("Coroutine is not suspended if HSM is not initialized");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    std::promise<TransitionResult> done;
+    std::promise<bool> doneState;
+
+    registerState(AbcState::A);
+    registerState(AbcState::B);
+    registerTransition(AbcState::A, AbcState::B, AbcEvent::E1);
+
+    //-------------------------------------------
+    // ACTIONS
+    (void)runTransitionWithExecutor(*this, nullptr, done);
+    (void)runStateWait(*this, AbcState::B, HSM_WAIT_INDEFINITELY, doneState);
+
+    auto future = done.get_future();
+    auto futureState = doneState.get_future();
+
+    //-------------------------------------------
+    // VALIDATION
+    ASSERT_EQ(future.wait_for(std::chrono::milliseconds(0)), std::future_status::ready);
+    ASSERT_EQ(futureState.wait_for(std::chrono::milliseconds(0)), std::future_status::ready);
+    EXPECT_EQ(future.get(), TransitionResult::CANCELED);
+    EXPECT_FALSE(futureState.get());
+}
+
+TEST_F(ABCHsm, coroutine_wait_for_state) {
+    TEST_DESCRIPTION("Coroutine is suspended until state becomes active or timeout expires");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    std::promise<bool> doneActive;
+    std::promise<bool> doneB;
+    std::promise<bool> doneTimeout;
+
+    registerState(AbcState::A);
+    registerState(AbcState::B);
+    registerState(AbcState::C);
+    registerTransition(AbcState::A, AbcState::B, AbcEvent::E1);
+
+    initializeHsm();
+
+    //-------------------------------------------
+    // ACTIONS
+    (void)runStateWait(*this, AbcState::A, HSM_WAIT_INDEFINITELY, doneActive);
+    (void)runStateWait(*this, AbcState::B, HSM_WAIT_INDEFINITELY, doneB);
+    (void)runStateWait(*this, AbcState::C, 50, doneTimeout);
+
+    auto futureActive = doneActive.get_future();
+    auto futureB = doneB.get_future();
+    auto futureTimeout = doneTimeout.get_future();
+
+    // already active state doesn't suspend coroutine
+    ASSERT_EQ(futureActive.wait_for(std::chrono::milliseconds(0)), std::future_status::ready);
+    EXPECT_EQ(futureB.wait_for(std::chrono::milliseconds(0)), std::future_status::timeout);
+
+    ASSERT_TRUE(transitionSync(AbcEvent::E1, TIMEOUT_SYNC_TRANSITION));
+
+    ASSERT_EQ(futureB.wait_for(std::chrono::milliseconds(TIMEOUT_SYNC_TRANSITION)), std::future_status::ready);
+    ASSERT_EQ(futureTimeout.wait_for(std::chrono::milliseconds(TIMEOUT_SYNC_TRANSITION)), std::future_status::ready);
+
+    //-------------------------------------------
+    // VALIDATION
+    EXPECT_TRUE(futureActive.get());
+    EXPECT_TRUE(futureB.get());
+    EXPECT_FALSE(futureTimeout.get());
+}
+
+#endif  // HSM_COROUTINES_AVAILABLE
@@ -0,0 +1,537 @@
+// Copyright (C) 2024 Igor Krechetov
+// Distributed under MIT license. See file LICENSE for details
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "hsm/ABCHsm.hpp"
+#include "hsmcpp/HsmDispatcherGroup.hpp"
+#include "hsmcpp/HsmGroup.hpp"
+
+namespace {
+constexpr size_t GROUP_MEMBERS_COUNT = 3;
+constexpr size_t GROUP_SHARDS_COUNT = 3;
+
+// keeps arguments object received by each member
+struct ReceivedArgs {
+    std::mutex sync;
+    std::vector<const VariantVector_t*> args;
+};
+
+std::unique_ptr<HierarchicalStateMachine> createMember(ReceivedArgs& received) {
+    std::unique_ptr<HierarchicalStateMachine> hsm(new HierarchicalStateMachine(AbcState::A));
+
+    hsm->registerState(AbcState::A);
+    hsm->registerState(AbcState::B);
+    hsm->registerTransition(AbcState::A, AbcState::B, AbcEvent::E1, [&received](const VariantVector_t& args) {
+        std::lock_guard<std::mutex> lck(received.sync);
+        received.args.push_back(&args);
+    });
+    hsm->registerTransition(AbcState::B, AbcState::A, AbcEvent::E2);
+
+    return hsm;
+}
+
+// dispatchers must be created and destroyed on main thread
+std::unique_ptr<HsmDispatcherGroup> createDispatcherGroup() {
+    std::unique_ptr<HsmDispatcherGroup> group;
+
+    executeOnMainThread([&]() {
+        group.reset(new HsmDispatcherGroup(GROUP_SHARDS_COUNT, [](const size_t) { return CREATE_DISPATCHER(); }));
+        return true;
+    });
+
+    return group;
+}
+
+void destroyDispatcherGroup(std::unique_ptr<HsmDispatcherGroup>& group) {
+    executeOnMainThread([&]() {
+        group.reset();
+        return true;
+    });
+}
+}  // namespace
+
+TEST_F(ABCHsm, group_broadcast) {
+    TEST_DESCRIPTION("Broadcast event is delivered to all members of the group with the same arguments object");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    ReceivedArgs received;
+    std::vector<std::unique_ptr<HierarchicalStateMachine>> members;
+
+    registerState(AbcState::A);
+    registerState(AbcState::B);
+    registerTransition(AbcState::A, AbcState::B, AbcEvent::E1);
+    initializeHsm();
+
+    HsmGroup group(gDispatcher);
+
+    ASSERT_TRUE(group.isValid());
+    ASSERT_TRUE(group.addMember(*this));
+
+    for (size_t i = 0; i < GROUP_MEMBERS_COUNT; ++i) {
+        members.emplace_back(createMember(received));
+        ASSERT_TRUE(members.back()->initialize(gDispatcher));
+        ASSERT_TRUE(group.addMember(*members.back()));
+    }
+
+    // adding same HSM twice is not allowed
+    EXPECT_FALSE(group.addMember(*this));
+    EXPECT_EQ(group.getMembersCount(), GROUP_MEMBERS_COUNT + 1);
+
+    //-------------------------------------------
+    // ACTIONS
+    ASSERT_TRUE(group.broadcast(AbcEvent::E1, 7, "arg"));
+
+    //-------------------------------------------
+    // VALIDATION
+    EXPECT_TRUE(waitForState(AbcState::B, TIMEOUT_SYNC_TRANSITION));
+
+    for (auto& member : members) {
+        EXPECT_TRUE(member->waitForState(AbcState::B, TIMEOUT_SYNC_TRANSITION));
+    }
+
+    std::lock_guard<std::mutex> lck(received.sync);
+
+    ASSERT_EQ(received.args.size(), GROUP_MEMBERS_COUNT);
+
+    for (const VariantVector_t* args : received.args) {
+        // all members must receive the same instance of arguments
+        EXPECT_EQ(args, received.args.front());
+    }
+}
+
+TEST_F(ABCHsm, group_remove_member) {
+    TEST_DESCRIPTION("Removed and destroyed members don't receive broadcast events");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    ReceivedArgs received;
+    std::unique_ptr<HierarchicalStateMachine> destroyedMember = createMember(received);
+
+    registerState(AbcState::A);
+    registerState(AbcState::B);
+    registerTransition(AbcState::A, AbcState::B, AbcEvent::E1);
+    initializeHsm();
+
+    std::unique_ptr<HierarchicalStateMachine> member = createMember(received);
+    HsmGroup group(gDispatcher);
+
+    ASSERT_TRUE(member->initialize(gDispatcher));
+    ASSERT_TRUE(destroyedMember->initialize(gDispatcher));
+    ASSERT_TRUE(group.addMember(*this));
+    ASSERT_TRUE(group.addMember(*member));
+    ASSERT_TRUE(group.addMember(*destroyedMember));
+
+    //-------------------------------------------
+    // ACTIONS
+    group.removeMember(*this);
+    destroyedMember.reset();
+
+    ASSERT_TRUE(group.broadcast(AbcEvent::E1));
+    ASSERT_TRUE(member->waitForState(AbcState::B, TIMEOUT_SYNC_TRANSITION));
+    // E2 is not handled in A. used to make sure HSM processed all previously queued events
+    (void)transitionSync(AbcEvent::E2, TIMEOUT_SYNC_TRANSITION);
+
+    //-------------------------------------------
+    // VALIDATION
+    EXPECT_TRUE(compareStateLists(getActiveStates(), {AbcState::A}));
+    // destroyed member is removed from the group automatically
+    EXPECT_EQ(group.getMembersCount(), 1);
+
+    std::lock_guard<std::mutex> lck(received.sync);
+    EXPECT_EQ(received.args.size(), 1);
+}
+
+TEST_F(ABCHsm, group_invalid_dispatcher) {
+    TEST_DESCRIPTION("Group without a dispatcher doesn't accept broadcasts");
+
+    //-------------------------------------------
+    // ACTIONS
+    HsmGroup group(nullptr);
+
+    //-------------------------------------------
+    // VALIDATION
+    EXPECT_FALSE(group.isValid());
+    EXPECT_FALSE(group.broadcast(AbcEvent::E1, 1));
+}
+
+TEST_F(ABCHsm, dispatcher_group_placement) {
+    TEST_DESCRIPTION("HSMs are placed on shards with the smallest load or based on a placement key");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    ReceivedArgs received;
+    std::vector<std::unique_ptr<HierarchicalStateMachine>> members;
+    std::unique_ptr<HierarchicalStateMachine> hashedMember = createMember(received);
+    std::unique_ptr<HsmDispatcherGroup> group = createDispatcherGroup();
+
+    ASSERT_EQ(group->getShardsCount(), GROUP_SHARDS_COUNT);
+
+    //-------------------------------------------
+    // ACTIONS
+    for (size_t i = 0; i < GROUP_SHARDS_COUNT; ++i) {
+        members.emplace_back(createMember(received));
+        EXPECT_EQ(group->attach(*members.back()), i);
+    }
+
+    const size_t hashedShard = group->attach(*hashedMember, ShardPlacementPolicy::HASH, 7);
+
+    //-------------------------------------------
+    // VALIDATION
+    for (size_t i = 0; i < GROUP_SHARDS_COUNT; ++i) {
+        EXPECT_TRUE(members[i]->isInitialized());
+        EXPECT_EQ(group->getShardIndex(*members[i]), i);
+        EXPECT_EQ(members[i]->dispatcher().lock(), group->getShard(i));
+    }
+
+    ASSERT_NE(hashedShard, INVALID_HSM_SHARD_INDEX);
+    EXPECT_EQ(group->getShardLoad(hashedShard), 2);
+    // HSM can be attached only once
+    EXPECT_EQ(group->attach(*hashedMember, ShardPlacementPolicy::HASH, 7), INVALID_HSM_SHARD_INDEX);
+
+    // same key is always mapped to the same shard
+    group->detach(*hashedMember);
+    EXPECT_EQ(group->getShardIndex(*hashedMember), INVALID_HSM_SHARD_INDEX);
+    EXPECT_EQ(group->attach(*hashedMember, ShardPlacementPolicy::HASH, 7), hashedShard);
+
+    // destroyed HSMs are not counted
+    members[0].reset();
+    EXPECT_EQ(group->getShardLoad(0), 0);
+
+    members.clear();
+    hashedMember.reset();
+    destroyDispatcherGroup(group);
+}
+
+// NOTE: test needs dispatchers which are running on their own threads
+#if defined(TEST_HSM_STD) || defined(TEST_HSM_FREERTOS)
+TEST_F(ABCHsm, dispatcher_group_migrate) {
+    TEST_DESCRIPTION("HSM is moved to a different shard together with it's pending events and running timers");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    const TimerID_t timerId = 1;
+    std::promise<void> unblockShard;
+    std::promise<std::thread::id> shardBlocked;
+    std::mutex syncThreads;
+    std::vector<std::thread::id> transitionThreads;
+    auto onTransition = [&](const VariantVector_t&) {
+        std::lock_guard<std::mutex> lck(syncThreads);
+        transitionThreads.push_back(std::this_thread::get_id());
+    };
+    std::unique_ptr<HsmDispatcherGroup> group = createDispatcherGroup();
+
+    registerState(AbcState::A);
+    registerState(AbcState::B);
+    registerState(AbcState::C);
+    registerTransition(AbcState::A, AbcState::B, AbcEvent::E1, onTransition);
+    registerTransition(AbcState::B, AbcState::C, AbcEvent::E1, onTransition);
+    registerTransition(AbcState::C, AbcState::A, AbcEvent::E2, onTransition);
+    registerTimer(timerId, AbcEvent::E2);
+
+    ASSERT_EQ(group->attach(*this), 0);
+
+    // block dispatcher of the first shard so that HSM events stay in the queue
+    auto shard = group->getShard(0);
+    auto blockedFuture = unblockShard.get_future();
+    const HandlerID_t blockingHandler = shard->registerEventHandler([&]() {
+        shardBlocked.set_value(std::this_thread::get_id());
+        blockedFuture.wait();
+        return true;
+    });
+
+    shard->emitEvent(blockingHandler);
+
+    auto shardThreadFuture = shardBlocked.get_future();
+
+    ASSERT_EQ(shardThreadFuture.wait_for(std::chrono::milliseconds(TIMEOUT_SYNC_TRANSITION)), std::future_status::ready);
+    const std::thread::id blockedThread = shardThreadFuture.get();
+
+    transition(AbcEvent::E1);
+    transition(AbcEvent::E1);
+    startTimer(timerId, 200, false);
+
+    //-------------------------------------------
+    // ACTIONS
+    ASSERT_TRUE(group->migrate(*this, 1));
+
+    //-------------------------------------------
+    // VALIDATION
+    EXPECT_EQ(group->getShardIndex(*this), 1);
+    EXPECT_EQ(dispatcher().lock(), group->getShard(1));
+    EXPECT_TRUE(isTimerRunning(timerId));
+    EXPECT_TRUE(waitForState(AbcState::C, TIMEOUT_SYNC_TRANSITION));
+    // timer restarted on the new shard
+    EXPECT_TRUE(waitForState(AbcState::A, TIMEOUT_SYNC_TRANSITION));
+    // repeating timer keeps running after the first expiration
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_TRUE(isTimerRunning(timerId));
+    stopTimer(timerId);
+
+    unblockShard.set_value();
+
+    {
+        std::lock_guard<std::mutex> lck(syncThreads);
+
+        ASSERT_EQ(transitionThreads.size(), 3);
+
+        for (const std::thread::id& curThread : transitionThreads) {
+            EXPECT_NE(curThread, blockedThread);
+            EXPECT_NE(curThread, std::this_thread::get_id());
+        }
+    }
+
+    shard->unregisterEventHandler(blockingHandler);
+    release();
+    destroyDispatcherGroup(group);
+}
+
+TEST_F(ABCHsm, dispatcher_group_migrate_interrupt_safe_events) {
+    TEST_DESCRIPTION("Events enqueued with transitionInterruptSafe() to the old shard are processed after migration");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    std::promise<void> unblockShard;
+    std::promise<void> shardBlocked;
+    std::unique_ptr<HsmDispatcherGroup> group = createDispatcherGroup();
+
+    registerState(AbcState::A);
+    registerState(AbcState::B);
+    registerState(AbcState::C);
+    registerTransition(AbcState::A, AbcState::B, AbcEvent::E1);
+    registerTransition(AbcState::B, AbcState::C, AbcEvent::E1);
+
+    ASSERT_EQ(group->attach(*this), 0);
+
+    // block dispatcher of the first shard so that enqueued events stay in it
+    auto shard = group->getShard(0);
+    auto blockedFuture = unblockShard.get_future();
+    const HandlerID_t blockingHandler = shard->registerEventHandler([&]() {
+        shardBlocked.set_value();
+        blockedFuture.wait();
+        return true;
+    });
+
+    shard->emitEvent(blockingHandler);
+    ASSERT_EQ(shardBlocked.get_future().wait_for(std::chrono::milliseconds(TIMEOUT_SYNC_TRANSITION)),
+              std::future_status::ready);
+
+    ASSERT_TRUE(transitionInterruptSafe(AbcEvent::E1));
+    ASSERT_TRUE(transitionInterruptSafe(AbcEvent::E1));
+
+    //-------------------------------------------
+    // ACTIONS
+    ASSERT_TRUE(group->migrate(*this, 1));
+    unblockShard.set_value();
+
+    //-------------------------------------------
+    // VALIDATION
+    EXPECT_TRUE(waitForState(AbcState::C, TIMEOUT_SYNC_TRANSITION));
+    EXPECT_EQ(dispatcher().lock(), group->getShard(1));
+
+    shard->unregisterEventHandler(blockingHandler);
+    release();
+    destroyDispatcherGroup(group);
+}
+
+TEST_F(ABCHsm, dispatcher_group_migrate_from_callback) {
+    TEST_DESCRIPTION("Migration requested from HSM callback is rejected instead of blocking dispatcher forever");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    std::unique_ptr<HsmDispatcherGroup> group = createDispatcherGroup();
+    bool migrateResult = true;
+
+    registerState(AbcState::A);
+    registerState(AbcState::B);
+    registerTransition(AbcState::A, AbcState::B, AbcEvent::E1, [&](const VariantVector_t&) {
+        migrateResult = migrate(group->getShard(1));
+    });
+
+    ASSERT_EQ(group->attach(*this), 0);
+
+    //-------------------------------------------
+    // ACTIONS
+    ASSERT_TRUE(transitionSync(AbcEvent::E1, TIMEOUT_SYNC_TRANSITION));
+
+    //-------------------------------------------
+    // VALIDATION
+    EXPECT_FALSE(migrateResult);
+    EXPECT_EQ(dispatcher().lock(), group->getShard(0));
+    EXPECT_TRUE(compareStateLists(getActiveStates(), {AbcState::B}));
+
+    release();
+    destroyDispatcherGroup(group);
+}
+
+TEST_F(ABCHsm, group_modify_members_from_callback) {
+    TEST_DESCRIPTION("Member callbacks called while broadcast is delivered are allowed to modify the group");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    ReceivedArgs received;
+    std::shared_ptr<IHsmEventDispatcher> memberDispatcher;
+    std::promise<void> dispatcherBlocked;
+    std::promise<void> unblockDispatcher;
+    std::promise<void> droppedEventReported;
+    std::shared_future<void> unblockFuture = unblockDispatcher.get_future().share();
+
+    registerState(AbcState::A);
+    registerState(AbcState::B);
+    registerTransition(AbcState::A, AbcState::B, AbcEvent::E1);
+    initializeHsm();
+    executeOnMainThread([&]() {
+        memberDispatcher = CREATE_DISPATCHER();
+        return true;
+    });
+
+    std::unique_ptr<HierarchicalStateMachine> member = createMember(received);
+    HsmGroup group(gDispatcher);
+
+    ASSERT_TRUE(member->initialize(memberDispatcher));
+    ASSERT_TRUE(group.addMember(*member));
+    member->setPendingEventsLimit(1, QueueOverflowPolicy::DROP_NEWEST);
+    // called on the group's dispatcher thread while broadcast is delivered to member
+    member->registerDroppedEventCallback([&](const hsmcpp::EventID_t, const VariantVector_t&, const EventDropReason) {
+        group.removeMember(*member);
+        (void)group.addMember(*this);
+        droppedEventReported.set_value();
+    });
+
+    // block member's dispatcher so that broadcast events stay in member's queue
+    const HandlerID_t blockingHandler = memberDispatcher->registerEventHandler([&]() {
+        dispatcherBlocked.set_value();
+        unblockFuture.wait();
+        return true;
+    });
+
+    memberDispatcher->emitEvent(blockingHandler);
+    ASSERT_EQ(dispatcherBlocked.get_future().wait_for(std::chrono::milliseconds(TIMEOUT_SYNC_TRANSITION)),
+              std::future_status::ready);
+
+    //-------------------------------------------
+    // ACTIONS
+    ASSERT_TRUE(group.broadcast(AbcEvent::E1));
+    // member's queue is full. event is dropped
+    ASSERT_TRUE(group.broadcast(AbcEvent::E1));
+
+    const std::future_status callbackStatus =
+        droppedEventReported.get_future().wait_for(std::chrono::milliseconds(TIMEOUT_SYNC_TRANSITION));
+
+    // this HSM was added to the group by the callback
+    ASSERT_TRUE(group.broadcast(AbcEvent::E1));
+    const bool newMemberReceivedEvent = waitForState(AbcState::B, TIMEOUT_SYNC_TRANSITION);
+
+    unblockDispatcher.set_value();
+
+    //-------------------------------------------
+    // VALIDATION
+    EXPECT_EQ(callbackStatus, std::future_status::ready);
+    EXPECT_TRUE(newMemberReceivedEvent);
+    EXPECT_TRUE(member->waitForState(AbcState::B, TIMEOUT_SYNC_TRANSITION));
+    EXPECT_EQ(group.getMembersCount(), 1);
+
+    memberDispatcher->unregisterEventHandler(blockingHandler);
+    member->release();
+    executeOnMainThread([&]() {
+        memberDispatcher.reset();
+        return true;
+    });
+}
+
+TEST_F(ABCHsm, group_fair_delivery) {
+    TEST_DESCRIPTION("Group delivers broadcast to one member per dispatch slot and doesn't delay other handlers");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    ReceivedArgs received;
+    std::vector<std::unique_ptr<HierarchicalStateMachine>> members;
+    std::shared_ptr<IHsmEventDispatcher> membersDispatcher;
+    std::promise<void> dispatcherBlocked;
+    std::promise<void> unblockDispatcher;
+    std::promise<void> unblockMembers;
+    std::promise<size_t> otherHandlerCalled;
+    std::shared_future<void> unblockFuture = unblockDispatcher.get_future().share();
+    std::shared_future<void> unblockMembersFuture = unblockMembers.get_future().share();
+
+    registerState(AbcState::A);
+    initializeHsm();
+    executeOnMainThread([&]() {
+        membersDispatcher = CREATE_DISPATCHER();
+        return true;
+    });
+
+    HsmGroup group(gDispatcher);
+
+    for (size_t i = 0; i < GROUP_MEMBERS_COUNT; ++i) {
+        members.emplace_back(createMember(received));
+        ASSERT_TRUE(members.back()->initialize(membersDispatcher));
+        ASSERT_TRUE(group.addMember(*members.back()));
+    }
+
+    // counts events which were delivered to members. members' dispatcher is blocked so they can't process them
+    auto countDeliveredEvents = [&]() {
+        size_t delivered = 0;
+
+        for (auto& member : members) {
+            delivered += member->getPendingEventsStats().pendingEvents;
+        }
+
+        return delivered;
+    };
+    const HandlerID_t blockingHandler = gDispatcher->registerEventHandler([&]() {
+        dispatcherBlocked.set_value();
+        unblockFuture.wait();
+        return true;
+    });
+    const HandlerID_t otherHandler = gDispatcher->registerEventHandler([&]() {
+        otherHandlerCalled.set_value(countDeliveredEvents());
+        return true;
+    });
+    const HandlerID_t membersBlockingHandler = membersDispatcher->registerEventHandler([&]() {
+        unblockMembersFuture.wait();
+        return true;
+    });
+
+    membersDispatcher->emitEvent(membersBlockingHandler);
+    gDispatcher->emitEvent(blockingHandler);
+    ASSERT_EQ(dispatcherBlocked.get_future().wait_for(std::chrono::milliseconds(TIMEOUT_SYNC_TRANSITION)),
+              std::future_status::ready);
+
+    //-------------------------------------------
+    // ACTIONS
+    ASSERT_TRUE(group.broadcast(AbcEvent::E1));
+    gDispatcher->emitEvent(otherHandler);
+    unblockDispatcher.set_value();
+
+    auto otherHandlerFuture = otherHandlerCalled.get_future();
+
+    const std::future_status otherHandlerStatus =
+        otherHandlerFuture.wait_for(std::chrono::milliseconds(TIMEOUT_SYNC_TRANSITION));
+
+    unblockMembers.set_value();
+
+    //-------------------------------------------
+    // VALIDATION
+    ASSERT_EQ(otherHandlerStatus, std::future_status::ready);
+    // other handler was called after the first member received the event
+    EXPECT_EQ(otherHandlerFuture.get(), 1);
+
+    for (auto& member : members) {
+        EXPECT_TRUE(member->waitForState(AbcState::B, TIMEOUT_SYNC_TRANSITION));
+    }
+
+    gDispatcher->unregisterEventHandler(blockingHandler);
+    gDispatcher->unregisterEventHandler(otherHandler);
+    membersDispatcher->unregisterEventHandler(membersBlockingHandler);
+    members.clear();
+    executeOnMainThread([&]() {
+        membersDispatcher.reset();
+        return true;
+    });
+}
+#endif  // TEST_HSM_STD || TEST_HSM_FREERTOS
@@ -0,0 +1,295 @@
+// Copyright (C) 2024 Igor Krechetov
+// Distributed under MIT license. See file LICENSE for details
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include "hsm/ABCHsm.hpp"
+#include "hsmcpp/HsmMemoryResource.hpp"
+
+namespace {
+
+// forwards all requests to the global heap and checks that every block is returned to the same resource
+class CountingMemoryResource : public HsmMemoryResource {
+public:
+    size_t allocationsCount() {
+        std::lock_guard<std::mutex> lck(mSync);
+        return mAllocationsCount;
+    }
+
+    size_t allocatedBlocks() {
+        std::lock_guard<std::mutex> lck(mSync);
+        return mBlocks.size();
+    }
+
+    size_t invalidDeallocations() {
+        std::lock_guard<std::mutex> lck(mSync);
+        return mInvalidDeallocations;
+    }
+
+protected:
+    void* doAllocate(const size_t bytes, const size_t alignment) override {
+        void* p = getDefaultMemoryResource()->allocate(bytes, alignment);
+        std::lock_guard<std::mutex> lck(mSync);
+
+        ++mAllocationsCount;
+        mBlocks[p] = bytes;
+        return p;
+    }
+
+    void doDeallocate(void* p, const size_t bytes, const size_t alignment) override {
+        {
+            std::lock_guard<std::mutex> lck(mSync);
+            auto it = mBlocks.find(p);
+
+            if ((mBlocks.end() != it) && (bytes == it->second)) {
+                mBlocks.erase(it);
+            } else {
+                ++mInvalidDeallocations;
+            }
+        }
+
+        getDefaultMemoryResource()->deallocate(p, bytes, alignment);
+    }
+
+private:
+    std::mutex mSync;
+    std::map<void*, size_t> mBlocks;
+    size_t mAllocationsCount = 0;
+    size_t mInvalidDeallocations = 0;
+};
+
+std::shared_ptr<IHsmEventDispatcher> createDispatcher() {
+    std::shared_ptr<IHsmEventDispatcher> dispatcher;
+
+    executeOnMainThread([&]() {
+        dispatcher = CREATE_DISPATCHER();
+        return true;
+    });
+
+    return dispatcher;
+}
+
+void destroyDispatcher(std::shared_ptr<IHsmEventDispatcher>& dispatcher) {
+    executeOnMainThread([&]() {
+        dispatcher.reset();
+        return true;
+    });
+}
+
+void registerAbcStructure(HierarchicalStateMachine& hsm) {
+    hsm.registerState(AbcState::A);
+    hsm.registerState(AbcState::B);
+    hsm.registerState(AbcState::C);
+    hsm.registerState(AbcState::D);
+    ASSERT_TRUE(hsm.registerSubstateEntryPoint(AbcState::C, AbcState::D));
+    hsm.registerTransition(AbcState::A, AbcState::B, AbcEvent::E1);
+    hsm.registerTransition(AbcState::B, AbcState::C, AbcEvent::E1);
+    hsm.registerTransition(AbcState::C, AbcState::A, AbcEvent::E2);
+    hsm.registerTimer(1, AbcEvent::E3);
+}
+}  // namespace
+
+TEST(memory_resource, hsm_allocations) {
+    TEST_DESCRIPTION("HSM structure and runtime objects should be allocated from provided memory resources");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    CountingMemoryResource structureResource;
+    CountingMemoryResource runtimeResource;
+    std::shared_ptr<IHsmEventDispatcher> dispatcher = createDispatcher();
+
+    {
+        HierarchicalStateMachine hsm(AbcState::A, &structureResource, &runtimeResource);
+
+        registerAbcStructure(hsm);
+
+        const size_t structureAllocations = structureResource.allocationsCount();
+
+        EXPECT_GT(structureAllocations, 0);
+        EXPECT_EQ(runtimeResource.allocationsCount(), 0);
+        ASSERT_TRUE(hsm.initialize(dispatcher));
+
+        //-------------------------------------------
+        // ACTIONS
+        EXPECT_TRUE(hsm.transitionSync(AbcEvent::E1, TIMEOUT_SYNC_TRANSITION, 1, "arg"));
+        EXPECT_TRUE(hsm.transitionSync(AbcEvent::E1, TIMEOUT_SYNC_TRANSITION));
+        EXPECT_TRUE(hsm.isStateActive(AbcState::D));
+        EXPECT_TRUE(hsm.transitionSync(AbcEvent::E2, TIMEOUT_SYNC_TRANSITION));
+
+        //-------------------------------------------
+        // VALIDATION
+        EXPECT_EQ(hsm.getActiveStates(), std::list<StateID_t>({AbcState::A}));
+        // structure is not modified while HSM is running
+        EXPECT_EQ(structureResource.allocationsCount(), structureAllocations);
+        EXPECT_GT(runtimeResource.allocationsCount(), 0);
+
+        hsm.release();
+    }
+
+    destroyDispatcher(dispatcher);
+
+    // all memory must be returned to the resource it was taken from
+    EXPECT_EQ(structureResource.allocatedBlocks(), 0);
+    EXPECT_EQ(runtimeResource.allocatedBlocks(), 0);
+    EXPECT_EQ(structureResource.invalidDeallocations(), 0);
+    EXPECT_EQ(runtimeResource.invalidDeallocations(), 0);
+}
+
+TEST(memory_resource, hsm_structure_arena) {
+    TEST_DESCRIPTION("HSM structure could be allocated from a monotonic arena");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    CountingMemoryResource upstream;
+    std::shared_ptr<IHsmEventDispatcher> dispatcher = createDispatcher();
+
+    {
+        HsmMonotonicMemoryResource arena(256, &upstream);
+        HierarchicalStateMachine hsm(AbcState::A, &arena, nullptr);
+
+        registerAbcStructure(hsm);
+        ASSERT_TRUE(hsm.initialize(dispatcher));
+
+        //-------------------------------------------
+        // ACTIONS
+        EXPECT_TRUE(hsm.transitionSync(AbcEvent::E1, TIMEOUT_SYNC_TRANSITION));
+        EXPECT_TRUE(hsm.transitionSync(AbcEvent::E1, TIMEOUT_SYNC_TRANSITION));
+
+        //-------------------------------------------
+        // VALIDATION
+        EXPECT_TRUE(hsm.isStateActive(AbcState::D));
+        EXPECT_GT(upstream.allocationsCount(), 0);
+        hsm.release();
+    }
+
+    destroyDispatcher(dispatcher);
+    EXPECT_EQ(upstream.allocatedBlocks(), 0);
+    EXPECT_EQ(upstream.invalidDeallocations(), 0);
+}
+
+TEST(memory_resource, monotonic_arena) {
+    TEST_DESCRIPTION("arena should use external buffer first and request new blocks from upstream when it's exhausted");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    CountingMemoryResource upstream;
+    alignas(std::max_align_t) unsigned char buffer[64] = {0};
+
+    {
+        HsmMonotonicMemoryResource arena(buffer, sizeof(buffer), &upstream);
+
+        //-------------------------------------------
+        // ACTIONS
+        void* p1 = arena.allocate(1, 1);
+        void* p2 = arena.allocate(8, 8);
+        void* p3 = arena.allocate(128, 16);
+        void* p4 = arena.allocate(8, 8);
+
+        //-------------------------------------------
+        // VALIDATION
+        EXPECT_EQ(p1, static_cast<void*>(buffer));
+        EXPECT_EQ(p2, static_cast<void*>(buffer + 8));
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(p3) % 16, 0);
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(p4) % 8, 0);
+        EXPECT_EQ(upstream.allocationsCount(), 1);
+
+        // deallocate doesn't release memory
+        arena.deallocate(p3, 128, 16);
+        EXPECT_EQ(upstream.allocatedBlocks(), 1);
+
+        arena.release();
+        EXPECT_EQ(upstream.allocatedBlocks(), 0);
+        EXPECT_EQ(arena.allocate(1, 1), static_cast<void*>(buffer));
+        (void)arena.allocate(256, 8);
+    }
+
+    EXPECT_EQ(upstream.allocationsCount(), 2);
+    EXPECT_EQ(upstream.allocatedBlocks(), 0);
+}
+
+#ifdef TEST_HSM_STD
+TEST(memory_resource, dispatcher_allocations) {
+    TEST_DESCRIPTION("dispatcher should allocate handlers, timers and pending events from provided memory resource");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    CountingMemoryResource resource;
+
+    {
+        auto dispatcher = HsmEventDispatcherSTD::create(DISPATCHER_DEFAULT_EVENTS_CACHESIZE, &resource);
+        std::promise<void> handlerCalled;
+        std::promise<void> timerFired;
+        bool timerWasFired = false;
+
+        ASSERT_TRUE(dispatcher->start());
+
+        const HandlerID_t handlerId = dispatcher->registerEventHandler([&]() {
+            handlerCalled.set_value();
+            return true;
+        });
+        const HandlerID_t timerHandlerId = dispatcher->registerTimerHandler([&](const TimerID_t) {
+            if (false == timerWasFired) {
+                timerWasFired = true;
+                timerFired.set_value();
+            }
+            return false;
+        });
+
+        //-------------------------------------------
+        // ACTIONS
+        dispatcher->emitEvent(handlerId);
+        dispatcher->startTimer(timerHandlerId, 1, 10, true);
+
+        //-------------------------------------------
+        // VALIDATION
+        EXPECT_EQ(handlerCalled.get_future().wait_for(std::chrono::milliseconds(TIMEOUT_SYNC_TRANSITION)),
+                  std::future_status::ready);
+        EXPECT_EQ(timerFired.get_future().wait_for(std::chrono::milliseconds(TIMEOUT_SYNC_TRANSITION)),
+                  std::future_status::ready);
+        EXPECT_GT(resource.allocationsCount(), 0);
+
+        dispatcher->unregisterEventHandler(handlerId);
+        dispatcher->unregisterTimerHandler(timerHandlerId);
+        dispatcher->stop();
+        dispatcher->join();
+    }
+
+    EXPECT_EQ(resource.allocatedBlocks(), 0);
+    EXPECT_EQ(resource.invalidDeallocations(), 0);
+}
+#endif  // TEST_HSM_STD
+
+#ifdef HSM_HAS_STD_PMR
+TEST(memory_resource, std_pmr) {
+    TEST_DESCRIPTION("std::pmr resources could be used through HsmPmrMemoryResource adapter");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    std::pmr::monotonic_buffer_resource arena;
+    std::pmr::synchronized_pool_resource pool;
+    HsmPmrMemoryResource structureResource(&arena);
+    HsmPmrMemoryResource runtimeResource(&pool);
+    std::shared_ptr<IHsmEventDispatcher> dispatcher = createDispatcher();
+
+    {
+        HierarchicalStateMachine hsm(AbcState::A, &structureResource, &runtimeResource);
+
+        registerAbcStructure(hsm);
+        ASSERT_TRUE(hsm.initialize(dispatcher));
+
+        //-------------------------------------------
+        // ACTIONS
+        EXPECT_TRUE(hsm.transitionSync(AbcEvent::E1, TIMEOUT_SYNC_TRANSITION, 1, "arg"));
+        EXPECT_TRUE(hsm.transitionSync(AbcEvent::E1, TIMEOUT_SYNC_TRANSITION));
+
+        //-------------------------------------------
+        // VALIDATION
+        EXPECT_TRUE(hsm.isStateActive(AbcState::D));
+        hsm.release();
+    }
+
+    destroyDispatcher(dispatcher);
+}
+#endif  // HSM_HAS_STD_PMR
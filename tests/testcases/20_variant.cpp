@@ -2,7 +2,9 @@
 // Distributed under MIT license. See file LICENSE for details
 #include "TestsCommon.hpp"
 #include "hsmcpp/variant.hpp"
+#include "hsmcpp/VariantSerializer.hpp"
 #include <inttypes.h>
+#include <limits>
 
 constexpr int gIndexValue = 0;
 constexpr int gIndexValueLess = 1;
@@ -1286,6 +1288,160 @@ TEST(variant, map) {
                                                      [](const Variant& v){ return v.toString(); })));
 }
 
+TEST(variant, map_lookup) {
+    TEST_DESCRIPTION("map keys are ordered and numeric keys are found regardless of their type");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    VariantMap_t m;
+
+    //-------------------------------------------
+    // ACTIONS
+    m.emplace(Variant("key"), Variant(1));
+    m.emplace(Variant(static_cast<uint32_t>(10)), Variant(2));
+    m.emplace(Variant(-5), Variant(3));
+    m.emplace(Variant(true), Variant(4));
+    m[Variant(2.5)] = Variant(5);
+    const bool duplicateInserted = m.emplace(Variant(static_cast<int8_t>(10)), Variant(6)).second;
+
+    //-------------------------------------------
+    // VALIDATION
+    EXPECT_FALSE(duplicateInserted);
+    ASSERT_EQ(m.size(), 5);
+
+    // numeric keys go first and are sorted by value. other types are sorted by Variant::Type
+    auto it = m.begin();
+    EXPECT_EQ((it++)->first, Variant(-5));
+    EXPECT_EQ((it++)->first, Variant(2.5));
+    EXPECT_EQ((it++)->first, Variant(10));
+    EXPECT_EQ((it++)->first, Variant(true));
+    EXPECT_EQ((it++)->first, Variant("key"));
+
+    EXPECT_EQ(m.at(Variant(static_cast<uint64_t>(10))), Variant(2));
+    EXPECT_EQ(m.at(Variant(10.0)), Variant(2));
+    EXPECT_EQ(m.at(Variant(std::string("key"))), Variant(1));
+    EXPECT_EQ(m.count(Variant(static_cast<uint8_t>(5))), 0);
+    EXPECT_THROW(m.at(Variant("missing")), std::out_of_range);
+
+    EXPECT_EQ(m.erase(Variant(-5)), 1);
+    EXPECT_EQ(m.find(Variant(-5)), m.end());
+    EXPECT_EQ(m.size(), 4);
+
+    EXPECT_LT(Variant(-1).compare(Variant(static_cast<uint64_t>(0))), 0);
+    EXPECT_GT(Variant(static_cast<uint64_t>(UINT64_MAX)).compare(Variant(INT64_MAX)), 0);
+    EXPECT_EQ(Variant(static_cast<int16_t>(7)).compare(Variant(7.0)), 0);
+    EXPECT_EQ(Variant().compare(Variant()), 0);
+    EXPECT_LT(Variant().compare(Variant("a")), 0);
+}
+
+TEST(variant, hash) {
+    TEST_DESCRIPTION("equal variants should have the same hash and can be used as keys of unordered containers");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    struct HashableType {
+        int value = 0;
+
+        bool operator>(const HashableType& val) const {
+            return (value > val.value);
+        }
+
+        bool operator==(const HashableType& val) const {
+            return (value == val.value);
+        }
+    };
+    const CustomType notHashable("abc", 17);
+    VariantUnorderedMap_t m;
+    VariantMap_t nested = {{Variant("a"), Variant(1)}, {Variant("b"), Variant(2)}};
+
+    //-------------------------------------------
+    // ACTIONS
+    m[Variant(static_cast<uint8_t>(1))] = Variant("one");
+    m[Variant("two")] = Variant(2);
+    m[Variant(ByteArray_t{1, 2, 3})] = Variant(3);
+    m[Variant(nested)] = Variant(4);
+
+    //-------------------------------------------
+    // VALIDATION
+    EXPECT_EQ(Variant(static_cast<int64_t>(7)).hash(), Variant(static_cast<uint16_t>(7)).hash());
+    EXPECT_EQ(Variant(static_cast<int64_t>(7)).hash(), Variant(7.0).hash());
+    EXPECT_EQ(Variant(std::string("abc")).hash(), Variant("abc").hash());
+    EXPECT_EQ(Variant(notHashable).hash(), Variant(notHashable).hash());
+    EXPECT_TRUE(Variant::make(std::wstring(L"custom")).isCustomType());
+    EXPECT_EQ(Variant::make(std::wstring(L"custom")).hash(), std::hash<std::wstring>()(L"custom"));
+    EXPECT_EQ(Variant::make(HashableType()).hash(), 0);
+    EXPECT_NE(Variant(VariantVector_t{Variant(1), Variant(2)}).hash(), Variant(VariantVector_t{Variant(2), Variant(1)}).hash());
+
+    ASSERT_EQ(m.size(), 4);
+    EXPECT_EQ(m.at(Variant(1)), Variant("one"));
+    EXPECT_EQ(m.at(Variant(std::string("two"))), Variant(2));
+    EXPECT_EQ(m.at(Variant(ByteArray_t{1, 2, 3})), Variant(3));
+    EXPECT_EQ(m.at(Variant(nested)), Variant(4));
+    EXPECT_EQ(m.count(Variant(ByteArray_t{1, 2})), 0);
+}
+
+TEST(variant, numeric_equality_consistency) {
+    TEST_DESCRIPTION("operator==, compare() and hash() should agree for numeric values of all types");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    const std::vector<Variant> values = {Variant(static_cast<int8_t>(-1)),
+                                         Variant(static_cast<int64_t>(INT64_MIN)),
+                                         Variant(-9.5e18),
+                                         Variant(-1.0),
+                                         Variant(-0.5),
+                                         Variant(-0.0),
+                                         Variant(static_cast<uint8_t>(0)),
+                                         Variant(1.0),
+                                         Variant(1.000000005),
+                                         Variant(static_cast<uint32_t>(1)),
+                                         Variant(static_cast<int64_t>(INT64_MAX)),
+                                         Variant(9223372036854775808.0),
+                                         Variant(static_cast<uint64_t>(9223372036854775808ULL)),
+                                         Variant(static_cast<uint64_t>(UINT64_MAX)),
+                                         Variant(1.0e20),
+                                         Variant(std::numeric_limits<double>::infinity()),
+                                         Variant(std::numeric_limits<double>::quiet_NaN()),
+                                         Variant(-std::numeric_limits<double>::quiet_NaN())};
+
+    //-------------------------------------------
+    // ACTIONS / VALIDATION
+    for (size_t i = 0; i < values.size(); ++i) {
+        for (size_t j = 0; j < values.size(); ++j) {
+            const Variant& a = values[i];
+            const Variant& b = values[j];
+            const int ab = a.compare(b);
+
+            // antisymmetric
+            EXPECT_EQ((ab > 0), (b.compare(a) < 0)) << "i=" << i << ", j=" << j;
+            EXPECT_EQ((0 == ab), (a == b)) << "i=" << i << ", j=" << j;
+
+            if (a == b) {
+                EXPECT_EQ(a.hash(), b.hash()) << "i=" << i << ", j=" << j;
+            }
+
+            // transitive
+            for (size_t k = 0; k < values.size(); ++k) {
+                const int bc = b.compare(values[k]);
+
+                if ((ab <= 0) && (bc <= 0)) {
+                    EXPECT_LE(a.compare(values[k]), 0) << "i=" << i << ", j=" << j << ", k=" << k;
+                }
+            }
+        }
+    }
+
+    EXPECT_NE(Variant(1.0), Variant(1.000000005));
+    EXPECT_LT(Variant(1.0).compare(Variant(1.000000005)), 0);
+    EXPECT_NE(Variant(-1), Variant(static_cast<uint64_t>(UINT64_MAX)));
+    EXPECT_LT(Variant(-1).compare(Variant(static_cast<uint64_t>(UINT64_MAX))), 0);
+    EXPECT_TRUE(Variant(static_cast<uint64_t>(UINT64_MAX)) > Variant(-1));
+    EXPECT_EQ(Variant(9223372036854775808.0), Variant(static_cast<uint64_t>(9223372036854775808ULL)));
+    EXPECT_NE(Variant(static_cast<int64_t>(INT64_MAX)), Variant(9223372036854775808.0));
+    EXPECT_EQ(Variant(-0.0), Variant(0));
+    EXPECT_EQ(Variant(std::numeric_limits<double>::quiet_NaN()), Variant(std::numeric_limits<double>::quiet_NaN()));
+}
+
 TEST(variant, pair_conversion) {
     TEST_DESCRIPTION("validate converting pair value to custom std::pair object");
 
@@ -1446,3 +1602,428 @@ TEST(variant, customtype_move) {
     v2.clear();
     ASSERT_TRUE(wasObjectDeleted);
 }
+
+// =================================================================================================================
+// serialization
+VariantSerializer createCustomTypeSerializer() {
+    return VariantSerializer(
+        [](const Variant& value, ByteArray_t& output) {
+            std::shared_ptr<CustomType> custom = value.getCustomType<CustomType>();
+
+            output.assign(custom->a.begin(), custom->a.end());
+            output.push_back(0);
+            output.push_back(static_cast<unsigned char>(custom->b));
+            return true;
+        },
+        [](const unsigned char* data, const size_t size, Variant& output) {
+            const std::string a(reinterpret_cast<const char*>(data));
+            bool res = false;
+
+            if (size == a.size() + 2) {
+                output = Variant::make(CustomType(a, data[size - 1]));
+                res = true;
+            }
+
+            return res;
+        });
+}
+
+TEST_P(FixtureVariantAllTypes, serialization) {
+    TEST_DESCRIPTION("all types should be restored after binary serialization");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    const int valueId = GetParam();
+    const auto values = std::get<gIndexValue>(allTypeValues);
+    const VariantSerializer serializer = createCustomTypeSerializer();
+    Variant v(constructVariantFromTuple(valueId, values));
+    Variant vDecoded;
+    ByteArray_t buffer;
+
+    //-------------------------------------------
+    // ACTIONS
+    ASSERT_TRUE(serializer.serialize(v, buffer));
+    ASSERT_TRUE(serializer.deserialize(buffer.data(), buffer.size(), vDecoded));
+
+    //-------------------------------------------
+    // VALIDATION
+    EXPECT_EQ(vDecoded.getType(), v.getType());
+    EXPECT_EQ(vDecoded, v);
+    EXPECT_TRUE(isCorrectType(valueId, vDecoded, std::get<gIndexFuncTypeCheck>(allTypeValues)));
+    checkVariantValue(valueId, vDecoded, std::get<gIndexFuncValueCheck>(allTypeValues), values);
+    EXPECT_EQ(VariantView::parse(buffer.data(), buffer.size()).encodedSize() + 1, buffer.size());
+}
+
+TEST(variant, serialization_args) {
+    TEST_DESCRIPTION("event arguments should be encoded compactly and be accessible without copying");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    const VariantSerializer serializer;
+    VariantVector_t args;
+    VariantVector_t decodedArgs;
+    ByteArray_t buffer;
+
+    makeVariantList(args, 5, -3, "text", binary2, mapIntStr, std::make_pair(Variant(1), Variant(true)),
+                    VariantVector_t{Variant(VariantList_t{Variant(2.5)})}, Variant());
+
+    //-------------------------------------------
+    // ACTIONS
+    ASSERT_TRUE(serializer.serialize(args, buffer));
+    ASSERT_TRUE(serializer.deserialize(buffer.data(), buffer.size(), decodedArgs));
+
+    const VariantView view = VariantView::parse(buffer.data(), buffer.size());
+
+    //-------------------------------------------
+    // VALIDATION
+    EXPECT_EQ(decodedArgs, args);
+
+    ASSERT_TRUE(view.isValid());
+    ASSERT_EQ(view.getType(), Variant::Type::VECTOR);
+    ASSERT_EQ(view.count(), args.size());
+    ASSERT_EQ(static_cast<size_t>(std::distance(view.begin(), view.end())), args.size());
+    EXPECT_EQ(view.at(0).toInt64(), 5);
+    EXPECT_EQ(view.at(0).encodedSize(), 2);  // type + 1 byte varint
+    EXPECT_EQ(view.at(1).toInt64(), -3);
+    EXPECT_EQ(view.at(2).toString(), "text");
+    EXPECT_EQ(view.at(3).size(), binary2.size());
+    EXPECT_EQ(memcmp(view.at(3).data(), binary2.data(), binary2.size()), 0);
+    // data is not copied
+    EXPECT_GE(view.at(2).data(), buffer.data());
+    EXPECT_LT(view.at(2).data(), buffer.data() + buffer.size());
+    ASSERT_EQ(view.at(4).count(), mapIntStr.size());
+    EXPECT_EQ(view.at(4).key(1).toInt64(), 2);
+    EXPECT_EQ(view.at(4).value(1).toString(), "bb");
+    EXPECT_EQ(view.at(5).first().toInt64(), 1);
+    EXPECT_TRUE(view.at(5).second().toBool());
+    EXPECT_DOUBLE_EQ(view.at(6).at(0).at(0).toDouble(), 2.5);
+    EXPECT_EQ(view.at(7).getType(), Variant::Type::UNKNOWN);
+    EXPECT_TRUE(view.at(7).isValid());
+    EXPECT_FALSE(view.at(8).isValid());
+}
+
+TEST(variant, serialization_view_iteration) {
+    TEST_DESCRIPTION("items of encoded containers should be accessible with a forward iterator");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    const VariantSerializer serializer;
+    VariantVector_t args;
+    ByteArray_t buffer;
+    const VariantMap_t map = {{Variant(1), Variant("a")}, {Variant(2), Variant("bb")}};
+
+    for (int i = 0; i < 1000; ++i) {
+        args.emplace_back(i * 3);
+    }
+
+    args.emplace_back(map);
+    args.emplace_back(std::make_pair(Variant(1), Variant(true)));
+    ASSERT_TRUE(serializer.serialize(args, buffer));
+
+    const VariantView view = VariantView::parse(buffer.data(), buffer.size());
+
+    ASSERT_TRUE(view.isValid());
+
+    //-------------------------------------------
+    // ACTIONS
+    std::vector<VariantView> items;
+    VariantMap_t decodedMap;
+    std::vector<VariantView> pairItems;
+
+    for (const VariantView& item : view) {
+        items.push_back(item);
+    }
+
+    ASSERT_EQ(items.size(), args.size());
+
+    const VariantView& mapView = items[args.size() - 2U];
+
+    for (auto it = mapView.begin(); it != mapView.end(); ++it) {
+        const VariantView key = *it;
+
+        ++it;
+        ASSERT_NE(it, mapView.end());
+        decodedMap.emplace(Variant(static_cast<int>(key.toInt64())), Variant(it->toString()));
+    }
+
+    pairItems.assign(items.back().begin(), items.back().end());
+
+    //-------------------------------------------
+    // VALIDATION
+    for (int i = 0; i < 1000; ++i) {
+        EXPECT_EQ(items[i].toInt64(), i * 3);
+    }
+
+    EXPECT_EQ(items[999].data(), view.at(999).data());
+    EXPECT_EQ(items[999].encodedSize(), view.at(999).encodedSize());
+
+    EXPECT_EQ(decodedMap, map);
+    ASSERT_EQ(pairItems.size(), 2u);
+    EXPECT_EQ(pairItems[0].toInt64(), 1);
+    EXPECT_TRUE(pairItems[1].toBool());
+    // scalars and invalid views don't have items
+    EXPECT_EQ(items[0].begin(), items[0].end());
+    EXPECT_EQ(VariantView().begin(), VariantView().end());
+}
+
+TEST(variant, serialization_errors) {
+    TEST_DESCRIPTION("serializer should reject malformed data and values it can't encode");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    const VariantSerializer serializer;
+    VariantVector_t args;
+    Variant decoded(7);
+    ByteArray_t buffer;
+
+    makeVariantList(args, 500, "abc", listStr, mapIntStr);
+    ASSERT_TRUE(serializer.serialize(args, buffer));
+
+    //-------------------------------------------
+    // ACTIONS / VALIDATION
+    // truncated data
+    for (size_t i = 0; i < buffer.size(); ++i) {
+        EXPECT_FALSE(serializer.deserialize(buffer.data(), i, decoded)) << "size=" << i;
+        EXPECT_FALSE(VariantView::parse(buffer.data(), i).isValid()) << "size=" << i;
+    }
+
+    EXPECT_EQ(decoded, Variant(7));
+
+    // unsupported version
+    buffer[0] = VariantSerializer::FORMAT_VERSION + 1;
+    EXPECT_FALSE(serializer.deserialize(buffer.data(), buffer.size(), decoded));
+
+    // custom types require handlers
+    buffer.clear();
+    EXPECT_FALSE(serializer.serialize(Variant::make(customTypeValue), buffer));
+    EXPECT_TRUE(buffer.empty());
+
+    // nesting depth is limited
+    Variant nested(1);
+
+    for (unsigned int i = 0; i <= VariantSerializer::MAX_NESTING_DEPTH; ++i) {
+        nested = Variant(VariantVector_t{nested});
+    }
+
+    EXPECT_FALSE(serializer.serialize(nested, buffer));
+
+    // huge items count
+    const ByteArray_t hugeVector = {VariantSerializer::FORMAT_VERSION, static_cast<unsigned char>(Variant::Type::VECTOR),
+                                    0xFF, 0xFF, 0xFF, 0xFF, 0x0F};
+    EXPECT_FALSE(serializer.deserialize(hugeVector.data(), hugeVector.size(), args));
+}
+
+TEST(variant, customtype_tostring) {
+    TEST_DESCRIPTION("custom types with toString() method should be converted to string");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    struct PrintableType {
+        int value = 0;
+
+        std::string toString() const {
+            return "printable:" + std::to_string(value);
+        }
+
+        bool operator>(const PrintableType& val) const {
+            return (value > val.value);
+        }
+
+        bool operator==(const PrintableType& val) const {
+            return (value == val.value);
+        }
+    };
+    PrintableType printable;
+    const CustomType notPrintable("abc", 17);
+
+    printable.value = 5;
+
+    //-------------------------------------------
+    // ACTIONS
+    Variant v1 = Variant::make(printable);
+    Variant v2 = Variant::make(notPrintable);
+
+    //-------------------------------------------
+    // VALIDATION
+    EXPECT_EQ(v1.toString(), "printable:5");
+    EXPECT_EQ(v2.toString(), "");
+}
+
+TEST(variant, object_size) {
+    TEST_DESCRIPTION("variant should keep only a pointer to type specific operations");
+
+    //-------------------------------------------
+    // VALIDATION
+    // type + data pointer + operations table
+    EXPECT_LE(sizeof(Variant), sizeof(Variant::Type) + sizeof(std::shared_ptr<void>) + sizeof(void*) + sizeof(void*));
+}
+
+TEST(variant, rvalue_constructors) {
+    TEST_DESCRIPTION("strings and byte arrays passed as rvalues should be moved into variant");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    ByteArray_t bytes(1024, 0xAB);
+    std::string str(1024, 'x');
+    const unsigned char* bytesData = bytes.data();
+    const char* strData = str.data();
+
+    //-------------------------------------------
+    // ACTIONS
+    Variant v1(std::move(bytes));
+    Variant v2(std::move(str));
+
+    //-------------------------------------------
+    // VALIDATION
+    ASSERT_TRUE(v1.isByteArray());
+    ASSERT_TRUE(v2.isString());
+    EXPECT_EQ(v1.getByteArray()->data(), bytesData);
+    EXPECT_EQ(v2.getBufferView().data(), reinterpret_cast<const unsigned char*>(strData));
+    EXPECT_EQ(v1.getByteArray()->size(), 1024);
+    EXPECT_EQ(v2.toString(), std::string(1024, 'x'));
+}
+
+TEST(variant, bufferview_shared) {
+    TEST_DESCRIPTION("copies of a view variant should point to the same memory");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    ByteArray_t bytes(1024, 0xAB);
+    const unsigned char* bytesData = bytes.data();
+    std::weak_ptr<const void> owner;
+
+    {
+        //-------------------------------------------
+        // ACTIONS
+        Variant v1(BufferView::share(std::move(bytes)));
+        Variant v2 = v1;
+        VariantVector_t args = {v2};
+        const BufferView view = args[0].getBufferView();
+
+        //-------------------------------------------
+        // VALIDATION
+        ASSERT_TRUE(v1.isByteArrayView());
+        ASSERT_TRUE(args[0].isByteArrayView());
+        EXPECT_TRUE(view.hasOwner());
+        EXPECT_EQ(view.data(), bytesData);
+        EXPECT_EQ(view.size(), 1024);
+        EXPECT_EQ(v1, v2);
+        EXPECT_EQ(v1.hash(), v2.hash());
+        EXPECT_EQ(v2.toByteArray(), ByteArray_t(1024, 0xAB));
+
+        const unsigned char* releasedData = view.data();
+        v1.clear();
+        v2.clear();
+        args.clear();
+
+        // view keeps buffer alive
+        EXPECT_EQ(view.data(), releasedData);
+        EXPECT_EQ(view.toByteArray(), ByteArray_t(1024, 0xAB));
+    }
+}
+
+TEST(variant, bufferview_no_owner) {
+    TEST_DESCRIPTION("view without owner should reference external memory");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    static const char gStaticData[] = "static buffer";
+    const BufferView view(gStaticData, sizeof(gStaticData) - 1U);
+
+    //-------------------------------------------
+    // ACTIONS
+    Variant v1(view);
+    Variant v2 = Variant::makeStringView(view);
+    Variant v3(BufferView(gStaticData, 6));
+
+    //-------------------------------------------
+    // VALIDATION
+    EXPECT_FALSE(view.hasOwner());
+    EXPECT_TRUE(v1.isByteArrayView());
+    EXPECT_TRUE(v2.isStringView());
+    EXPECT_EQ(v1.getBufferView().data(), reinterpret_cast<const unsigned char*>(gStaticData));
+    EXPECT_EQ(v2.toString(), "static buffer");
+    EXPECT_EQ(v3.toString(), "static");
+    EXPECT_NE(v1, v3);
+    EXPECT_GT(v1, v3);
+}
+
+TEST(variant, bufferview_subview) {
+    TEST_DESCRIPTION("subView should reference part of the original buffer and share its owner");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    const BufferView view = BufferView::share(std::string("header:payload"));
+
+    //-------------------------------------------
+    // ACTIONS
+    const BufferView payload = view.subView(7, 100);
+    const BufferView header = view.subView(0, 6);
+    const BufferView outside = view.subView(100, 1);
+
+    //-------------------------------------------
+    // VALIDATION
+    EXPECT_TRUE(payload.hasOwner());
+    EXPECT_EQ(payload.toString(), "payload");
+    EXPECT_EQ(header.toString(), "header");
+    EXPECT_EQ(payload.data(), view.data() + 7);
+    EXPECT_TRUE(outside.empty());
+    EXPECT_FALSE(outside.hasOwner());
+}
+
+TEST(variant, bufferview_from_variant) {
+    TEST_DESCRIPTION("getBufferView() should reference memory of string and byte array variants");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    Variant str("12345");
+    Variant bytes(ByteArray_t{1, 2, 3});
+    Variant number(5);
+
+    //-------------------------------------------
+    // ACTIONS
+    const BufferView strView = str.getBufferView();
+    const BufferView strView2 = str.getBufferView();
+    const BufferView bytesView = bytes.getBufferView();
+    Variant strViewVariant = Variant::makeStringView(strView);
+
+    //-------------------------------------------
+    // VALIDATION
+    EXPECT_EQ(strView.data(), strView2.data());
+    EXPECT_EQ(strView.toString(), "12345");
+    EXPECT_EQ(bytesView.data(), bytes.getByteArray()->data());
+    EXPECT_TRUE(number.getBufferView().empty());
+    EXPECT_EQ(strViewVariant.toInt64(), 12345);
+    EXPECT_EQ(strViewVariant.toDouble(), 12345.0);
+    EXPECT_TRUE(strViewVariant.toBool());
+    EXPECT_EQ(strViewVariant.toString(), str.toString());
+
+    // views still work after original variant is released
+    str.clear();
+    EXPECT_EQ(strViewVariant.toString(), "12345");
+}
+
+TEST(variant, bufferview_serialization) {
+    TEST_DESCRIPTION("views should be serialized as regular strings and byte arrays");
+
+    //-------------------------------------------
+    // PRECONDITIONS
+    const VariantSerializer serializer;
+    const VariantVector_t args = {Variant(BufferView::share(ByteArray_t{1, 2, 3})),
+                                  Variant::makeStringView(BufferView::share(std::string("text")))};
+    ByteArray_t buffer;
+    VariantVector_t decodedArgs;
+
+    //-------------------------------------------
+    // ACTIONS
+    ASSERT_TRUE(serializer.serialize(args, buffer));
+    ASSERT_TRUE(serializer.deserialize(buffer.data(), buffer.size(), decodedArgs));
+
+    //-------------------------------------------
+    // VALIDATION
+    ASSERT_EQ(decodedArgs.size(), 2);
+    EXPECT_TRUE(decodedArgs[0].isByteArray());
+    EXPECT_EQ(decodedArgs[0].toByteArray(), ByteArray_t({1, 2, 3}));
+    EXPECT_TRUE(decodedArgs[1].isString());
+    EXPECT_EQ(decodedArgs[1].toString(), "text");
+}